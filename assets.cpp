@@ -0,0 +1,200 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include "assets.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+
+/*
+* Checks whether this executable was built with cooked models in it.
+* Returns true if it was, and false if models get read from resources/.
+*/
+bool assetsEmbedded()
+{
+	for (int i = 0; i < COOKED_MODELS; i++)
+	{
+		if (cookedMeshes[i] != NULL)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/*
+* Looks for a model among the ones that were cooked into the executable.
+* Returns the cooked mesh, or NULL if it wasn't cooked (or nothing was).
+*/
+const CookedMesh *findCookedMesh(const string &objFile)
+{
+	for (int i = 0; i < COOKED_MODELS; i++)
+	{
+		if (objFile == cookedModelFiles[i])
+		{
+			return cookedMeshes[i];
+		}
+	}
+	return NULL;
+}
+
+
+/*
+* Looks up how big a file is and when it was last changed, in nanoseconds where the system keeps track of them (an edit that doesn't change the size is easy to make within a second of the last one).
+* Returns true if the file is there.
+*/
+bool fileStamp(const string &fileName, long long *size, long long *time)
+{
+	struct stat info;
+	if (stat(fileName.c_str(), &info) != 0)
+	{
+		return false;
+	}
+	*size = (long long)info.st_size;
+#if defined(__MINGW64__)
+	*time = (long long)info.st_mtime * 1000000000LL;
+#elif defined(__APPLE__)
+	*time = (long long)info.st_mtimespec.tv_sec * 1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+	*time = (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+
+/*
+* Looks up how big a model's .obj file is and when it was last changed, which is what tells a cooked model whether it's still right.
+* Returns true if the file is there.
+*/
+bool modelFileStamp(const string &objFile, long long *size, long long *time)
+{
+	return fileStamp("resources" + pathSeparator + "models" + pathSeparator + objFile, size, time);
+}
+
+
+/*
+* Checks whether a model was changed too close to when its cooked file was written to tell a later edit that doesn't change the size apart by its stamp. Where the file system only keeps whole seconds (both stamps land exactly on one), that's anything in the same second or later. Otherwise it's only a model that looks no older than its cooked file, so a model cooked straight after it was saved is trusted.
+* Returns true if the stamp can't be trusted, and the model needs checking properly.
+*/
+bool stampTooRecent(long long sourceTime, long long cookedTime)
+{
+	if (sourceTime % 1000000000LL == 0 && cookedTime % 1000000000LL == 0)
+	{
+		return sourceTime / 1000000000LL >= cookedTime / 1000000000LL;
+	}
+	return sourceTime >= cookedTime;
+}
+
+
+/*
+* Works out where drive_cook --cache puts a model.
+* Returns the file name.
+*/
+string cookedMeshFileName(const string &objFile)
+{
+	return "resources" + pathSeparator + "cooked" + pathSeparator + objFile + ".mesh";
+}
+
+
+/*
+* Reads a model that drive_cook --cache cooked into resources/cooked, as long as the model hasn't been changed since (if the .obj isn't there at all, the cooked one is all there is, so that's fine too).
+* Returns true if the mesh was filled in, or false if it needs reading from its .obj.
+*/
+bool loadCookedMeshFile(const string &objFile, Mesh *mesh)
+{
+	FILE *file = fopen(cookedMeshFileName(objFile).c_str(), "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	CookedMeshFileHeader header;
+	bool good = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "MESH", 4) == 0 && header.version == cookedMeshFileVersion;
+	good = good && header.vertexCount > 0 && header.vertexCount <= 65536 && header.indexCount > 0 && header.indexCount % 3 == 0;
+
+	//We can't check the contents without reading the model anyway, so one that might have been changed again just after it was cooked gets read too (drive_cook --cache sorts it out next time it's run)
+	long long size;
+	long long time;
+	long long cookedSize;
+	long long cookedTime;
+	if (good && modelFileStamp(objFile, &size, &time))
+	{
+		if (size != header.sourceSize || time != header.sourceTime)
+		{
+			if (meshLogging)
+			{
+				printf("  Cooked %s is out of date, so reading the model instead\n", objFile.c_str());
+			}
+			good = false;
+		}
+		else if (fileStamp(cookedMeshFileName(objFile), &cookedSize, &cookedTime) && stampTooRecent(time, cookedTime))
+		{
+			if (meshLogging)
+			{
+				printf("  Cooked %s might be out of date, so reading the model instead\n", objFile.c_str());
+			}
+			good = false;
+		}
+	}
+
+	if (good)
+	{
+		mesh->vertices.resize(header.vertexCount);
+		mesh->indices.resize(header.indexCount);
+		good = fread(&mesh->vertices[0], sizeof(PackedVertex), header.vertexCount, file) == (size_t)header.vertexCount;
+		good = good && fread(&mesh->indices[0], sizeof(GLushort), header.indexCount, file) == (size_t)header.indexCount;
+		for (int i = 0; i < header.indexCount && good; i++)
+		{
+			good = mesh->indices[i] < header.vertexCount;
+		}
+	}
+	fclose(file);
+
+	if (!good)
+	{
+		mesh->vertices.clear();
+		mesh->indices.clear();
+		return false;
+	}
+
+	for (int a = 0; a < 3; a++)
+	{
+		mesh->quantCentre[a] = header.quantCentre[a];
+		mesh->quantScale[a] = header.quantScale[a];
+	}
+	mesh->boundX = header.bound[0];
+	mesh->boundY = header.bound[1];
+	mesh->boundZ = header.bound[2];
+	mesh->boundRadius = header.bound[3];
+	return true;
+}
+
+
+/*
+* Opens one of the files under resources/ for SDL (or SDL_ttf or SDL_mixer) to read, straight out of the executable if it was cooked in.
+* Returns the SDL_RWops, or NULL if the file couldn't be opened (SDL_GetError() says why).
+*/
+SDL_RWops *openAsset(const string &directory, const string &file)
+{
+	for (int i = 0; i < COOKED_FILES; i++)
+	{
+		if (cookedFiles[i] != NULL && directory == cookedFileDirectories[i] && file == cookedFileNames[i])
+		{
+			return SDL_RWFromConstMem(cookedFiles[i]->data, cookedFiles[i]->size);
+		}
+	}
+
+	return SDL_RWFromFile(("resources" + pathSeparator + directory + pathSeparator + file).c_str(), "rb");
+}
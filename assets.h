@@ -0,0 +1,97 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <SDL2/SDL.h>
+#include <string>
+
+#include "mesh.h"
+
+//The models that the cooker (cook.cpp) can build into the executable. The cooked mesh table is in this order, so these index straight into it
+enum CookedModel
+{
+	COOKED_GROUND,
+	COOKED_BUILDINGS,
+	COOKED_HILL,
+	COOKED_TREE,
+	COOKED_BLADDER,
+	COOKED_CHASIS,
+	COOKED_FANS,
+	COOKED_MODELS
+};
+
+constexpr const char *cookedModelFiles[COOKED_MODELS] = {"ground.obj", "buildings.obj", "hill.obj", "tree.obj", "bladder.obj", "chasis.obj", "fans.obj"};
+
+//The other files the cooker can build in (if it's asked to), as they are on disk
+enum CookedFile
+{
+	COOKED_FONT,
+	COOKED_HOVER_SOUND,
+	COOKED_FAN_SOUND,
+	COOKED_MUSIC,
+	COOKED_FILES
+};
+
+//Which directory under resources/ each one is in, and its name
+constexpr const char *cookedFileDirectories[COOKED_FILES] = {"fonts", "sounds", "sounds", "sounds"};
+constexpr const char *cookedFileNames[COOKED_FILES] = {"SciFly-Sans.ttf", "hovercraft.ogg", "fan.ogg", "Funk_Game_Loop.ogg"};
+
+//A model exactly as loadMesh() would leave it, packed and optimised
+struct CookedMesh
+{
+	const PackedVertex *vertices;
+	int vertexCount;
+	const GLushort *indices;
+	int indexCount;
+	float quantCentre[3];
+	float quantScale[3];
+	float bound[4];
+};
+
+//A file's contents, untouched
+struct CookedData
+{
+	const unsigned char *data;
+	size_t size;
+};
+
+//Models can also be cooked ahead of time into resources/cooked by drive_cook --cache, one file each (the model's name with .mesh on the end), which can be changed without building the game again
+//Each file starts with this, followed by the vertices and then the indices. The model's size and modification time (in nanoseconds) are kept from when it was cooked, so that a model that's been changed since then gets read from its .obj instead
+const int cookedMeshFileVersion = 2;
+struct CookedMeshFileHeader
+{
+	char magic[4];
+	int version;
+	long long sourceSize;
+	long long sourceTime;
+	int vertexCount;
+	int indexCount;
+	float quantCentre[3];
+	float quantScale[3];
+	float bound[4];
+};
+
+//The cooked tables. Built with cooked assets these come from the file the cooker writes, and otherwise from nocooked.cpp, which leaves everything out
+extern const CookedMesh *const cookedMeshes[COOKED_MODELS];
+extern const CookedData *const cookedFiles[COOKED_FILES];
+
+bool assetsEmbedded();
+const CookedMesh *findCookedMesh(const std::string &objFile);
+bool fileStamp(const std::string &fileName, long long *size, long long *time);
+bool modelFileStamp(const std::string &objFile, long long *size, long long *time);
+bool stampTooRecent(long long sourceTime, long long cookedTime);
+std::string cookedMeshFileName(const std::string &objFile);
+bool loadCookedMeshFile(const std::string &objFile, Mesh *mesh);
+SDL_RWops *openAsset(const std::string &directory, const std::string &file);
+
+#endif
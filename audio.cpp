@@ -0,0 +1,277 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include "audio.h"
+#include <stdio.h>
+#include <atomic>
+
+using namespace std;
+
+//The buffer size that init() will open the audio device with (--low-latency-audio and --audio-buffer change this)
+int audioBufferSize = audioBufferNormal;
+
+//Parameters handed from the simulation to the audio thread
+//These are only ever touched through atomics, so neither side ever has to wait for the other
+static atomic<float> fanGainTarget(0.0f);
+static atomic<Uint64> fanGainControlTime(0);
+static atomic<Uint32> fanGainSerial(0);
+
+//Only touched by whichever thread is running updateSound(): the time of a throttle input that hasn't shown up as a fan volume change yet, and the last gain we handed over
+static Uint64 pendingControlTime = 0;
+static float postedFanGain = -1.0f;
+
+//Audio thread only: where the fan volume ramp is up to, which update we last saw and when the device will run out of audio
+static float fanGainCurrent = 0.0f;
+static Uint32 fanGainSeenSerial = 0;
+static Uint64 audioPlayedUntil = 0;
+
+//Statistics written by the audio thread and read by the game
+static atomic<Uint32> statCallbacks(0);
+static atomic<Uint32> statUnderruns(0);
+static atomic<Uint32> statLatencySamples(0);
+static atomic<Uint64> statLatencyTotal(0);
+static atomic<Uint64> statLatencyMax(0);
+static atomic<Uint64> statLatencyLast(0);
+
+//Details of the device we ended up with
+static int mixFrequency = 0;
+static int mixChannelCount = 0;
+static Uint16 mixFormat = 0;
+static Uint64 bufferTicks = 0;
+static int fanEffectChannel = -1;
+
+
+/*
+* Converts a performance counter duration to milliseconds.
+* Returns the duration in milliseconds.
+*/
+static float ticksToMs(Uint64 ticks)
+{
+	return (float)((double)ticks * 1000.0 / (double)SDL_GetPerformanceFrequency());
+}
+
+
+/*
+* Channel effect that applies the fan volume to the fan sound as it's being mixed. This runs on the audio thread, so it must not allocate, lock or print.
+* Returns nothing.
+*/
+static void fanGainEffect(int chan, void *stream, int len, void *udata)
+{
+	//Pick up the latest gain from the simulation
+	Uint32 serial = fanGainSerial.load(memory_order_acquire);
+	float target = fanGainTarget.load(memory_order_relaxed);
+
+	//If this is the first buffer to carry a new gain, work out how long it's been since the input that caused it
+	//The samples we're writing now will be heard once the buffer ahead of us has played out, so we add one buffer's worth of time on top
+	if (serial != fanGainSeenSerial)
+	{
+		fanGainSeenSerial = serial;
+		Uint64 controlTime = fanGainControlTime.load(memory_order_relaxed);
+		if (controlTime != 0)
+		{
+			Uint64 latency = SDL_GetPerformanceCounter() - controlTime + bufferTicks;
+			statLatencyLast.store(latency, memory_order_relaxed);
+			statLatencyTotal.fetch_add(latency, memory_order_relaxed);
+			if (latency > statLatencyMax.load(memory_order_relaxed))
+			{
+				statLatencyMax.store(latency, memory_order_relaxed);
+			}
+			statLatencySamples.fetch_add(1, memory_order_relaxed);
+		}
+	}
+
+	//Ramp from the previous gain to the new one across the buffer so that big changes don't click
+	Sint16 *samples = (Sint16 *)stream;
+	int frames = len / (int)(sizeof(Sint16) * mixChannelCount);
+	if (frames <= 0)
+	{
+		return;
+	}
+	float gain = fanGainCurrent;
+	float step = (target - fanGainCurrent) / frames;
+	for (int i = 0; i < frames; i++)
+	{
+		gain += step;
+		for (int c = 0; c < mixChannelCount; c++)
+		{
+			int s = (int)(samples[i * mixChannelCount + c] * gain);
+			if (s > 32767)
+			{
+				s = 32767;
+			}
+			else if (s < -32768)
+			{
+				s = -32768;
+			}
+			samples[i * mixChannelCount + c] = (Sint16)s;
+		}
+	}
+	fanGainCurrent = target;
+}
+
+
+/*
+* Post mix callback that keeps track of how regularly the mixer is being asked for audio. This runs on the audio thread, so it must not allocate, lock or print.
+* Returns nothing.
+*/
+static void audioPostMix(void *udata, Uint8 *stream, int len)
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+	statCallbacks.fetch_add(1, memory_order_relaxed);
+
+	//If we've come back for more audio well after the device would have finished playing everything we'd given it, it will have gone silent in between
+	//We allow half a buffer of slack since callbacks never arrive exactly on time
+	if (audioPlayedUntil != 0 && now > audioPlayedUntil + bufferTicks / 2)
+	{
+		statUnderruns.fetch_add(1, memory_order_relaxed);
+	}
+
+	//The device can't be more than a couple of buffers ahead of us, so don't let early callbacks push our estimate out forever
+	if (audioPlayedUntil < now)
+	{
+		audioPlayedUntil = now;
+	}
+	audioPlayedUntil += bufferTicks;
+	if (audioPlayedUntil > now + bufferTicks * 2)
+	{
+		audioPlayedUntil = now + bufferTicks * 2;
+	}
+}
+
+
+/*
+* Hooks our mixing callbacks into SDL_mixer once the audio device is open and the fan sound is playing on the given channel.
+* Returns true if the fan volume will be applied by our callback, or false if the caller should keep using Mix_VolumeChunk.
+*/
+bool initAudioMixing(int fanChannel)
+{
+	//Find out what the device actually gave us
+	if (Mix_QuerySpec(&mixFrequency, &mixFormat, &mixChannelCount) == 0)
+	{
+		printf("Error whilst querying audio device: %s\n", Mix_GetError());
+		return false;
+	}
+	bufferTicks = (Uint64)audioBufferSize * SDL_GetPerformanceFrequency() / mixFrequency;
+	printf("Audio: %dHz, %d channels, %d frame buffer (%.1fms)\n", mixFrequency, mixChannelCount, audioBufferSize, ticksToMs(bufferTicks));
+
+	//Keep an eye on callback timing regardless of whether we can do the fan volume ourselves
+	Mix_SetPostMix(audioPostMix, NULL);
+
+	//Our gain ramp only knows about 16 bit samples, which is what MIX_DEFAULT_FORMAT gives us on every platform we care about
+	if (fanChannel == -1 || mixFormat != AUDIO_S16SYS)
+	{
+		printf("Audio: fan volume will be set per chunk (format 0x%x)\n", mixFormat);
+		return false;
+	}
+
+	if (Mix_RegisterEffect(fanChannel, fanGainEffect, NULL, NULL) == 0)
+	{
+		printf("Error whilst registering fan volume effect: %s\n", Mix_GetError());
+		return false;
+	}
+	fanEffectChannel = fanChannel;
+
+	return true;
+}
+
+
+/*
+* Notes that the player has just changed the throttle so that we can measure how long it takes to be heard.
+* Returns nothing.
+*/
+void audioMarkControlInput()
+{
+	//Keep the earliest input if several arrive before the sound changes
+	if (pendingControlTime == 0)
+	{
+		pendingControlTime = SDL_GetPerformanceCounter();
+	}
+}
+
+
+/*
+* Hands a new fan volume (0 to 1) over to the audio thread.
+* Returns nothing.
+*/
+void audioSetFanGain(float gain)
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+
+	//An input that hasn't changed the volume within a tenth of a second (e.g. accelerating at top speed) isn't going to, so stop waiting on it
+	if (pendingControlTime != 0 && now - pendingControlTime > SDL_GetPerformanceFrequency() / 10)
+	{
+		pendingControlTime = 0;
+	}
+
+	//Nothing to do if the volume hasn't changed
+	if (gain == postedFanGain)
+	{
+		return;
+	}
+	postedFanGain = gain;
+
+	//Publish the gain and the input it came from, then bump the serial so that the audio thread knows to look
+	fanGainTarget.store(gain, memory_order_relaxed);
+	fanGainControlTime.store(pendingControlTime, memory_order_relaxed);
+	fanGainSerial.fetch_add(1, memory_order_release);
+	pendingControlTime = 0;
+}
+
+
+/*
+* Collects the audio thread's statistics into something a bit more readable.
+* Returns an AudioStats.
+*/
+AudioStats getAudioStats()
+{
+	AudioStats stats;
+	stats.callbacks = statCallbacks.load(memory_order_relaxed);
+	stats.underruns = statUnderruns.load(memory_order_relaxed);
+	stats.latencySamples = statLatencySamples.load(memory_order_relaxed);
+	stats.latencyAverageMs = 0;
+	if (stats.latencySamples > 0)
+	{
+		stats.latencyAverageMs = ticksToMs(statLatencyTotal.load(memory_order_relaxed)) / stats.latencySamples;
+	}
+	stats.latencyMaxMs = ticksToMs(statLatencyMax.load(memory_order_relaxed));
+	stats.latencyLastMs = ticksToMs(statLatencyLast.load(memory_order_relaxed));
+	stats.bufferMs = ticksToMs(bufferTicks);
+	return stats;
+}
+
+
+/*
+* Prints the audio statistics to the console.
+* Returns nothing.
+*/
+void printAudioStats()
+{
+	AudioStats stats = getAudioStats();
+	printf("Audio: %u callbacks, %u underruns, %.1fms buffer\n", stats.callbacks, stats.underruns, stats.bufferMs);
+	printf("Audio: control to audio latency over %u changes: average %.1fms, max %.1fms, last %.1fms\n", stats.latencySamples, stats.latencyAverageMs, stats.latencyMaxMs, stats.latencyLastMs);
+}
+
+
+/*
+* Unhooks our mixing callbacks and reports how they went.
+* Returns nothing.
+*/
+void closeAudioMixing()
+{
+	if (fanEffectChannel != -1)
+	{
+		Mix_UnregisterAllEffects(fanEffectChannel);
+		fanEffectChannel = -1;
+	}
+	Mix_SetPostMix(NULL, NULL);
+
+	printAudioStats();
+}
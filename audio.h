@@ -0,0 +1,52 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+
+//The number of sample frames SDL_mixer will buffer in normal and low-latency mode
+//At 44.1kHz, 2048 frames is about 46ms and 256 frames is about 6ms
+const int audioBufferNormal = 2048;
+const int audioBufferLowLatency = 256;
+
+//The buffer size that init() will open the audio device with
+extern int audioBufferSize;
+
+//Numbers collected by the mixing callbacks so that we can tell how well the audio thread is keeping up
+struct AudioStats
+{
+	//How many times the mixer has asked us for audio
+	Uint32 callbacks;
+
+	//How many times the mixer came back for more audio later than the device could have played out the last buffer (SDL doesn't tell us about underruns directly, so this is our best guess)
+	Uint32 underruns;
+
+	//Time from a throttle/steering input to the first buffer that carries the resulting fan volume change, plus the time that buffer takes to play out
+	Uint32 latencySamples;
+	float latencyAverageMs;
+	float latencyMaxMs;
+	float latencyLastMs;
+
+	//The length of one mixing buffer
+	float bufferMs;
+};
+
+bool initAudioMixing(int fanChannel);
+void audioMarkControlInput();
+void audioSetFanGain(float gain);
+AudioStats getAudioStats();
+void printAudioStats();
+void closeAudioMixing();
+
+#endif
@@ -0,0 +1,543 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include "bench.h"
+#include "jobs.h"
+#include "mesh.h"
+#include "memory.h"
+#include "occlusion.h"
+#include "stress.h"
+#include "impostor.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <list>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//An object in our synthetic scene, laid out much like a GameObject's position and bounds
+struct BenchObject
+{
+	float x;
+	float y;
+	float rz;
+	float radius;
+
+	//Filled in by the frame stages
+	float world[16];
+	bool visible;
+	int lod;
+};
+
+//Everything the frame stages need to get at
+struct BenchScene
+{
+	vector<BenchObject> objects;
+	float planes[6][4];
+	float cameraX;
+	float cameraY;
+	float soundLevels[64];
+};
+
+
+/*
+* Transform stage: builds each object's world matrix from its position and rotation, the same way renderObject() does with glTranslatef and glRotatef.
+* Returns nothing.
+*/
+static void benchTransforms(void *data, int begin, int end)
+{
+	BenchScene *scene = (BenchScene *)data;
+	for (int i = begin; i < end; i++)
+	{
+		BenchObject *o = &scene->objects[i];
+		float c = cos(o->rz * (float)M_PI / 180);
+		float s = sin(o->rz * (float)M_PI / 180);
+		float *m = o->world;
+		m[0] = c;	m[4] = 0;	m[8] = s;	m[12] = o->x;
+		m[1] = 0;	m[5] = 1;	m[9] = 0;	m[13] = 0;
+		m[2] = -s;	m[6] = 0;	m[10] = c;	m[14] = o->y;
+		m[3] = 0;	m[7] = 0;	m[11] = 0;	m[15] = 1;
+	}
+}
+
+
+/*
+* Culling and LOD stage: tests each object's bounding sphere against the view frustum, and picks a level of detail from its distance to the camera.
+* Returns nothing.
+*/
+static void benchCullAndLod(void *data, int begin, int end)
+{
+	BenchScene *scene = (BenchScene *)data;
+	for (int i = begin; i < end; i++)
+	{
+		BenchObject *o = &scene->objects[i];
+		float cx = o->world[12];
+		float cy = o->world[13];
+		float cz = o->world[14];
+
+		o->visible = true;
+		for (int p = 0; p < 6; p++)
+		{
+			const float *plane = scene->planes[p];
+			if (plane[0] * cx + plane[1] * cy + plane[2] * cz + plane[3] < -o->radius)
+			{
+				o->visible = false;
+				break;
+			}
+		}
+
+		float dx = cx - scene->cameraX;
+		float dz = cz - scene->cameraY;
+		float distance = sqrt(dx * dx + dz * dz);
+		o->lod = (distance < 100) ? 0 : (distance < 400) ? 1 : 2;
+	}
+}
+
+
+/*
+* Stage wrappers so that the parallel loops can sit in a job graph.
+* Returns nothing.
+*/
+static void benchTransformStage(void *data)
+{
+	BenchScene *scene = (BenchScene *)data;
+	jobsParallelFor((int)scene->objects.size(), 1024, benchTransforms, data);
+}
+
+static void benchCullStage(void *data)
+{
+	BenchScene *scene = (BenchScene *)data;
+	jobsParallelFor((int)scene->objects.size(), 1024, benchCullAndLod, data);
+}
+
+
+/*
+* Audio stage: stands in for working out positional audio parameters, which doesn't depend on the scene stages at all.
+* Returns nothing.
+*/
+static void benchAudioStage(void *data)
+{
+	BenchScene *scene = (BenchScene *)data;
+	for (int i = 0; i < 64; i++)
+	{
+		float dx = scene->cameraX - i;
+		float dz = scene->cameraY + i;
+		scene->soundLevels[i] = atan2(dx, dz) + sqrt(dx * dx + dz * dz);
+	}
+}
+
+
+/*
+* Runs our frame stages over a big synthetic scene with 1 to maxThreads threads, and prints how long a frame takes and how that scales.
+* Returns nothing.
+*/
+void runJobBenchmark(int maxThreads, int objectCount)
+{
+	if (maxThreads <= 0)
+	{
+		maxThreads = thread::hardware_concurrency();
+		if (maxThreads <= 0)
+		{
+			maxThreads = 1;
+		}
+	}
+
+	//Scatter objects over a big square, always from the same seed so that every run sees the same scene
+	BenchScene scene;
+	srand(1234);
+	scene.objects.resize(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		BenchObject *o = &scene.objects[i];
+		o->x = (rand() / (float)RAND_MAX - 0.5f) * 2000;
+		o->y = (rand() / (float)RAND_MAX - 0.5f) * 2000;
+		o->rz = rand() / (float)RAND_MAX * 360;
+		o->radius = 1 + rand() / (float)RAND_MAX * 10;
+	}
+
+	//A camera at the origin looking down -Z with a 90 degree field of view, which is close enough to the game's
+	float frustum[6][4] = {
+		{ 0.7071f, 0, -0.7071f, 0},
+		{-0.7071f, 0, -0.7071f, 0},
+		{0,  0.7071f, -0.7071f, 0},
+		{0, -0.7071f, -0.7071f, 0},
+		{0, 0, -1, -0.2f},
+		{0, 0, 1, 2000}
+	};
+	for (int p = 0; p < 6; p++)
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			scene.planes[p][k] = frustum[p][k];
+		}
+	}
+	scene.cameraX = 0;
+	scene.cameraY = 0;
+
+	printf("Job system benchmark: %d objects, 1 to %d threads\n", objectCount, maxThreads);
+	printf("threads\tms/frame\tspeedup\tvisible\n");
+
+	double baseline = 0;
+	int warmupFrames = 5;
+	int frames = 50;
+
+	for (int threads = 1; threads <= maxThreads; threads++)
+	{
+		jobsInit(threads);
+
+		//Transforms have to finish before culling can start, but audio can go alongside either of them
+		JobGraph graph;
+		int transformStage = jobGraphAdd(&graph, "transforms", benchTransformStage, &scene);
+		int cullStage = jobGraphAdd(&graph, "cull", benchCullStage, &scene);
+		jobGraphAdd(&graph, "audio", benchAudioStage, &scene);
+		jobGraphDepends(&graph, cullStage, transformStage);
+
+		for (int i = 0; i < warmupFrames; i++)
+		{
+			jobGraphRun(&graph);
+		}
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int i = 0; i < frames; i++)
+		{
+			//Turn the camera a little each frame so that the visible set changes
+			scene.planes[0][0] = 0.7071f * cos(i * 0.01f);
+			jobGraphRun(&graph);
+		}
+		double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / frames;
+
+		if (threads == 1)
+		{
+			baseline = ms;
+		}
+
+		int visible = 0;
+		for (int i = 0; i < objectCount; i++)
+		{
+			if (scene.objects[i].visible)
+			{
+				visible++;
+			}
+		}
+
+		printf("%d\t%.3f\t\t%.2fx\t%d\n", threads, ms, baseline / ms, visible);
+
+		jobsShutdown();
+	}
+}
+
+
+/*
+* Builds a camera matrix the same way gluPerspective() and rotateCamera() would, for a camera at x, y (at eye height) turned heading degrees from looking down -Z.
+* Returns nothing.
+*/
+static void benchCameraMatrix(float x, float y, float heading, float out[16])
+{
+	//The same projection that initGL() sets up
+	float aspect = 1300.0f / 716.0f;
+	float nearPlane = 0.2f;
+	float farPlane = 2000;
+	float f = 1 / tan(75 * (float)M_PI / 360);
+	float projection[16] = {
+		f / aspect, 0, 0, 0,
+		0, f, 0, 0,
+		0, 0, (farPlane + nearPlane) / (nearPlane - farPlane), -1,
+		0, 0, 2 * farPlane * nearPlane / (nearPlane - farPlane), 0
+	};
+
+	//Turn the world around the camera, then move it so that the camera is at the origin
+	float c = cos(heading * (float)M_PI / 180);
+	float s = sin(heading * (float)M_PI / 180);
+	float view[16] = {
+		c, 0, s, 0,
+		0, 1, 0, 0,
+		-s, 0, c, 0,
+		-(c * x - s * y), 0, -(s * x + c * y), 1
+	};
+
+	for (int col = 0; col < 4; col++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			out[col * 4 + row] = 0;
+			for (int k = 0; k < 4; k++)
+			{
+				out[col * 4 + row] += projection[k * 4 + row] * view[col * 4 + k];
+			}
+		}
+	}
+}
+
+
+/*
+* Frustum culls a list of objects against a camera matrix, the same way cullScenery() does.
+* Returns nothing.
+*/
+static void benchFrustumCull(vector<GameObject*> &objects, const float clip[16])
+{
+	float planes[6][4];
+	for (int p = 0; p < 6; p++)
+	{
+		int row = p / 2;
+		float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+		for (int col = 0; col < 4; col++)
+		{
+			planes[p][col] = clip[col * 4 + 3] + sign * clip[col * 4 + row];
+		}
+		float length = sqrt(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+		for (int col = 0; col < 4; col++)
+		{
+			planes[p][col] /= length;
+		}
+	}
+
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		GameObject *o = objects[i];
+		float c = cos((M_PI * o->rz) / 180);
+		float s = sin((M_PI * o->rz) / 180);
+		float x = o->x + o->mesh->boundX * c + o->mesh->boundZ * s;
+		float y = o->mesh->boundY;
+		float z = o->y - o->mesh->boundX * s + o->mesh->boundZ * c;
+
+		o->visible = true;
+		for (int p = 0; p < 6; p++)
+		{
+			if (planes[p][0] * x + planes[p][1] * y + planes[p][2] * z + planes[p][3] < -o->mesh->boundRadius)
+			{
+				o->visible = false;
+				break;
+			}
+		}
+	}
+}
+
+
+/*
+* Builds a dense city out of our building and tree models, looks around it from street level, and prints how much occlusion culling hides and what it costs.
+* We can't time the GPU without a window, so the saving is given as the draw calls and triangles that don't get submitted.
+* Returns nothing.
+*/
+void runOcclusionBenchmark(int threads)
+{
+	if (threads <= 0)
+	{
+		threads = thread::hardware_concurrency();
+		if (threads <= 0)
+		{
+			threads = 1;
+		}
+	}
+	jobsInit(threads);
+	initFrameArena();
+
+	//Blocks of buildings (each buildings.obj is a cluster about 150 by 330) with streets between them, and trees everywhere else
+	list<GameObject> city;
+	SDL_Colour grey = {128, 128, 128, 255};
+	SDL_Colour green = {60, 140, 60, 255};
+	srand(1234);
+	for (int bx = -4; bx < 4; bx++)
+	{
+		for (int by = -4; by < 4; by++)
+		{
+			city.push_back(loadObj("buildings.obj", grey, bx * 200 + 200, by * 400 - 20, 0));
+		}
+	}
+	for (int i = 0; i < 4000; i++)
+	{
+		float x = (rand() / (float)RAND_MAX - 0.5f) * 1600;
+		float y = (rand() / (float)RAND_MAX - 0.5f) * 3200;
+		city.push_back(loadObj("tree.obj", green, x, y, rand() / (float)RAND_MAX * 360));
+	}
+
+	vector<GameObject*> objects;
+	for (list<GameObject>::iterator x = city.begin(); x != city.end(); ++x)
+	{
+		objects.push_back(&(*x));
+	}
+
+	printf("Occlusion culling benchmark: %d objects, %d threads, %dx%d depth buffer, %.1fms budget\n", (int)objects.size(), threads, occlusionWidth, occlusionHeight, occlusionBudget);
+	printf("heading\tin view\tculled\ttriangles\tafter\tms\n");
+
+	int frames = 20;
+	int totalInView = 0;
+	int totalCulled = 0;
+	long totalTriangles = 0;
+	long totalAfter = 0;
+	double totalMs = 0;
+
+	//Stand in a street in the middle of the city and turn around
+	for (int heading = 0; heading < 360; heading += 45)
+	{
+		float clip[16];
+		benchCameraMatrix(100, 200, (float)heading, clip);
+
+		int inView = 0;
+		int visible = 0;
+		long triangles = 0;
+		long after = 0;
+		double ms = 0;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			benchFrustumCull(objects, clip);
+
+			inView = 0;
+			triangles = 0;
+			for (size_t i = 0; i < objects.size(); i++)
+			{
+				if (objects[i]->visible)
+				{
+					inView++;
+					triangles += objects[i]->mesh->indices.size() / 3;
+				}
+			}
+
+			frameArenaReset();
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			occlusionBeginFrame(clip);
+			cullOccluded(objects);
+			ms += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+			visible = 0;
+			after = 0;
+			for (size_t i = 0; i < objects.size(); i++)
+			{
+				if (objects[i]->visible)
+				{
+					visible++;
+					after += objects[i]->mesh->indices.size() / 3;
+				}
+			}
+		}
+		ms /= frames;
+
+		printf("%d\t%d\t%d\t%ld\t\t%ld\t%.3f\n", heading, inView, inView - visible, triangles, after, ms);
+		totalInView += inView;
+		totalCulled += inView - visible;
+		totalTriangles += triangles;
+		totalAfter += after;
+		totalMs += ms;
+	}
+
+	printf("Average: %d of %d objects in view culled (%.0f%% fewer draw calls, %.0f%% fewer triangles) for %.3fms of CPU a frame\n", totalCulled / 8, totalInView / 8, 100.0 * totalCulled / totalInView, 100.0 * (totalTriangles - totalAfter) / totalTriangles, totalMs / 8);
+
+	for (list<GameObject>::iterator x = city.begin(); x != city.end(); ++x)
+	{
+		releaseMesh(x->mesh);
+	}
+	closeFrameArena();
+	jobsShutdown();
+}
+
+
+/*
+* Builds the same stress scene at sizes from 1/256 of the one asked for up to all of it, flies around each one without a window and prints how frustum and occlusion culling cope as the scene grows.
+* Every size sees the same mix of models and the same path (scaled to the scene), so the only thing that changes is how much there is.
+* Returns nothing.
+*/
+void runStressBenchmark(int threads, int buildings, int trees, int hills, unsigned int seed)
+{
+	if (threads <= 0)
+	{
+		threads = thread::hardware_concurrency();
+		if (threads <= 0)
+		{
+			threads = 1;
+		}
+	}
+	jobsInit(threads);
+	initFrameArena();
+
+	//A quarter of a million objects, mostly trees, unless we've been told otherwise
+	if (buildings + trees + hills <= 0)
+	{
+		buildings = 10240;
+		trees = 240640;
+		hills = 5120;
+	}
+
+	printf("Stress scene benchmark: up to %d buildings, %d trees and %d hills, seed %u, %d threads\n", buildings, trees, hills, seed, threads);
+	printf("objects\tplace ms\tin view\tculled\ttriangles\tafter\timpostors\tcull ms\tocclusion ms\n");
+
+	int poses = 60;
+	for (int divisor = 256; divisor >= 1; divisor /= 4)
+	{
+		list<GameObject> scenery;
+		StressScene scene = generateStressScene(scenery, buildings / divisor, trees / divisor, hills / divisor, seed);
+		FlyThroughPath path = makeFlyThrough(scene, 60.0f);
+
+		vector<GameObject*> objects;
+		for (list<GameObject>::iterator x = scenery.begin(); x != scenery.end(); ++x)
+		{
+			objects.push_back(&(*x));
+		}
+
+		long inView = 0;
+		long visible = 0;
+		long triangles = 0;
+		long after = 0;
+		long withImpostors = 0;
+		double cullMs = 0;
+		double occlusionMs = 0;
+		for (int p = 0; p < poses; p++)
+		{
+			float clip[16];
+			FlyThroughPose pose = flyThroughAt(path, p * path.seconds / poses);
+			flyThroughMatrix(pose, 75, 1300.0f / 716.0f, clip);
+
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			benchFrustumCull(objects, clip);
+			cullMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+			for (size_t i = 0; i < objects.size(); i++)
+			{
+				if (objects[i]->visible)
+				{
+					inView++;
+					triangles += objects[i]->mesh->indices.size() / 3;
+				}
+			}
+
+			frameArenaReset();
+			start = chrono::steady_clock::now();
+			occlusionBeginFrame(clip);
+			cullOccluded(objects);
+			occlusionMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+			for (size_t i = 0; i < objects.size(); i++)
+			{
+				if (objects[i]->visible)
+				{
+					visible++;
+					long meshTriangles = objects[i]->mesh->indices.size() / 3;
+					after += meshTriangles;
+
+					//What renderScenery() would draw with far away trees and buildings as impostors (two triangles each, plus the mesh while they're fading)
+					int fade = impostorModel(objects[i]->mesh->name) ? impostorFadeLevel(*objects[i], pose.x, pose.y) : 0;
+					withImpostors += (fade < impostorFadeLevels ? meshTriangles : 0) + (fade > 0 ? 2 : 0);
+				}
+			}
+		}
+
+		printf("%d\t%.0f\t\t%ld\t%ld\t%ld\t\t%ld\t%ld\t\t%.3f\t%.3f\n", (int)objects.size(), scene.milliseconds, inView / poses, (inView - visible) / poses, triangles / poses, after / poses, withImpostors / poses, cullMs / poses, occlusionMs / poses);
+
+		for (list<GameObject>::iterator x = scenery.begin(); x != scenery.end(); ++x)
+		{
+			releaseMesh(x->mesh);
+		}
+	}
+
+	closeFrameArena();
+	jobsShutdown();
+}
@@ -0,0 +1,19 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+void runJobBenchmark(int maxThreads, int objectCount);
+void runOcclusionBenchmark(int threads);
+void runStressBenchmark(int threads, int buildings, int trees, int hills, unsigned int seed);
+
+#endif
@@ -0,0 +1,541 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#ifdef __MINGW64__
+	#include <direct.h>
+#else
+	#include <sys/stat.h>
+#endif
+
+#include "capture.h"
+#include "framepacing.h"
+#include "mesh.h"
+#include "glstats.h"
+
+using namespace std;
+
+//Settings (from the command line)
+string captureDirectory = "capture";
+CaptureFormat captureFormat = CAPTURE_TGA;
+
+//One pixel buffer in the readback ring
+enum CaptureSlotState
+{
+	//Nothing in it, ready for the next frame
+	SLOT_FREE,
+
+	//glReadPixels has been asked to fill it, and the fence tells us when the GPU has
+	SLOT_READING,
+
+	//Mapped, and waiting for the writer thread to copy the pixels out
+	SLOT_MAPPED
+};
+
+struct CaptureSlot
+{
+	GLuint buffer;
+	GLsync fence;
+	CaptureSlotState state;
+	const unsigned char *pixels;
+	int frame;
+
+	//Set by the writer thread once it's copied the pixels, so that we can unmap the buffer
+	atomic<bool> copied;
+};
+
+//The frames the writer thread is working through. They start out in a mapped slot, and end up in one of our own copies
+struct CaptureJob
+{
+	CaptureSlot *slot;
+	unsigned char *copy;
+	int frame;
+};
+
+static bool capturing = false;
+static int captureWidth = 0;
+static int captureHeight = 0;
+static size_t frameBytes = 0;
+static CaptureSlot slots[captureRingSize];
+static int nextSlot = 0;
+static int nextFrame = 0;
+static FILE *rawFile = NULL;
+
+//The writer thread, and the lists we pass work back and forth on. Frames get copied out of the mapped buffers before anything else so that the ring is handed back quickly, and then encoded and written
+static thread writerThread;
+static mutex writerMutex;
+static condition_variable writerCondition;
+static condition_variable writerIdle;
+static bool writerStopping = false;
+static deque<CaptureJob> mappedJobs;
+static deque<CaptureJob> encodeJobs;
+static vector<unsigned char*> freeFrames;
+static vector<unsigned char*> frameStore;
+static int writerBusy = 0;
+
+//Totals since we last printed anything
+static const Uint32 captureLogInterval = 5000;
+static Uint32 lastLogTime = 0;
+static int logFramesCaptured = 0;
+static int logFramesWritten = 0;
+static int logFramesDropped = 0;
+static double logMainThreadMs = 0;
+static double logWriteMs = 0;
+static CaptureStats lastStats = {0, 0, 0, 0};
+
+
+/*
+* Run length encodes a frame as a 24 bit TGA. GL gives us rows bottom-up in BGRA, which is how TGA likes them anyway, so it's just a matter of dropping the alpha and finding runs. Packets don't cross rows, as the format asks.
+* Returns the number of bytes of out that were used.
+*/
+size_t encodeTGA(const unsigned char *bgra, int width, int height, vector<unsigned char> &out)
+{
+	//The worst case is no runs at all, so a header byte for every 128 pixels on top of the pixels themselves
+	size_t worst = 18 + (size_t)height * ((size_t)width * 3 + (width + 127) / 128);
+	if (out.size() < worst)
+	{
+		out.resize(worst);
+	}
+	unsigned char *o = &out[0];
+
+	memset(o, 0, 18);
+	o[2] = 10;
+	o[12] = width & 0xFF;
+	o[13] = (width >> 8) & 0xFF;
+	o[14] = height & 0xFF;
+	o[15] = (height >> 8) & 0xFF;
+	o[16] = 24;
+	o += 18;
+
+	for (int y = 0; y < height; y++)
+	{
+		const Uint32 *row = (const Uint32 *)(bgra + (size_t)y * width * 4);
+		int x = 0;
+		while (x < width)
+		{
+			//See how far the colour at x repeats (ignoring alpha)
+			Uint32 colour = row[x] & 0x00FFFFFF;
+			int run = 1;
+			while (x + run < width && run < 128 && (row[x + run] & 0x00FFFFFF) == colour)
+			{
+				run++;
+			}
+
+			if (run > 1)
+			{
+				*o++ = 0x80 | (run - 1);
+				memcpy(o, &row[x], 3);
+				o += 3;
+				x += run;
+				continue;
+			}
+
+			//Otherwise gather up pixels until the next run of at least two starts
+			int count = 1;
+			while (x + count < width && count < 128 && ((row[x + count] ^ row[x + count - 1]) & 0x00FFFFFF) != 0)
+			{
+				count++;
+			}
+			if (x + count < width && count > 1 && count < 128)
+			{
+				//The last one we looked at starts the next run, so leave it for that
+				count--;
+			}
+			*o++ = count - 1;
+			for (int i = 0; i < count; i++)
+			{
+				memcpy(o, &row[x + i], 3);
+				o += 3;
+			}
+			x += count;
+		}
+	}
+
+	return o - &out[0];
+}
+
+
+/*
+* The writer thread. Copies frames out of the mapped pixel buffers as soon as they arrive, then encodes and writes them whenever there's nothing to copy.
+* Returns nothing.
+*/
+static void writerLoop()
+{
+	vector<unsigned char> encoded;
+	char fileName[512];
+
+	unique_lock<mutex> lock(writerMutex);
+	while (true)
+	{
+		writerCondition.wait(lock, [] { return writerStopping || (!mappedJobs.empty() && !freeFrames.empty()) || !encodeJobs.empty(); });
+
+		if (!mappedJobs.empty() && !freeFrames.empty())
+		{
+			CaptureJob job = mappedJobs.front();
+			mappedJobs.pop_front();
+			unsigned char *frame = freeFrames.back();
+			freeFrames.pop_back();
+			writerBusy++;
+			lock.unlock();
+
+			memcpy(frame, job.slot->pixels, frameBytes);
+			job.slot->copied.store(true);
+
+			lock.lock();
+			writerBusy--;
+			job.slot = NULL;
+			job.copy = frame;
+			encodeJobs.push_back(job);
+			continue;
+		}
+
+		if (!encodeJobs.empty())
+		{
+			CaptureJob job = encodeJobs.front();
+			encodeJobs.pop_front();
+			unsigned char *frame = job.copy;
+			writerBusy++;
+			lock.unlock();
+
+			Uint64 start = SDL_GetPerformanceCounter();
+			if (captureFormat == CAPTURE_RAW)
+			{
+				fwrite(frame, 1, frameBytes, rawFile);
+			}
+			else
+			{
+				size_t bytes = encodeTGA(frame, captureWidth, captureHeight, encoded);
+				snprintf(fileName, sizeof(fileName), "%s%sframe%06d.tga", captureDirectory.c_str(), pathSeparator.c_str(), job.frame);
+				FILE *out = fopen(fileName, "wb");
+				if (out != NULL)
+				{
+					fwrite(&encoded[0], 1, bytes, out);
+					fclose(out);
+				}
+			}
+			double ms = (double)(SDL_GetPerformanceCounter() - start) * 1000 / SDL_GetPerformanceFrequency();
+
+			lock.lock();
+			writerBusy--;
+			freeFrames.push_back(frame);
+			logFramesWritten++;
+			logWriteMs += ms;
+			if (mappedJobs.empty() && encodeJobs.empty() && writerBusy == 0)
+			{
+				writerIdle.notify_all();
+			}
+			continue;
+		}
+
+		if (writerStopping)
+		{
+			break;
+		}
+	}
+}
+
+
+/*
+* Sets up the pixel buffer ring and starts the writer thread. Needs pixel buffer objects and fences (GL 3.2, or the ARB extensions on older drivers).
+* Returns true if we're now capturing.
+*/
+bool startCapture(int width, int height)
+{
+	if (capturing)
+	{
+		return true;
+	}
+
+	if (!(GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object) || !(GLEW_VERSION_3_2 || GLEW_ARB_sync))
+	{
+		printf("No pixel buffer objects or fences, so no capturing\n");
+		return false;
+	}
+
+#ifdef __MINGW64__
+	_mkdir(captureDirectory.c_str());
+#else
+	mkdir(captureDirectory.c_str(), 0755);
+#endif
+
+	captureWidth = width;
+	captureHeight = height;
+	frameBytes = (size_t)width * height * 4;
+
+	if (captureFormat == CAPTURE_RAW)
+	{
+		char fileName[512];
+		snprintf(fileName, sizeof(fileName), "%s%scapture-%dx%d.bgra", captureDirectory.c_str(), pathSeparator.c_str(), width, height);
+		rawFile = fopen(fileName, "ab");
+		if (rawFile == NULL)
+		{
+			printf("Couldn't open %s for capturing\n", fileName);
+			return false;
+		}
+	}
+
+	//Room on the GPU side for the frames in flight, and on our side for the ones waiting to be written
+	for (int i = 0; i < captureRingSize; i++)
+	{
+		glGenBuffers(1, &slots[i].buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, NULL, GL_STREAM_READ);
+		slots[i].fence = 0;
+		slots[i].state = SLOT_FREE;
+		slots[i].copied.store(false);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	for (int i = 0; i < captureQueueSize; i++)
+	{
+		frameStore.push_back(new unsigned char[frameBytes]);
+	}
+	freeFrames = frameStore;
+
+	writerStopping = false;
+	writerThread = thread(writerLoop);
+
+	nextSlot = 0;
+	lastLogTime = SDL_GetTicks();
+	capturing = true;
+	printf("Capturing %dx%d frames to %s\n", width, height, captureDirectory.c_str());
+	return true;
+}
+
+
+/*
+* Maps a slot whose pixels have arrived, and hands it to the writer thread to copy out.
+* Returns nothing.
+*/
+static void mapSlot(CaptureSlot *slot)
+{
+	glDeleteSync(slot->fence);
+	slot->fence = 0;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+	slot->pixels = (const unsigned char *)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (slot->pixels == NULL)
+	{
+		slot->state = SLOT_FREE;
+		logFramesDropped++;
+		return;
+	}
+
+	slot->state = SLOT_MAPPED;
+	slot->copied.store(false);
+	{
+		lock_guard<mutex> lock(writerMutex);
+		CaptureJob job = {slot, NULL, slot->frame};
+		mappedJobs.push_back(job);
+	}
+	writerCondition.notify_one();
+}
+
+
+/*
+* Unmaps a slot once the writer thread has its pixels.
+* Returns nothing.
+*/
+static void unmapSlot(CaptureSlot *slot)
+{
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot->pixels = NULL;
+	slot->state = SLOT_FREE;
+}
+
+
+/*
+* Moves every slot along as far as it can go without waiting: finished readbacks get mapped and handed over, and copied ones get unmapped.
+* Returns nothing.
+*/
+static void advanceSlots()
+{
+	for (int i = 0; i < captureRingSize; i++)
+	{
+		CaptureSlot *slot = &slots[(nextSlot + i) % captureRingSize];
+		if (slot->state == SLOT_READING)
+		{
+			GLenum result = glClientWaitSync(slot->fence, 0, 0);
+			if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+			{
+				mapSlot(slot);
+			}
+		}
+		if (slot->state == SLOT_MAPPED && slot->copied.load())
+		{
+			unmapSlot(slot);
+		}
+	}
+}
+
+
+/*
+* Starts reading back what's been drawn this frame, and passes on any earlier frames that have finished. Call it after everything's been drawn and before the swap. This never waits on the GPU or the writer thread: if either has fallen behind, the frame is dropped.
+* Returns nothing.
+*/
+void captureFrame()
+{
+	if (!capturing)
+	{
+		return;
+	}
+
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	advanceSlots();
+
+	//Kick off the readback into the next slot, if it's been handed back
+	CaptureSlot *slot = &slots[nextSlot];
+	if (slot->state == SLOT_FREE)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadBuffer(GL_BACK);
+		glReadPixels(0, 0, captureWidth, captureHeight, GL_BGRA, GL_UNSIGNED_BYTE, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot->state = SLOT_READING;
+		slot->frame = nextFrame++;
+		nextSlot = (nextSlot + 1) % captureRingSize;
+		logFramesCaptured++;
+	}
+	else
+	{
+		logFramesDropped++;
+	}
+
+	logMainThreadMs += (double)(SDL_GetPerformanceCounter() - start) * 1000 / SDL_GetPerformanceFrequency();
+
+	//Every so often, print how it's going and how long frames are taking while we're at it
+	Uint32 now = SDL_GetTicks();
+	if (now - lastLogTime >= captureLogInterval && logFramesCaptured > 0)
+	{
+		int written;
+		double writeMs;
+		{
+			lock_guard<mutex> lock(writerMutex);
+			written = logFramesWritten;
+			writeMs = logWriteMs;
+			logFramesWritten = 0;
+			logWriteMs = 0;
+		}
+		int frames = logFramesCaptured + logFramesDropped;
+		lastStats.framesWritten = written;
+		lastStats.framesDropped = logFramesDropped;
+		lastStats.mainThreadMs = logMainThreadMs / frames;
+		lastStats.writeMs = written ? writeMs / written : 0;
+
+		printf("Capture: %d frames written, %d dropped, %.3fms a frame on the main thread, %.1fms a frame on the writer thread, frame time %.2fms\n", lastStats.framesWritten, lastStats.framesDropped, lastStats.mainThreadMs, lastStats.writeMs, getFramePacingStats().frameTimeMs);
+		lastLogTime = now;
+		logFramesCaptured = 0;
+		logFramesDropped = 0;
+		logMainThreadMs = 0;
+	}
+}
+
+
+/*
+* Finishes off the frames in flight, waits for the writer thread to write everything out, and frees the ring.
+* Returns nothing.
+*/
+void stopCapture()
+{
+	if (!capturing)
+	{
+		return;
+	}
+
+	//Let the GPU finish the readbacks we've asked for, and hand them over
+	for (int i = 0; i < captureRingSize; i++)
+	{
+		CaptureSlot *slot = &slots[(nextSlot + i) % captureRingSize];
+		if (slot->state == SLOT_READING)
+		{
+			glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			mapSlot(slot);
+		}
+	}
+
+	//Wait for the writer thread to get through everything, unmapping buffers as it copies them
+	{
+		unique_lock<mutex> lock(writerMutex);
+		while (!mappedJobs.empty() || !encodeJobs.empty() || writerBusy > 0)
+		{
+			lock.unlock();
+			advanceSlots();
+			lock.lock();
+			writerIdle.wait_for(lock, chrono::milliseconds(1));
+		}
+		writerStopping = true;
+	}
+	writerCondition.notify_all();
+	writerThread.join();
+	advanceSlots();
+
+	for (int i = 0; i < captureRingSize; i++)
+	{
+		if (slots[i].state == SLOT_MAPPED)
+		{
+			unmapSlot(&slots[i]);
+		}
+		glDeleteBuffers(1, &slots[i].buffer);
+		slots[i].buffer = 0;
+	}
+
+	for (size_t i = 0; i < frameStore.size(); i++)
+	{
+		delete [] frameStore[i];
+	}
+	frameStore.clear();
+	freeFrames.clear();
+
+	if (rawFile != NULL)
+	{
+		fclose(rawFile);
+		rawFile = NULL;
+		printf("Raw frames can be turned into a video with: ffmpeg -f rawvideo -pixel_format bgra -video_size %dx%d -framerate 60 -i <file> -vf vflip capture.mp4\n", captureWidth, captureHeight);
+	}
+
+	capturing = false;
+	printf("Stopped capturing after %d frames\n", nextFrame);
+}
+
+
+/*
+* Checks whether we're capturing.
+* Returns true if we are.
+*/
+bool isCapturing()
+{
+	return capturing;
+}
+
+
+/*
+* Gets the capture statistics from the last logging interval.
+* Returns a CaptureStats.
+*/
+CaptureStats getCaptureStats()
+{
+	return lastStats;
+}
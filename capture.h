@@ -0,0 +1,59 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+//How many frames the readback can be behind the GPU before we start dropping frames rather than waiting for it
+const int captureRingSize = 3;
+
+//How many frames can be queued up for the writer thread before we start dropping frames rather than waiting for it
+const int captureQueueSize = 8;
+
+//The ways we can write frames out
+enum CaptureFormat
+{
+	//One run length encoded TGA per frame
+	CAPTURE_TGA,
+
+	//Every frame one after another in a single file, as raw bottom-up BGRA (quick to write, but big)
+	CAPTURE_RAW
+};
+
+//Where captures go and how they're written (from the command line)
+extern std::string captureDirectory;
+extern CaptureFormat captureFormat;
+
+//How capturing is going, over the last logging interval
+struct CaptureStats
+{
+	int framesWritten;
+	int framesDropped;
+
+	//Time spent in captureFrame() on the main thread, which is all that capturing adds to the frame time
+	float mainThreadMs;
+
+	//Time the writer thread spends on each frame
+	float writeMs;
+};
+
+bool startCapture(int width, int height);
+void captureFrame();
+void stopCapture();
+bool isCapturing();
+CaptureStats getCaptureStats();
+size_t encodeTGA(const unsigned char *bgra, int width, int height, std::vector<unsigned char> &out);
+
+#endif
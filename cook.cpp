@@ -0,0 +1,896 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+//The asset cooker. It loads every model the way the game does (parsing, packing and optimising) and writes the results out as C++ tables that can be built into the game, along with the font and sounds if it's asked to
+//Or, with --cache, it cooks every model in resources/models into its own file in resources/cooked, which the game reads instead of the .obj. Only models that have changed since the last time get cooked again, on all of the cores
+//Run it from the directory that resources/ is in: drive_cook output.cpp [--files], or drive_cook --cache [--threads count] [--force]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <dirent.h>
+#include "assets.h"
+#include "jobs.h"
+
+#ifdef __MINGW64__
+	#include <direct.h>
+#else
+	#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+
+/*
+* Writes out an array of bytes as a C++ array definition, a line at a time.
+* Returns nothing.
+*/
+static void writeBytes(FILE *out, const char *name, const vector<unsigned char> &bytes)
+{
+	fprintf(out, "static const unsigned char %s[] = {", name);
+	for (size_t i = 0; i < bytes.size(); i++)
+	{
+		fprintf(out, "%s%d,", (i % 32 == 0) ? "\n\t" : "", bytes[i]);
+	}
+
+	//Empty arrays aren't allowed, so an empty file still gets one byte (its size says there's nothing there)
+	fprintf(out, "%s\n};\n", bytes.empty() ? "\n\t0" : "");
+}
+
+
+/*
+* Loads a model and writes it out as a vertex table, an index table and a CookedMesh pointing at them.
+* Returns true if the model loaded.
+*/
+static bool cookModel(FILE *out, int index)
+{
+	Mesh *mesh = loadMesh(cookedModelFiles[index]);
+	if (mesh->indices.empty())
+	{
+		printf("Couldn't cook %s\n", cookedModelFiles[index]);
+		delete mesh;
+		return false;
+	}
+
+	fprintf(out, "\n//%s\n", cookedModelFiles[index]);
+	fprintf(out, "static const PackedVertex cookedVertices%d[] = {", index);
+	for (size_t i = 0; i < mesh->vertices.size(); i++)
+	{
+		const PackedVertex &v = mesh->vertices[i];
+		fprintf(out, "%s{{%d, %d, %d}, {%d, %d}},", (i % 8 == 0) ? "\n\t" : " ", v.position[0], v.position[1], v.position[2], v.normal[0], v.normal[1]);
+	}
+	fprintf(out, "\n};\n");
+
+	fprintf(out, "static const GLushort cookedIndices%d[] = {", index);
+	for (size_t i = 0; i < mesh->indices.size(); i++)
+	{
+		fprintf(out, "%s%d,", (i % 24 == 0) ? "\n\t" : " ", mesh->indices[i]);
+	}
+	fprintf(out, "\n};\n");
+
+	//Nine significant digits gets every float back exactly
+	fprintf(out, "static const CookedMesh cookedMesh%d = {cookedVertices%d, %d, cookedIndices%d, %d, {%.9g, %.9g, %.9g}, {%.9g, %.9g, %.9g}, {%.9g, %.9g, %.9g, %.9g}};\n",
+		index, index, (int)mesh->vertices.size(), index, (int)mesh->indices.size(),
+		mesh->quantCentre[0], mesh->quantCentre[1], mesh->quantCentre[2],
+		mesh->quantScale[0], mesh->quantScale[1], mesh->quantScale[2],
+		mesh->boundX, mesh->boundY, mesh->boundZ, mesh->boundRadius);
+
+	printf("Cooked %s: %d vertices, %d indices\n", cookedModelFiles[index], (int)mesh->vertices.size(), (int)mesh->indices.size());
+	delete mesh;
+	return true;
+}
+
+
+/*
+* Reads a file under resources/ and writes it out as a byte table and a CookedData pointing at it.
+* Returns true if the file could be read.
+*/
+static bool cookFile(FILE *out, int index)
+{
+	string fileName = string("resources") + pathSeparator + cookedFileDirectories[index] + pathSeparator + cookedFileNames[index];
+	FILE *in = fopen(fileName.c_str(), "rb");
+	if (in == NULL)
+	{
+		printf("Couldn't cook %s\n", fileName.c_str());
+		return false;
+	}
+
+	vector<unsigned char> bytes;
+	unsigned char buffer[65536];
+	size_t got;
+	while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0)
+	{
+		bytes.insert(bytes.end(), buffer, buffer + got);
+	}
+	fclose(in);
+
+	char name[64];
+	snprintf(name, sizeof(name), "cookedBytes%d", index);
+	fprintf(out, "\n//%s\n", fileName.c_str());
+	writeBytes(out, name, bytes);
+	fprintf(out, "static const CookedData cookedFile%d = {cookedBytes%d, %d};\n", index, index, (int)bytes.size());
+
+	printf("Cooked %s: %d bytes\n", fileName.c_str(), (int)bytes.size());
+	return true;
+}
+
+
+//Bump this whenever cooking for the cache changes what comes out (the reader below, packMesh() or optimiseMesh()), so that everything gets cooked again
+static const int cacheCookVersion = 1;
+
+//The database of what's been cooked, which lives with the cooked models
+static const string cacheDirectory = "resources" + pathSeparator + "cooked";
+static const string cacheDatabaseFile = cacheDirectory + pathSeparator + "cook.db";
+
+//What the database remembers about a model from when it was last cooked: a hash of the whole .obj, and its size and modification time (which are much quicker to check, so the hash only gets worked out when they've changed)
+struct CacheEntry
+{
+	unsigned long long hash;
+	long long size;
+	long long time;
+};
+
+//What happened to a model this time around
+enum CacheResult
+{
+	CACHE_TOUCHED,
+	CACHE_COOKED,
+	CACHE_FAILED
+};
+
+//A model that might need cooking, and how it went. Each job thread only ever touches its own
+struct CacheJob
+{
+	string name;
+	long long size;
+	long long time;
+	bool known;
+	CacheEntry last;
+
+	CacheResult result;
+	unsigned long long hash;
+	int vertices;
+	int triangles;
+	int splitFaces;
+	int madeNormals;
+	int flippedNormals;
+	int droppedTriangles;
+	string error;
+};
+
+
+/*
+* Hashes a whole file's contents with FNV-1a, the same as the lighting cache does.
+* Returns the hash.
+*/
+static unsigned long long hashContents(const vector<char> &bytes)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < bytes.size(); i++)
+	{
+		hash ^= (unsigned char)bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+
+/*
+* Reads a whole file into memory.
+* Returns true if it could be read.
+*/
+static bool readWholeFile(const string &fileName, vector<char> &bytes)
+{
+	FILE *in = fopen(fileName.c_str(), "rb");
+	if (in == NULL)
+	{
+		return false;
+	}
+
+	char buffer[65536];
+	size_t got;
+	while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0)
+	{
+		bytes.insert(bytes.end(), buffer, buffer + got);
+	}
+	fclose(in);
+	return true;
+}
+
+
+/*
+* Reads one corner of a face ("v", "v/vt", "v//vn" or "v/vt/vn"), counting negative indices back from the last position or normal so far. The normal is -1 if there isn't a usable one.
+* Returns true if the corner made sense.
+*/
+static bool readCorner(const char *&p, int positionCount, int normalCount, int *position, int *normal)
+{
+	char *end;
+	long v = strtol(p, &end, 10);
+	if (end == p)
+	{
+		return false;
+	}
+	p = end;
+	*position = (v < 0) ? positionCount + (int)v : (int)v - 1;
+	*normal = -1;
+
+	if (*p == '/')
+	{
+		//We don't use texture coordinates, so skip over them
+		p++;
+		strtol(p, &end, 10);
+		p = end;
+		if (*p == '/')
+		{
+			p++;
+			long n = strtol(p, &end, 10);
+			if (end == p)
+			{
+				return false;
+			}
+			p = end;
+			*normal = (n < 0) ? normalCount + (int)n : (int)n - 1;
+			if (*normal < 0 || *normal >= normalCount)
+			{
+				*normal = -1;
+			}
+		}
+	}
+	return *position >= 0 && *position < positionCount;
+}
+
+
+/*
+* Reads a model for the cache, more thoroughly than loadMesh() does: faces can have any number of corners (which get split into triangles) and any of the OBJ corner styles, triangles with no area are dropped, corners without a normal get their triangle's, and normals that point into their triangle's back face are turned around. Then it's packed and optimised the same way loadMesh() does it.
+* Returns true if the mesh was filled in, or false (with job->error saying why) if it wasn't.
+*/
+static bool readCacheModel(CacheJob *job, const vector<char> &text, Mesh *mesh)
+{
+	vector<GLfloat> positions;
+	vector<GLfloat> normals;
+	vector< pair<unsigned int, unsigned int> > corners;
+	map< pair<unsigned int, unsigned int>, GLushort> cornerIndex;
+
+	//Each normal that had to be turned around, and where the turned around copy went
+	map<int, int> flippedIndex;
+
+	vector<int> facePositions;
+	vector<int> faceNormals;
+
+	//The text ends with a 0, so we can read straight out of it
+	const char *p = &text[0];
+	while (*p != '\0')
+	{
+		while (*p == ' ' || *p == '\t')
+		{
+			p++;
+		}
+
+		if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			p++;
+			for (int a = 0; a < 3; a++)
+			{
+				char *end;
+				positions.push_back(strtof(p, &end));
+				p = end;
+			}
+		}
+		else if (p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t'))
+		{
+			p += 2;
+			for (int a = 0; a < 3; a++)
+			{
+				char *end;
+				normals.push_back(strtof(p, &end));
+				p = end;
+			}
+		}
+		else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			p++;
+			facePositions.clear();
+			faceNormals.clear();
+			while (true)
+			{
+				while (*p == ' ' || *p == '\t')
+				{
+					p++;
+				}
+				if (*p == '\n' || *p == '\r' || *p == '\0' || *p == '#')
+				{
+					break;
+				}
+
+				int position;
+				int normal;
+				if (!readCorner(p, (int)positions.size() / 3, (int)normals.size() / 3, &position, &normal))
+				{
+					job->error = "a face uses a vertex that isn't there";
+					return false;
+				}
+				facePositions.push_back(position);
+				faceNormals.push_back(normal);
+			}
+
+			if (facePositions.size() < 3)
+			{
+				job->error = "a face has fewer than three corners";
+				return false;
+			}
+			if (facePositions.size() > 3)
+			{
+				job->splitFaces++;
+			}
+
+			//Split the face into a fan of triangles around its first corner
+			for (size_t f = 1; f + 1 < facePositions.size(); f++)
+			{
+				size_t triangle[3] = {0, f, f + 1};
+
+				//Which way the triangle faces, going by its winding (anticlockwise from the front in OBJ files)
+				const GLfloat *a = &positions[facePositions[triangle[0]] * 3];
+				const GLfloat *b = &positions[facePositions[triangle[1]] * 3];
+				const GLfloat *c = &positions[facePositions[triangle[2]] * 3];
+				float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+				float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+				float face[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+				float faceLength = sqrt(face[0] * face[0] + face[1] * face[1] + face[2] * face[2]);
+				if (faceLength <= 0)
+				{
+					job->droppedTriangles++;
+					continue;
+				}
+
+				int madeNormal = -1;
+				int cornerNormals[3];
+				for (int k = 0; k < 3; k++)
+				{
+					int n = faceNormals[triangle[k]];
+					float dot = 0;
+					float length = 0;
+					if (n >= 0)
+					{
+						for (int axis = 0; axis < 3; axis++)
+						{
+							dot += normals[n * 3 + axis] * face[axis];
+							length += normals[n * 3 + axis] * normals[n * 3 + axis];
+						}
+					}
+
+					if (n < 0 || length <= 0)
+					{
+						//No normal (or a broken one), so it gets the triangle's
+						if (madeNormal < 0)
+						{
+							madeNormal = (int)normals.size() / 3;
+							for (int axis = 0; axis < 3; axis++)
+							{
+								normals.push_back(face[axis] / faceLength);
+							}
+							job->madeNormals++;
+						}
+						n = madeNormal;
+					}
+					else if (dot < 0)
+					{
+						//A normal pointing out of the back of its triangle, which lighting would get wrong
+						map<int, int>::iterator found = flippedIndex.find(n);
+						if (found == flippedIndex.end())
+						{
+							int flipped = (int)normals.size() / 3;
+							for (int axis = 0; axis < 3; axis++)
+							{
+								normals.push_back(-normals[n * 3 + axis]);
+							}
+							flippedIndex[n] = flipped;
+							job->flippedNormals++;
+							n = flipped;
+						}
+						else
+						{
+							n = found->second;
+						}
+					}
+					cornerNormals[k] = n;
+				}
+
+				//Add the corners backwards so that they're in the right order for glFrontFace(GL_CW), like loadMesh() does
+				for (int k = 2; k >= 0; k--)
+				{
+					pair<unsigned int, unsigned int> corner(facePositions[triangle[k]], cornerNormals[k]);
+					map< pair<unsigned int, unsigned int>, GLushort>::iterator found = cornerIndex.find(corner);
+					if (found != cornerIndex.end())
+					{
+						mesh->indices.push_back(found->second);
+					}
+					else if (corners.size() < 65536)
+					{
+						cornerIndex[corner] = (GLushort)corners.size();
+						mesh->indices.push_back((GLushort)corners.size());
+						corners.push_back(corner);
+					}
+					else
+					{
+						job->error = "it has more vertices than 16 bit indices can reach";
+						return false;
+					}
+				}
+				job->triangles++;
+			}
+		}
+
+		//On to the next line
+		while (*p != '\n' && *p != '\0')
+		{
+			p++;
+		}
+		if (*p == '\n')
+		{
+			p++;
+		}
+	}
+
+	if (mesh->indices.empty())
+	{
+		job->error = "there's nothing in it";
+		return false;
+	}
+
+	packMesh(mesh, positions, normals, corners);
+	job->vertices = (int)mesh->vertices.size();
+	return true;
+}
+
+
+/*
+* Writes out a cooked model for the game to read, by way of a temporary file so that the game never sees half of one.
+* Returns true if it was written.
+*/
+static bool writeCacheModel(const CacheJob *job, const Mesh *mesh)
+{
+	CookedMeshFileHeader header;
+	memcpy(header.magic, "MESH", 4);
+	header.version = cookedMeshFileVersion;
+	header.sourceSize = job->size;
+	header.sourceTime = job->time;
+	header.vertexCount = (int)mesh->vertices.size();
+	header.indexCount = (int)mesh->indices.size();
+	for (int a = 0; a < 3; a++)
+	{
+		header.quantCentre[a] = mesh->quantCentre[a];
+		header.quantScale[a] = mesh->quantScale[a];
+	}
+	header.bound[0] = mesh->boundX;
+	header.bound[1] = mesh->boundY;
+	header.bound[2] = mesh->boundZ;
+	header.bound[3] = mesh->boundRadius;
+
+	string fileName = cookedMeshFileName(job->name);
+	string partFile = fileName + ".part";
+	FILE *out = fopen(partFile.c_str(), "wb");
+	if (out == NULL)
+	{
+		return false;
+	}
+	bool good = fwrite(&header, sizeof(header), 1, out) == 1;
+	good = good && fwrite(&mesh->vertices[0], sizeof(PackedVertex), mesh->vertices.size(), out) == mesh->vertices.size();
+	good = good && fwrite(&mesh->indices[0], sizeof(GLushort), mesh->indices.size(), out) == mesh->indices.size();
+	good = (fclose(out) == 0) && good;
+	if (!good)
+	{
+		remove(partFile.c_str());
+		return false;
+	}
+
+	remove(fileName.c_str());
+	return rename(partFile.c_str(), fileName.c_str()) == 0;
+}
+
+
+/*
+* Updates the size and modification time in a cooked model whose .obj has been saved again without changing, so that the game knows it's still right.
+* Returns true if the cooked model was there to update.
+*/
+static bool touchCacheModel(const CacheJob *job)
+{
+	FILE *file = fopen(cookedMeshFileName(job->name).c_str(), "r+b");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	CookedMeshFileHeader header;
+	bool good = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "MESH", 4) == 0 && header.version == cookedMeshFileVersion;
+	if (good)
+	{
+		header.sourceSize = job->size;
+		header.sourceTime = job->time;
+		good = fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+	}
+	good = (fclose(file) == 0) && good;
+	return good;
+}
+
+
+/*
+* Cooks models begin to end (exclusive) of a list of CacheJobs. This runs on the job threads, and each model is read, hashed and cooked without touching anything shared.
+* Returns nothing.
+*/
+static void cookCacheModels(void *data, int begin, int end)
+{
+	vector<CacheJob> &jobs = *(vector<CacheJob>*)data;
+	for (int i = begin; i < end; i++)
+	{
+		CacheJob *job = &jobs[i];
+
+		vector<char> text;
+		if (!readWholeFile("resources" + pathSeparator + "models" + pathSeparator + job->name, text))
+		{
+			job->result = CACHE_FAILED;
+			job->error = "it couldn't be read";
+			continue;
+		}
+		job->hash = hashContents(text);
+
+		//If it's only been saved again, what we cooked last time is still right
+		if (job->known && job->hash == job->last.hash && touchCacheModel(job))
+		{
+			job->result = CACHE_TOUCHED;
+			continue;
+		}
+
+		text.push_back('\0');
+		Mesh mesh;
+		mesh.name = job->name;
+		mesh.users = 0;
+		mesh.impostor = -1;
+		if (!readCacheModel(job, text, &mesh))
+		{
+			job->result = CACHE_FAILED;
+			continue;
+		}
+		if (!writeCacheModel(job, &mesh))
+		{
+			job->result = CACHE_FAILED;
+			job->error = "the cooked model couldn't be written";
+			continue;
+		}
+		job->result = CACHE_COOKED;
+	}
+}
+
+
+/*
+* Reads the database of what was cooked last time. A database from a different version of the cooker is as good as none at all.
+* Returns nothing.
+*/
+static void readCacheDatabase(map<string, CacheEntry> &database)
+{
+	FILE *in = fopen(cacheDatabaseFile.c_str(), "r");
+	if (in == NULL)
+	{
+		return;
+	}
+
+	char line[1024];
+	int cookVersion = 0;
+	int fileVersion = 0;
+	if (fgets(line, sizeof(line), in) == NULL || sscanf(line, "drive_cook cache %d %d", &cookVersion, &fileVersion) != 2 || cookVersion != cacheCookVersion || fileVersion != cookedMeshFileVersion)
+	{
+		fclose(in);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		CacheEntry entry;
+		int nameStart = 0;
+		if (sscanf(line, "%llx %lld %lld %n", &entry.hash, &entry.size, &entry.time, &nameStart) != 3 || nameStart == 0)
+		{
+			continue;
+		}
+		string name = line + nameStart;
+		while (!name.empty() && (name[name.size() - 1] == '\n' || name[name.size() - 1] == '\r'))
+		{
+			name.erase(name.size() - 1);
+		}
+		database[name] = entry;
+	}
+	fclose(in);
+}
+
+
+/*
+* Writes out the database of what's been cooked, by way of a temporary file like everything else.
+* Returns true if it was written.
+*/
+static bool writeCacheDatabase(const map<string, CacheEntry> &database)
+{
+	string partFile = cacheDatabaseFile + ".part";
+	FILE *out = fopen(partFile.c_str(), "w");
+	if (out == NULL)
+	{
+		return false;
+	}
+
+	fprintf(out, "drive_cook cache %d %d\n", cacheCookVersion, cookedMeshFileVersion);
+	for (map<string, CacheEntry>::const_iterator x = database.begin(); x != database.end(); ++x)
+	{
+		fprintf(out, "%016llx %lld %lld %s\n", x->second.hash, x->second.size, x->second.time, x->first.c_str());
+	}
+	if (fclose(out) != 0)
+	{
+		remove(partFile.c_str());
+		return false;
+	}
+
+	remove(cacheDatabaseFile.c_str());
+	return rename(partFile.c_str(), cacheDatabaseFile.c_str()) == 0;
+}
+
+
+/*
+* Finds every .obj file in resources/models.
+* Returns true if the directory could be read.
+*/
+static bool listModels(vector<string> &models)
+{
+	string directory = "resources" + pathSeparator + "models";
+	DIR *dir = opendir(directory.c_str());
+	if (dir == NULL)
+	{
+		return false;
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		string name = entry->d_name;
+		if (name.size() > 4 && name.compare(name.size() - 4, 4, ".obj") == 0)
+		{
+			models.push_back(name);
+		}
+	}
+	closedir(dir);
+
+	sort(models.begin(), models.end());
+	return true;
+}
+
+
+/*
+* Brings resources/cooked up to date with resources/models: models that are new or have changed get cooked (spread across the job threads), models that have only been saved again get their cooked files updated to match, and cooked files for models that have gone get removed.
+* Returns the exit code (non-zero if any model couldn't be cooked).
+*/
+static int cookCache(int argc, char *argv[])
+{
+	int threads = 0;
+	bool force = false;
+	for (int i = 2; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "--threads" && i + 1 < argc)
+		{
+			threads = atoi(argv[++i]);
+		}
+		else if (arg == "--force")
+		{
+			force = true;
+		}
+		else
+		{
+			printf("Usage: drive_cook --cache [--threads count] [--force]\n");
+			return 1;
+		}
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	meshLogging = false;
+
+#ifdef __MINGW64__
+	_mkdir(cacheDirectory.c_str());
+#else
+	mkdir(cacheDirectory.c_str(), 0755);
+#endif
+
+	//What was cooked last time (--force forgets it, so that everything gets cooked again)
+	map<string, CacheEntry> database;
+	if (!force)
+	{
+		readCacheDatabase(database);
+	}
+
+	vector<string> models;
+	if (!listModels(models))
+	{
+		printf("Couldn't read resources%smodels\n", pathSeparator.c_str());
+		return 1;
+	}
+
+	//Anything that's the same size and age as last time, and still has its cooked file, is left alone without even being read
+	//Unless it was changed too close to when it was cooked (see stampTooRecent()), since then a quick second edit could have the same stamp. Those get hashed again, and touching the cooked file moves it on past the model
+	map<string, CacheEntry> cooked;
+	vector<CacheJob> jobs;
+	for (size_t i = 0; i < models.size(); i++)
+	{
+		CacheJob job;
+		if (!modelFileStamp(models[i], &job.size, &job.time))
+		{
+			continue;
+		}
+
+		map<string, CacheEntry>::iterator found = database.find(models[i]);
+		long long cookedSize;
+		long long cookedTime;
+		if (found != database.end() && found->second.size == job.size && found->second.time == job.time && fileStamp(cookedMeshFileName(models[i]), &cookedSize, &cookedTime) && !stampTooRecent(job.time, cookedTime))
+		{
+			cooked[models[i]] = found->second;
+			continue;
+		}
+
+		job.name = models[i];
+		job.known = (found != database.end());
+		if (job.known)
+		{
+			job.last = found->second;
+		}
+		job.vertices = 0;
+		job.triangles = 0;
+		job.splitFaces = 0;
+		job.madeNormals = 0;
+		job.flippedNormals = 0;
+		job.droppedTriangles = 0;
+		jobs.push_back(job);
+	}
+	int upToDate = (int)cooked.size();
+
+	//Each model is plenty of work on its own, so they're handed out one at a time
+	int threadsUsed = 0;
+	if (!jobs.empty())
+	{
+		jobsInit(threads);
+		threadsUsed = jobsThreadCount();
+		jobsParallelFor((int)jobs.size(), 1, cookCacheModels, &jobs);
+		jobsShutdown();
+	}
+
+	int cookedCount = 0;
+	int touched = 0;
+	int failed = 0;
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		const CacheJob &job = jobs[i];
+		if (job.result == CACHE_FAILED)
+		{
+			printf("Couldn't cook %s: %s\n", job.name.c_str(), job.error.c_str());
+			failed++;
+			continue;
+		}
+
+		CacheEntry entry = {job.hash, job.size, job.time};
+		cooked[job.name] = entry;
+		if (job.result == CACHE_TOUCHED)
+		{
+			touched++;
+			continue;
+		}
+
+		printf("Cooked %s: %d vertices, %d triangles (%d faces split, %d normals made, %d normals turned around, %d empty triangles dropped)\n", job.name.c_str(), job.vertices, job.triangles, job.splitFaces, job.madeNormals, job.flippedNormals, job.droppedTriangles);
+		cookedCount++;
+	}
+
+	//Throw away what was cooked from models that aren't there any more
+	int removed = 0;
+	for (map<string, CacheEntry>::iterator x = database.begin(); x != database.end(); ++x)
+	{
+		if (!binary_search(models.begin(), models.end(), x->first))
+		{
+			remove(cookedMeshFileName(x->first).c_str());
+			removed++;
+		}
+	}
+
+	if ((force || cookedCount + touched + removed + failed > 0) && !writeCacheDatabase(cooked))
+	{
+		printf("Couldn't write %s\n", cacheDatabaseFile.c_str());
+		return 1;
+	}
+
+	float milliseconds = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+	printf("%d models: %d cooked, %d up to date, %d saved again unchanged, %d removed, %d failed in %.1fms", (int)models.size(), cookedCount, upToDate, touched, removed, failed, milliseconds);
+	if (threadsUsed > 0)
+	{
+		printf(" on %d thread%s", threadsUsed, threadsUsed == 1 ? "" : "s");
+	}
+	printf("\n");
+
+	return failed > 0 ? 1 : 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		printf("Usage: drive_cook output.cpp [--files]\n       drive_cook --cache [--threads count] [--force]\n");
+		return 1;
+	}
+	if (strcmp(argv[1], "--cache") == 0)
+	{
+		return cookCache(argc, argv);
+	}
+	bool withFiles = (argc > 2 && strcmp(argv[2], "--files") == 0);
+
+	//Write to a temporary file first, so that a failed cook doesn't leave a half written table behind for the build to pick up
+	string outputFile = argv[1];
+	string partFile = outputFile + ".part";
+	FILE *out = fopen(partFile.c_str(), "w");
+	if (out == NULL)
+	{
+		printf("Couldn't write %s\n", partFile.c_str());
+		return 1;
+	}
+
+	meshLogging = false;
+	fprintf(out, "//Cooked assets, written by drive_cook. Cook them again rather than editing this\n");
+	fprintf(out, "#include \"assets.h\"\n");
+
+	bool cooked = true;
+	for (int i = 0; i < COOKED_MODELS && cooked; i++)
+	{
+		cooked = cookModel(out, i);
+	}
+	for (int i = 0; i < COOKED_FILES && cooked && withFiles; i++)
+	{
+		cooked = cookFile(out, i);
+	}
+
+	fprintf(out, "\nconst CookedMesh *const cookedMeshes[COOKED_MODELS] = {");
+	for (int i = 0; i < COOKED_MODELS; i++)
+	{
+		fprintf(out, "%s&cookedMesh%d", i ? ", " : "", i);
+	}
+	fprintf(out, "};\n");
+
+	fprintf(out, "const CookedData *const cookedFiles[COOKED_FILES] = {");
+	for (int i = 0; i < COOKED_FILES; i++)
+	{
+		if (withFiles)
+		{
+			fprintf(out, "%s&cookedFile%d", i ? ", " : "", i);
+		}
+		else
+		{
+			fprintf(out, "%sNULL", i ? ", " : "");
+		}
+	}
+	fprintf(out, "};\n");
+	fclose(out);
+
+	if (!cooked)
+	{
+		remove(partFile.c_str());
+		return 1;
+	}
+
+	remove(outputFile.c_str());
+	if (rename(partFile.c_str(), outputFile.c_str()) != 0)
+	{
+		printf("Couldn't write %s\n", outputFile.c_str());
+		return 1;
+	}
+	return 0;
+}
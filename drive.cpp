@@ -26,23 +26,41 @@
 #include <SDL2/SDL_ttf.h>
 #include <list>
 #include <string>
+#include <vector>
+#include <stdlib.h>
+
+#include "audio.h"
+#include "framepacing.h"
+#include "resolution.h"
+#include "jobs.h"
+#include "bench.h"
+#include "mesh.h"
+#include "world.h"
+#include "occlusion.h"
+#include "memory.h"
+#include "text.h"
+#include "capture.h"
+#include "sim.h"
+#include "net.h"
+#include "particles.h"
+#include "lighting.h"
+#include "assets.h"
+#include "replay.h"
+#include "terrain.h"
+#include "stress.h"
+#include "transform.h"
+#include "impostor.h"
+#include "glstats.h"
 
 using namespace std;
 
-//Certain operating systems are dumb and use the wrong slash to separate paths.
-//Thanks, Windows.
-const string pathSeparator = 
-#ifdef __MINGW64__
-	"\\";
-#else
-	"/";
-#endif
-
-
 //The size of the window we're going to generate
 int screenWidth = 1300;
 int screenHeight = 716;
 
+//How much the camera can see, top to bottom, in degrees
+float fieldOfView = 75;
+
 //Some windowing and OpenGL variables
 SDL_Window* win = NULL;
 SDL_GLContext glContext;
@@ -50,10 +68,42 @@ SDL_GLContext glContext;
 //Whether or not we want to continue playing
 bool running = true;
 
+//Whether we're just here to run the job system benchmark (--bench-jobs)
+bool benchJobs = false;
+int benchJobObjects = 200000;
+
+//Whether we're just here to run the occlusion culling benchmark (--bench-occlusion)
+bool benchOcclusion = false;
+
+//Whether we're just here to run the stress scene benchmark (--bench-stress)
+bool benchStress = false;
+
+//Whether we're just here to run the network benchmark (--bench-net)
+bool benchNet = false;
+
+//Whether to host a network game (--host), or the host to join (--connect)
+bool hostGame = false;
+string connectHost = "";
+
+//The streamed world to drive around in (--world), instead of the built in scenery
+string worldFile = "";
+
+//Where to write a generated world and how many chunks across it should be (--generate-world)
+string generateWorldDirectory = "";
+int generateWorldSize = 0;
+unsigned int generateWorldSeed = 1;
+
+//Whether to start recording frames as soon as the game starts (--capture)
+bool captureOnStart = false;
+
+//Whether to hold the accelerator down for us (handy for driving across a big world to see how streaming copes)
+bool autoDrive = false;
+
 //HUD text variables
 SDL_Colour textColour = {255,255,255};
 int hudSize = 32;
 TTF_Font *hudFont = NULL;
+FontAtlas hudAtlas = {0};
 
 //Mouselook variables
 int limitY = 60;
@@ -63,6 +113,11 @@ float mouseSensY = 0.1f;
 GLfloat rotY = 0;
 GLfloat rotX = 0;
 
+//Where the camera is. It stays where the game starts it unless we're flying through a stress scene
+float cameraX = 0;
+float cameraY = 0;
+float cameraHeight = 0;
+
 //Vehicle position/orientation variables
 int carSteer = 0;
 bool carAccel = false;
@@ -79,49 +134,417 @@ Mix_Chunk* sampleHover;
 Mix_Chunk* sampleFans;
 Mix_Music* sampleMusic;
 
-//A structure representing a 3D model in the game
-struct GameObject
-{
-	string name;
-
-	//Position
-	float x;
-	float y;
-	float rz;
-
-	//Material
-	SDL_Colour colour;
-
-	//Geometry
-	list <GLfloat> vertexList;
-	list <GLubyte> faceList;
-	list <GLubyte> normalList;
-};
+//Whether the fan volume is applied by our own mixing callback (see audio.cpp) rather than by Mix_VolumeChunk
+bool fanGainInCallback = false;
 
 //Lists of the 3D models that appear in the game
 list<GameObject> sceneryObjects;
 list<GameObject> vehicleObjects;
 
+//The node in the transform hierarchy that the vehicle's parts hang off
+int vehicleTransform = transformNone;
+
+//The scenery objects again, but in something we can index into so that the culling can be split up between threads
+vector<GameObject*> sceneryDrawList;
+
+//The planes (a, b, c, d with ax + by + cz + d >= 0 being inside) that bound what the camera can see, in world coordinates
+float frustumPlanes[6][4];
+
+//The stages of work that happen each frame before we start submitting geometry
+JobGraph frameGraph;
+
+//How much scenery renderScenery() drew last frame
+int sceneryDrawnObjects = 0;
+long sceneryDrawnTriangles = 0;
+
+//The stress scene we're driving around (if there is one) and the way the camera flies around it
+StressScene stressScene;
+FlyThroughPath flyThrough;
+
 //Declarations for all the functions we'll be using
 //(this is only necessary when functions are being used that are written later in the file than they're being called, but it's a nice overview)
+bool parseArgs(int argc, char* args[]);
 bool init();
 bool initGL();
+void handleEvents();
+void latchCameraInput();
 void handleMouseMotion(int xrel, int yrel);
 void handleMouseClick(SDL_MouseButtonEvent button);
 void handleKeys(SDL_KeyboardEvent key);
 void updateSim();
+void applyReplayFrame(const ReplayFrame &frame);
 void rotateCamera();
+void updateFrustum();
+void cullScenery(void *data, int begin, int end);
+void buildFrameGraph();
 void updateLighting();
 void updateSound();
 void renderScenery();
+void renderVehicle(float x, float y, float direction);
 void renderCar();
+void updateVehicleParticles(float seconds);
 void renderHUD();
-void renderText(TTF_Font *font, float x, float y, int width, string text);
-GameObject loadObj(string objectName, SDL_Colour foo);
+void attachScenery();
+void bakeScenery(string cacheFile);
+void loadScenery();
+void rebuildDrawList();
 void loadAssets();
 void close();
 
 
+/*
+* Reads any command line options and sets the matching variables.
+* Returns true if all the options made sense and false if the game shouldn't start.
+*/
+bool parseArgs(int argc, char* args[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = args[i];
+
+		//Small audio buffers so that engine sound changes are heard sooner (at the cost of more chance of crackles on slow machines)
+		if (arg == "--low-latency-audio")
+		{
+			audioBufferSize = audioBufferLowLatency;
+		}
+		//A specific audio buffer size in sample frames
+		else if (arg == "--audio-buffer" && i + 1 < argc)
+		{
+			audioBufferSize = atoi(args[++i]);
+			if (audioBufferSize <= 0)
+			{
+				printf("Audio buffer size must be a positive number of sample frames\n");
+				return false;
+			}
+		}
+		//Let the driver hold us to the display's refresh rate (this is the default)
+		else if (arg == "--vsync")
+		{
+			pacingMode = PACING_VSYNC;
+		}
+		//The number of threads to spread per-frame work across (the default is one per core)
+		else if (arg == "--threads" && i + 1 < argc)
+		{
+			jobThreads = atoi(args[++i]);
+			if (jobThreads <= 0)
+			{
+				printf("Thread count must be a positive number\n");
+				return false;
+			}
+		}
+		//Run the job system benchmark and quit, instead of playing
+		else if (arg == "--bench-jobs")
+		{
+			benchJobs = true;
+		}
+		//The number of objects in the job system benchmark's scene
+		else if (arg == "--bench-objects" && i + 1 < argc)
+		{
+			benchJobObjects = atoi(args[++i]);
+			if (benchJobObjects <= 0)
+			{
+				printf("Benchmark object count must be a positive number\n");
+				return false;
+			}
+		}
+		//Drive around a streamed world instead of the built in scenery
+		else if (arg == "--world" && i + 1 < argc)
+		{
+			worldFile = args[++i];
+		}
+		//Write out a generated world of the given number of chunks across and quit
+		else if (arg == "--generate-world" && i + 2 < argc)
+		{
+			generateWorldDirectory = args[++i];
+			generateWorldSize = atoi(args[++i]);
+			if (generateWorldSize <= 0)
+			{
+				printf("Generated world size must be a positive number of chunks\n");
+				return false;
+			}
+		}
+		//The seed for --generate-world
+		else if (arg == "--seed" && i + 1 < argc)
+		{
+			generateWorldSeed = strtoul(args[++i], NULL, 10);
+		}
+		//How many chunks out from the car to keep loaded
+		else if (arg == "--stream-radius" && i + 1 < argc)
+		{
+			worldStreamRadius = atoi(args[++i]);
+			if (worldStreamRadius < 0)
+			{
+				printf("Stream radius can't be negative\n");
+				return false;
+			}
+		}
+		//How many megabytes the streamed world can use before far away chunks get thrown out
+		else if (arg == "--world-budget" && i + 1 < argc)
+		{
+			worldMemoryBudget = atof(args[++i]);
+			if (worldMemoryBudget <= 0)
+			{
+				printf("World memory budget must be a positive number of megabytes\n");
+				return false;
+			}
+		}
+		//Hold the accelerator down
+		else if (arg == "--autodrive")
+		{
+			autoDrive = true;
+		}
+		//Vsync, but tear rather than wait a whole refresh when we're running late
+		else if (arg == "--adaptive-vsync")
+		{
+			pacingMode = PACING_ADAPTIVE_VSYNC;
+		}
+		//Turn vsync off and time the frames ourselves
+		else if (arg == "--frame-cap" && i + 1 < argc)
+		{
+			pacingMode = PACING_CAP;
+			frameCapRate = atof(args[++i]);
+			if (frameCapRate <= 0)
+			{
+				printf("Frame cap must be a positive number of frames per second\n");
+				return false;
+			}
+		}
+		//Draw as fast as we can
+		else if (arg == "--uncapped")
+		{
+			pacingMode = PACING_UNCAPPED;
+		}
+		//The frame rate to drop to when the window isn't focused
+		else if (arg == "--background-fps" && i + 1 < argc)
+		{
+			backgroundFrameRate = atof(args[++i]);
+			if (backgroundFrameRate <= 0)
+			{
+				printf("Background frame rate must be a positive number of frames per second\n");
+				return false;
+			}
+		}
+		//Stop drawing altogether when the window isn't focused
+		else if (arg == "--background-pause")
+		{
+			pauseInBackground = true;
+		}
+		//Render the scene offscreen at whatever resolution keeps us within our frame time budget
+		else if (arg == "--dynamic-resolution")
+		{
+			dynamicResolution = true;
+		}
+		//The GPU time (in milliseconds) that dynamic resolution tries to keep the scene under
+		else if (arg == "--target-frame-time" && i + 1 < argc)
+		{
+			targetFrameTimeMs = atof(args[++i]);
+			if (targetFrameTimeMs <= 0)
+			{
+				printf("Target frame time must be a positive number of milliseconds\n");
+				return false;
+			}
+		}
+		//The lowest fraction of the window size that dynamic resolution is allowed to drop to
+		else if (arg == "--min-render-scale" && i + 1 < argc)
+		{
+			minRenderScale = atof(args[++i]);
+			if (minRenderScale <= 0 || minRenderScale > 1)
+			{
+				printf("Minimum render scale must be between 0 and 1\n");
+				return false;
+			}
+		}
+		//Draw everything that's in view, even if it's hidden behind something big
+		else if (arg == "--no-occlusion")
+		{
+			occlusionCulling = false;
+		}
+		//How long drawing occluders is allowed to take each frame
+		else if (arg == "--occlusion-budget" && i + 1 < argc)
+		{
+			occlusionBudget = atof(args[++i]);
+			if (occlusionBudget <= 0)
+			{
+				printf("Occlusion budget must be a positive number of milliseconds\n");
+				return false;
+			}
+		}
+		//Run the occlusion culling benchmark and quit, instead of playing
+		else if (arg == "--bench-occlusion")
+		{
+			benchOcclusion = true;
+		}
+		//Drive around a scene of this many buildings, trees and hills (placed from --seed) instead of the built in scenery
+		else if (arg == "--stress-scene" && i + 3 < argc)
+		{
+			stressBuildings = atoi(args[++i]);
+			stressTrees = atoi(args[++i]);
+			stressHills = atoi(args[++i]);
+			if (stressBuildings < 0 || stressTrees < 0 || stressHills < 0)
+			{
+				printf("Stress scene counts can't be negative\n");
+				return false;
+			}
+		}
+		//Fly the camera around the scene for this many seconds, print the frame times and quit
+		else if (arg == "--fly-through" && i + 1 < argc)
+		{
+			flyThroughSeconds = atof(args[++i]);
+			if (flyThroughSeconds <= 0)
+			{
+				printf("Fly-through length must be a positive number of seconds\n");
+				return false;
+			}
+		}
+		//Cull stress scenes from small to big and quit, instead of playing
+		else if (arg == "--bench-stress")
+		{
+			benchStress = true;
+		}
+		//Complain about any heap allocation once the game has settled down
+		else if (arg == "--check-allocations")
+		{
+			checkAllocations = true;
+		}
+		//Record every frame into a directory, starting straight away
+		else if (arg == "--capture" && i + 1 < argc)
+		{
+			captureDirectory = args[++i];
+			captureOnStart = true;
+		}
+		//Write captured frames into one big raw file instead of a TGA each
+		else if (arg == "--capture-raw")
+		{
+			captureFormat = CAPTURE_RAW;
+		}
+		//Host a network game for others to join
+		else if (arg == "--host" && i + 1 < argc)
+		{
+			hostGame = true;
+			netPort = atoi(args[++i]);
+			if (netPort <= 0 || netPort > 65535)
+			{
+				printf("Port must be between 1 and 65535\n");
+				return false;
+			}
+		}
+		//Join someone else's network game, on the default port unless one is given (host:port)
+		else if (arg == "--connect" && i + 1 < argc)
+		{
+			connectHost = args[++i];
+			size_t colon = connectHost.rfind(':');
+			if (colon != string::npos)
+			{
+				netPort = atoi(connectHost.c_str() + colon + 1);
+				connectHost = connectHost.substr(0, colon);
+				if (netPort <= 0 || netPort > 65535)
+				{
+					printf("Port must be between 1 and 65535\n");
+					return false;
+				}
+			}
+		}
+		//Pretend the network is further away than it is
+		else if (arg == "--net-latency" && i + 1 < argc)
+		{
+			netLatencyMs = atof(args[++i]);
+			if (netLatencyMs < 0)
+			{
+				printf("Network latency can't be negative\n");
+				return false;
+			}
+		}
+		//Pretend the network loses some of what it's given
+		else if (arg == "--net-loss" && i + 1 < argc)
+		{
+			netLossPercent = atof(args[++i]);
+			if (netLossPercent < 0 || netLossPercent > 100)
+			{
+				printf("Network loss must be between 0 and 100 percent\n");
+				return false;
+			}
+		}
+		//Run the network benchmark and quit, instead of playing
+		else if (arg == "--bench-net")
+		{
+			benchNet = true;
+		}
+		//How many particles of each type there can be (0 for none)
+		else if (arg == "--particles" && i + 1 < argc)
+		{
+			particleBudget = atoi(args[++i]);
+			if (particleBudget < 0)
+			{
+				printf("Particle count can't be negative\n");
+				return false;
+			}
+		}
+		//Light the scenery as it's drawn every frame instead of baking its lighting when it loads
+		else if (arg == "--dynamic-lighting")
+		{
+			bakedLighting = false;
+		}
+		//How many minutes of driving to keep for rewinding (0 to not record at all)
+		else if (arg == "--replay-minutes" && i + 1 < argc)
+		{
+			replayMinutes = atof(args[++i]);
+			if (replayMinutes < 0)
+			{
+				printf("Replay length can't be negative\n");
+				return false;
+			}
+		}
+		//Drive over generated hills this many units across instead of the built in ground
+		else if (arg == "--terrain" && i + 1 < argc)
+		{
+			terrainSize = atoi(args[++i]);
+			if (terrainSize <= 0)
+			{
+				printf("Terrain size must be at least 1\n");
+				return false;
+			}
+		}
+		//Drive over a heightmap from a PGM file instead of the built in ground
+		else if (arg == "--heightmap" && i + 1 < argc)
+		{
+			heightmapFile = args[++i];
+		}
+		//How far away trees and buildings start turning into impostors (0 to always draw them properly)
+		else if (arg == "--impostor-distance" && i + 1 < argc)
+		{
+			impostorDistance = atof(args[++i]);
+			if (impostorDistance < 0)
+			{
+				printf("Impostor distance can't be negative\n");
+				return false;
+			}
+		}
+#ifdef GL_STATS
+		//Write what each frame asks of GL to a file every few seconds
+		else if (arg == "--gl-stats" && i + 1 < argc)
+		{
+			if (!glStatsOpenLog(args[++i]))
+			{
+				return false;
+			}
+		}
+#endif
+		else
+		{
+			printf("Unknown option: %s\n", args[i]);
+			printf("Usage: drive [--low-latency-audio] [--audio-buffer frames] [--vsync | --adaptive-vsync | --frame-cap fps | --uncapped] [--background-fps fps] [--background-pause] [--dynamic-resolution] [--target-frame-time ms] [--min-render-scale scale] [--threads count] [--bench-jobs] [--bench-objects count] [--world file] [--generate-world directory chunks] [--seed seed] [--stream-radius chunks] [--world-budget megabytes] [--autodrive] [--no-occlusion] [--occlusion-budget ms] [--bench-occlusion] [--stress-scene buildings trees hills] [--fly-through seconds] [--bench-stress] [--check-allocations] [--capture directory] [--capture-raw] [--host port] [--connect host[:port]] [--net-latency ms] [--net-loss percent] [--bench-net] [--particles count] [--dynamic-lighting] [--replay-minutes minutes] [--terrain size | --heightmap file] [--impostor-distance units]");
+#ifdef GL_STATS
+			printf(" [--gl-stats file]");
+#endif
+			printf("\n");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
 /*
 * Intitialises the SDL, SDL_TTF and SDL_Mixer, creates our window and OpenGL context, and loads our fonts.
 * Returns true if all actions are successful and false if there have been any errors.
@@ -162,8 +585,8 @@ bool init()
 				errors = true;
 			}
 
-			//Load the font that we're going to be using
-			hudFont = TTF_OpenFont(("resources" + pathSeparator + "fonts" + pathSeparator + "SciFly-Sans.ttf").c_str(), hudSize);
+			//Load the font that we're going to be using (straight out of the executable if it was cooked in)
+			hudFont = TTF_OpenFontRW(openAsset("fonts", "SciFly-Sans.ttf"), 1, hudSize);
 			if(hudFont == NULL)
 			{
 				printf("Error whilst loading description font face: %s\n", TTF_GetError());
@@ -178,7 +601,8 @@ bool init()
 			}
 
 			//Test opening audio so that if there are problems, we know about it now
-			if(Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
+			//The buffer size decides how far behind the game our sound effects are - 2048 frames is about 46ms, so --low-latency-audio drops it a lot lower
+			if(Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, audioBufferSize) < 0)
 			{
 				printf("Error whilst initialising SDL_mixer: %s\n", Mix_GetError());
 				errors = false;
@@ -193,11 +617,8 @@ bool init()
 			}
 			else
 			{
-				//FIXME: This is meant to enforce vsync, but I still get tearing \o/
-				if(SDL_GL_SetSwapInterval(1) < 0)
-				{
-					printf("No vsync? : %s\n", SDL_GetError());
-				}
+				//Set up vsync (or not) depending on how we want our frames paced
+				initFramePacing(win);
 
 				//Call our function that tests a bunch of OpenGL initialisaton
 				if(!initGL())
@@ -205,6 +626,14 @@ bool init()
 					printf("We couldn't get the OpenGLs to work for us. We'll have to bail :(!\n");
 					errors = true;
 				}
+				//Set up the offscreen buffer if we want dynamic resolution (if we can't, we'll just render straight to the window as usual)
+				else
+				{
+					initDynamicResolution(screenWidth, screenHeight);
+
+					//Compile the shader that unpacks our compact vertices (if we can't, they get unpacked on the CPU)
+					initMeshRendering();
+				}
 			}
 		}
 	}
@@ -228,7 +657,7 @@ bool initGL()
 	glLoadIdentity();
 
 	//Set up the camera's frustrum by defining the horizontal FOV (75 here), the aspect ratio from which the vertical FOV can be derived, and the near and far clipping planes
-	gluPerspective(75, (float)screenWidth / (float)screenHeight, 0.2f, 2000);
+	gluPerspective(fieldOfView, (float)screenWidth / (float)screenHeight, 0.2f, 2000);
 	
 	//Check for errors
 	e = glGetError();
@@ -283,12 +712,95 @@ bool initGL()
 
 
 
+/*
+* Polls for and handles all of the input events that have arrived since the last frame.
+* Returns nothing.
+*/
+void handleEvents()
+{
+	//Declare an SDL_Event object that we'll use for polling for mouse and keyboard input
+	SDL_Event e;
+
+	//While we have input events to handle (this allows us to deal with multiple events per loop iteration)
+	while(SDL_PollEvent(&e) != 0)
+	{
+		//Switch on the type of input event we've gotten
+		switch (e.type)
+		{
+
+			case SDL_MOUSEMOTION:
+				//Update the camera orientation based on the relative x and y mouse movement
+				handleMouseMotion(e.motion.xrel, e.motion.yrel);
+				framePacingNoteInput(e.motion.timestamp);
+				break;
+
+			case SDL_KEYDOWN:
+			case SDL_KEYUP:
+				//Perform any state changes (like steering, acceleration or quitting) that result from keyboard input events
+				handleKeys(e.key);
+				framePacingNoteInput(e.key.timestamp);
+				break;
+
+			case SDL_MOUSEBUTTONDOWN:
+			case SDL_MOUSEBUTTONUP:
+				//Perform any state changes or actions that result from mouse click events (this is a placeholder)
+				handleMouseClick(e.button);
+				break;
+
+			case SDL_WINDOWEVENT:
+				//Keep track of focus and minimising so that we can slow down or stop drawing when nobody's looking
+				framePacingWindowEvent(e.window);
+				break;
+
+			case SDL_QUIT:
+				//Set the running flag to false so that we'll fall out of the game loop
+				running = false;
+				break;
+
+			default:
+				break;
+		}
+	}
+}
+
+
+/*
+* Grabs any mouse movement that has arrived since we handled events at the start of the frame, so that the camera orientation is as up to date as possible when we start drawing.
+* Only mouse motion is taken out of the queue here - everything else waits for handleEvents() next frame.
+* Returns nothing.
+*/
+void latchCameraInput()
+{
+	//Ask SDL to fetch anything new from the OS
+	SDL_PumpEvents();
+
+	//Take the mouse motion events out of the queue a handful at a time
+	SDL_Event events[16];
+	int count = 0;
+	do
+	{
+		count = SDL_PeepEvents(events, 16, SDL_GETEVENT, SDL_MOUSEMOTION, SDL_MOUSEMOTION);
+		for (int i = 0; i < count; i++)
+		{
+			handleMouseMotion(events[i].motion.xrel, events[i].motion.yrel);
+			framePacingNoteInput(events[i].motion.timestamp);
+		}
+	} while (count == 16);
+}
+
+
 /*
 * Updates our camera orientation variables based on the relative X and Y mouse movement.
 * Returns nothing.
 */
 void handleMouseMotion(int xrel, int yrel)
 {
+	//While we're playing back, the camera looks wherever it looked at the time
+	if (isReplaying())
+	{
+		return;
+	}
+
 	//If we've moved in the X axis
 	if (xrel != 0)
 	{
@@ -441,6 +953,11 @@ void handleKeys(SDL_KeyboardEvent key)
 
 		case SDLK_w:
 		case SDLK_UP:
+			//Let the audio code know that the throttle changed so that it can time how long it takes to be heard
+			if (key.repeat == 0)
+			{
+				audioMarkControlInput();
+			}
 			if (press)
 			{
 				//Make go faster
@@ -454,6 +971,10 @@ void handleKeys(SDL_KeyboardEvent key)
 
 		case SDLK_s:
 		case SDLK_DOWN:
+			if (key.repeat == 0)
+			{
+				audioMarkControlInput();
+			}
 			if (press)
 			{
 				//Brake
@@ -473,6 +994,89 @@ void handleKeys(SDL_KeyboardEvent key)
 			}
 			break;
 
+		case SDLK_o:
+			if (press)
+			{
+				//Toggle occlusion culling so that we can see what it's saving us
+				occlusionCulling = !occlusionCulling;
+				printf("Occlusion culling %s\n", occlusionCulling ? "on" : "off");
+			}
+			break;
+
+		case SDLK_r:
+			if (press && key.repeat == 0)
+			{
+				//Start rewinding, or take over from wherever the replay has got to
+				if (isReplaying())
+				{
+					stopReplay();
+
+					//Pick the controls back up from whatever's being held down now rather than whatever was held down in the replay
+					const Uint8 *keys = SDL_GetKeyboardState(NULL);
+					carSteer = (keys[SDL_SCANCODE_A] || keys[SDL_SCANCODE_LEFT]) ? 1 : (keys[SDL_SCANCODE_D] || keys[SDL_SCANCODE_RIGHT]) ? -1 : 0;
+					carAccel = autoDrive || keys[SDL_SCANCODE_W] || keys[SDL_SCANCODE_UP];
+					carBrake = keys[SDL_SCANCODE_S] || keys[SDL_SCANCODE_DOWN];
+				}
+				else if (netActive())
+				{
+					printf("Replays aren't available in network games\n");
+				}
+				else if (!startReplay())
+				{
+					printf("There's nothing to replay (see --replay-minutes)\n");
+				}
+			}
+			break;
+
+		case SDLK_SPACE:
+			if (press && isReplaying())
+			{
+				toggleReplayPause();
+			}
+			break;
+
+		case SDLK_LEFTBRACKET:
+		case SDLK_RIGHTBRACKET:
+			if (press && isReplaying())
+			{
+				//Step through the playback speeds: [ goes towards rewinding quickly and ] towards fast forward
+				changeReplaySpeed((key.keysym.sym == SDLK_LEFTBRACKET) ? -1 : 1);
+			}
+			break;
+
+		case SDLK_HOME:
+		case SDLK_END:
+			if (press && isReplaying())
+			{
+				jumpReplay(key.keysym.sym == SDLK_END);
+			}
+			break;
+
+		case SDLK_F9:
+			if (press)
+			{
+				//Start or stop recording frames
+				if (isCapturing())
+				{
+					stopCapture();
+				}
+				else
+				{
+					startCapture(screenWidth, screenHeight);
+				}
+			}
+			break;
+
+#ifdef GL_STATS
+		case SDLK_F3:
+			if (press)
+			{
+				//Show or hide what the last frame asked GL to do
+				glStatsOverlay = !glStatsOverlay;
+			}
+			break;
+#endif
+
 		case SDLK_ESCAPE:
 		case SDLK_q:
 			//Quit the game when Q is pressed
@@ -484,62 +1088,50 @@ void handleKeys(SDL_KeyboardEvent key)
 
 /*
 * Handles the loose simulation that the game runs on. Moving these calculations outside of input events and rendering calls is important.
-* Longer term, it would make sense to bring the time since last frame into the equation so that movement becomes independent of frame rate (you could also go multithreaded).
+* This is called simTickRate times a second (see framePacingSimTicks()), so movement is independent of frame rate.
 * Returns nothing.
 */
 void updateSim()
 {
-	//Steering will be a negative number for right, positive number for left. If we're going straight, then carSteer will be zero and there'll be no change
-	carDirection += 5.0f * carSteer;
-	
-	//Adjust orientation to fit within 0 - 360 degrees
-	if (carDirection > 360)
-	{
-		carDirection = fmod(carDirection, 360.0f);
-	}
-	else if (carDirection < 0)
-	{
-		carDirection = 360.0f - carDirection;
-	}
+	CarInput input = {carSteer, carAccel, carBrake};
 
-	//If we're braking, slow us down nice and quick
-	if (carBrake)
-	{
-		carSpeed -= 0.01f;
-		if (carSpeed < 0)
-		{
-			carSpeed = 0.0f;
-		}	
-	}
-	//If we're accelerating, speed us up quickfast (node that this increases our speed over time rather than jumping instantly to top speed)
-	else if (carAccel)
+	//Over the network, the network layer runs our car (and everyone else's) and tells us where it ended up
+	CarState car = {carX, carY, carDirection, carSpeed};
+	if (netActive())
 	{
-		carSpeed += 0.01f;
-		if (carSpeed > 0.25f)
-		{
-			carSpeed = 0.25f;
-		}
+		netTick(input);
+		car = netLocalCar();
 	}
-	//If we're not braking or accelerating, let's slow down by a tiny amount to give the impression of drag
-	else if (carSpeed > 0.02f)
+	else
 	{
-		carSpeed -= 0.0025f;
-		
-		//This if is unnecessary, but if we ever applied drag when carSpeed was below 0.0025, we'd end up moving backwards, so we'd need this check
-		if (carSpeed < 0)
-		{
-			carSpeed = 0.0f;
-		}
+		stepCar(&car, input);
 	}
+	carX = car.x;
+	carY = car.y;
+	carDirection = car.direction;
+	carSpeed = car.speed;
+
+	//Keep every tick so that we can rewind
+	ReplayFrame frame = {car, input, rotX, rotY};
+	replayRecord(frame);
+}
 
-	//Yay, trigonometry! What we're calculating is the distance that the vehicle has traveled from 0,0 (world origin) along each axis since the last frame
-	//cos() and sin() take stuff in radians, so we're doing the conversion from degrees inline
-	float dy = cos((M_PI * carDirection) / 180) * carSpeed;
-	float dx = sin((M_PI * carDirection) / 180) * carSpeed;
 
-	//Add these new distances to the car's current position
-	carX += dx;	
-	carY += dy;	
+/*
+* Puts the vehicle, the controls and the camera back the way they were in a tick that's being replayed.
+* Returns nothing.
+*/
+void applyReplayFrame(const ReplayFrame &frame)
+{
+	carX = frame.car.x;
+	carY = frame.car.y;
+	carDirection = frame.car.direction;
+	carSpeed = frame.car.speed;
+	carSteer = frame.input.steer;
+	carAccel = frame.input.accel;
+	carBrake = frame.input.brake;
+	rotX = frame.rotX;
+	rotY = frame.rotY;
 }
 
 
@@ -560,6 +1152,132 @@ void rotateCamera()
         
         //Correct up axis for roll/gimbal lock by resetting Z rotation to 0;
 	glRotatef(0, 0, 0, 1);
+
+	//Move the world so that the camera is where it's meant to be (which is where everything is drawn from, unless we're flying through)
+	glTranslatef(-cameraX, -cameraHeight, -cameraY);
+}
+
+
+/*
+* Works out the planes that bound the camera's view from the current projection and modelview matrices, so that we can skip objects that are completely outside of it.
+* This needs to be called after rotateCamera().
+* Returns nothing.
+*/
+void updateFrustum()
+{
+	GLfloat projection[16];
+	GLfloat modelview[16];
+	glGetFloatv(GL_PROJECTION_MATRIX, projection);
+	glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+
+	//Combine the two matrices (OpenGL stores them column by column)
+	GLfloat clip[16];
+	for (int col = 0; col < 4; col++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			clip[col * 4 + row] = 0;
+			for (int k = 0; k < 4; k++)
+			{
+				clip[col * 4 + row] += projection[k * 4 + row] * modelview[col * 4 + k];
+			}
+		}
+	}
+
+	//Each plane is the last row of the combined matrix plus or minus one of the other rows (left, right, bottom, top, near, far)
+	for (int p = 0; p < 6; p++)
+	{
+		int row = p / 2;
+		float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+		for (int col = 0; col < 4; col++)
+		{
+			frustumPlanes[p][col] = clip[col * 4 + 3] + sign * clip[col * 4 + row];
+		}
+
+		//Normalise the plane so that plugging a point into it gives us a real distance that we can compare with a radius
+		float length = sqrt(frustumPlanes[p][0] * frustumPlanes[p][0] + frustumPlanes[p][1] * frustumPlanes[p][1] + frustumPlanes[p][2] * frustumPlanes[p][2]);
+		for (int col = 0; col < 4; col++)
+		{
+			frustumPlanes[p][col] /= length;
+		}
+	}
+
+	//Occlusion culling needs the same view to draw occluders into its depth buffer
+	occlusionBeginFrame(clip);
+}
+
+
+/*
+* Tests scenery objects begin to end (exclusive) in sceneryDrawList against the view frustum and sets their visible flags. This runs on the job threads, so it mustn't touch OpenGL.
+* Returns nothing.
+*/
+void cullScenery(void *data, int begin, int end)
+{
+	for (int i = begin; i < end; i++)
+	{
+		GameObject *o = sceneryDrawList[i];
+
+		//Move the centre of the bounding sphere to where renderObject() will put the object (rotated around Y by rz, then moved to x, y)
+		float c = cos((M_PI * o->rz) / 180);
+		float s = sin((M_PI * o->rz) / 180);
+		float x = o->x + o->mesh->boundX * c + o->mesh->boundZ * s;
+		float y = o->mesh->boundY;
+		float z = o->y - o->mesh->boundX * s + o->mesh->boundZ * c;
+
+		//If the sphere is entirely on the outside of any plane, we can't see any of it
+		o->visible = true;
+		for (int p = 0; p < 6; p++)
+		{
+			if (frustumPlanes[p][0] * x + frustumPlanes[p][1] * y + frustumPlanes[p][2] * z + frustumPlanes[p][3] < -o->mesh->boundRadius)
+			{
+				o->visible = false;
+				break;
+			}
+		}
+	}
+}
+
+
+/*
+* Frame graph stage that culls all of the scenery, split up between the job threads.
+* Returns nothing.
+*/
+void cullSceneryStage(void *data)
+{
+	jobsParallelFor((int)sceneryDrawList.size(), 16, cullScenery, NULL);
+}
+
+
+/*
+* Frame graph stage that hides scenery that's behind big objects like buildings and hills. This only looks at what frustum culling has left visible, so it has to go after that.
+* Returns nothing.
+*/
+void occlusionStage(void *data)
+{
+	cullOccluded(sceneryDrawList);
+}
+
+
+/*
+* Frame graph stage that positions our sounds. SDL_mixer does its own locking, so this is safe to run on any thread.
+* Returns nothing.
+*/
+void soundStage(void *data)
+{
+	updateSound();
+}
+
+
+/*
+* Sets up the stages of work that happen every frame between the simulation and submitting geometry. Culling and sound don't depend on each other, so they can run at the same time, but occlusion culling has to wait for frustum culling to finish.
+* Returns nothing.
+*/
+void buildFrameGraph()
+{
+	int cullStage = jobGraphAdd(&frameGraph, "cull scenery", cullSceneryStage, NULL);
+	int occlusionCullStage = jobGraphAdd(&frameGraph, "occlusion", occlusionStage, NULL);
+	jobGraphAdd(&frameGraph, "sound", soundStage, NULL);
+	jobGraphDepends(&frameGraph, occlusionCullStage, cullStage);
 }
 
 
@@ -591,11 +1309,12 @@ void updateLighting()
 
 	//Set the position for this light
 	//FIXME: There's something fishy about the position required to get this light behaving nicely - it's probably indicating weird normals?
-	GLfloat position[] = {0.0f, 10.0f, 200.0f, 1.0f};
+	//The scenery's baked lighting is worked out from the same position and ambient level, so change them in lighting.h
+	GLfloat position[] = {sceneLightPosition[0], sceneLightPosition[1], sceneLightPosition[2], 1.0f};
 	glLightfv(GL_LIGHT0, GL_POSITION, position);
 
 	//Make the ambient light level nice and bright
-	GLfloat gambient[] = {0.8f, 0.8f, 0.8f, 1.0f};
+	GLfloat gambient[] = {sceneAmbient, sceneAmbient, sceneAmbient, 1.0f};
 	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, gambient);
 }
 
@@ -624,7 +1343,24 @@ void updateSound()
 
 	//Adjust the fan sound's volume so that it's louder when we're going faster
 	//carSpeed will never be more than 0.25, so the fan volume will never be more than MIX_MAX_VOLUME / 4
-	Mix_VolumeChunk(sampleFans, MIX_MAX_VOLUME * carSpeed);
+	//If our mixing callback is running, it picks the new volume up on the very next audio buffer without either side having to wait on a lock
+	if (fanGainInCallback)
+	{
+		audioSetFanGain(carSpeed);
+	}
+	else
+	{
+		Mix_VolumeChunk(sampleFans, MIX_MAX_VOLUME * carSpeed);
+	}
+
+	//Let us know if the audio thread hasn't been keeping up
+	static Uint32 lastUnderruns = 0;
+	AudioStats audioStats = getAudioStats();
+	if (audioStats.underruns != lastUnderruns)
+	{
+		printf("Audio underrun (%u so far) - try a bigger --audio-buffer\n", audioStats.underruns);
+		lastUnderruns = audioStats.underruns;
+	}
 
 	//Set the fan sound position
 	if(!Mix_SetPosition(mixChannelFans, bearing + rotX, distance * 4))
@@ -638,14 +1374,21 @@ void updateSound()
 * Draws the geometry for a given object, translating and rotating it as required.
 * Returns nothing.
 */
-void renderObject(GameObject o)
+void renderObject(const GameObject &o)
 {
 	//Push the current matrix onto the stack (just in case it's not stored there - we want to make sure we can come back to it)
 	glPushMatrix();
 
-	//Translate (move) and rotate based on the object's x and y properties
-	glTranslatef(o.x, 0.0f, o.y);
-	glRotatef(o.rz, 0.0f, 1.0f, 0.0f);		
+	//Use the object's world matrix if it's in the transform hierarchy, and otherwise translate (move) and rotate based on the object's x and y properties
+	if (o.transform != transformNone)
+	{
+		glMultMatrixf(getWorldMatrix(o.transform));
+	}
+	else
+	{
+		glTranslatef(o.x, 0.0f, o.y);
+		glRotatef(o.rz, 0.0f, 1.0f, 0.0f);
+	}
 
 	//Enable ambient and diffuse colouring
 	glEnable(GL_COLOR_MATERIAL);
@@ -654,81 +1397,123 @@ void renderObject(GameObject o)
 	//Set the rendering colour based on the scenery object's colour
 	glColor3ub(o.colour.r, o.colour.g, o.colour.b);
 
-	//Make c style arrays for the vertex, face and lists that we can pass to OpenGL
-	GLfloat * verts = new GLfloat[o.vertexList.size()];
-	copy(o.vertexList.begin(),o.vertexList.end(), verts);
-
-	GLubyte * faces = new GLubyte[o.faceList.size()];
-	copy(o.faceList.begin(), o.faceList.end(), faces);
+	//Draw the model's packed geometry, with the lighting that was baked into it if there is any
+	drawMesh(o.mesh, (bakedLighting && !o.bakedColours.empty()) ? &o.bakedColours[0] : NULL);
 
-	GLubyte * normals = new GLubyte[o.normalList.size()];
-	copy(o.normalList.begin(), o.normalList.end(), normals);
+	//Pop the last stored matrix off the top of the stack so that we go back to the state we were in at the start of the loop		
+	glPopMatrix();
+}
 
-	//Enable the use of vertex and normal arrays
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_NORMAL_ARRAY);
 
-	//Give OpenGL pointers to our vertex and normal arrays
-	glVertexPointer(3, GL_FLOAT, 0, verts);
-	//FIXME: We get a segfault here if we pass GL_UNSIGNED_BYTE as the first parameter, even though that's the type that we're reading
-	//FIXME: Also, some normals aren't facing the direction we'd expect - I'm not sure that we should be skipping over every third value, but it's 3am, and it looks better this way than the alternatives \o/
-	glNormalPointer(GL_BYTE, sizeof(GLubyte) * 3, normals);
 
-	//Ask OpenGL to draw polygons based on the indices contained in the faces array, which correspond to the vertexes from the normal array
-	glDrawElements(GL_TRIANGLES, o.faceList.size(), GL_UNSIGNED_BYTE, faces);
+/*
+* Loop through all of our visible scenery objects and call renderObject() for each.
+* Returns nothing.
+*/
+void renderScenery()
+{
+	sceneryDrawnObjects = 0;
+	sceneryDrawnTriangles = 0;
+	beginImpostors(cameraX, cameraY);
 
-	//Disable the use of vertex and normal arrays (since we might not need this for other rendering)
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_NORMAL_ARRAY);
+	//Loop through our list of scenery objects and render the ones that cullScenery() says we can see
+	//Far away trees and buildings are queued up as impostors instead, and those in between are drawn both ways with a dither pattern each
+	for (size_t i = 0; i < sceneryDrawList.size(); i++)
+	{
+		GameObject *o = sceneryDrawList[i];
+		if (!o->visible)
+		{
+			continue;
+		}
 
-	//Since we're using new above, these deletes are necessary
-	delete [] verts;
-	delete [] faces;
-	delete [] normals;
+		int fade = (o->mesh->impostor >= 0) ? impostorFadeLevel(*o, cameraX, cameraY) : 0;
+		if (fade < impostorFadeLevels)
+		{
+			if (fade > 0)
+			{
+				beginMeshFade(fade);
+			}
+			renderObject(*o);
+			if (fade > 0)
+			{
+				endMeshFade();
+			}
+			sceneryDrawnTriangles += o->mesh->indices.size() / 3;
+		}
+		if (fade > 0)
+		{
+			addImpostor(*o, fade);
+			sceneryDrawnTriangles += 2;
+		}
+		sceneryDrawnObjects++;
+	}
 
-	//Pop the last stored matrix off the top of the stack so that we go back to the state we were in at the start of the loop		
-	glPopMatrix();
+	renderImpostors();
 }
 
 
-
 /*
-* Loop through all of our scenery objects and call renderObject() for each.
+* Loop through all of our vehicle objects and call renderObject() for each, at the given position and orientation.
 * Returns nothing.
 */
-void renderScenery()
+void renderVehicle(float x, float y, float direction)
 {
-	//Loop through our list of scenery objects and render them
-	list<GameObject>::iterator x;
-	for(x = sceneryObjects.begin(); x != sceneryObjects.end(); ++x)
+	//Move the vehicle to its new position, up on top of the terrain if there is any. Only the vehicle and its parts need their world matrices working out again
+	setTransform(vehicleTransform, x, carHoverHeight + terrainHeight(x, y), y, direction);
+	updateTransforms();
+
+	//Loop through our list of vehicle objects and render them
+	list<GameObject>::iterator object;
+	for(object = vehicleObjects.begin(); object != vehicleObjects.end(); ++object)
 	{
-		renderObject(*x);
+		renderObject(*object);
 	}
 }
 
 
 /*
-* Loop through all of our vehicle objects and call renderObject() for each.
+* Draws our vehicle, and everyone else's if we're in a network game.
 * Returns nothing.
 */
 void renderCar()
 {
-	//Push the current matrix onto the stack (just in case it's not stored there - we want to make sure we can come back to it)
-	glPushMatrix();
+	renderVehicle(carX, carY, carDirection);
 
-	//Translate to the vehicle's new position
-	glTranslatef(carX, -1.8f, carY);
-	glRotatef(carDirection, 0.0f, 1.0f, 0.0f);
-	
-	//Loop through our list of scenery objects and render them
-	list<GameObject>::iterator x;
-	for(x = vehicleObjects.begin(); x != vehicleObjects.end(); ++x)
+	if (netActive())
 	{
-		renderObject(*x);
+		NetCar others[netMaxPlayers];
+		int count = netOtherCars(others, netMaxPlayers);
+		for (int i = 0; i < count; i++)
+		{
+			renderVehicle(others[i].state.x, others[i].state.y, others[i].state.direction);
+		}
 	}
+}
 
-	//Pop the vehicle's position off the matrix stack
-	glPopMatrix();
+
+/*
+* Starts the particles coming off our vehicle, and everyone else's if we're in a network game.
+* Returns nothing.
+*/
+void updateVehicleParticles(float seconds)
+{
+	updateParticles(seconds);
+
+	CarState car = {carX, carY, carDirection, carSpeed};
+	CarInput input = {carSteer, carAccel, carBrake};
+	emitVehicleParticles(car, input, seconds);
+
+	//We don't know what anyone else is pressing, so guess from how they're moving
+	if (netActive())
+	{
+		NetCar others[netMaxPlayers];
+		int count = netOtherCars(others, netMaxPlayers);
+		for (int i = 0; i < count; i++)
+		{
+			CarInput guess = {0, others[i].state.speed > 0.02f, false};
+			emitVehicleParticles(others[i].state, guess, seconds);
+		}
+	}
 }
 
 
@@ -754,11 +1539,11 @@ void renderHUD()
 	glColor3ub(textColour.r, textColour.g, textColour.b);
 
 	//Make a character array for our HUD text
-	char hudtext[20];
+	char hudtext[64];
 	
 	//Fill the HUD text with the current speed, and then render it towards the bottom right of the screen
 	sprintf(hudtext, "Speed: %.0f", carSpeed * 100);
-	renderText(hudFont, screenWidth - 300, screenHeight - hudSize * 5, 300, hudtext);
+	renderText(hudAtlas, screenWidth - 300, screenHeight - hudSize * 5, 300, hudtext);
 
 	//Fill the HUD text with the implied state of the left fan, and then draw it towards the bottom left of the screen
 	if ((carSteer < 0) || (carSteer == 0 && !carAccel))
@@ -769,7 +1554,7 @@ void renderHUD()
 	{
 		sprintf(hudtext, "Left Fan: On");
 	}
-	renderText(hudFont, 100, screenHeight - hudSize * 5, 300, hudtext);
+	renderText(hudAtlas, 100, screenHeight - hudSize * 5, 300, hudtext);
 
 	//Fill the HUD text with the implied state of the right fan, and then draw it towards the bottom left of the screen
 	if ((carSteer > 0) || (carSteer == 0 && !carAccel))
@@ -780,8 +1565,48 @@ void renderHUD()
 	{
 		sprintf(hudtext, "Right Fan: On");
 	}
-	renderText(hudFont, 100, screenHeight - hudSize * 4, 300, hudtext);
-	
+	renderText(hudAtlas, 100, screenHeight - hudSize * 4, 300, hudtext);
+
+	//Show how long it's taking for input to make it to the screen, towards the top right of the screen
+	FramePacingStats pacingStats = getFramePacingStats();
+	sprintf(hudtext, "Latency: %.1fms", pacingStats.latencyAverageMs);
+	renderText(hudAtlas, screenWidth - 300, hudSize, 300, hudtext);
+	sprintf(hudtext, "FPS: %.0f", pacingStats.fps);
+	renderText(hudAtlas, screenWidth - 300, hudSize * 2, 300, hudtext);
+
+	//If the scene resolution is changing to keep up, show where it's at
+	if (dynamicResolution)
+	{
+		sprintf(hudtext, "Scale: %.0f%%", getRenderScale() * 100);
+		renderText(hudAtlas, screenWidth - 300, hudSize * 3, 300, hudtext);
+	}
+
+	//Show how many particles were started last frame and what sending them to the GPU cost
+	if (particleBudget > 0)
+	{
+		ParticleStats particleStats = getParticleStats();
+		sprintf(hudtext, "Particles: %d (%.1fKB)", particleStats.emitted, particleStats.uploadBytes / 1024.0f);
+		renderText(hudAtlas, screenWidth - 300, hudSize * 4, 300, hudtext);
+	}
+
+	//While we're playing back, show where we are in the recording and how quickly we're going through it
+	if (isReplaying())
+	{
+		ReplayStats replayStats = getReplayStats();
+		sprintf(hudtext, "Replay %+.2gx: -%.1fs of %.0fs", getReplaySpeed(), getReplaySecondsBehind(), replayStats.minutes * 60);
+		renderText(hudAtlas, 100, screenHeight - hudSize * 3, 400, hudtext);
+		sprintf(hudtext, "%.1fKB/min, seek %.1fus", replayStats.bytesPerMinute / 1024.0f, replayStats.seekAverageUs);
+		renderText(hudAtlas, 100, screenHeight - hudSize * 2, 400, hudtext);
+	}
+
+#ifdef GL_STATS
+	//List out the last frame's GL calls down the left hand side if we've been asked to
+	if (glStatsOverlay)
+	{
+		renderGLStatsPage(hudAtlas, 100, hudSize, screenWidth - 500);
+	}
+#endif
+
 	//Reset the matrix state that we set at the beginning of the function
 	glMatrixMode(GL_PROJECTION);
 	glPopMatrix();
@@ -793,185 +1618,71 @@ void renderHUD()
 
 
 /*
-* Renders a given string in a given font at given coordinates, wrapping to a given width.
+* Puts every scenery object that isn't already in the transform hierarchy into it, each on its own since none of them hang off anything else.
 * Returns nothing.
 */
-void renderText(TTF_Font *font, float x, float y, int width, string text)
+void attachScenery()
 {
-	//Create a new SDL_Surface and write the string to it - we'll be generating our OpenGL texture from this
-	//It's worth noting that the colour parameter is more or less ignored, as the glColour call overrides
-	SDL_Surface *surf = TTF_RenderText_Blended_Wrapped(font, text.c_str(), textColour, width);
-	if(surf == NULL)
-	{
-		printf("Error whilst rendering text: %s\n", TTF_GetError());
-	}
- 
- 	//Make a new OpenGL texture and bind our current rendering actions to it
-	unsigned tex = 0;
-	glGenTextures(1, &tex);
-	glBindTexture(GL_TEXTURE_2D, tex);
- 
- 	//Set some properties for this texture. These are to do with how scaling is handled when the texture is rendered above or below its native pixel resolution
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	//Copy the pixels from our SDL_Surface into the new texture
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, surf->w, surf->h, 0, GL_BGRA, GL_UNSIGNED_BYTE, surf->pixels);
- 
-	//Draw this texture on a quad with the given coordinates.
-	glBegin(GL_QUADS);
-		glTexCoord2d(0, 0); glVertex3d(x, y, 1.0);
-		glTexCoord2d(1, 0); glVertex3d(x + surf->w, y, 1.0);
-		glTexCoord2d(1, 1); glVertex3d(x + surf->w, y + surf->h, 1.0);
-		glTexCoord2d(0, 1); glVertex3d(x, y + surf->h, 1.0);
-	glEnd();
- 
-	//Clean up the texture and surface since we won't be using them anymore
-	glDeleteTextures(1, &tex);
-	SDL_FreeSurface(surf);
+	list<GameObject>::iterator x;
+	for (x = sceneryObjects.begin(); x != sceneryObjects.end(); ++x)
+	{
+		if (x->transform == transformNone)
+		{
+			attachTransform(&(*x), transformNone);
+		}
+	}
 }
 
 
 /*
-* Reads a specified .obj model and creates a GameObject instance representing the 3D model and its position/rotation in 3D space.
-* Returns a GameObject.
+* Works out the lighting for everything in sceneryObjects and keeps it in their vertex colours (unless we're lighting the scenery as it's drawn), using the cache file if it's still right.
+* Returns nothing.
 */
-GameObject loadObj(string objFile, SDL_Colour foo, float posX, float posY, float rotZ)
+void bakeScenery(string cacheFile)
 {
-	//Create a new GameObject and set its properties based on what's been passed in
-	GameObject newObject;
-	newObject.name = objFile;
-	newObject.x = posX;
-	newObject.y = posY;
-	newObject.rz = rotZ;
-
-	//TODO: This stuff should be parsed from whatever mtrl files the OBJ says it uses
-	//Set the colour for the object
-	newObject.colour.r = foo.r;
-	newObject.colour.g = foo.g;
-	newObject.colour.b = foo.b;
-
-	//Declare some temporary variables that we'll be using
-	GLfloat x = 0;
-	GLfloat y = 0;
-	GLfloat z = 0;
-
-	//Open the .obj file
-	string fileName = "resources" + pathSeparator + "models" + pathSeparator + objFile;
-	FILE * currentFile = fopen(fileName.c_str(), "r");
-
-	//If the file exists and can be opened
-	if(currentFile != NULL)
-	{
-		printf("  Attempting to parse obj file %s\n", fileName.c_str());
-		
-		//Loop through forever (we'll break out if we detect the end of the file)
-		while(1)
+	if (bakedLighting)
+	{
+		vector<GameObject*> staticObjects;
+		list<GameObject>::iterator x;
+		for (x = sceneryObjects.begin(); x != sceneryObjects.end(); ++x)
 		{
-			//A character array that we'll store the first part of the line that we're reading in
-			char lineType[256];
-
-			//TODO: Longer term, it'd probably be worth just reading the entire line here and then do our conditionals based on  the first two characters, instead of just reading the first word.
-			//Grab everything on the line before the first space (in the Wavefront OBJ format, the first few characters indicate the type of data stored on that line)
-			int result = fscanf(currentFile, "%s ", lineType);
-
-			//printf("   %s\n", lineType);
-
-			//If we've hit the end of the file, drop out of the loop
-			if (result == EOF)
-			{
-				break;
-			}
-
-			//TODO: There are other line types in the OBJ spec such as vt, usemtrl and mtrlib that we're ignoring for now
-			//If the line represents a vertex
-			if (strcmp(lineType, "v") == 0)
-			{
-				//Read the three float values and store them in the object's vertex list
-				fscanf(currentFile, "%f %f %f\n", &x, &y, &z);
-				newObject.vertexList.push_back(x);
-				newObject.vertexList.push_back(y);
-				newObject.vertexList.push_back(z);
-
-
-			}
-			//If the line represents a face
-			else if (strcmp(lineType, "f") == 0)
-			{
-				//Declare some temporary arrays to store the values we're reading out
-				unsigned int faceDefs[3];
-				unsigned int normalDefs[3];
-
-				//TODO: This doesn't account for other styles of face definitions (with texture verts)
-				//Read the vertex and normal values out of the file and put them into the temporary arrays
-				int pcount = fscanf(currentFile, "%d//%d %d//%d %d//%d\n", &faceDefs[0], &normalDefs[0], &faceDefs[1], &normalDefs[1], &faceDefs[2], &normalDefs[2]);
-				//If we've gotten the right number of pattern matches when reading from the file
-				if (pcount == 6)
-				{
-					
-					//These indices aren't 0 based, so let's subtract one to get the right index into vertexList[]
-					//Push the face and normal values onto their respective lists
-					//We're adding them backwards so that they're in the right order (we should probably just be using push_front instead)
-					newObject.faceList.push_back((GLubyte)(faceDefs[2] - 1));
-					newObject.faceList.push_back((GLubyte)(faceDefs[1] - 1));
-					newObject.faceList.push_back((GLubyte)(faceDefs[0] - 1));
-
-					//FIXME: There's something funky going on here with how we're reading out normals here - some faces are not facing the directions we're expecting
-					newObject.normalList.push_back((GLubyte)(normalDefs[2]));
-					newObject.normalList.push_back((GLubyte)(normalDefs[1]));
-					newObject.normalList.push_back((GLubyte)(normalDefs[0]));
-				}
-				//Else something has gone wrong. We'll output some information and try to make do with what we have
-				else
-				{
-					//Push the face and normal values onto their respective lists
-					//We're adding them backwards so that they're in the right order (we should probably just be using push_front instead)
-					newObject.faceList.push_back((GLubyte)(faceDefs[2] - 1));
-					newObject.faceList.push_back((GLubyte)(faceDefs[1] - 1));
-					newObject.faceList.push_back((GLubyte)(faceDefs[0] - 1));
-
-					newObject.normalList.push_back((GLubyte)(normalDefs[2]));
-					newObject.normalList.push_back((GLubyte)(normalDefs[1]));
-					newObject.normalList.push_back((GLubyte)(normalDefs[0]));
-
-					printf("Our obj parser is bad and we should feel bad. We couldn't parse the face defs >_<");
-					printf("%d  x: %+d  y: %+d  z: %+d\n", pcount, faceDefs[0], faceDefs[1], faceDefs[2]);
-					break;
-				}
-			}
+			staticObjects.push_back(&(*x));
 		}
-		//printf("  Finished parsing obj file: %d verts, %d face indices\n", (int)newObject.vertexList.size(), (int)newObject.faceList.size());
 
-		//Close the .obj file
-		fclose(currentFile);
-	}
-	else
-	{
-		printf("Couldn't open %s\n", fileName.c_str());
+		LightingBakeStats bake;
+		bakeLighting(staticObjects, cacheFile, true, &bake);
+		if (meshLogging)
+		{
+			printf("%s lighting for %d objects (%d vertices) in %.1fms\n", bake.fromCache ? "Loaded baked" : "Baked", bake.objects, bake.vertices, bake.milliseconds);
+		}
 	}
-
-	return newObject;
 }
 
 
 /*
-* Specifies which assets should be loaded and calls appropriate functions to load models and sounds.
+* Loads the built in scenery that we use when we're not driving around a streamed world.
 * Returns nothing.
 */
-void loadAssets()
+void loadScenery()
 {
 	//Define a temporary colour.
 	//Longer term, we'd look at reading colours from .mtrl files listed in the .obj files we're loading, but for now we'll declare our colours here
 	SDL_Colour temp = {128,128,128};
 
-	//Load the object we're using for the ground. Its coordinates in the file are already positioned below the camera, so we don't need to lower it
-	sceneryObjects.push_back(loadObj("ground.obj", temp, 0, 0, 0));
+	//Load the object we're using for the ground (unless the terrain is standing in for it). Its coordinates in the file are already positioned below the camera, so we don't need to lower it
+	if (!terrainActive())
+	{
+		sceneryObjects.push_back(loadObj("ground.obj", temp, 0, 0, 0));
+	}
 
 	//Load the object we're using for the builings. Their coordinates in the file are already positioned below the camera, so we don't need to lower it
 	sceneryObjects.push_back(loadObj("buildings.obj", temp, 0, 0, 0));
 
-	//Load the object we're using for the hill. Its coordinates in the file are already positioned below the camera, so we don't need to lower it
-	sceneryObjects.push_back(loadObj("hill.obj", temp, 0, 0, 0));
+	//Load the object we're using for the hill (which the terrain also stands in for). Its coordinates in the file are already positioned below the camera, so we don't need to lower it
+	if (!terrainActive())
+	{
+		sceneryObjects.push_back(loadObj("hill.obj", temp, 0, 0, 0));
+	}
 
 	//Make a stack of trees to line the north side of the environment! :D
 	temp = (SDL_Colour){60,128,60};
@@ -1016,6 +1727,72 @@ void loadAssets()
 	sceneryObjects.push_back(loadObj("tree.obj", temp, 80.0f, 100.0f, 0));
 	sceneryObjects.push_back(loadObj("tree.obj", temp, 90.0f, 100.0f, 0));
 
+	//None of it moves, so its world matrices are worked out once and kept
+	attachScenery();
+
+	//None of the scenery moves and neither does the light, so work out its lighting once now (or pick it up from last time) instead of every frame
+	bakeScenery("resources" + pathSeparator + "scenery.lighting");
+}
+
+
+/*
+* Rebuilds the indexable list of scenery that the culling and rendering work through, from the built in scenery and whatever part of the streamed world is loaded.
+* Returns nothing.
+*/
+void rebuildDrawList()
+{
+	sceneryDrawList.clear();
+
+	list<GameObject>::iterator x;
+	for(x = sceneryObjects.begin(); x != sceneryObjects.end(); ++x)
+	{
+		sceneryDrawList.push_back(&(*x));
+	}
+
+	addWorldObjects(sceneryDrawList);
+}
+
+
+/*
+* Specifies which assets should be loaded and calls appropriate functions to load models and sounds.
+* Returns nothing.
+*/
+void loadAssets()
+{
+	//Make or load the terrain first, so that the built in scenery knows to leave its own ground out
+	if (!heightmapFile.empty())
+	{
+		if (!loadHeightmap(heightmapFile))
+		{
+			printf("Falling back to the built in ground\n");
+		}
+	}
+	else if (terrainSize > 0)
+	{
+		generateTerrain(terrainSize, generateWorldSeed);
+	}
+
+	//Load either the built in scenery, a stress scene or the streamed world. The world won't have anything in it until updateWorldStreaming() starts loading chunks around the car
+	if (stressBuildings + stressTrees + stressHills > 0)
+	{
+		stressScene = generateStressScene(sceneryObjects, stressBuildings, stressTrees, stressHills, generateWorldSeed);
+		attachScenery();
+		bakeScenery("resources" + pathSeparator + "stress.lighting");
+	}
+	else if (worldFile.empty())
+	{
+		loadScenery();
+	}
+	else if (!loadWorld(worldFile))
+	{
+		printf("Falling back to the built in scenery\n");
+		worldFile = "";
+		loadScenery();
+	}
+
+	//Define a temporary colour for the vehicle.
+	SDL_Colour temp;
+
 	//Load the components that make up the vehicle
 	temp = (SDL_Colour){30, 30, 30};
 	vehicleObjects.push_back(loadObj("bladder.obj", temp, 0, 0, 0));
@@ -1023,13 +1800,33 @@ void loadAssets()
 	vehicleObjects.push_back(loadObj("chasis.obj", temp, 0, 0, 0));
 	vehicleObjects.push_back(loadObj("fans.obj", temp, 0, 0, 0));
 
+	//The parts all hang off one node that moves with the vehicle
+	vehicleTransform = createTransform(transformNone);
+	list<GameObject>::iterator part;
+	for (part = vehicleObjects.begin(); part != vehicleObjects.end(); ++part)
+	{
+		attachTransform(&(*part), vehicleTransform);
+	}
+
+	//Blow particles out of the back of the fans and from under the bladder (if we can do them on the GPU; otherwise we go without)
+	initParticles(vehicleObjects.back().mesh, vehicleObjects.front().mesh);
+
+	//Make an indexable list of the scenery for culling
+	rebuildDrawList();
+
+	//Take pictures of the trees and buildings from all the way around, for drawing them far away
+	initImpostors();
+
+	//Render every character the HUD might need up front, so that drawing text each frame is just a few quads
+	buildFontAtlas(hudFont, textColour, &hudAtlas);
+
 	//Set the initial direction and location of the vehicle so that it'll be visible on screen when the game starts
 	carDirection = 180.0f;
 	carY = -4.0f;
 
 
-	//Load a sound that will represent the hover fan's constant sound
-	sampleHover = Mix_LoadWAV(("resources" + pathSeparator + "sounds" + pathSeparator + "hovercraft.ogg").c_str());
+	//Load a sound that will represent the hover fan's constant sound. Like the font, sounds come out of the executable if they were cooked in
+	sampleHover = Mix_LoadWAV_RW(openAsset("sounds", "hovercraft.ogg"), 1);
 	if(sampleHover == NULL)
 	{
 		fprintf(stderr, "Unable to load audio file hovercraft.ogg: %s\n", Mix_GetError());
@@ -1054,7 +1851,7 @@ void loadAssets()
 
 	
 	//Load a sound that will represent the movement fans' sound
-	sampleFans = Mix_LoadWAV(("resources" + pathSeparator + "sounds" + pathSeparator + "fan.ogg").c_str());
+	sampleFans = Mix_LoadWAV_RW(openAsset("sounds", "fan.ogg"), 1);
 	if(sampleFans == NULL)
 	{
 		fprintf(stderr, "Unable to load audio file fan.ogg: %s\n", Mix_GetError());
@@ -1071,6 +1868,13 @@ void loadAssets()
 		fprintf(stderr, "Unable to play audio file fan.ogg: %s\n", Mix_GetError());
 	}
 
+	//Hand the fan volume over to our mixing callback if we can. It does the volume itself, so the chunk goes back to full volume
+	fanGainInCallback = initAudioMixing(mixChannelFans);
+	if (fanGainInCallback)
+	{
+		Mix_VolumeChunk(sampleFans, MIX_MAX_VOLUME);
+	}
+
 	//Set the position of the fans' sound to match the angle and distance of the vehicle
 	if(!Mix_SetPosition(mixChannelFans, 0,  sqrt(pow(carX,2.0) + pow(carY, 2.0))))
 	{
@@ -1078,7 +1882,7 @@ void loadAssets()
 	}
 	
 	//Load a repeating sound that will be played as a music track
-	sampleMusic = Mix_LoadMUS(("resources" + pathSeparator + "sounds" + pathSeparator + "Funk_Game_Loop.ogg").c_str());
+	sampleMusic = Mix_LoadMUS_RW(openAsset("sounds", "Funk_Game_Loop.ogg"), 1);
 	if(sampleMusic == NULL)
 	{
 		fprintf(stderr, "Unable to play audio file Funk_Game_Loop.ogg: %s\n", Mix_GetError());
@@ -1104,6 +1908,42 @@ void close()
 	//TODO: Is there anything else we need to do here? Should we kill the GL context, etc.?
 
 	printf("Time to quit now \\o/\n");
+
+	//Unhook our mixing callbacks before the mixer goes away
+	closeAudioMixing();
+
+	//Tell the host we're leaving, or stop hosting
+	netClose();
+
+	//Write out any frames we're still capturing, and free the offscreen buffer, mesh shader, particles, terrain, impostor atlas and font atlas while we still have a GL context
+	stopCapture();
+	closeDynamicResolution();
+	closeMeshRendering();
+	closeParticles();
+	closeTerrain();
+	closeImpostors();
+	freeFontAtlas(&hudAtlas);
+
+	//Stop our job threads
+	jobsShutdown();
+
+	//Stop streaming and throw the world away, and then the transform hierarchy that it and everything else was in
+	closeWorld();
+	closeTransforms();
+
+	//Say what keeping the replay cost, and throw it away
+	ReplayStats replayStats = getReplayStats();
+	if (replayStats.minutes > 0)
+	{
+		printf("Replay: %.1f minutes kept in %.1fKB (%.1fKB a minute, %.1fKB set aside), %ld seeks taking %.1fus on average and %.1fus at most\n", replayStats.minutes, replayStats.bytes / 1024.0f, replayStats.bytesPerMinute / 1024.0f, replayStats.capacity / 1024.0f, replayStats.seeks, replayStats.seekAverageUs, replayStats.seekMaxUs);
+	}
+	replayClose();
+
+	closeFrameArena();
+
+	//Write out the last of the GL statistics
+	glStatsClose();
+
 	SDL_DestroyWindow(win);
 	win = NULL;
 
@@ -1113,12 +1953,63 @@ void close()
 }
 
 
+//The microbenchmarks (microbench.cpp) build this file without main() so that they can drive the game's own functions
+#ifndef HOVER_DRIVE_NO_MAIN
 /*
 * Calls our initialisation and asset loading functions, and then runs the main game loop.
 * Returns an integer representing the quit state (zero means things exited normally).
 */
 int main(int argc, char* args[])
 {
+	//If the command line doesn't make sense, don't bother starting
+	if(!parseArgs(argc, args))
+	{
+		return 1;
+	}
+
+	//If we're only here for the job system benchmark, run it and leave
+	if (benchJobs)
+	{
+		runJobBenchmark(jobThreads, benchJobObjects);
+		return 0;
+	}
+
+	if (benchOcclusion)
+	{
+		runOcclusionBenchmark(jobThreads);
+		return 0;
+	}
+
+	if (benchStress)
+	{
+		runStressBenchmark(jobThreads, stressBuildings, stressTrees, stressHills, generateWorldSeed);
+		return 0;
+	}
+
+	if (benchNet)
+	{
+		runNetBenchmark(netMaxPlayers, 10);
+		return 0;
+	}
+
+	//If we're only here to generate a world, do that and leave
+	if (!generateWorldDirectory.empty())
+	{
+		return generateWorld(generateWorldDirectory, generateWorldSize, generateWorldSeed) ? 0 : 1;
+	}
+
+	//Start up the threads that share out per-frame work
+	jobsInit(jobThreads);
+
+	//Set aside the memory that each frame's temporary data comes out of
+	initFrameArena();
+
+	//And the memory that we keep the last few minutes of driving in
+	replayInit();
+
+	//Time how long it takes to get from here to the first frame, which is mostly reading (or unpacking) assets
+	Uint64 startupStart = SDL_GetPerformanceCounter();
+
 	//If we have problems during the initialisation, print a message and skip running the game
 	if(!init())
 	{
@@ -1130,8 +2021,46 @@ int main(int argc, char* args[])
 		//Load in all our models and sounds
 		loadAssets();
 
-		//Declare an SDL_Event object that we'll use for polling for mouse and keyboard input
-		SDL_Event e;
+		//Set up the work that gets done each frame
+		buildFrameGraph();
+
+		printf("Started up in %.1fms with %s assets\n", (double)(SDL_GetPerformanceCounter() - startupStart) * 1000 / SDL_GetPerformanceFrequency(), assetsEmbedded() ? "cooked" : "file");
+
+		//Start recording if we've been asked to
+		if (captureOnStart)
+		{
+			startCapture(screenWidth, screenHeight);
+		}
+
+		//Start or join a network game if we've been asked to (if that doesn't work out, we just play on our own)
+		if (hostGame)
+		{
+			netHost(netPort);
+		}
+		else if (!connectHost.empty())
+		{
+			netConnect(connectHost.c_str(), netPort);
+		}
+
+		//Put our foot down if we've been asked to
+		if (autoDrive)
+		{
+			carAccel = true;
+		}
+
+		//Plan the fly-through. Without a stress scene, it goes around the built in scenery
+		if (flyThroughSeconds > 0)
+		{
+			if (stressBuildings + stressTrees + stressHills == 0)
+			{
+				stressScene.seed = generateWorldSeed;
+				stressScene.buildings = stressScene.trees = stressScene.hills = stressScene.groundTiles = 0;
+				stressScene.size = 800;
+				stressScene.milliseconds = 0;
+			}
+			flyThrough = makeFlyThrough(stressScene, flyThroughSeconds);
+			beginFlyThroughReport(stressScene, flyThroughSeconds);
+		}
 
 		//Turn on mouse grab
 		SDL_SetRelativeMouseMode((SDL_bool)true);
@@ -1139,46 +2068,61 @@ int main(int argc, char* args[])
 		//While we want the game to continue
 		while(running)
 		{
-			//Update the vehicle simulation to reflect the changes that should've happened since the last iteration of this loop
-			updateSim();
+			//Wait until it's time for the next frame (if we're capping the frame rate). We wait before reading input rather than after drawing so that the input is fresh
+			framePacingWait();
+
+			//Everything the last frame put in the frame arena is finished with now
+			frameArenaReset();
 
-			//While we have input events to handle (this allows us to deal with multiple events per loop iteration)
-			while(SDL_PollEvent(&e) != 0)
+			//Handle any input that's arrived since last frame before we simulate, so that it affects this frame rather than the next one
+			handleEvents();
+
+			//Update the vehicle simulation to catch up with real time. This runs at a fixed rate, so it may take zero, one or several ticks
+			int simTicks = framePacingSimTicks();
+			ReplayFrame replayFrame;
+			if (advanceReplay(simTicks, &replayFrame))
+			{
+				//If we're playing back, show the recording instead
+				applyReplayFrame(replayFrame);
+			}
+			else
 			{
-				//Switch on the type of input event we've gotten
-				switch (e.type)
+				for (int i = 0; i < simTicks; i++)
 				{
-
-					case SDL_MOUSEMOTION:
-						//Update the camera orientation based on the relative x and y mouse movement
-						handleMouseMotion(e.motion.xrel, e.motion.yrel);
-						break;
-
-					case SDL_KEYDOWN:
-					case SDL_KEYUP:
-						//Perform any state changes (like steering, acceleration or quitting) that result from keyboard input events
-						handleKeys(e.key);
-						break;
-
-					case SDL_MOUSEBUTTONDOWN:
-					case SDL_MOUSEBUTTONUP:
-						//Perform any state changes or actions that result from mouse click events (this is a placeholder)
-						handleMouseClick(e.button);
-						break;
-
-					case SDL_QUIT:
-						//Set the running flag to false so that we'll fall out of the game loop
-						running = false;
-						break;
-
-					default:
-						break;
+					updateSim();
 				}
 			}
+
+			//Particles move themselves on the GPU, so all they need from us is the new ones
+			updateVehicleParticles(simTicks / (float)simTickRate);
+
+			//Load the parts of the world around the car and drop the distant ones (this only waits on the disk in the background, never here)
+			if (!worldFile.empty() && updateWorldStreaming(carX, carY))
+			{
+				rebuildDrawList();
+			}
+
+			//Bring in the terrain around the car (just the rows and columns it's moved onto). A fly-through leaves the car parked and takes the camera all over the scene, so then it's the camera the terrain follows (from where it was last frame, which is close enough)
+			if (flyThroughSeconds > 0)
+			{
+				updateTerrain(cameraX, cameraY);
+			}
+			else
+			{
+				updateTerrain(carX, carY);
+			}
+
+			//Work out the world matrices of anything that's been placed or moved (scenery only needs it once, when it arrives)
+			updateTransforms();
+
+			//If the window is minimised there's nothing to draw to, so go back around and wait
+			if (!framePacingShouldRender())
+			{
+				continue;
+			}
 			
-			//Bind our rendering to the primary framebuffer and tell OpenGL to render to the entire window
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
-			glViewport(0, 0, screenWidth, screenHeight);
+			//Bind our rendering to the primary framebuffer (or our offscreen buffer if we're using dynamic resolution) and set the viewport to match
+			beginSceneRender();
 			
 			//Clear the buffer with our background colour (a nice blue)
 			glClearColor(0.5f, 0.5f, 1.0f, 1.0f);
@@ -1187,17 +2131,35 @@ int main(int argc, char* args[])
 			//Enable depth testing - this allows a polygon's position in 3D space to determine whether it's visible or occluded (otherwise everything will render based on the order in which we're drawing things)
 			glEnable(GL_DEPTH_TEST);
 
-			//Rotate the camera to match the current camera orientation
+			//Pick up any mouse movement that's arrived while we were busy, and then rotate the camera to match the current camera orientation
+			latchCameraInput();
+
+			//If we're flying through, the path says where the camera is and where it's looking instead
+			if (flyThroughSeconds > 0)
+			{
+				FlyThroughPose pose = flyThroughAt(flyThrough, flyThroughTime());
+				cameraX = pose.x;
+				cameraY = pose.y;
+				cameraHeight = pose.height;
+				rotX = pose.heading;
+				rotY = pose.pitch;
+			}
 			rotateCamera();
 
+			//Work out what the camera can see so that the culling stage can skip everything else
+			updateFrustum();
+
 			//Push this matrix onto the stack so that it becomes the "default" matrix for anything afterward (this allows the scene to be rendered as though the camera has moved whilst still using normal x, y coordinates. 
 			glPushMatrix();
 
 			//Set the lighting colour and position
 			updateLighting();
 
-			//Set the position of any positional audio we have
-			updateSound();
+			//Cull the scenery and set the position of any positional audio we have, spread across our job threads
+			jobGraphRun(&frameGraph);
+
+			//Render the terrain under everything else
+			renderTerrain();
 
 			//Render the scenery models
 			renderScenery();
@@ -1205,14 +2167,38 @@ int main(int argc, char* args[])
 			//Render the vehicle models
 			renderCar();
 
+			//Render the exhaust and spray over the top of everything solid
+			renderParticles(screenHeight * getRenderScale(), fieldOfView);
+
+			//If we rendered offscreen, stretch the scene over the window so that the HUD can go on top at full resolution
+			endSceneRender();
+
 			//Render the speed and fan states as HUD elements
 			renderHUD();
 
 			//Pop the matrix so that we don't have anything lefton the stack.
 			glPopMatrix();
 
+			//If we're recording, start reading this frame back before it goes out (the pixels arrive a few frames later)
+			captureFrame();
+
 			//Draw our freshly rendered frame to the window
 			SDL_GL_SwapWindow(win);
+
+			//Note when the frame went out so that we can keep track of input latency
+			framePacingPresented();
+
+			//Once the fly-through has been all the way round, say how the frames went and stop
+			if (flyThroughSeconds > 0 && flyThroughFrame(sceneryDrawnObjects, sceneryDrawnTriangles))
+			{
+				running = false;
+			}
+
+			//Start counting GL calls afresh for the next frame
+			glStatsFrameEnd();
+
+			//Count up this frame's heap allocations. We only expect them while the world is streaming in or we're writing captured frames out
+			allocationFrameEnd(isWorldStreamingIdle() && !isCapturing());
 		}
 	}
 
@@ -1232,3 +2218,4 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 	
 }
 #endif
+#endif
@@ -0,0 +1,23 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+//Measures how many environment steps a second the batched environments manage with each number of threads
+//Usage: drive_envbench [threads] [seconds]
+#include <stdlib.h>
+#include "envs.h"
+
+int main(int argc, char *argv[])
+{
+	int threads = (argc > 1) ? atoi(argv[1]) : 0;
+	int seconds = (argc > 2) ? atoi(argv[2]) : 3;
+	runEnvBenchmark(threads, (seconds > 0) ? seconds : 3);
+	return 0;
+}
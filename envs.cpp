@@ -0,0 +1,455 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include "envs.h"
+#include "jobs.h"
+#include "random.h"
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//How many environments each job steps. Enough that the job system's overhead disappears, few enough that every core gets a share of a few thousand
+const int envStepGrain = 256;
+
+//A batch of environments. The vehicles are kept together in one array and so are their observations, so that stepping them is a straight run through memory
+struct EnvBatch
+{
+	int count;
+	int rays;
+	float rayRange;
+	int stride;
+
+	vector<CarState> states;
+	vector<float> observations;
+
+	//The range finders' angles from straight ahead
+	vector<float> rayCos;
+	vector<float> raySin;
+
+	//The obstacles, and a grid over them (each cell lists every obstacle that pokes into it) so that each vehicle only looks at the ones nearby
+	vector<EnvObstacle> obstacles;
+	float gridX;
+	float gridY;
+	float cellSize;
+	int gridWidth;
+	int gridHeight;
+	vector<int> cellStart;
+	vector<int> cellObstacles;
+
+	//The actions for the step in progress
+	const CarInput *actions;
+};
+
+
+/*
+* Works out which grid cells a square covers, clamped to the grid.
+* Returns false if the square misses the grid altogether.
+*/
+static bool gridRange(const EnvBatch *batch, float x, float y, float halfSize, int *x0, int *y0, int *x1, int *y1)
+{
+	*x0 = (int)floor((x - halfSize - batch->gridX) / batch->cellSize);
+	*y0 = (int)floor((y - halfSize - batch->gridY) / batch->cellSize);
+	*x1 = (int)floor((x + halfSize - batch->gridX) / batch->cellSize);
+	*y1 = (int)floor((y + halfSize - batch->gridY) / batch->cellSize);
+	if (*x1 < 0 || *y1 < 0 || *x0 >= batch->gridWidth || *y0 >= batch->gridHeight)
+	{
+		return false;
+	}
+	*x0 = (*x0 < 0) ? 0 : *x0;
+	*y0 = (*y0 < 0) ? 0 : *y0;
+	*x1 = (*x1 >= batch->gridWidth) ? batch->gridWidth - 1 : *x1;
+	*y1 = (*y1 >= batch->gridHeight) ? batch->gridHeight - 1 : *y1;
+	return true;
+}
+
+
+/*
+* Sorts the obstacles into the grid. The cells are as big as the range finders can see, so a vehicle never has to look at more than three cells across.
+* Returns nothing.
+*/
+static void buildObstacleGrid(EnvBatch *batch)
+{
+	batch->cellSize = (batch->rayRange > 1) ? batch->rayRange : 1;
+
+	float minX = 0, minY = 0, maxX = 0, maxY = 0;
+	for (size_t i = 0; i < batch->obstacles.size(); i++)
+	{
+		const EnvObstacle &o = batch->obstacles[i];
+		if (i == 0 || o.x - o.radius < minX) minX = o.x - o.radius;
+		if (i == 0 || o.y - o.radius < minY) minY = o.y - o.radius;
+		if (i == 0 || o.x + o.radius > maxX) maxX = o.x + o.radius;
+		if (i == 0 || o.y + o.radius > maxY) maxY = o.y + o.radius;
+	}
+	batch->gridX = minX;
+	batch->gridY = minY;
+	batch->gridWidth = (int)((maxX - minX) / batch->cellSize) + 1;
+	batch->gridHeight = (int)((maxY - minY) / batch->cellSize) + 1;
+
+	//Count what goes in each cell, turn the counts into where each cell's list starts, then fill the lists in
+	int cells = batch->gridWidth * batch->gridHeight;
+	vector<int> counts(cells, 0);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (size_t i = 0; i < batch->obstacles.size(); i++)
+		{
+			const EnvObstacle &o = batch->obstacles[i];
+			int x0, y0, x1, y1;
+			if (!gridRange(batch, o.x, o.y, o.radius, &x0, &y0, &x1, &y1))
+			{
+				continue;
+			}
+			for (int cy = y0; cy <= y1; cy++)
+			{
+				for (int cx = x0; cx <= x1; cx++)
+				{
+					int cell = cy * batch->gridWidth + cx;
+					if (pass == 0)
+					{
+						counts[cell]++;
+					}
+					else
+					{
+						batch->cellObstacles[batch->cellStart[cell] + counts[cell]++] = i;
+					}
+				}
+			}
+		}
+
+		if (pass == 0)
+		{
+			batch->cellStart.assign(cells + 1, 0);
+			for (int c = 0; c < cells; c++)
+			{
+				batch->cellStart[c + 1] = batch->cellStart[c] + counts[c];
+				counts[c] = 0;
+			}
+			batch->cellObstacles.resize(batch->cellStart[cells]);
+		}
+	}
+}
+
+
+/*
+* Fills in one vehicle's observation row from its state, casting its range finders against the obstacles near it.
+* Returns nothing.
+*/
+static void observe(EnvBatch *batch, int index)
+{
+	const CarState &car = batch->states[index];
+	float *row = &batch->observations[(size_t)index * batch->stride];
+	row[envObservationX] = car.x;
+	row[envObservationY] = car.y;
+	row[envObservationDirection] = car.direction;
+	row[envObservationSpeed] = car.speed;
+
+	float *ranges = row + envObservationRays;
+	for (int r = 0; r < batch->rays; r++)
+	{
+		ranges[r] = batch->rayRange;
+	}
+
+	int x0, y0, x1, y1;
+	if (batch->obstacles.empty() || !gridRange(batch, car.x, car.y, batch->rayRange, &x0, &y0, &x1, &y1))
+	{
+		return;
+	}
+
+	//Straight ahead is the same way stepCar() moves the vehicle, and the range finders turn from there
+	float forwardX = sin((M_PI * car.direction) / 180);
+	float forwardY = cos((M_PI * car.direction) / 180);
+	float rayX[envMaxRays];
+	float rayY[envMaxRays];
+	for (int r = 0; r < batch->rays; r++)
+	{
+		rayX[r] = forwardX * batch->rayCos[r] + forwardY * batch->raySin[r];
+		rayY[r] = forwardY * batch->rayCos[r] - forwardX * batch->raySin[r];
+	}
+
+	for (int cy = y0; cy <= y1; cy++)
+	{
+		for (int cx = x0; cx <= x1; cx++)
+		{
+			int cell = cy * batch->gridWidth + cx;
+			for (int k = batch->cellStart[cell]; k < batch->cellStart[cell + 1]; k++)
+			{
+				//A big obstacle can be in more than one of the cells we're looking at, but seeing it twice doesn't change the answer
+				const EnvObstacle &o = batch->obstacles[batch->cellObstacles[k]];
+				float dx = o.x - car.x;
+				float dy = o.y - car.y;
+				float distanceSquared = dx * dx + dy * dy;
+				float reach = batch->rayRange + o.radius;
+				if (distanceSquared > reach * reach)
+				{
+					continue;
+				}
+
+				float inside = distanceSquared - o.radius * o.radius;
+				for (int r = 0; r < batch->rays; r++)
+				{
+					if (inside <= 0)
+					{
+						ranges[r] = 0;
+						continue;
+					}
+
+					//How far along the ray the obstacle's middle is, and then where the ray first meets its edge (if it does)
+					float along = dx * rayX[r] + dy * rayY[r];
+					float discriminant = along * along - inside;
+					if (along <= 0 || discriminant < 0)
+					{
+						continue;
+					}
+					float hit = along - sqrt(discriminant);
+					ranges[r] = (hit < ranges[r]) ? hit : ranges[r];
+				}
+			}
+		}
+	}
+}
+
+
+/*
+* Job function that steps a range of environments with their actions and observes the results.
+* Returns nothing.
+*/
+static void stepEnvs(void *data, int begin, int end)
+{
+	EnvBatch *batch = (EnvBatch *)data;
+	for (int i = begin; i < end; i++)
+	{
+		stepCar(&batch->states[i], batch->actions[i]);
+		observe(batch, i);
+	}
+}
+
+
+/*
+* Job function that observes a range of environments without stepping them (for when they've just been set up).
+* Returns nothing.
+*/
+static void observeEnvs(void *data, int begin, int end)
+{
+	EnvBatch *batch = (EnvBatch *)data;
+	for (int i = begin; i < end; i++)
+	{
+		observe(batch, i);
+	}
+}
+
+
+/*
+* Makes a batch of environments, with every vehicle at the start and its first observation ready.
+* Returns the batch, or NULL if the config doesn't make sense.
+*/
+EnvBatch *envCreate(const EnvConfig &config)
+{
+	if (config.count <= 0 || config.rays < 0 || config.rays > envMaxRays || config.rayRange < 0 || config.obstacleCount < 0)
+	{
+		printf("Environments need a positive count, no more than %d rays, and can't have negative range or obstacles\n", envMaxRays);
+		return NULL;
+	}
+
+	EnvBatch *batch = new EnvBatch;
+	batch->count = config.count;
+	batch->rays = config.rays;
+	batch->rayRange = config.rayRange;
+	batch->stride = envObservationRays + config.rays;
+	batch->states.assign(config.count, config.start);
+	batch->observations.resize((size_t)config.count * batch->stride);
+	batch->actions = NULL;
+
+	//The range finders turn left from straight ahead, the same way positive steering does
+	for (int r = 0; r < config.rays; r++)
+	{
+		float angle = 2 * M_PI * r / config.rays;
+		batch->rayCos.push_back(cos(angle));
+		batch->raySin.push_back(sin(angle));
+	}
+
+	if (config.obstacleCount > 0)
+	{
+		batch->obstacles.assign(config.obstacles, config.obstacles + config.obstacleCount);
+	}
+	buildObstacleGrid(batch);
+
+	jobsParallelFor(batch->count, envStepGrain, observeEnvs, batch);
+	return batch;
+}
+
+
+/*
+* Frees a batch of environments.
+* Returns nothing.
+*/
+void envDestroy(EnvBatch *batch)
+{
+	delete batch;
+}
+
+
+/*
+* Puts one environment's vehicle somewhere new (usually back at the start, after an episode ends) and observes it there.
+* Returns nothing.
+*/
+void envReset(EnvBatch *batch, int index, CarState state)
+{
+	if (index < 0 || index >= batch->count)
+	{
+		return;
+	}
+	batch->states[index] = state;
+	observe(batch, index);
+}
+
+
+/*
+* Steps every environment by one simulation tick, each with its own action (one per environment, in order), and observes where they end up. The environments are shared out between the job threads.
+* Returns nothing.
+*/
+void envStep(EnvBatch *batch, const CarInput *actions)
+{
+	batch->actions = actions;
+	jobsParallelFor(batch->count, envStepGrain, stepEnvs, batch);
+	batch->actions = NULL;
+}
+
+
+/*
+* Gets the latest observations, one row of envObservationSize() floats per environment, one after the other.
+* Returns the observations, which stay put until the batch is destroyed.
+*/
+const float *envObservations(const EnvBatch *batch)
+{
+	return &batch->observations[0];
+}
+
+
+/*
+* Gets how many floats there are in each environment's observation.
+* Returns the number of floats.
+*/
+int envObservationSize(const EnvBatch *batch)
+{
+	return batch->stride;
+}
+
+
+/*
+* Gets every environment's vehicle state, one after the other, for anyone who wants the exact values rather than the observations.
+* Returns the states.
+*/
+const CarState *envStates(const EnvBatch *batch)
+{
+	return &batch->states[0];
+}
+
+
+/*
+* Steps a big batch of environments through a field of obstacles with random driving, for a while with each number of threads from 1 up to maxThreads, and prints how many steps a second it managed. Every thread count drives the same way, so they should all end up with the same checksum.
+* Returns nothing.
+*/
+void runEnvBenchmark(int maxThreads, int seconds)
+{
+	if (maxThreads <= 0)
+	{
+		maxThreads = thread::hardware_concurrency();
+		maxThreads = (maxThreads > 0) ? maxThreads : 1;
+	}
+
+	const int count = 16384;
+	const int obstacleCount = 2000;
+	const float area = 2000;
+	const int actionBatches = 64;
+	const int checkSteps = 200;
+
+	unsigned int seed = 1;
+	vector<EnvObstacle> obstacles(obstacleCount);
+	for (int i = 0; i < obstacleCount; i++)
+	{
+		obstacles[i].x = (nextRandom(&seed) - 0.5f) * area;
+		obstacles[i].y = (nextRandom(&seed) - 0.5f) * area;
+		obstacles[i].radius = 2 + nextRandom(&seed) * 10;
+	}
+
+	//Vehicles spread over the field, and a pile of random actions (which mostly go forwards) to drive them with
+	vector<CarState> starts(count);
+	for (int i = 0; i < count; i++)
+	{
+		starts[i].x = (nextRandom(&seed) - 0.5f) * area;
+		starts[i].y = (nextRandom(&seed) - 0.5f) * area;
+		starts[i].direction = nextRandom(&seed) * 360;
+		starts[i].speed = nextRandom(&seed) * 0.25f;
+	}
+	vector<CarInput> actions((size_t)count * actionBatches);
+	for (size_t i = 0; i < actions.size(); i++)
+	{
+		float choice = nextRandom(&seed);
+		actions[i].steer = (choice < 0.2f) ? -1 : (choice < 0.4f) ? 1 : 0;
+		actions[i].accel = nextRandom(&seed) < 0.7f;
+		actions[i].brake = nextRandom(&seed) < 0.05f;
+	}
+
+	EnvConfig config;
+	config.count = count;
+	config.rays = 8;
+	config.rayRange = 50;
+	config.obstacles = &obstacles[0];
+	config.obstacleCount = obstacleCount;
+	config.start = starts[0];
+
+	printf("Environment benchmark: %d environments, %d obstacles over %.0f units square, %d range finders reaching %.0f units, %d seconds a run\n", count, obstacleCount, area, config.rays, config.rayRange, seconds);
+	printf("%8s %16s %10s %20s\n", "threads", "steps/second", "speedup", "checksum");
+
+	double singleRate = 0;
+	for (int threads = 1; threads <= maxThreads; threads++)
+	{
+		jobsInit(threads);
+		EnvBatch *batch = envCreate(config);
+		for (int i = 0; i < count; i++)
+		{
+			envReset(batch, i, starts[i]);
+		}
+
+		//A fixed number of steps first, to check that sharing the work out doesn't change the results
+		for (int s = 0; s < checkSteps; s++)
+		{
+			envStep(batch, &actions[(size_t)(s % actionBatches) * count]);
+		}
+		double checksum = 0;
+		const float *observations = envObservations(batch);
+		for (size_t i = 0; i < (size_t)count * envObservationSize(batch); i++)
+		{
+			checksum += observations[i];
+		}
+
+		long steps = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		chrono::steady_clock::time_point end = start + chrono::seconds(seconds);
+		chrono::steady_clock::time_point now = start;
+		while (now < end)
+		{
+			envStep(batch, &actions[(size_t)(steps % actionBatches) * count]);
+			steps++;
+			now = chrono::steady_clock::now();
+		}
+		double rate = steps * (double)count / chrono::duration<double>(now - start).count();
+		singleRate = (threads == 1) ? rate : singleRate;
+
+		printf("%8d %16.0f %9.2fx %20.3f\n", threads, rate, rate / singleRate, checksum);
+
+		envDestroy(batch);
+		jobsShutdown();
+	}
+}
@@ -0,0 +1,66 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef ENVS_H
+#define ENVS_H
+
+//Lots of independent vehicles being driven by something other than a person (driving agents being trained or tested), stepped all at once
+//None of this needs SDL or OpenGL, so it can be built into other programs with just sim.cpp and jobs.cpp. Call jobsInit() first to spread the work over every core
+#include "sim.h"
+
+//Something to steer around, as a circle on the ground
+struct EnvObstacle
+{
+	float x;
+	float y;
+	float radius;
+};
+
+//How to set up a batch of environments
+struct EnvConfig
+{
+	//How many vehicles (one per environment)
+	int count;
+
+	//How many range finders each vehicle has (up to envMaxRays), spread evenly around it starting straight ahead, and how far they can see
+	int rays;
+	float rayRange;
+
+	//The obstacles, which every environment shares
+	const EnvObstacle *obstacles;
+	int obstacleCount;
+
+	//Where vehicles start, and go back to when they're reset
+	CarState start;
+};
+
+//Each vehicle's observation is a row of envObservationSize() floats: x, y, direction (in degrees), speed, and then the distance each range finder got before hitting an obstacle (rayRange if it didn't)
+const int envObservationX = 0;
+const int envObservationY = 1;
+const int envObservationDirection = 2;
+const int envObservationSpeed = 3;
+const int envObservationRays = 4;
+
+//The most range finders a vehicle can have
+const int envMaxRays = 64;
+
+struct EnvBatch;
+
+EnvBatch *envCreate(const EnvConfig &config);
+void envDestroy(EnvBatch *batch);
+void envReset(EnvBatch *batch, int index, CarState state);
+void envStep(EnvBatch *batch, const CarInput *actions);
+const float *envObservations(const EnvBatch *batch);
+int envObservationSize(const EnvBatch *batch);
+const CarState *envStates(const EnvBatch *batch);
+void runEnvBenchmark(int maxThreads, int seconds);
+
+#endif
@@ -0,0 +1,449 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include "framepacing.h"
+#include <stdio.h>
+#include <time.h>
+
+#ifndef __MINGW64__
+	#include <sys/resource.h>
+#endif
+
+//How we're pacing frames (set from the command line)
+PacingMode pacingMode = PACING_VSYNC;
+float frameCapRate = 60.0f;
+float pacingLogInterval = 5.0f;
+
+//What we do when the window isn't in focus (set from the command line)
+float backgroundFrameRate = 10.0f;
+bool pauseInBackground = false;
+
+//What the window is up to
+static bool windowFocused = true;
+static bool windowMinimised = false;
+
+//The display's refresh rate, and whether the driver seems to be ignoring our request for vsync
+static int displayRefreshRate = 60;
+static bool vsyncIgnored = false;
+static int fastFrames = 0;
+
+//When the next capped frame is due to start
+static Uint64 nextFrameTime = 0;
+
+//How much longer than asked SDL_Delay tends to sleep for. We stop sleeping this far out from a deadline and spin the rest of the way
+static Uint64 sleepOvershoot = 0;
+
+//How much simulation time we owe, and when we last worked that out
+static Uint64 simLastTime = 0;
+static Uint64 simAccumulator = 0;
+
+//The earliest input that will be visible in the frame we're currently building (zero if there hasn't been any)
+static Uint64 frameInputTime = 0;
+
+//Running totals for the current logging interval
+static Uint64 intervalStart = 0;
+static Uint64 lastPresentTime = 0;
+static Uint32 intervalFrames = 0;
+static Uint64 intervalLatencyTotal = 0;
+static Uint64 intervalLatencyMax = 0;
+static Uint32 intervalLatencySamples = 0;
+static Uint32 intervalWakeups = 0;
+static double intervalCpuStart = 0;
+static long intervalSwitchesStart = 0;
+
+//The statistics for the last complete logging interval
+static FramePacingStats lastStats = {0, 0, 0, 0, 0, 0, 0, 0};
+
+
+/*
+* Converts a performance counter duration to milliseconds.
+* Returns the duration in milliseconds.
+*/
+static float ticksToMs(Uint64 ticks)
+{
+	return (float)((double)ticks * 1000.0 / (double)SDL_GetPerformanceFrequency());
+}
+
+
+/*
+* Gets the amount of CPU time the whole process (all threads) has used so far, and how many times the OS has switched it in and out.
+* Returns the CPU time in seconds.
+*/
+static double processCpuTime(long *contextSwitches)
+{
+#ifdef __MINGW64__
+	//clock() is wall time on Windows, so this is only really meaningful elsewhere
+	*contextSwitches = 0;
+	return (double)clock() / CLOCKS_PER_SEC;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	*contextSwitches = usage.ru_nvcsw + usage.ru_nivcsw;
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+#endif
+}
+
+
+/*
+* Sets the swap interval to match our pacing mode. This needs to be called once the GL context exists.
+* Returns true if we got the pacing we asked for (or something close enough) and false otherwise.
+*/
+bool initFramePacing(SDL_Window *window)
+{
+	bool ok = true;
+
+	switch (pacingMode)
+	{
+		case PACING_ADAPTIVE_VSYNC:
+			//A swap interval of -1 asks for late swap tearing. Not every driver supports it, so fall back to normal vsync if we need to
+			if (SDL_GL_SetSwapInterval(-1) < 0)
+			{
+				printf("No adaptive vsync, falling back to vsync: %s\n", SDL_GetError());
+				pacingMode = PACING_VSYNC;
+				//Some drivers ignore the swap interval completely - framePacingPresented() notices and starts limiting the frame rate itself
+				if (SDL_GL_SetSwapInterval(1) < 0)
+				{
+					printf("No vsync? : %s\n", SDL_GetError());
+					vsyncIgnored = true;
+					ok = false;
+				}
+			}
+			break;
+
+		case PACING_VSYNC:
+			//Some drivers ignore the swap interval completely - framePacingPresented() notices and starts limiting the frame rate itself
+			if (SDL_GL_SetSwapInterval(1) < 0)
+			{
+				printf("No vsync? : %s\n", SDL_GetError());
+				vsyncIgnored = true;
+				ok = false;
+			}
+			break;
+
+		case PACING_CAP:
+		case PACING_UNCAPPED:
+			//We don't want the driver holding us up, since we're doing our own timing (or none at all)
+			if (SDL_GL_SetSwapInterval(0) < 0)
+			{
+				printf("Couldn't turn vsync off: %s\n", SDL_GetError());
+				ok = false;
+			}
+			break;
+	}
+
+	//Find out how fast the display refreshes so that we know what to limit ourselves to if vsync doesn't work
+	SDL_DisplayMode mode;
+	if (SDL_GetWindowDisplayMode(window, &mode) == 0 && mode.refresh_rate > 0)
+	{
+		displayRefreshRate = mode.refresh_rate;
+	}
+
+	//Start off assuming SDL_Delay overshoots by a couple of milliseconds, which is typical for a desktop OS
+	sleepOvershoot = SDL_GetPerformanceFrequency() / 500;
+
+	Uint64 now = SDL_GetPerformanceCounter();
+	nextFrameTime = now;
+	simLastTime = now;
+	intervalStart = now;
+	lastPresentTime = now;
+	intervalCpuStart = processCpuTime(&intervalSwitchesStart);
+
+	return ok;
+}
+
+
+/*
+* Keeps track of focus and minimising so that we can back off when nobody's looking.
+* Returns nothing.
+*/
+void framePacingWindowEvent(SDL_WindowEvent event)
+{
+	switch (event.event)
+	{
+		case SDL_WINDOWEVENT_FOCUS_LOST:
+			windowFocused = false;
+			break;
+
+		case SDL_WINDOWEVENT_FOCUS_GAINED:
+			windowFocused = true;
+			break;
+
+		case SDL_WINDOWEVENT_MINIMIZED:
+		case SDL_WINDOWEVENT_HIDDEN:
+			windowMinimised = true;
+			break;
+
+		case SDL_WINDOWEVENT_RESTORED:
+		case SDL_WINDOWEVENT_SHOWN:
+		case SDL_WINDOWEVENT_EXPOSED:
+		case SDL_WINDOWEVENT_MAXIMIZED:
+			windowMinimised = false;
+			break;
+
+		default:
+			break;
+	}
+}
+
+
+/*
+* Works out whether there's any point drawing a frame right now.
+* Returns false if the window is minimised (or unfocused with --background-pause), and true otherwise.
+*/
+bool framePacingShouldRender()
+{
+	return !(windowMinimised || (pauseInBackground && !windowFocused));
+}
+
+
+/*
+* Waits until the given performance counter time. Sleeping is cheap on power but imprecise, and spinning is precise but keeps a core busy, so we sleep for most of the wait and spin for the last little bit.
+* Returns nothing.
+*/
+static void waitUntil(Uint64 deadline)
+{
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	Uint64 now = SDL_GetPerformanceCounter();
+
+	//Sleep in small steps until we're within the usual oversleep of the deadline
+	while (now + sleepOvershoot + frequency / 1000 < deadline)
+	{
+		Uint64 before = now;
+		SDL_Delay(1);
+		now = SDL_GetPerformanceCounter();
+		intervalWakeups++;
+
+		//Keep a running estimate of how far past a millisecond SDL_Delay(1) goes, leaning towards the worst cases we see
+		Uint64 slept = now - before;
+		Uint64 overshoot = (slept > frequency / 1000) ? slept - frequency / 1000 : 0;
+		if (overshoot > sleepOvershoot)
+		{
+			sleepOvershoot = (sleepOvershoot + overshoot) / 2;
+		}
+		else
+		{
+			sleepOvershoot -= (sleepOvershoot - overshoot) / 64;
+		}
+	}
+
+	//Spin for the rest
+	while (now < deadline)
+	{
+		now = SDL_GetPerformanceCounter();
+	}
+}
+
+
+/*
+* Writes out the frame, latency and CPU usage statistics once per logging interval.
+* Returns nothing.
+*/
+static void logPacingStats(Uint64 now)
+{
+	float elapsedMs = ticksToMs(now - intervalStart);
+	if (elapsedMs < pacingLogInterval * 1000.0f)
+	{
+		return;
+	}
+
+	long switches = 0;
+	double cpu = processCpuTime(&switches);
+
+	lastStats.fps = intervalFrames * 1000.0f / elapsedMs;
+	lastStats.frameTimeMs = (intervalFrames > 0) ? elapsedMs / intervalFrames : 0;
+	lastStats.latencySamples = intervalLatencySamples;
+	lastStats.latencyAverageMs = 0;
+	if (intervalLatencySamples > 0)
+	{
+		lastStats.latencyAverageMs = ticksToMs(intervalLatencyTotal) / intervalLatencySamples;
+	}
+	lastStats.latencyMaxMs = ticksToMs(intervalLatencyMax);
+	lastStats.cpuPercent = (float)((cpu - intervalCpuStart) * 100000.0 / elapsedMs);
+	lastStats.wakeupsPerSecond = intervalWakeups * 1000.0f / elapsedMs;
+	lastStats.contextSwitchesPerSecond = (switches - intervalSwitchesStart) * 1000.0f / elapsedMs;
+
+	const char *state = "active";
+	if (!framePacingShouldRender())
+	{
+		state = "paused";
+	}
+	else if (!windowFocused)
+	{
+		state = "background";
+	}
+
+	printf("Frames: %.1f fps (%.2fms), input to present %.1fms average, %.1fms max over %u inputs\n", lastStats.fps, lastStats.frameTimeMs, lastStats.latencyAverageMs, lastStats.latencyMaxMs, lastStats.latencySamples);
+	printf("Usage (%s): %.1f%% CPU, %.1f loop wakeups/s, %.1f context switches/s\n", state, lastStats.cpuPercent, lastStats.wakeupsPerSecond, lastStats.contextSwitchesPerSecond);
+
+	intervalStart = now;
+	intervalFrames = 0;
+	intervalLatencyTotal = 0;
+	intervalLatencyMax = 0;
+	intervalLatencySamples = 0;
+	intervalWakeups = 0;
+	intervalCpuStart = cpu;
+	intervalSwitchesStart = switches;
+}
+
+
+/*
+* Waits until it's time to start the next frame. We want to do our waiting here, before we read any input, rather than after drawing, so that the input we draw with is as fresh as possible.
+* Returns nothing.
+*/
+void framePacingWait()
+{
+	intervalWakeups++;
+	logPacingStats(SDL_GetPerformanceCounter());
+
+	//If we're not drawing at all, just sleep until something happens (or at least once a second so that our stats keep ticking over)
+	if (!framePacingShouldRender())
+	{
+		SDL_WaitEventTimeout(NULL, 1000);
+		nextFrameTime = SDL_GetPerformanceCounter();
+		return;
+	}
+
+	//Work out what rate (if any) we need to limit ourselves to
+	float rate = 0;
+	if (!windowFocused)
+	{
+		rate = backgroundFrameRate;
+	}
+	else if (pacingMode == PACING_CAP)
+	{
+		rate = frameCapRate;
+	}
+	else if ((pacingMode == PACING_VSYNC || pacingMode == PACING_ADAPTIVE_VSYNC) && vsyncIgnored)
+	{
+		rate = displayRefreshRate;
+	}
+
+	if (rate <= 0)
+	{
+		nextFrameTime = SDL_GetPerformanceCounter();
+		return;
+	}
+
+	Uint64 period = (Uint64)(SDL_GetPerformanceFrequency() / rate);
+	Uint64 now = SDL_GetPerformanceCounter();
+
+	//If we've fallen more than a frame behind (or have just dropped to a slower rate), there's no catching up, so start counting again from now
+	if (now > nextFrameTime + period || nextFrameTime > now + period)
+	{
+		nextFrameTime = now;
+	}
+
+	waitUntil(nextFrameTime);
+	nextFrameTime += period;
+}
+
+
+/*
+* Works out how many fixed simulation ticks need to run to catch the simulation up with real time.
+* Returns the number of times updateSim() should be called this frame.
+*/
+int framePacingSimTicks()
+{
+	Uint64 tickLength = SDL_GetPerformanceFrequency() / simTickRate;
+	Uint64 now = SDL_GetPerformanceCounter();
+	simAccumulator += now - simLastTime;
+	simLastTime = now;
+
+	//If we've stalled for a long time (loading, being dragged around, a breakpoint), don't try to run the whole lot at once
+	if (simAccumulator > tickLength * 5)
+	{
+		simAccumulator = tickLength * 5;
+	}
+
+	int ticks = 0;
+	while (simAccumulator >= tickLength)
+	{
+		simAccumulator -= tickLength;
+		ticks++;
+	}
+
+	return ticks;
+}
+
+
+/*
+* Records that an input event with the given SDL timestamp is going to be reflected in the frame we're building.
+* Returns nothing.
+*/
+void framePacingNoteInput(Uint32 eventTimestamp)
+{
+	//SDL stamps events in milliseconds when it pulls them from the OS, so work back from now to find when that was on the performance counter
+	Uint64 now = SDL_GetPerformanceCounter();
+	Uint32 ageMs = SDL_GetTicks() - eventTimestamp;
+	Uint64 age = (Uint64)ageMs * SDL_GetPerformanceFrequency() / 1000;
+	Uint64 inputTime = (age < now) ? now - age : now;
+
+	if (frameInputTime == 0 || inputTime < frameInputTime)
+	{
+		frameInputTime = inputTime;
+	}
+}
+
+
+/*
+* Records that a frame has just been handed to the display.
+* SDL_GL_SwapWindow returning isn't quite the same as the light leaving the screen, so the latency numbers are a lower bound on the real input-to-photon time.
+* Returns nothing.
+*/
+void framePacingPresented()
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+	Uint64 frameTime = now - lastPresentTime;
+	intervalFrames++;
+	lastPresentTime = now;
+
+	//If any input made it into this frame, we now know how long it took to get to the screen
+	if (frameInputTime != 0)
+	{
+		Uint64 latency = now - frameInputTime;
+		intervalLatencyTotal += latency;
+		if (latency > intervalLatencyMax)
+		{
+			intervalLatencyMax = latency;
+		}
+		intervalLatencySamples++;
+		frameInputTime = 0;
+	}
+
+	//If vsync is meant to be on but we keep getting frames out much faster than the display can show them, the driver isn't honouring it
+	//Once we've seen a solid second of that, we start limiting to the refresh rate ourselves
+	if ((pacingMode == PACING_VSYNC || pacingMode == PACING_ADAPTIVE_VSYNC) && !vsyncIgnored && windowFocused)
+	{
+		if (frameTime < SDL_GetPerformanceFrequency() / displayRefreshRate / 2)
+		{
+			fastFrames++;
+			if (fastFrames > displayRefreshRate)
+			{
+				printf("Vsync doesn't seem to be working, limiting to %dHz ourselves\n", displayRefreshRate);
+				vsyncIgnored = true;
+			}
+		}
+		else
+		{
+			fastFrames = 0;
+		}
+	}
+}
+
+
+/*
+* Gets the frame timing, latency and CPU usage statistics from the last complete logging interval.
+* Returns a FramePacingStats.
+*/
+FramePacingStats getFramePacingStats()
+{
+	return lastStats;
+}
@@ -0,0 +1,73 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef FRAMEPACING_H
+#define FRAMEPACING_H
+
+#include <SDL2/SDL.h>
+
+//The different ways we can decide when to start drawing the next frame
+enum PacingMode
+{
+	//Let the driver block us in SDL_GL_SwapWindow until the next vertical blank
+	PACING_VSYNC,
+
+	//Like vsync, but if we miss a vertical blank the driver swaps straight away (with a tear) rather than waiting a whole extra refresh
+	PACING_ADAPTIVE_VSYNC,
+
+	//No vsync, we time the frames ourselves to a fixed rate
+	PACING_CAP,
+
+	//No vsync and no waiting
+	PACING_UNCAPPED
+};
+
+//The simulation runs at a fixed rate regardless of how fast we're drawing, so that the car handles the same at any frame rate
+//The handling numbers in updateSim() were tuned with vsync on a 60Hz display, so that's the rate we use
+const int simTickRate = 60;
+
+//How we're pacing frames and the frame rate that PACING_CAP aims for
+extern PacingMode pacingMode;
+extern float frameCapRate;
+
+//How often (in seconds) the frame pacing statistics get written to the console
+extern float pacingLogInterval;
+
+//The frame rate we drop to when the window loses focus, and whether we stop drawing altogether instead
+//We always stop drawing when the window is minimised
+extern float backgroundFrameRate;
+extern bool pauseInBackground;
+
+//Frame timing, input latency and CPU usage, averaged over the last logging interval
+struct FramePacingStats
+{
+	float fps;
+	float frameTimeMs;
+	float latencyAverageMs;
+	float latencyMaxMs;
+	Uint32 latencySamples;
+
+	//How much CPU time the process used as a percentage of one core, how often our main loop woke up, and how often the OS switched any of our threads in or out (the last two are what stop a CPU from dropping into its deeper power saving states)
+	float cpuPercent;
+	float wakeupsPerSecond;
+	float contextSwitchesPerSecond;
+};
+
+bool initFramePacing(SDL_Window *window);
+void framePacingWindowEvent(SDL_WindowEvent event);
+bool framePacingShouldRender();
+void framePacingWait();
+int framePacingSimTicks();
+void framePacingNoteInput(Uint32 eventTimestamp);
+void framePacingPresented();
+FramePacingStats getFramePacingStats();
+
+#endif
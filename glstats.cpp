@@ -0,0 +1,951 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+//We're the ones that make the real calls, so we don't want them swapped for our own
+#define GLSTATS_IMPLEMENTATION
+#include "glstats.h"
+
+#ifdef GL_STATS
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include "text.h"
+
+bool glStatsOverlay = false;
+
+//The frame we're counting, and the last one we finished
+static GLFrameStats currentFrame;
+static GLFrameStats lastFrame;
+
+//Totals since we last wrote to the log
+static const Uint32 glStatsLogInterval = 5000;
+static FILE *logFile = NULL;
+static Uint32 lastLogTime = 0;
+static int logFrames = 0;
+static GLFrameStats logTotals;
+static unsigned int logMostDrawCalls = 0;
+
+//What's between glBegin and glEnd so far
+static GLenum immediateMode = GL_TRIANGLES;
+static unsigned int immediateVertices = 0;
+
+//Where the client side arrays are, so that we can work out how much GL has to read out of them when we draw
+struct ClientArray
+{
+	bool enabled;
+	GLint size;
+	GLenum type;
+	GLsizei stride;
+
+	//Whether it comes out of a buffer object rather than our memory
+	bool inBuffer;
+};
+
+//The buffer objects bound for vertices and indices (0 means client side arrays)
+static GLuint arrayBuffer = 0;
+static GLuint elementBuffer = 0;
+
+static const int maxVertexAttribs = 16;
+static ClientArray vertexArray;
+static ClientArray normalArray;
+static ClientArray colourArray;
+static ClientArray texCoordArray;
+static ClientArray attribArrays[maxVertexAttribs];
+
+static const char *callTypeNames[GLCALL_TYPES] = {"draw", "immediate", "state", "matrix", "array", "texture", "other"};
+
+
+/*
+* Counts a call of the given type.
+* Returns nothing.
+*/
+static inline void countCall(GLCallType type)
+{
+	currentFrame.calls++;
+	currentFrame.callsByType[type]++;
+}
+
+
+/*
+* Works out how big one component of the given type is.
+* Returns the size in bytes.
+*/
+static size_t typeBytes(GLenum type)
+{
+	switch (type)
+	{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:
+			return 2;
+		case GL_DOUBLE:
+			return 8;
+		default:
+			return 4;
+	}
+}
+
+
+/*
+* Works out how big one pixel is for a texture upload.
+* Returns the size in bytes.
+*/
+static size_t pixelBytes(GLenum format, GLenum type)
+{
+	//Packed types hold the whole pixel
+	switch (type)
+	{
+		case GL_UNSIGNED_BYTE_3_3_2:
+		case GL_UNSIGNED_BYTE_2_3_3_REV:
+			return 1;
+		case GL_UNSIGNED_SHORT_5_6_5:
+		case GL_UNSIGNED_SHORT_5_6_5_REV:
+		case GL_UNSIGNED_SHORT_4_4_4_4:
+		case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+		case GL_UNSIGNED_SHORT_5_5_5_1:
+		case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+			return 2;
+		case GL_UNSIGNED_INT_8_8_8_8:
+		case GL_UNSIGNED_INT_8_8_8_8_REV:
+		case GL_UNSIGNED_INT_10_10_10_2:
+		case GL_UNSIGNED_INT_2_10_10_10_REV:
+			return 4;
+	}
+
+	size_t components;
+	switch (format)
+	{
+		case GL_RGBA:
+		case GL_BGRA:
+			components = 4;
+			break;
+		case GL_RGB:
+		case GL_BGR:
+			components = 3;
+			break;
+		case GL_LUMINANCE_ALPHA:
+		case GL_RG:
+			components = 2;
+			break;
+		default:
+			components = 1;
+			break;
+	}
+	return components * typeBytes(type);
+}
+
+
+/*
+* Works out how many primitives a number of vertices makes in the given mode.
+* Returns the number of points, lines, triangles or quads.
+*/
+static unsigned int primitivesFor(GLenum mode, unsigned int vertices)
+{
+	switch (mode)
+	{
+		case GL_POINTS:
+			return vertices;
+		case GL_LINES:
+			return vertices / 2;
+		case GL_LINE_STRIP:
+			return (vertices > 1) ? vertices - 1 : 0;
+		case GL_LINE_LOOP:
+			return (vertices > 1) ? vertices : 0;
+		case GL_TRIANGLES:
+			return vertices / 3;
+		case GL_TRIANGLE_STRIP:
+		case GL_TRIANGLE_FAN:
+			return (vertices > 2) ? vertices - 2 : 0;
+		case GL_QUADS:
+			return vertices / 4;
+		case GL_QUAD_STRIP:
+			return (vertices > 3) ? (vertices - 2) / 2 : 0;
+		default:
+			return (vertices > 2) ? 1 : 0;
+	}
+}
+
+
+/*
+* Works out how many bytes GL reads out of the enabled client side arrays for a run of vertices.
+* Returns the number of bytes.
+*/
+static size_t clientArrayBytes(unsigned int vertices)
+{
+	size_t bytes = 0;
+	const ClientArray *arrays[4 + maxVertexAttribs];
+	int count = 0;
+	arrays[count++] = &vertexArray;
+	arrays[count++] = &normalArray;
+	arrays[count++] = &colourArray;
+	arrays[count++] = &texCoordArray;
+	for (int i = 0; i < maxVertexAttribs; i++)
+	{
+		arrays[count++] = &attribArrays[i];
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		if (arrays[i]->enabled && !arrays[i]->inBuffer)
+		{
+			size_t element = arrays[i]->size * typeBytes(arrays[i]->type);
+			size_t stride = arrays[i]->stride ? arrays[i]->stride : element;
+
+			//The last vertex only needs its own element, not a whole stride
+			bytes += (vertices > 0) ? (vertices - 1) * stride + element : 0;
+		}
+	}
+	return bytes;
+}
+
+
+/*
+* Starts writing the statistics to a file every few seconds, one JSON object per line.
+* Returns true if the file could be opened.
+*/
+bool glStatsOpenLog(const char *fileName)
+{
+	logFile = fopen(fileName, "w");
+	if (logFile == NULL)
+	{
+		printf("Couldn't open %s for GL statistics\n", fileName);
+		return false;
+	}
+	return true;
+}
+
+
+/*
+* Writes the average of each statistic since the last time to the log.
+* Returns nothing.
+*/
+static void writeLog(Uint32 now)
+{
+	double frames = logFrames;
+	fprintf(logFile, "{\"time_ms\": %u, \"frames\": %d, \"calls\": %.1f, \"draw_calls\": %.1f, \"max_draw_calls\": %u, \"primitives\": %.1f, \"vertices\": %.1f, \"texture_uploads\": %.2f, \"texture_bytes\": %.1f, \"textures_created\": %.2f, \"textures_deleted\": %.2f, \"array_bytes\": %.1f, \"buffer_bytes\": %.1f, \"readback_bytes\": %.1f, \"immediate_bytes\": %.1f, \"calls_by_type\": {",
+		now, logFrames, logTotals.calls / frames, logTotals.drawCalls / frames, logMostDrawCalls, logTotals.primitives / frames, logTotals.vertices / frames,
+		logTotals.textureUploads / frames, logTotals.textureBytes / frames, logTotals.texturesCreated / frames, logTotals.texturesDeleted / frames,
+		logTotals.arrayBytes / frames, logTotals.bufferBytes / frames, logTotals.readbackBytes / frames, logTotals.immediateBytes / frames);
+	for (int i = 0; i < GLCALL_TYPES; i++)
+	{
+		fprintf(logFile, "%s\"%s\": %.1f", i ? ", " : "", callTypeNames[i], logTotals.callsByType[i] / frames);
+	}
+	fprintf(logFile, "}}\n");
+	fflush(logFile);
+}
+
+
+/*
+* Finishes counting this frame and starts on the next. Call it once a frame, after the swap.
+* Returns nothing.
+*/
+void glStatsFrameEnd()
+{
+	lastFrame = currentFrame;
+	memset(&currentFrame, 0, sizeof(currentFrame));
+
+	if (logFile == NULL)
+	{
+		return;
+	}
+
+	logFrames++;
+	logTotals.calls += lastFrame.calls;
+	for (int i = 0; i < GLCALL_TYPES; i++)
+	{
+		logTotals.callsByType[i] += lastFrame.callsByType[i];
+	}
+	logTotals.drawCalls += lastFrame.drawCalls;
+	logTotals.primitives += lastFrame.primitives;
+	logTotals.vertices += lastFrame.vertices;
+	logTotals.textureUploads += lastFrame.textureUploads;
+	logTotals.textureBytes += lastFrame.textureBytes;
+	logTotals.texturesCreated += lastFrame.texturesCreated;
+	logTotals.texturesDeleted += lastFrame.texturesDeleted;
+	logTotals.arrayBytes += lastFrame.arrayBytes;
+	logTotals.bufferBytes += lastFrame.bufferBytes;
+	logTotals.readbackBytes += lastFrame.readbackBytes;
+	logTotals.immediateBytes += lastFrame.immediateBytes;
+	if (lastFrame.drawCalls > logMostDrawCalls)
+	{
+		logMostDrawCalls = lastFrame.drawCalls;
+	}
+
+	Uint32 now = SDL_GetTicks();
+	if (lastLogTime == 0)
+	{
+		lastLogTime = now;
+	}
+	if (now - lastLogTime >= glStatsLogInterval && logFrames > 0)
+	{
+		writeLog(now);
+		lastLogTime = now;
+		logFrames = 0;
+		memset(&logTotals, 0, sizeof(logTotals));
+		logMostDrawCalls = 0;
+	}
+}
+
+
+/*
+* Gets what the last finished frame asked GL to do.
+* Returns a GLFrameStats.
+*/
+GLFrameStats getGLFrameStats()
+{
+	return lastFrame;
+}
+
+
+/*
+* Draws the last frame's statistics as a page of HUD text. Expects the HUD's pixel coordinates to be set up already. The page's own calls are counted in the frame it's drawn in, so they show up on the next one.
+* Returns nothing.
+*/
+void renderGLStatsPage(const FontAtlas &atlas, int x, int y, int width)
+{
+	const GLFrameStats &s = lastFrame;
+	char page[512];
+	snprintf(page, sizeof(page),
+		"GL calls: %u\n"
+		"Draw calls: %u\n"
+		"Primitives: %u (%u vertices)\n"
+		"Texture uploads: %u (%.1fKB)\n"
+		"Array data: %.1fKB\n"
+		"Buffer data: %.1fKB\n"
+		"Read back: %.1fKB\n"
+		"Immediate data: %.1fKB\n"
+		"Draw %u, immediate %u, state %u\n"
+		"Matrix %u, array %u, texture %u, other %u",
+		s.calls, s.drawCalls, s.primitives, s.vertices, s.textureUploads, s.textureBytes / 1024.0, s.arrayBytes / 1024.0, s.bufferBytes / 1024.0, s.readbackBytes / 1024.0, s.immediateBytes / 1024.0,
+		s.callsByType[GLCALL_DRAW], s.callsByType[GLCALL_IMMEDIATE], s.callsByType[GLCALL_STATE],
+		s.callsByType[GLCALL_MATRIX], s.callsByType[GLCALL_ARRAY], s.callsByType[GLCALL_TEXTURE], s.callsByType[GLCALL_OTHER]);
+	renderText(atlas, x, y, width, page);
+}
+
+
+/*
+* Writes out anything left over and closes the log.
+* Returns nothing.
+*/
+void glStatsClose()
+{
+	if (logFile != NULL)
+	{
+		if (logFrames > 0)
+		{
+			writeLog(SDL_GetTicks());
+		}
+		fclose(logFile);
+		logFile = NULL;
+	}
+}
+
+
+//Drawing
+
+void glStatsDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices)
+{
+	countCall(GLCALL_DRAW);
+	currentFrame.drawCalls++;
+	currentFrame.primitives += primitivesFor(mode, count);
+	currentFrame.vertices += count;
+
+	//If the indices are in our memory we can look through them. Only the range of vertices they use gets read
+	if (elementBuffer == 0 && indices != NULL && count > 0)
+	{
+		unsigned int lowest = 0xFFFFFFFF;
+		unsigned int highest = 0;
+		for (GLsizei i = 0; i < count; i++)
+		{
+			unsigned int index;
+			if (type == GL_UNSIGNED_BYTE)
+			{
+				index = ((const GLubyte *)indices)[i];
+			}
+			else if (type == GL_UNSIGNED_SHORT)
+			{
+				index = ((const GLushort *)indices)[i];
+			}
+			else
+			{
+				index = ((const GLuint *)indices)[i];
+			}
+			lowest = (index < lowest) ? index : lowest;
+			highest = (index > highest) ? index : highest;
+		}
+		currentFrame.arrayBytes += count * typeBytes(type) + clientArrayBytes(highest - lowest + 1);
+	}
+
+	glDrawElements(mode, count, type, indices);
+}
+
+void glStatsDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	countCall(GLCALL_DRAW);
+	currentFrame.drawCalls++;
+	currentFrame.primitives += primitivesFor(mode, count);
+	currentFrame.vertices += count;
+	currentFrame.arrayBytes += clientArrayBytes(count);
+	glDrawArrays(mode, first, count);
+}
+
+void glStatsBegin(GLenum mode)
+{
+	countCall(GLCALL_DRAW);
+	immediateMode = mode;
+	immediateVertices = 0;
+	glBegin(mode);
+}
+
+void glStatsEnd()
+{
+	countCall(GLCALL_DRAW);
+	currentFrame.drawCalls++;
+	currentFrame.primitives += primitivesFor(immediateMode, immediateVertices);
+	currentFrame.vertices += immediateVertices;
+	glEnd();
+}
+
+void glStatsVertex2f(GLfloat x, GLfloat y)
+{
+	countCall(GLCALL_IMMEDIATE);
+	immediateVertices++;
+	currentFrame.immediateBytes += 2 * sizeof(GLfloat);
+	glVertex2f(x, y);
+}
+
+void glStatsVertex3f(GLfloat x, GLfloat y, GLfloat z)
+{
+	countCall(GLCALL_IMMEDIATE);
+	immediateVertices++;
+	currentFrame.immediateBytes += 3 * sizeof(GLfloat);
+	glVertex3f(x, y, z);
+}
+
+void glStatsTexCoord2f(GLfloat s, GLfloat t)
+{
+	countCall(GLCALL_IMMEDIATE);
+	currentFrame.immediateBytes += 2 * sizeof(GLfloat);
+	glTexCoord2f(s, t);
+}
+
+
+//State
+
+void glStatsClear(GLbitfield mask)
+{
+	countCall(GLCALL_OTHER);
+	glClear(mask);
+}
+
+void glStatsClearColor(GLclampf r, GLclampf g, GLclampf b, GLclampf a)
+{
+	countCall(GLCALL_STATE);
+	glClearColor(r, g, b, a);
+}
+
+void glStatsEnable(GLenum cap)
+{
+	countCall(GLCALL_STATE);
+	glEnable(cap);
+}
+
+void glStatsDisable(GLenum cap)
+{
+	countCall(GLCALL_STATE);
+	glDisable(cap);
+}
+
+void glStatsColor3ub(GLubyte r, GLubyte g, GLubyte b)
+{
+	countCall(GLCALL_STATE);
+	glColor3ub(r, g, b);
+}
+
+void glStatsColorMaterial(GLenum face, GLenum mode)
+{
+	countCall(GLCALL_STATE);
+	glColorMaterial(face, mode);
+}
+
+void glStatsShadeModel(GLenum mode)
+{
+	countCall(GLCALL_STATE);
+	glShadeModel(mode);
+}
+
+void glStatsAlphaFunc(GLenum func, GLclampf ref)
+{
+	countCall(GLCALL_STATE);
+	glAlphaFunc(func, ref);
+}
+
+void glStatsPolygonStipple(const GLubyte *mask)
+{
+	countCall(GLCALL_STATE);
+	glPolygonStipple(mask);
+}
+
+void glStatsPushAttrib(GLbitfield mask)
+{
+	countCall(GLCALL_STATE);
+	glPushAttrib(mask);
+}
+
+void glStatsPopAttrib()
+{
+	countCall(GLCALL_STATE);
+	glPopAttrib();
+}
+
+void glStatsFrontFace(GLenum mode)
+{
+	countCall(GLCALL_STATE);
+	glFrontFace(mode);
+}
+
+void glStatsBlendFunc(GLenum sfactor, GLenum dfactor)
+{
+	countCall(GLCALL_STATE);
+	glBlendFunc(sfactor, dfactor);
+}
+
+void glStatsDepthMask(GLboolean flag)
+{
+	countCall(GLCALL_STATE);
+	glDepthMask(flag);
+}
+
+void glStatsViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	countCall(GLCALL_STATE);
+	glViewport(x, y, width, height);
+}
+
+void glStatsLightfv(GLenum light, GLenum pname, const GLfloat *params)
+{
+	countCall(GLCALL_STATE);
+	glLightfv(light, pname, params);
+}
+
+void glStatsLightModelfv(GLenum pname, const GLfloat *params)
+{
+	countCall(GLCALL_STATE);
+	glLightModelfv(pname, params);
+}
+
+void glStatsUseProgram(GLuint program)
+{
+	countCall(GLCALL_STATE);
+	glUseProgram(program);
+}
+
+void glStatsUniform1f(GLint location, GLfloat value)
+{
+	countCall(GLCALL_STATE);
+	glUniform1f(location, value);
+}
+
+void glStatsUniform3fv(GLint location, GLsizei count, const GLfloat *value)
+{
+	countCall(GLCALL_STATE);
+	glUniform3fv(location, count, value);
+}
+
+void glStatsUniform4fv(GLint location, GLsizei count, const GLfloat *value)
+{
+	countCall(GLCALL_STATE);
+	glUniform4fv(location, count, value);
+}
+
+void glStatsBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	countCall(GLCALL_STATE);
+	glBindFramebuffer(target, framebuffer);
+}
+
+
+//Matrices
+
+void glStatsMatrixMode(GLenum mode)
+{
+	countCall(GLCALL_MATRIX);
+	glMatrixMode(mode);
+}
+
+void glStatsPushMatrix()
+{
+	countCall(GLCALL_MATRIX);
+	glPushMatrix();
+}
+
+void glStatsPopMatrix()
+{
+	countCall(GLCALL_MATRIX);
+	glPopMatrix();
+}
+
+void glStatsLoadIdentity()
+{
+	countCall(GLCALL_MATRIX);
+	glLoadIdentity();
+}
+
+void glStatsTranslatef(GLfloat x, GLfloat y, GLfloat z)
+{
+	countCall(GLCALL_MATRIX);
+	glTranslatef(x, y, z);
+}
+
+void glStatsRotatef(GLfloat angle, GLfloat x, GLfloat y, GLfloat z)
+{
+	countCall(GLCALL_MATRIX);
+	glRotatef(angle, x, y, z);
+}
+
+void glStatsMultMatrixf(const GLfloat *m)
+{
+	countCall(GLCALL_MATRIX);
+	glMultMatrixf(m);
+}
+
+void glStatsScalef(GLfloat x, GLfloat y, GLfloat z)
+{
+	countCall(GLCALL_MATRIX);
+	glScalef(x, y, z);
+}
+
+void glStatsOrtho(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top, GLdouble zNear, GLdouble zFar)
+{
+	countCall(GLCALL_MATRIX);
+	glOrtho(left, right, bottom, top, zNear, zFar);
+}
+
+
+//Vertex arrays
+
+void glStatsEnableClientState(GLenum array)
+{
+	countCall(GLCALL_ARRAY);
+	if (array == GL_VERTEX_ARRAY)
+	{
+		vertexArray.enabled = true;
+	}
+	else if (array == GL_NORMAL_ARRAY)
+	{
+		normalArray.enabled = true;
+	}
+	else if (array == GL_COLOR_ARRAY)
+	{
+		colourArray.enabled = true;
+	}
+	else if (array == GL_TEXTURE_COORD_ARRAY)
+	{
+		texCoordArray.enabled = true;
+	}
+	glEnableClientState(array);
+}
+
+void glStatsDisableClientState(GLenum array)
+{
+	countCall(GLCALL_ARRAY);
+	if (array == GL_VERTEX_ARRAY)
+	{
+		vertexArray.enabled = false;
+	}
+	else if (array == GL_NORMAL_ARRAY)
+	{
+		normalArray.enabled = false;
+	}
+	else if (array == GL_COLOR_ARRAY)
+	{
+		colourArray.enabled = false;
+	}
+	else if (array == GL_TEXTURE_COORD_ARRAY)
+	{
+		texCoordArray.enabled = false;
+	}
+	glDisableClientState(array);
+}
+
+void glStatsVertexPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *pointer)
+{
+	countCall(GLCALL_ARRAY);
+	vertexArray.size = size;
+	vertexArray.type = type;
+	vertexArray.stride = stride;
+	vertexArray.inBuffer = (arrayBuffer != 0);
+	glVertexPointer(size, type, stride, pointer);
+}
+
+void glStatsNormalPointer(GLenum type, GLsizei stride, const GLvoid *pointer)
+{
+	countCall(GLCALL_ARRAY);
+	normalArray.size = 3;
+	normalArray.type = type;
+	normalArray.stride = stride;
+	normalArray.inBuffer = (arrayBuffer != 0);
+	glNormalPointer(type, stride, pointer);
+}
+
+void glStatsColorPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *pointer)
+{
+	countCall(GLCALL_ARRAY);
+	colourArray.size = size;
+	colourArray.type = type;
+	colourArray.stride = stride;
+	colourArray.inBuffer = (arrayBuffer != 0);
+	glColorPointer(size, type, stride, pointer);
+}
+
+void glStatsTexCoordPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *pointer)
+{
+	countCall(GLCALL_ARRAY);
+	texCoordArray.size = size;
+	texCoordArray.type = type;
+	texCoordArray.stride = stride;
+	texCoordArray.inBuffer = (arrayBuffer != 0);
+	glTexCoordPointer(size, type, stride, pointer);
+}
+
+void glStatsEnableVertexAttribArray(GLuint index)
+{
+	countCall(GLCALL_ARRAY);
+	if (index < (GLuint)maxVertexAttribs)
+	{
+		attribArrays[index].enabled = true;
+	}
+	glEnableVertexAttribArray(index);
+}
+
+void glStatsDisableVertexAttribArray(GLuint index)
+{
+	countCall(GLCALL_ARRAY);
+	if (index < (GLuint)maxVertexAttribs)
+	{
+		attribArrays[index].enabled = false;
+	}
+	glDisableVertexAttribArray(index);
+}
+
+void glStatsVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer)
+{
+	countCall(GLCALL_ARRAY);
+	if (index < (GLuint)maxVertexAttribs)
+	{
+		attribArrays[index].size = size;
+		attribArrays[index].type = type;
+		attribArrays[index].stride = stride;
+		attribArrays[index].inBuffer = (arrayBuffer != 0);
+	}
+	glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+
+//Textures
+
+void glStatsGenTextures(GLsizei n, GLuint *textures)
+{
+	countCall(GLCALL_TEXTURE);
+	currentFrame.texturesCreated += n;
+	glGenTextures(n, textures);
+}
+
+void glStatsDeleteTextures(GLsizei n, const GLuint *textures)
+{
+	countCall(GLCALL_TEXTURE);
+	currentFrame.texturesDeleted += n;
+	glDeleteTextures(n, textures);
+}
+
+void glStatsBindTexture(GLenum target, GLuint texture)
+{
+	countCall(GLCALL_TEXTURE);
+	glBindTexture(target, texture);
+}
+
+void glStatsTexParameteri(GLenum target, GLenum pname, GLint param)
+{
+	countCall(GLCALL_TEXTURE);
+	glTexParameteri(target, pname, param);
+}
+
+void glStatsTexParameterf(GLenum target, GLenum pname, GLfloat param)
+{
+	countCall(GLCALL_TEXTURE);
+	glTexParameterf(target, pname, param);
+}
+
+void glStatsPixelStorei(GLenum pname, GLint param)
+{
+	countCall(GLCALL_TEXTURE);
+	glPixelStorei(pname, param);
+}
+
+void glStatsTexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid *pixels)
+{
+	countCall(GLCALL_TEXTURE);
+
+	//Without any pixels, this only sets aside space
+	if (pixels != NULL)
+	{
+		currentFrame.textureUploads++;
+		currentFrame.textureBytes += (size_t)width * height * pixelBytes(format, type);
+	}
+	glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+}
+
+void glStatsTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid *pixels)
+{
+	countCall(GLCALL_TEXTURE);
+	currentFrame.textureUploads++;
+	currentFrame.textureBytes += (size_t)width * height * pixelBytes(format, type);
+	glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+}
+
+
+//Buffer objects
+
+void glStatsBindBuffer(GLenum target, GLuint buffer)
+{
+	countCall(GLCALL_STATE);
+	if (target == GL_ARRAY_BUFFER)
+	{
+		arrayBuffer = buffer;
+	}
+	else if (target == GL_ELEMENT_ARRAY_BUFFER)
+	{
+		elementBuffer = buffer;
+	}
+	glBindBuffer(target, buffer);
+}
+
+void glStatsBufferData(GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage)
+{
+	countCall(GLCALL_ARRAY);
+
+	//Without any data, this only sets aside space
+	if (data != NULL)
+	{
+		currentFrame.bufferBytes += size;
+	}
+	glBufferData(target, size, data, usage);
+}
+
+void glStatsBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data)
+{
+	countCall(GLCALL_ARRAY);
+	currentFrame.bufferBytes += size;
+	glBufferSubData(target, offset, size, data);
+}
+
+GLvoid *glStatsMapBuffer(GLenum target, GLenum access)
+{
+	countCall(GLCALL_OTHER);
+	return glMapBuffer(target, access);
+}
+
+GLvoid *glStatsMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+	countCall(GLCALL_OTHER);
+
+	//We can't see what gets written, so count everything mapped for writing as sent
+	if (access & GL_MAP_WRITE_BIT)
+	{
+		currentFrame.bufferBytes += length;
+	}
+	return glMapBufferRange(target, offset, length, access);
+}
+
+GLboolean glStatsUnmapBuffer(GLenum target)
+{
+	countCall(GLCALL_OTHER);
+	return glUnmapBuffer(target);
+}
+
+
+//Everything else
+
+void glStatsReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid *pixels)
+{
+	countCall(GLCALL_OTHER);
+	currentFrame.readbackBytes += (size_t)width * height * pixelBytes(format, type);
+	glReadPixels(x, y, width, height, format, type, pixels);
+}
+
+void glStatsFinish()
+{
+	countCall(GLCALL_OTHER);
+	glFinish();
+}
+
+void glStatsGetFloatv(GLenum pname, GLfloat *params)
+{
+	countCall(GLCALL_OTHER);
+	glGetFloatv(pname, params);
+}
+
+void glStatsReadBuffer(GLenum mode)
+{
+	countCall(GLCALL_STATE);
+	glReadBuffer(mode);
+}
+
+
+//Queries and fences
+
+void glStatsBeginQuery(GLenum target, GLuint id)
+{
+	countCall(GLCALL_OTHER);
+	glBeginQuery(target, id);
+}
+
+void glStatsEndQuery(GLenum target)
+{
+	countCall(GLCALL_OTHER);
+	glEndQuery(target);
+}
+
+void glStatsGetQueryObjectiv(GLuint id, GLenum pname, GLint *params)
+{
+	countCall(GLCALL_OTHER);
+	glGetQueryObjectiv(id, pname, params);
+}
+
+void glStatsGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64 *params)
+{
+	countCall(GLCALL_OTHER);
+	glGetQueryObjectui64v(id, pname, params);
+}
+
+GLsync glStatsFenceSync(GLenum condition, GLbitfield flags)
+{
+	countCall(GLCALL_OTHER);
+	return glFenceSync(condition, flags);
+}
+
+GLenum glStatsClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+	countCall(GLCALL_OTHER);
+	return glClientWaitSync(sync, flags, timeout);
+}
+
+void glStatsDeleteSync(GLsync sync)
+{
+	countCall(GLCALL_OTHER);
+	glDeleteSync(sync);
+}
+
+#endif
@@ -0,0 +1,264 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+//Counts the GL calls we make each frame. Include this after every other header in any file that makes GL calls, and the GL functions we use get swapped for versions that count themselves before passing the call on.
+#ifndef GLSTATS_H
+#define GLSTATS_H
+
+#include <GL/glew.h>
+#include <stddef.h>
+
+//Counting costs a little on every call, so it's only built into debug builds
+#ifndef NDEBUG
+#define GL_STATS
+#endif
+
+#ifdef GL_STATS
+
+struct FontAtlas;
+
+//The kinds of calls we count separately
+enum GLCallType
+{
+	GLCALL_DRAW,
+	GLCALL_IMMEDIATE,
+	GLCALL_STATE,
+	GLCALL_MATRIX,
+	GLCALL_ARRAY,
+	GLCALL_TEXTURE,
+	GLCALL_OTHER,
+	GLCALL_TYPES
+};
+
+//What one frame asked GL to do
+struct GLFrameStats
+{
+	unsigned int calls;
+	unsigned int callsByType[GLCALL_TYPES];
+
+	//glDrawElements, glDrawArrays and glBegin/glEnd blocks
+	unsigned int drawCalls;
+	unsigned int primitives;
+	unsigned int vertices;
+
+	//Texture data sent with glTexImage2D and glTexSubImage2D
+	unsigned int textureUploads;
+	size_t textureBytes;
+	unsigned int texturesCreated;
+	unsigned int texturesDeleted;
+
+	//Vertex and index data GL has to read out of our memory when we draw from client side arrays
+	size_t arrayBytes;
+
+	//Data sent into buffer objects with glBufferData or glBufferSubData, or mapped for writing with glMapBufferRange
+	size_t bufferBytes;
+
+	//Pixels read back with glReadPixels
+	size_t readbackBytes;
+
+	//Vertex data passed one glVertex/glTexCoord at a time
+	size_t immediateBytes;
+};
+
+//Whether the HUD shows the last frame's GL statistics (F3 toggles this)
+extern bool glStatsOverlay;
+
+bool glStatsOpenLog(const char *fileName);
+void glStatsFrameEnd();
+GLFrameStats getGLFrameStats();
+void renderGLStatsPage(const FontAtlas &atlas, int x, int y, int width);
+void glStatsClose();
+
+//The counting versions of the GL functions we use. Calls that only happen while setting things up (creating shaders, framebuffers, buffers and queries) aren't counted
+void glStatsDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices);
+void glStatsDrawArrays(GLenum mode, GLint first, GLsizei count);
+void glStatsBegin(GLenum mode);
+void glStatsEnd();
+void glStatsVertex2f(GLfloat x, GLfloat y);
+void glStatsVertex3f(GLfloat x, GLfloat y, GLfloat z);
+void glStatsTexCoord2f(GLfloat s, GLfloat t);
+void glStatsClear(GLbitfield mask);
+void glStatsClearColor(GLclampf r, GLclampf g, GLclampf b, GLclampf a);
+void glStatsEnable(GLenum cap);
+void glStatsDisable(GLenum cap);
+void glStatsColor3ub(GLubyte r, GLubyte g, GLubyte b);
+void glStatsColorMaterial(GLenum face, GLenum mode);
+void glStatsShadeModel(GLenum mode);
+void glStatsAlphaFunc(GLenum func, GLclampf ref);
+void glStatsPolygonStipple(const GLubyte *mask);
+void glStatsPushAttrib(GLbitfield mask);
+void glStatsPopAttrib();
+void glStatsFrontFace(GLenum mode);
+void glStatsBlendFunc(GLenum sfactor, GLenum dfactor);
+void glStatsDepthMask(GLboolean flag);
+void glStatsViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void glStatsLightfv(GLenum light, GLenum pname, const GLfloat *params);
+void glStatsLightModelfv(GLenum pname, const GLfloat *params);
+void glStatsUseProgram(GLuint program);
+void glStatsUniform1f(GLint location, GLfloat value);
+void glStatsUniform3fv(GLint location, GLsizei count, const GLfloat *value);
+void glStatsUniform4fv(GLint location, GLsizei count, const GLfloat *value);
+void glStatsBindFramebuffer(GLenum target, GLuint framebuffer);
+void glStatsMatrixMode(GLenum mode);
+void glStatsPushMatrix();
+void glStatsPopMatrix();
+void glStatsLoadIdentity();
+void glStatsTranslatef(GLfloat x, GLfloat y, GLfloat z);
+void glStatsRotatef(GLfloat angle, GLfloat x, GLfloat y, GLfloat z);
+void glStatsMultMatrixf(const GLfloat *m);
+void glStatsScalef(GLfloat x, GLfloat y, GLfloat z);
+void glStatsOrtho(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top, GLdouble zNear, GLdouble zFar);
+void glStatsEnableClientState(GLenum array);
+void glStatsDisableClientState(GLenum array);
+void glStatsVertexPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *pointer);
+void glStatsNormalPointer(GLenum type, GLsizei stride, const GLvoid *pointer);
+void glStatsColorPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *pointer);
+void glStatsTexCoordPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *pointer);
+void glStatsEnableVertexAttribArray(GLuint index);
+void glStatsDisableVertexAttribArray(GLuint index);
+void glStatsVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer);
+void glStatsGenTextures(GLsizei n, GLuint *textures);
+void glStatsDeleteTextures(GLsizei n, const GLuint *textures);
+void glStatsBindTexture(GLenum target, GLuint texture);
+void glStatsTexParameteri(GLenum target, GLenum pname, GLint param);
+void glStatsTexParameterf(GLenum target, GLenum pname, GLfloat param);
+void glStatsPixelStorei(GLenum pname, GLint param);
+void glStatsTexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid *pixels);
+void glStatsTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid *pixels);
+void glStatsBindBuffer(GLenum target, GLuint buffer);
+void glStatsBufferData(GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage);
+void glStatsBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data);
+GLvoid *glStatsMapBuffer(GLenum target, GLenum access);
+GLvoid *glStatsMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+GLboolean glStatsUnmapBuffer(GLenum target);
+void glStatsReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid *pixels);
+void glStatsFinish();
+void glStatsGetFloatv(GLenum pname, GLfloat *params);
+void glStatsReadBuffer(GLenum mode);
+void glStatsBeginQuery(GLenum target, GLuint id);
+void glStatsEndQuery(GLenum target);
+void glStatsGetQueryObjectiv(GLuint id, GLenum pname, GLint *params);
+void glStatsGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64 *params);
+GLsync glStatsFenceSync(GLenum condition, GLbitfield flags);
+GLenum glStatsClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout);
+void glStatsDeleteSync(GLsync sync);
+
+//glstats.cpp needs the real functions, everyone else gets ours
+#ifndef GLSTATS_IMPLEMENTATION
+	//GLEW makes some of these macros already, so clear those out of the way first
+	#undef glDrawElements
+	#undef glDrawArrays
+	#undef glUseProgram
+	#undef glUniform1f
+	#undef glUniform3fv
+	#undef glUniform4fv
+	#undef glBindFramebuffer
+	#undef glEnableVertexAttribArray
+	#undef glDisableVertexAttribArray
+	#undef glVertexAttribPointer
+	#undef glTexSubImage2D
+	#undef glBindBuffer
+	#undef glBufferData
+	#undef glBufferSubData
+	#undef glMapBuffer
+	#undef glMapBufferRange
+	#undef glUnmapBuffer
+	#undef glBeginQuery
+	#undef glEndQuery
+	#undef glGetQueryObjectiv
+	#undef glGetQueryObjectui64v
+	#undef glFenceSync
+	#undef glClientWaitSync
+	#undef glDeleteSync
+
+	#define glDrawElements(mode, count, type, indices) glStatsDrawElements(mode, count, type, indices)
+	#define glDrawArrays(mode, first, count) glStatsDrawArrays(mode, first, count)
+	#define glBegin(mode) glStatsBegin(mode)
+	#define glEnd() glStatsEnd()
+	#define glVertex2f(x, y) glStatsVertex2f(x, y)
+	#define glVertex3f(x, y, z) glStatsVertex3f(x, y, z)
+	#define glTexCoord2f(s, t) glStatsTexCoord2f(s, t)
+	#define glClear(mask) glStatsClear(mask)
+	#define glClearColor(r, g, b, a) glStatsClearColor(r, g, b, a)
+	#define glEnable(cap) glStatsEnable(cap)
+	#define glDisable(cap) glStatsDisable(cap)
+	#define glColor3ub(r, g, b) glStatsColor3ub(r, g, b)
+	#define glColorMaterial(face, mode) glStatsColorMaterial(face, mode)
+	#define glShadeModel(mode) glStatsShadeModel(mode)
+	#define glAlphaFunc(func, ref) glStatsAlphaFunc(func, ref)
+	#define glPolygonStipple(mask) glStatsPolygonStipple(mask)
+	#define glPushAttrib(mask) glStatsPushAttrib(mask)
+	#define glPopAttrib() glStatsPopAttrib()
+	#define glFrontFace(mode) glStatsFrontFace(mode)
+	#define glBlendFunc(sfactor, dfactor) glStatsBlendFunc(sfactor, dfactor)
+	#define glDepthMask(flag) glStatsDepthMask(flag)
+	#define glViewport(x, y, width, height) glStatsViewport(x, y, width, height)
+	#define glLightfv(light, pname, params) glStatsLightfv(light, pname, params)
+	#define glLightModelfv(pname, params) glStatsLightModelfv(pname, params)
+	#define glUseProgram(program) glStatsUseProgram(program)
+	#define glUniform1f(location, value) glStatsUniform1f(location, value)
+	#define glUniform3fv(location, count, value) glStatsUniform3fv(location, count, value)
+	#define glUniform4fv(location, count, value) glStatsUniform4fv(location, count, value)
+	#define glBindFramebuffer(target, framebuffer) glStatsBindFramebuffer(target, framebuffer)
+	#define glMatrixMode(mode) glStatsMatrixMode(mode)
+	#define glPushMatrix() glStatsPushMatrix()
+	#define glPopMatrix() glStatsPopMatrix()
+	#define glLoadIdentity() glStatsLoadIdentity()
+	#define glTranslatef(x, y, z) glStatsTranslatef(x, y, z)
+	#define glRotatef(angle, x, y, z) glStatsRotatef(angle, x, y, z)
+	#define glMultMatrixf(m) glStatsMultMatrixf(m)
+	#define glScalef(x, y, z) glStatsScalef(x, y, z)
+	#define glOrtho(left, right, bottom, top, zNear, zFar) glStatsOrtho(left, right, bottom, top, zNear, zFar)
+	#define glEnableClientState(array) glStatsEnableClientState(array)
+	#define glDisableClientState(array) glStatsDisableClientState(array)
+	#define glVertexPointer(size, type, stride, pointer) glStatsVertexPointer(size, type, stride, pointer)
+	#define glNormalPointer(type, stride, pointer) glStatsNormalPointer(type, stride, pointer)
+	#define glColorPointer(size, type, stride, pointer) glStatsColorPointer(size, type, stride, pointer)
+	#define glTexCoordPointer(size, type, stride, pointer) glStatsTexCoordPointer(size, type, stride, pointer)
+	#define glEnableVertexAttribArray(index) glStatsEnableVertexAttribArray(index)
+	#define glDisableVertexAttribArray(index) glStatsDisableVertexAttribArray(index)
+	#define glVertexAttribPointer(index, size, type, normalized, stride, pointer) glStatsVertexAttribPointer(index, size, type, normalized, stride, pointer)
+	#define glGenTextures(n, textures) glStatsGenTextures(n, textures)
+	#define glDeleteTextures(n, textures) glStatsDeleteTextures(n, textures)
+	#define glBindTexture(target, texture) glStatsBindTexture(target, texture)
+	#define glTexParameteri(target, pname, param) glStatsTexParameteri(target, pname, param)
+	#define glTexParameterf(target, pname, param) glStatsTexParameterf(target, pname, param)
+	#define glPixelStorei(pname, param) glStatsPixelStorei(pname, param)
+	#define glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels) glStatsTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels)
+	#define glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels) glStatsTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels)
+	#define glBindBuffer(target, buffer) glStatsBindBuffer(target, buffer)
+	#define glBufferData(target, size, data, usage) glStatsBufferData(target, size, data, usage)
+	#define glBufferSubData(target, offset, size, data) glStatsBufferSubData(target, offset, size, data)
+	#define glMapBuffer(target, access) glStatsMapBuffer(target, access)
+	#define glMapBufferRange(target, offset, length, access) glStatsMapBufferRange(target, offset, length, access)
+	#define glUnmapBuffer(target) glStatsUnmapBuffer(target)
+	#define glReadPixels(x, y, width, height, format, type, pixels) glStatsReadPixels(x, y, width, height, format, type, pixels)
+	#define glFinish() glStatsFinish()
+	#define glGetFloatv(pname, params) glStatsGetFloatv(pname, params)
+	#define glReadBuffer(mode) glStatsReadBuffer(mode)
+	#define glBeginQuery(target, id) glStatsBeginQuery(target, id)
+	#define glEndQuery(target) glStatsEndQuery(target)
+	#define glGetQueryObjectiv(id, pname, params) glStatsGetQueryObjectiv(id, pname, params)
+	#define glGetQueryObjectui64v(id, pname, params) glStatsGetQueryObjectui64v(id, pname, params)
+	#define glFenceSync(condition, flags) glStatsFenceSync(condition, flags)
+	#define glClientWaitSync(sync, flags, timeout) glStatsClientWaitSync(sync, flags, timeout)
+	#define glDeleteSync(sync) glStatsDeleteSync(sync)
+#endif
+
+#else
+
+//In release builds the GL calls go straight through and there's nothing to count
+inline void glStatsFrameEnd() {}
+inline void glStatsClose() {}
+
+#endif
+
+#endif
@@ -0,0 +1,655 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "impostor.h"
+#include "lighting.h"
+#include "transform.h"
+#include "glstats.h"
+
+using namespace std;
+
+float impostorDistance = 300.0f;
+
+//The models that get impostors. Trees and buildings are what there are lots of out in the distance; hills are big enough that they're still worth drawing properly
+static const char *impostorModelFiles[] = {"tree.obj", "buildings.obj"};
+static const int impostorModelCount = sizeof(impostorModelFiles) / sizeof(impostorModelFiles[0]);
+
+//The pictures are taken a little wider than the bounding sphere so that the model never touches the edge of its picture (which would bleed into the next one when the atlas is filtered)
+static const float impostorMargin = 1.05f;
+
+//The meshes we've taken pictures of (each one's impostor index is where it is in here), and the atlas the pictures are in: one row for each mesh, one column for each direction
+static vector<Mesh*> impostorMeshes;
+static GLuint atlasTexture = 0;
+static int atlasWidth = 0;
+static int atlasHeight = 0;
+
+//One corner of an impostor's quad, already in world coordinates
+struct ImpostorVertex
+{
+	GLfloat position[3];
+	GLfloat texCoord[2];
+	GLubyte colour[4];
+
+	//Which way the light is from the object, in the model's own coordinates (the same ones as the normals in the atlas), and how much ambient light the object gets
+	GLfloat lighting[4];
+};
+
+//The atlas holds each picture's normals rather than its colours, so that every impostor can be lit the way its mesh would be: from wherever the light is relative to it, and with however much ambient light the bake left it
+static GLuint captureProgram = 0;
+static GLuint impostorProgram = 0;
+static GLint diffuseLightUniform = -1;
+
+//Where the shaders expect the packed normals (like the mesh shader) and each impostor's lighting (0 is gl_Vertex on some drivers, so we stay clear of it)
+static const GLuint packedNormalAttribute = 1;
+static const GLuint lightingAttribute = 1;
+
+//Unpacks normals the same way the mesh shader does and writes them out as colours. They're in the model's own coordinates, since the quantisation scale that's in the modelview isn't applied to them
+static const char *captureVertexShader =
+	"#version 120\n"
+	"attribute vec2 packedNormal;\n"
+	"varying vec3 normal;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 e = packedNormal / 127.0;\n"
+	"	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+	"	if (n.z < 0.0)\n"
+	"	{\n"
+	"		n.xy = (1.0 - abs(n.yx)) * (step(0.0, n.xy) * 2.0 - 1.0);\n"
+	"	}\n"
+	"	normal = n;\n"
+	"	gl_Position = ftransform();\n"
+	"}\n";
+
+static const char *captureFragmentShader =
+	"#version 120\n"
+	"varying vec3 normal;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = vec4(normalize(normal) * 0.5 + 0.5, 1.0);\n"
+	"}\n";
+
+//Lights each pixel of an impostor the same way the mesh shader and the bake light each vertex: ambient plus diffuse, times the object's colour
+static const char *impostorVertexShader =
+	"#version 120\n"
+	"attribute vec4 lighting;\n"
+	"varying vec4 light;\n"
+	"void main()\n"
+	"{\n"
+	"	light = lighting;\n"
+	"	gl_FrontColor = gl_Color;\n"
+	"	gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+	"	gl_Position = ftransform();\n"
+	"}\n";
+
+static const char *impostorFragmentShader =
+	"#version 120\n"
+	"uniform sampler2D atlas;\n"
+	"uniform float diffuseLight;\n"
+	"varying vec4 light;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 texel = texture2D(atlas, gl_TexCoord[0].st);\n"
+	"	if (texel.a <= 0.5)\n"
+	"	{\n"
+	"		discard;\n"
+	"	}\n"
+	"	vec3 normal = texel.rgb * 2.0 - 1.0;\n"
+	"	float diffuse = max(dot(normal, light.xyz), 0.0) / max(length(normal), 0.001);\n"
+	"	gl_FragColor = vec4(gl_Color.rgb * (light.w + diffuseLight * diffuse), 1.0);\n"
+	"}\n";
+
+//This frame's quads, batched up by how far they've faded in, so that each batch can be drawn in one go with its own dither pattern
+static vector<ImpostorVertex> batches[impostorFadeLevels + 1];
+static float viewX = 0;
+static float viewY = 0;
+
+//32x32 stipple patterns for each fade level. The impostor gets the pixels where the 4x4 ordered dither is below the level and the mesh gets the rest, so between them every pixel is drawn exactly once
+static GLubyte impostorPatterns[impostorFadeLevels + 1][128];
+static GLubyte meshPatterns[impostorFadeLevels + 1][128];
+static const int ditherMatrix[4][4] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+
+
+/*
+* Checks whether a model is one of the ones that gets drawn as an impostor when it's far away.
+* Returns true if it is.
+*/
+bool impostorModel(const string &objFile)
+{
+	for (int i = 0; i < impostorModelCount; i++)
+	{
+		if (objFile == impostorModelFiles[i])
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/*
+* Works out where the middle of an object's bounding sphere is in the world, from its world matrix if it's in the transform hierarchy and otherwise the same way renderObject() places it.
+* Returns nothing.
+*/
+static void boundCentre(const GameObject &o, float centre[3])
+{
+	if (o.transform != transformNone)
+	{
+		const float *m = getWorldMatrix(o.transform);
+		for (int a = 0; a < 3; a++)
+		{
+			centre[a] = m[a] * o.mesh->boundX + m[4 + a] * o.mesh->boundY + m[8 + a] * o.mesh->boundZ + m[12 + a];
+		}
+		return;
+	}
+
+	float c = cos((M_PI * o.rz) / 180);
+	float s = sin((M_PI * o.rz) / 180);
+	centre[0] = o.x + o.mesh->boundX * c + o.mesh->boundZ * s;
+	centre[1] = o.mesh->boundY;
+	centre[2] = o.y - o.mesh->boundX * s + o.mesh->boundZ * c;
+}
+
+
+/*
+* Works out how far an object has faded into its impostor, from how far it is from the camera along the ground. This doesn't check whether the object's model has an impostor, and it doesn't touch OpenGL.
+* Returns 0 if it should be drawn as it is, impostorFadeLevels if it should only be drawn as an impostor, or somewhere in between if it's fading.
+*/
+int impostorFadeLevel(const GameObject &o, float cameraX, float cameraY)
+{
+	if (impostorDistance <= 0)
+	{
+		return 0;
+	}
+
+	float centre[3];
+	boundCentre(o, centre);
+	float dx = centre[0] - cameraX;
+	float dy = centre[2] - cameraY;
+	float distanceSquared = dx * dx + dy * dy;
+
+	//Most of what's close by can skip the square root
+	if (distanceSquared <= impostorDistance * impostorDistance)
+	{
+		return 0;
+	}
+
+	int level = (int)((sqrt(distanceSquared) - impostorDistance) / impostorFadeDistance * impostorFadeLevels + 0.5f);
+	return level < impostorFadeLevels ? level : impostorFadeLevels;
+}
+
+
+/*
+* Fills in the dither patterns for each fade level.
+* Returns nothing.
+*/
+static void buildFadePatterns()
+{
+	for (int level = 0; level <= impostorFadeLevels; level++)
+	{
+		memset(impostorPatterns[level], 0, 128);
+		memset(meshPatterns[level], 0, 128);
+		for (int y = 0; y < 32; y++)
+		{
+			for (int x = 0; x < 32; x++)
+			{
+				GLubyte bit = 0x80 >> (x % 8);
+				if (ditherMatrix[y % 4][x % 4] < level)
+				{
+					impostorPatterns[level][y * 4 + x / 8] |= bit;
+				}
+				else
+				{
+					meshPatterns[level][y * 4 + x / 8] |= bit;
+				}
+			}
+		}
+	}
+}
+
+
+/*
+* Compiles and links one of the impostor shader programs, with the given attribute bound to the given location.
+* Returns the program, or 0 if it wouldn't build.
+*/
+static GLuint buildImpostorProgram(const char *vertexSource, const char *fragmentSource, GLuint attribute, const char *attributeName)
+{
+	GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource, "impostor");
+	GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource, "impostor");
+	if (vertexShader == 0 || fragmentShader == 0)
+	{
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glBindAttribLocation(program, attribute, attributeName);
+	glLinkProgram(program);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+	{
+		char log[1024];
+		glGetProgramInfoLog(program, sizeof(log), NULL, log);
+		printf("Couldn't link impostor shader: %s\n", log);
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+
+/*
+* Draws a mesh's normals as colours with the capture shader, which must be in use. This is drawMesh() without the lighting.
+* Returns nothing.
+*/
+static void drawMeshNormals(Mesh *mesh)
+{
+	glPushMatrix();
+	glTranslatef(mesh->quantCentre[0], mesh->quantCentre[1], mesh->quantCentre[2]);
+	glScalef(mesh->quantScale[0], mesh->quantScale[1], mesh->quantScale[2]);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableVertexAttribArray(packedNormalAttribute);
+	glVertexPointer(3, GL_SHORT, sizeof(PackedVertex), mesh->vertices[0].position);
+	glVertexAttribPointer(packedNormalAttribute, 2, GL_BYTE, GL_FALSE, sizeof(PackedVertex), mesh->vertices[0].normal);
+	glDrawElements(GL_TRIANGLES, mesh->indices.size(), GL_UNSIGNED_SHORT, &mesh->indices[0]);
+	glDisableVertexAttribArray(packedNormalAttribute);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	glPopMatrix();
+}
+
+
+/*
+* Takes pictures of each impostor model's normals from all the way around into the atlas, so that renderImpostors() can light them the same way the meshes are lit. This needs framebuffer objects and shaders.
+* Returns true if there are impostors to draw, or false if there won't be any (in which case everything is drawn as it is).
+*/
+bool initImpostors()
+{
+	if (impostorDistance <= 0)
+	{
+		return false;
+	}
+
+	//Framebuffer objects are core in GL 3.0, and available as an extension on most 2.1 drivers
+	if (!(GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object))
+	{
+		printf("No framebuffer objects, so no impostors\n");
+		impostorDistance = 0;
+		return false;
+	}
+
+	if (!GLEW_VERSION_2_0)
+	{
+		printf("No shaders, so no impostors\n");
+		impostorDistance = 0;
+		return false;
+	}
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	buildFadePatterns();
+
+	captureProgram = buildImpostorProgram(captureVertexShader, captureFragmentShader, packedNormalAttribute, "packedNormal");
+	impostorProgram = buildImpostorProgram(impostorVertexShader, impostorFragmentShader, lightingAttribute, "lighting");
+	if (captureProgram == 0 || impostorProgram == 0)
+	{
+		closeImpostors();
+		impostorDistance = 0;
+		return false;
+	}
+	diffuseLightUniform = glGetUniformLocation(impostorProgram, "diffuseLight");
+
+	//Hang on to the meshes for as long as we have pictures of them. Every object using the same file shares the mesh, so they all find its impostor through it
+	for (int i = 0; i < impostorModelCount; i++)
+	{
+		Mesh *mesh = acquireMesh(impostorModelFiles[i]);
+		if (mesh->indices.empty())
+		{
+			releaseMesh(mesh);
+			continue;
+		}
+		mesh->impostor = (int)impostorMeshes.size();
+		impostorMeshes.push_back(mesh);
+	}
+	if (impostorMeshes.empty())
+	{
+		closeImpostors();
+		impostorDistance = 0;
+		return false;
+	}
+
+	atlasWidth = impostorViews * impostorViewSize;
+	atlasHeight = (int)impostorMeshes.size() * impostorViewSize;
+
+	//Mipmaps stop far off impostors from sparkling, but only the first few, as the smaller ones would blur each picture into the next
+	glGenTextures(1, &atlasTexture);
+	glBindTexture(GL_TEXTURE_2D, atlasTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 4);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlasWidth, atlasHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	//The pictures need a depth buffer while they're being taken, but not afterwards
+	GLuint depth = 0;
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasWidth, atlasHeight);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLuint framebuffer = 0;
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlasTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		printf("Error whilst creating impostor framebuffer: 0x%x\n", status);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &depth);
+		closeImpostors();
+		impostorDistance = 0;
+		return false;
+	}
+
+	glPushAttrib(GL_ENABLE_BIT | GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+
+	//Anything that isn't model is see through. The colour underneath is a normal of nothing at all, so that filtering shortens the normals around the edges rather than turning them
+	glViewport(0, 0, atlasWidth, atlasHeight);
+	glClearColor(0.5f, 0.5f, 0.5f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glDisable(GL_TEXTURE_2D);
+	glDisable(GL_BLEND);
+	glDisable(GL_LIGHTING);
+	glEnable(GL_DEPTH_TEST);
+	glUseProgram(captureProgram);
+
+	for (size_t m = 0; m < impostorMeshes.size(); m++)
+	{
+		Mesh *mesh = impostorMeshes[m];
+		float half = mesh->boundRadius * impostorMargin;
+
+		for (int v = 0; v < impostorViews; v++)
+		{
+			glViewport(v * impostorViewSize, (int)m * impostorViewSize, impostorViewSize, impostorViewSize);
+
+			glMatrixMode(GL_PROJECTION);
+			glLoadIdentity();
+			glOrtho(-half, half, -half, half, -half, half);
+
+			//Turn the model so that we're looking at it from this direction around it, level with the middle of it
+			glMatrixMode(GL_MODELVIEW);
+			glLoadIdentity();
+			glRotatef(-v * 360.0f / impostorViews, 0, 1, 0);
+
+			glTranslatef(-mesh->boundX, -mesh->boundY, -mesh->boundZ);
+			drawMeshNormals(mesh);
+		}
+	}
+	glUseProgram(0);
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+	glPopAttrib();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &depth);
+
+	glBindTexture(GL_TEXTURE_2D, atlasTexture);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	float milliseconds = (float)((double)(SDL_GetPerformanceCounter() - start) * 1000 / SDL_GetPerformanceFrequency());
+	printf("Impostors: %d models from %d directions into a %dx%d atlas in %.1fms, drawn from %.0f units away\n", (int)impostorMeshes.size(), impostorViews, atlasWidth, atlasHeight, milliseconds, impostorDistance);
+	return true;
+}
+
+
+/*
+* Starts a new frame of impostors, seen from the given position.
+* Returns nothing.
+*/
+void beginImpostors(float cameraX, float cameraY)
+{
+	viewX = cameraX;
+	viewY = cameraY;
+	for (int level = 0; level <= impostorFadeLevels; level++)
+	{
+		batches[level].clear();
+	}
+}
+
+
+/*
+* Sets up the dither pattern for drawing a mesh that's partway faded into its impostor. Anything drawn until endMeshFade() only covers the pixels that the impostor doesn't.
+* Returns nothing.
+*/
+void beginMeshFade(int level)
+{
+	glPushAttrib(GL_ENABLE_BIT | GL_POLYGON_STIPPLE_BIT);
+	glEnable(GL_POLYGON_STIPPLE);
+	glPolygonStipple(meshPatterns[level]);
+}
+
+
+/*
+* Goes back to drawing meshes solid.
+* Returns nothing.
+*/
+void endMeshFade()
+{
+	glPopAttrib();
+}
+
+
+/*
+* Queues up an object's impostor for renderImpostors(): a quad standing upright through the middle of the object, turned to face the camera, showing the picture taken from closest to where the camera is.
+* Returns nothing.
+*/
+void addImpostor(const GameObject &o, int level)
+{
+	float centre[3];
+	boundCentre(o, centre);
+
+	//Which way the camera is from the object along the ground
+	float dx = viewX - centre[0];
+	float dy = viewY - centre[2];
+	float length = sqrt(dx * dx + dy * dy);
+	if (length < 0.001f)
+	{
+		return;
+	}
+	dx /= length;
+	dy /= length;
+
+	//Turn that into the model's own coordinates to pick the picture
+	float angle = atan2(dx, dy) * 180 / M_PI - o.rz;
+	int view = (int)floor(angle * impostorViews / 360.0f + 0.5f) % impostorViews;
+	if (view < 0)
+	{
+		view += impostorViews;
+	}
+
+	float half = o.mesh->boundRadius * impostorMargin;
+	float rightX = dy * half;
+	float rightZ = -dx * half;
+
+	//The light is a point light, so which way it is depends on where the object is. Turned into the model's own coordinates, that's what the atlas's normals get lit from
+	float toLight[3];
+	float lightLength = 0;
+	for (int a = 0; a < 3; a++)
+	{
+		toLight[a] = sceneLightPosition[a] - centre[a];
+		lightLength += toLight[a] * toLight[a];
+	}
+	lightLength = sqrt(lightLength);
+	if (lightLength > 0)
+	{
+		toLight[0] /= lightLength;
+		toLight[1] /= lightLength;
+		toLight[2] /= lightLength;
+	}
+	float lighting[4];
+	if (o.transform != transformNone)
+	{
+		const float *m = getWorldMatrix(o.transform);
+		for (int a = 0; a < 3; a++)
+		{
+			lighting[a] = m[a * 4] * toLight[0] + m[a * 4 + 1] * toLight[1] + m[a * 4 + 2] * toLight[2];
+		}
+	}
+	else
+	{
+		float c = cos((M_PI * o.rz) / 180);
+		float s = sin((M_PI * o.rz) / 180);
+		lighting[0] = toLight[0] * c - toLight[2] * s;
+		lighting[1] = toLight[1];
+		lighting[2] = toLight[0] * s + toLight[2] * c;
+	}
+
+	//Baked scenery gets however much of the ambient light its vertices were left with on average, and everything else gets all of it like the mesh shader gives it
+	lighting[3] = (bakedLighting && !o.bakedColours.empty()) ? o.bakedAmbient : sceneAmbient;
+
+	float u0 = (float)view / impostorViews;
+	float u1 = (float)(view + 1) / impostorViews;
+	float v0 = (float)(o.mesh->impostor * impostorViewSize) / atlasHeight;
+	float v1 = (float)((o.mesh->impostor + 1) * impostorViewSize) / atlasHeight;
+
+	//Bottom left, bottom right, top right, top left
+	ImpostorVertex corners[4] = {
+		{{centre[0] - rightX, centre[1] - half, centre[2] - rightZ}, {u0, v0}, {o.colour.r, o.colour.g, o.colour.b, 255}, {lighting[0], lighting[1], lighting[2], lighting[3]}},
+		{{centre[0] + rightX, centre[1] - half, centre[2] + rightZ}, {u1, v0}, {o.colour.r, o.colour.g, o.colour.b, 255}, {lighting[0], lighting[1], lighting[2], lighting[3]}},
+		{{centre[0] + rightX, centre[1] + half, centre[2] + rightZ}, {u1, v1}, {o.colour.r, o.colour.g, o.colour.b, 255}, {lighting[0], lighting[1], lighting[2], lighting[3]}},
+		{{centre[0] - rightX, centre[1] + half, centre[2] - rightZ}, {u0, v1}, {o.colour.r, o.colour.g, o.colour.b, 255}, {lighting[0], lighting[1], lighting[2], lighting[3]}}
+	};
+	batches[level].insert(batches[level].end(), corners, corners + 4);
+}
+
+
+/*
+* Draws all of this frame's impostors, one batch for each fade level, each lit from its own direction and coloured by its object's own colour. Anything that's see through in the atlas is left out rather than blended, so they don't need sorting.
+* Returns nothing.
+*/
+void renderImpostors()
+{
+	if (atlasTexture == 0)
+	{
+		return;
+	}
+
+	glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_POLYGON_STIPPLE_BIT);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_CULL_FACE);
+	glDisable(GL_BLEND);
+	glBindTexture(GL_TEXTURE_2D, atlasTexture);
+	glUseProgram(impostorProgram);
+	glUniform1f(diffuseLightUniform, sceneDiffuse);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glEnableVertexAttribArray(lightingAttribute);
+
+	for (int level = 1; level <= impostorFadeLevels; level++)
+	{
+		if (batches[level].empty())
+		{
+			continue;
+		}
+
+		//Fully faded in impostors don't need a pattern at all
+		if (level < impostorFadeLevels)
+		{
+			glEnable(GL_POLYGON_STIPPLE);
+			glPolygonStipple(impostorPatterns[level]);
+		}
+		else
+		{
+			glDisable(GL_POLYGON_STIPPLE);
+		}
+
+		glVertexPointer(3, GL_FLOAT, sizeof(ImpostorVertex), batches[level][0].position);
+		glTexCoordPointer(2, GL_FLOAT, sizeof(ImpostorVertex), batches[level][0].texCoord);
+		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(ImpostorVertex), batches[level][0].colour);
+		glVertexAttribPointer(lightingAttribute, 4, GL_FLOAT, GL_FALSE, sizeof(ImpostorVertex), batches[level][0].lighting);
+		glDrawArrays(GL_QUADS, 0, (GLsizei)batches[level].size());
+	}
+
+	glDisableVertexAttribArray(lightingAttribute);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glUseProgram(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPopAttrib();
+}
+
+
+/*
+* Throws away the atlas and shaders and lets go of the meshes it has pictures of. Everything is drawn as it is afterwards.
+* Returns nothing.
+*/
+void closeImpostors()
+{
+	if (captureProgram != 0)
+	{
+		glDeleteProgram(captureProgram);
+		captureProgram = 0;
+	}
+	if (impostorProgram != 0)
+	{
+		glDeleteProgram(impostorProgram);
+		impostorProgram = 0;
+	}
+
+	if (atlasTexture != 0)
+	{
+		glDeleteTextures(1, &atlasTexture);
+		atlasTexture = 0;
+	}
+
+	for (size_t m = 0; m < impostorMeshes.size(); m++)
+	{
+		impostorMeshes[m]->impostor = -1;
+		releaseMesh(impostorMeshes[m]);
+	}
+	impostorMeshes.clear();
+
+	for (int level = 0; level <= impostorFadeLevels; level++)
+	{
+		vector<ImpostorVertex>().swap(batches[level]);
+	}
+}
@@ -0,0 +1,44 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include <string>
+
+#include "mesh.h"
+
+//Impostors are pictures of a model taken from all the way around it when it's loaded, so that far away copies of it can be drawn as a single quad turned to face the camera
+//The pictures hold the model's normals rather than its colours, so that each impostor can be lit the way its mesh would be: from the light's direction and with as much ambient light as the object gets
+//Between impostorDistance and impostorDistance + impostorFadeDistance both are drawn, each with a dither pattern that lets the other one show through, so that one fades into the other
+
+//How far away (along the ground) scenery starts turning into impostors (from the command line, 0 to always draw the real thing)
+extern float impostorDistance;
+const float impostorFadeDistance = 60.0f;
+
+//How many directions each model is pictured from, and how big each picture is
+const int impostorViews = 8;
+const int impostorViewSize = 128;
+
+//How many steps the fade goes through. This is how many pixels there are in the 4x4 dither pattern
+const int impostorFadeLevels = 16;
+
+bool impostorModel(const std::string &objFile);
+int impostorFadeLevel(const GameObject &o, float cameraX, float cameraY);
+bool initImpostors();
+void beginImpostors(float cameraX, float cameraY);
+void beginMeshFade(int level);
+void endMeshFade();
+void addImpostor(const GameObject &o, int level);
+void renderImpostors();
+void closeImpostors();
+
+#endif
@@ -0,0 +1,433 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include "jobs.h"
+#include <stdio.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+using namespace std;
+
+//How many jobs each thread's queue can hold. If a queue fills up, the job just gets run straight away instead
+const int jobQueueCapacity = 4096;
+
+//Each thread has its own queue. The owner pushes and pops jobs at the back (so it works on whatever's freshest in its cache), and idle threads steal from the front (so they take the oldest, and usually biggest, chunks of work)
+//The lock is only ever held for a couple of instructions, so a spin lock does the job
+struct JobQueue
+{
+	atomic_flag lock;
+	Job jobs[jobQueueCapacity];
+	int head;
+	int tail;
+};
+
+//How many threads we asked for on the command line (zero means one per core)
+int jobThreads = 0;
+
+//Our threads and their queues. Queue 0 belongs to the thread that called jobsInit()
+static JobQueue *queues = NULL;
+static vector<thread> workers;
+static int threadCount = 0;
+
+//Which queue belongs to the current thread (-1 for threads that aren't ours)
+static thread_local int currentQueue = -1;
+
+//Idle workers sleep on this until there's something to do
+static mutex sleepMutex;
+static condition_variable sleepCondition;
+static atomic<int> sleepers(0);
+static atomic<int> queuedJobs(0);
+static atomic<bool> shuttingDown(false);
+
+
+/*
+* Takes a queue's spin lock.
+* Returns nothing.
+*/
+static void lockQueue(JobQueue *queue)
+{
+	while (queue->lock.test_and_set(memory_order_acquire))
+	{
+	}
+}
+
+
+/*
+* Releases a queue's spin lock.
+* Returns nothing.
+*/
+static void unlockQueue(JobQueue *queue)
+{
+	queue->lock.clear(memory_order_release);
+}
+
+
+/*
+* Runs a job and lets its counter know that it's done.
+* Returns nothing.
+*/
+static void runJob(const Job &job)
+{
+	job.function(job.data, job.begin, job.end);
+	if (job.counter != NULL)
+	{
+		job.counter->remaining.fetch_sub(1, memory_order_acq_rel);
+	}
+}
+
+
+/*
+* Grabs a job from our own queue if there's one there, or steals one from another thread's queue if not.
+* Returns true if we got a job and false if every queue was empty.
+*/
+static bool findJob(int own, Job *job)
+{
+	//Our own queue first, newest job first
+	JobQueue *queue = &queues[own];
+	lockQueue(queue);
+	if (queue->tail != queue->head)
+	{
+		queue->tail--;
+		*job = queue->jobs[queue->tail % jobQueueCapacity];
+		unlockQueue(queue);
+		queuedJobs.fetch_sub(1);
+		return true;
+	}
+	unlockQueue(queue);
+
+	//Then everyone else's, oldest job first, starting with our neighbour so that the threads don't all pile onto the same victim
+	for (int i = 1; i < threadCount; i++)
+	{
+		queue = &queues[(own + i) % threadCount];
+		lockQueue(queue);
+		if (queue->tail != queue->head)
+		{
+			*job = queue->jobs[queue->head % jobQueueCapacity];
+			queue->head++;
+			unlockQueue(queue);
+			queuedJobs.fetch_sub(1);
+			return true;
+		}
+		unlockQueue(queue);
+	}
+
+	return false;
+}
+
+
+/*
+* The loop that each worker thread runs until we shut down.
+* Returns nothing.
+*/
+static void workerLoop(int index)
+{
+	currentQueue = index;
+	Job job;
+	int idleSpins = 0;
+
+	while (!shuttingDown.load())
+	{
+		if (findJob(index, &job))
+		{
+			runJob(job);
+			idleSpins = 0;
+			continue;
+		}
+
+		//Spin for a little while in case more work turns up straight away (which it usually does mid-frame), then go to sleep so that we're not burning power between frames
+		if (idleSpins < 64)
+		{
+			idleSpins++;
+			this_thread::yield();
+			continue;
+		}
+
+		unique_lock<mutex> lock(sleepMutex);
+		sleepers.fetch_add(1);
+		while (!shuttingDown.load() && queuedJobs.load() == 0)
+		{
+			sleepCondition.wait(lock);
+		}
+		sleepers.fetch_sub(1);
+		idleSpins = 0;
+	}
+}
+
+
+/*
+* Starts the worker threads. The calling thread becomes one of the job threads too, and does its share of the work whenever it waits on a job.
+* Returns true if the threads started and false otherwise.
+*/
+bool jobsInit(int threads)
+{
+	if (threads <= 0)
+	{
+		threads = thread::hardware_concurrency();
+		if (threads <= 0)
+		{
+			threads = 1;
+		}
+	}
+
+	threadCount = threads;
+	queues = new JobQueue[threadCount];
+	for (int i = 0; i < threadCount; i++)
+	{
+		queues[i].lock.clear();
+		queues[i].head = 0;
+		queues[i].tail = 0;
+	}
+	currentQueue = 0;
+	shuttingDown.store(false);
+
+	for (int i = 1; i < threadCount; i++)
+	{
+		workers.push_back(thread(workerLoop, i));
+	}
+
+	return true;
+}
+
+
+/*
+* Stops the worker threads once they've finished whatever they were doing.
+* Returns nothing.
+*/
+void jobsShutdown()
+{
+	{
+		lock_guard<mutex> lock(sleepMutex);
+		shuttingDown.store(true);
+	}
+	sleepCondition.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+	workers.clear();
+
+	delete [] queues;
+	queues = NULL;
+	threadCount = 0;
+	currentQueue = -1;
+}
+
+
+/*
+* Gets how many threads are running jobs.
+* Returns the number of threads, including the one that called jobsInit().
+*/
+int jobsThreadCount()
+{
+	return threadCount;
+}
+
+
+/*
+* Queues up a job on the current thread's queue (or the main thread's if this isn't one of our threads), for it or any idle thread to pick up.
+* Returns nothing.
+*/
+void jobsPush(void (*function)(void *data, int begin, int end), void *data, int begin, int end, JobCounter *counter)
+{
+	Job job;
+	job.function = function;
+	job.data = data;
+	job.begin = begin;
+	job.end = end;
+	job.counter = counter;
+
+	if (counter != NULL)
+	{
+		counter->remaining.fetch_add(1, memory_order_relaxed);
+	}
+
+	//If we haven't been started, there's nobody else to do it
+	if (queues == NULL)
+	{
+		runJob(job);
+		return;
+	}
+
+	JobQueue *queue = &queues[currentQueue >= 0 ? currentQueue : 0];
+	lockQueue(queue);
+	if (queue->tail - queue->head >= jobQueueCapacity)
+	{
+		//The queue is full, so just do it now
+		unlockQueue(queue);
+		runJob(job);
+		return;
+	}
+	queue->jobs[queue->tail % jobQueueCapacity] = job;
+	queue->tail++;
+	unlockQueue(queue);
+
+	//Wake up a sleeping worker if there is one
+	queuedJobs.fetch_add(1);
+	if (sleepers.load() > 0)
+	{
+		{
+			lock_guard<mutex> lock(sleepMutex);
+		}
+		sleepCondition.notify_one();
+	}
+}
+
+
+/*
+* Waits for all of the jobs attached to a counter to finish. Rather than sitting idle, the waiting thread runs queued jobs (its own or stolen) in the meantime.
+* Returns nothing.
+*/
+void jobsWait(JobCounter *counter)
+{
+	int own = currentQueue >= 0 ? currentQueue : 0;
+	Job job;
+	while (counter->remaining.load(memory_order_acquire) > 0)
+	{
+		if (queues != NULL && findJob(own, &job))
+		{
+			runJob(job);
+		}
+		else
+		{
+			this_thread::yield();
+		}
+	}
+}
+
+
+/*
+* Runs a function over the range 0 to count, split into chunks of about grain items that are shared out between all of the job threads. The function gets called with the beginning and end (exclusive) of each chunk.
+* Returns once the whole range has been done.
+*/
+void jobsParallelFor(int count, int grain, void (*function)(void *data, int begin, int end), void *data)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	if (grain < 1)
+	{
+		grain = 1;
+	}
+
+	//Not worth the overhead if there's only one chunk or one thread
+	if (count <= grain || threadCount <= 1)
+	{
+		function(data, 0, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (int begin = 0; begin < count; begin += grain)
+	{
+		int end = (begin + grain < count) ? begin + grain : count;
+		jobsPush(function, data, begin, end, &counter);
+	}
+	jobsWait(&counter);
+}
+
+
+/*
+* Adds a stage to a job graph.
+* Returns the stage's index for use with jobGraphDepends(), or -1 if the graph is full.
+*/
+int jobGraphAdd(JobGraph *graph, const char *name, void (*function)(void *data), void *data)
+{
+	if (graph->stageCount >= maxJobStages)
+	{
+		printf("Too many stages in job graph, couldn't add %s\n", name);
+		return -1;
+	}
+
+	JobStage *stage = &graph->stages[graph->stageCount];
+	stage->name = name;
+	stage->function = function;
+	stage->data = data;
+	stage->dependentCount = 0;
+	stage->dependencyCount = 0;
+	stage->waitingOn.store(0);
+
+	return graph->stageCount++;
+}
+
+
+/*
+* Says that one stage of a job graph can't start until another has finished.
+* Returns true if the dependency was added and false otherwise.
+*/
+bool jobGraphDepends(JobGraph *graph, int stage, int dependsOn)
+{
+	if (stage < 0 || stage >= graph->stageCount || dependsOn < 0 || dependsOn >= graph->stageCount || stage == dependsOn)
+	{
+		printf("Bad job graph dependency %d -> %d\n", dependsOn, stage);
+		return false;
+	}
+
+	JobStage *before = &graph->stages[dependsOn];
+	if (before->dependentCount >= maxStageDependents)
+	{
+		printf("Too many stages depend on %s\n", before->name);
+		return false;
+	}
+
+	before->dependents[before->dependentCount++] = stage;
+	graph->stages[stage].dependencyCount++;
+	return true;
+}
+
+
+/*
+* Runs one stage of a graph and then kicks off any stages that were only waiting on it. Each of these jobs covers exactly one stage, so begin is the stage's index and the end of the range isn't needed.
+* Returns nothing.
+*/
+static void runGraphStage(void *data, int begin, int /*end*/)
+{
+	JobGraph *graph = (JobGraph *)data;
+	JobStage *stage = &graph->stages[begin];
+
+	stage->function(stage->data);
+
+	for (int i = 0; i < stage->dependentCount; i++)
+	{
+		JobStage *next = &graph->stages[stage->dependents[i]];
+		if (next->waitingOn.fetch_sub(1, memory_order_acq_rel) == 1)
+		{
+			jobsPush(runGraphStage, graph, stage->dependents[i], stage->dependents[i] + 1, &graph->counter);
+		}
+	}
+}
+
+
+/*
+* Runs every stage of a job graph, respecting the dependencies between them.
+* Returns once all of the stages have finished.
+*/
+void jobGraphRun(JobGraph *graph)
+{
+	for (int i = 0; i < graph->stageCount; i++)
+	{
+		graph->stages[i].waitingOn.store(graph->stages[i].dependencyCount, memory_order_relaxed);
+	}
+
+	//Start everything that doesn't depend on anything, and the rest will follow on from those
+	for (int i = 0; i < graph->stageCount; i++)
+	{
+		if (graph->stages[i].dependencyCount == 0)
+		{
+			jobsPush(runGraphStage, graph, i, i + 1, &graph->counter);
+		}
+	}
+
+	jobsWait(&graph->counter);
+}
@@ -0,0 +1,79 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <atomic>
+
+//A counter that jobs decrement as they finish, so that whoever started them can wait for the lot
+struct JobCounter
+{
+	std::atomic<int> remaining;
+
+	JobCounter() : remaining(0) {}
+};
+
+//A piece of work. Jobs that work over part of a range get the range in begin and end, and everything else can ignore them
+struct Job
+{
+	void (*function)(void *data, int begin, int end);
+	void *data;
+	int begin;
+	int end;
+	JobCounter *counter;
+};
+
+//The most stages a JobGraph can have, and the most stages that can depend on any one stage
+const int maxJobStages = 16;
+const int maxStageDependents = 8;
+
+//One stage of a JobGraph
+struct JobStage
+{
+	const char *name;
+	void (*function)(void *data);
+	void *data;
+
+	//The stages that can't start until this one has finished
+	int dependents[maxStageDependents];
+	int dependentCount;
+
+	//How many stages this one has to wait for, and how many of those are still going this run
+	int dependencyCount;
+	std::atomic<int> waitingOn;
+};
+
+//A set of stages with dependencies between them (e.g. the stages of a frame). Stages that don't depend on each other run at the same time
+struct JobGraph
+{
+	JobStage stages[maxJobStages];
+	int stageCount;
+	JobCounter counter;
+
+	JobGraph() : stageCount(0) {}
+};
+
+//The number of threads (including the one that calls jobsInit) that will run jobs. Zero means one per CPU core
+extern int jobThreads;
+
+bool jobsInit(int threads);
+void jobsShutdown();
+int jobsThreadCount();
+void jobsPush(void (*function)(void *data, int begin, int end), void *data, int begin, int end, JobCounter *counter);
+void jobsWait(JobCounter *counter);
+void jobsParallelFor(int count, int grain, void (*function)(void *data, int begin, int end), void *data);
+
+int jobGraphAdd(JobGraph *graph, const char *name, void (*function)(void *data), void *data);
+bool jobGraphDepends(JobGraph *graph, int stage, int dependsOn);
+void jobGraphRun(JobGraph *graph);
+
+#endif
@@ -0,0 +1,532 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include "lighting.h"
+#include "jobs.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <map>
+
+using namespace std;
+
+bool bakedLighting = true;
+
+//Bump this whenever the bake changes, so that old cache files get baked again instead of used
+static const unsigned int bakeVersion = 2;
+
+//The sky map is a grid of the highest point in each cell, and this is the most cells it can have along each side
+static const int skyMapMaxCells = 512;
+
+//How far out from each vertex we look for things blocking the sky, and in how many directions
+static const float occlusionDistance = 50.0f;
+static const int occlusionDirections = 8;
+
+//How far down ambient occlusion can take the ambient light (1 would let a vertex with no sky at all go completely without)
+static const float occlusionStrength = 0.6f;
+
+//Where an object's vertices and normals end up in the world
+struct WorldVertices
+{
+	vector<float> positions;
+	vector<float> normals;
+};
+
+//A top down height map of everything being baked, which is what we check the sky against
+struct SkyMap
+{
+	float minX;
+	float minZ;
+	float cellSize;
+	int width;
+	int depth;
+	vector<float> heights;
+};
+
+//Everything the bake jobs need
+struct BakeJob
+{
+	vector<GameObject*> *objects;
+	vector<WorldVertices> world;
+	SkyMap sky;
+};
+
+
+/*
+* Moves an object's vertices into the world the same way renderObject() and drawMesh() do: undo the quantisation, rotate around Y by rz, then move to x, y.
+* Returns nothing.
+*/
+static void transformObject(const GameObject *o, WorldVertices *world)
+{
+	const Mesh *mesh = o->mesh;
+	float c = cos((M_PI * o->rz) / 180);
+	float s = sin((M_PI * o->rz) / 180);
+
+	world->positions.resize(mesh->vertices.size() * 3);
+	world->normals.resize(mesh->vertices.size() * 3);
+	for (size_t i = 0; i < mesh->vertices.size(); i++)
+	{
+		const PackedVertex &v = mesh->vertices[i];
+		float p[3];
+		for (int a = 0; a < 3; a++)
+		{
+			p[a] = mesh->quantCentre[a] + v.position[a] * mesh->quantScale[a];
+		}
+		float n[3];
+		decodeNormal(v.normal, n);
+
+		float *position = &world->positions[i * 3];
+		position[0] = p[0] * c + p[2] * s + o->x;
+		position[1] = p[1];
+		position[2] = -p[0] * s + p[2] * c + o->y;
+
+		float *normal = &world->normals[i * 3];
+		normal[0] = n[0] * c + n[2] * s;
+		normal[1] = n[1];
+		normal[2] = -n[0] * s + n[2] * c;
+	}
+}
+
+
+/*
+* Job function that moves a range of objects into the world.
+* Returns nothing.
+*/
+static void transformObjects(void *data, int begin, int end)
+{
+	BakeJob *job = (BakeJob *)data;
+	for (int i = begin; i < end; i++)
+	{
+		transformObject((*job->objects)[i], &job->world[i]);
+	}
+}
+
+
+/*
+* Raises a sky map cell to a height if it isn't that high already. Points outside the map are ignored.
+* Returns nothing.
+*/
+static void raiseSkyMap(SkyMap *sky, float x, float z, float height)
+{
+	int cx = (int)floor((x - sky->minX) / sky->cellSize);
+	int cz = (int)floor((z - sky->minZ) / sky->cellSize);
+	if (cx < 0 || cz < 0 || cx >= sky->width || cz >= sky->depth)
+	{
+		return;
+	}
+	float *cell = &sky->heights[cz * sky->width + cx];
+	*cell = (height > *cell) ? height : *cell;
+}
+
+
+/*
+* Draws a triangle into the sky map from above. The edges are walked as well as the inside filled, so that walls and other things that are thin from above still show up.
+* Returns nothing.
+*/
+static void rasteriseSkyMap(SkyMap *sky, const float *a, const float *b, const float *c)
+{
+	const float *corners[3] = {a, b, c};
+	for (int e = 0; e < 3; e++)
+	{
+		const float *from = corners[e];
+		const float *to = corners[(e + 1) % 3];
+		float length = sqrt((to[0] - from[0]) * (to[0] - from[0]) + (to[2] - from[2]) * (to[2] - from[2]));
+		int steps = (int)(length / (sky->cellSize * 0.5f)) + 1;
+		for (int i = 0; i <= steps; i++)
+		{
+			float t = i / (float)steps;
+			raiseSkyMap(sky, from[0] + (to[0] - from[0]) * t, from[2] + (to[2] - from[2]) * t, from[1] + (to[1] - from[1]) * t);
+		}
+	}
+
+	//Triangles standing on their edge have nothing more to them from above
+	float area = (b[0] - a[0]) * (c[2] - a[2]) - (c[0] - a[0]) * (b[2] - a[2]);
+	if (fabs(area) < 1e-6f)
+	{
+		return;
+	}
+
+	float minX = fmin(a[0], fmin(b[0], c[0]));
+	float maxX = fmax(a[0], fmax(b[0], c[0]));
+	float minZ = fmin(a[2], fmin(b[2], c[2]));
+	float maxZ = fmax(a[2], fmax(b[2], c[2]));
+	int x0 = (int)floor((minX - sky->minX) / sky->cellSize);
+	int x1 = (int)floor((maxX - sky->minX) / sky->cellSize);
+	int z0 = (int)floor((minZ - sky->minZ) / sky->cellSize);
+	int z1 = (int)floor((maxZ - sky->minZ) / sky->cellSize);
+	x0 = (x0 < 0) ? 0 : x0;
+	z0 = (z0 < 0) ? 0 : z0;
+	x1 = (x1 >= sky->width) ? sky->width - 1 : x1;
+	z1 = (z1 >= sky->depth) ? sky->depth - 1 : z1;
+
+	for (int cz = z0; cz <= z1; cz++)
+	{
+		float z = sky->minZ + (cz + 0.5f) * sky->cellSize;
+		for (int cx = x0; cx <= x1; cx++)
+		{
+			float x = sky->minX + (cx + 0.5f) * sky->cellSize;
+
+			//Barycentric weights of the cell's middle, which are all positive (or all negative, depending on the winding) inside the triangle
+			float wa = ((b[0] - x) * (c[2] - z) - (c[0] - x) * (b[2] - z)) / area;
+			float wb = ((c[0] - x) * (a[2] - z) - (a[0] - x) * (c[2] - z)) / area;
+			float wc = 1 - wa - wb;
+			if (wa < 0 || wb < 0 || wc < 0)
+			{
+				continue;
+			}
+			float *cell = &sky->heights[cz * sky->width + cx];
+			float height = wa * a[1] + wb * b[1] + wc * c[1];
+			*cell = (height > *cell) ? height : *cell;
+		}
+	}
+}
+
+
+/*
+* Builds the sky map for everything being baked.
+* Returns nothing.
+*/
+static void buildSkyMap(BakeJob *job)
+{
+	SkyMap *sky = &job->sky;
+	float minX = FLT_MAX, minZ = FLT_MAX;
+	float maxX = -FLT_MAX, maxZ = -FLT_MAX;
+	for (size_t o = 0; o < job->world.size(); o++)
+	{
+		const vector<float> &positions = job->world[o].positions;
+		for (size_t i = 0; i < positions.size(); i += 3)
+		{
+			minX = fmin(minX, positions[i]);
+			maxX = fmax(maxX, positions[i]);
+			minZ = fmin(minZ, positions[i + 2]);
+			maxZ = fmax(maxZ, positions[i + 2]);
+		}
+	}
+	if (minX > maxX)
+	{
+		minX = maxX = minZ = maxZ = 0;
+	}
+
+	float size = fmax(maxX - minX, maxZ - minZ);
+	sky->cellSize = fmax(size / skyMapMaxCells, 0.25f);
+	sky->minX = minX;
+	sky->minZ = minZ;
+	sky->width = (int)((maxX - minX) / sky->cellSize) + 1;
+	sky->depth = (int)((maxZ - minZ) / sky->cellSize) + 1;
+	sky->heights.assign(sky->width * sky->depth, -FLT_MAX);
+
+	for (size_t o = 0; o < job->world.size(); o++)
+	{
+		const Mesh *mesh = (*job->objects)[o]->mesh;
+		const float *positions = job->world[o].positions.empty() ? NULL : &job->world[o].positions[0];
+		for (size_t i = 0; i + 2 < mesh->indices.size(); i += 3)
+		{
+			rasteriseSkyMap(sky, positions + mesh->indices[i] * 3, positions + mesh->indices[i + 1] * 3, positions + mesh->indices[i + 2] * 3);
+		}
+	}
+}
+
+
+/*
+* Looks up the highest point in the sky map cell under a position.
+* Returns the height, or -FLT_MAX if there's nothing there (or it's off the map).
+*/
+static float skyMapHeight(const SkyMap *sky, float x, float z)
+{
+	int cx = (int)floor((x - sky->minX) / sky->cellSize);
+	int cz = (int)floor((z - sky->minZ) / sky->cellSize);
+	if (cx < 0 || cz < 0 || cx >= sky->width || cz >= sky->depth)
+	{
+		return -FLT_MAX;
+	}
+	return sky->heights[cz * sky->width + cx];
+}
+
+
+/*
+* Works out how much of the sky a vertex can see, by finding how high the horizon is in each direction around it. Directions the vertex faces away from count for less, and ones behind it don't count at all.
+* Returns 1 for a vertex with nothing in the way, down towards 0 for one that's completely boxed in.
+*/
+static float skyVisibility(const SkyMap *sky, const float *position, const float *normal)
+{
+	//Start a little way off the surface, so that a vertex doesn't find the cells of the surface it's sitting on
+	float nudge = sky->cellSize * 1.5f;
+	float x = position[0] + normal[0] * nudge;
+	float y = position[1] + normal[1] * nudge;
+	float z = position[2] + normal[2] * nudge;
+
+	float visible = 0;
+	float total = 0;
+	for (int d = 0; d < occlusionDirections; d++)
+	{
+		float angle = 2 * M_PI * d / occlusionDirections;
+		float dx = cos(angle);
+		float dz = sin(angle);
+		float weight = 1 + normal[0] * dx + normal[2] * dz;
+		if (weight <= 0)
+		{
+			continue;
+		}
+
+		//Steps get further apart as we go, since distant things need to be much taller to block much sky
+		float steepest = 0;
+		for (float distance = sky->cellSize; distance <= occlusionDistance; distance *= 1.4f)
+		{
+			float slope = (skyMapHeight(sky, x + dx * distance, z + dz * distance) - y) / distance;
+			steepest = (slope > steepest) ? slope : steepest;
+		}
+
+		//The sky above the horizon's elevation is what's left
+		visible += weight * (1 - steepest / sqrt(1 + steepest * steepest));
+		total += weight;
+	}
+
+	return (total > 0) ? visible / total : 1;
+}
+
+
+/*
+* Job function that works out the lit colour of every vertex of a range of objects, the same way the mesh shader lights them but with the ambient light cut down by how much sky each vertex can see.
+* Returns nothing.
+*/
+static void bakeObjects(void *data, int begin, int end)
+{
+	BakeJob *job = (BakeJob *)data;
+	for (int o = begin; o < end; o++)
+	{
+		GameObject *object = (*job->objects)[o];
+		const WorldVertices &world = job->world[o];
+		size_t count = world.positions.size() / 3;
+		object->bakedColours.resize(count * 4);
+		float totalOcclusion = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			const float *position = &world.positions[i * 3];
+			const float *normal = &world.normals[i * 3];
+
+			float toLight[3];
+			float length = 0;
+			for (int a = 0; a < 3; a++)
+			{
+				toLight[a] = sceneLightPosition[a] - position[a];
+				length += toLight[a] * toLight[a];
+			}
+			length = sqrt(length);
+			float diffuse = 0;
+			if (length > 0)
+			{
+				diffuse = (normal[0] * toLight[0] + normal[1] * toLight[1] + normal[2] * toLight[2]) / length;
+				diffuse = (diffuse > 0) ? diffuse : 0;
+			}
+
+			float occlusion = 1 - occlusionStrength * (1 - skyVisibility(&job->sky, position, normal));
+			float light = sceneAmbient * occlusion + sceneDiffuse * diffuse;
+			totalOcclusion += occlusion;
+
+			GLubyte *colour = &object->bakedColours[i * 4];
+			float r = object->colour.r * light;
+			float g = object->colour.g * light;
+			float b = object->colour.b * light;
+			colour[0] = (GLubyte)((r > 255) ? 255 : r);
+			colour[1] = (GLubyte)((g > 255) ? 255 : g);
+			colour[2] = (GLubyte)((b > 255) ? 255 : b);
+			colour[3] = 255;
+		}
+		object->bakedAmbient = sceneAmbient * ((count > 0) ? totalOcclusion / count : 1);
+	}
+}
+
+
+/*
+* Adds some bytes to a running FNV-1a hash.
+* Returns nothing.
+*/
+static void hashBytes(unsigned long long *hash, const void *data, size_t size)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		*hash ^= bytes[i];
+		*hash *= 1099511628211ULL;
+	}
+}
+
+
+/*
+* Hashes everything that goes into a bake (the bake itself, the light, and every object's model, colour and position), so that a cache file can tell whether it's still right.
+* Returns the hash.
+*/
+static unsigned long long hashBake(const vector<GameObject*> &objects)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	hashBytes(&hash, &bakeVersion, sizeof(bakeVersion));
+	hashBytes(&hash, sceneLightPosition, sizeof(sceneLightPosition));
+	hashBytes(&hash, &sceneAmbient, sizeof(sceneAmbient));
+	hashBytes(&hash, &sceneDiffuse, sizeof(sceneDiffuse));
+
+	//Lots of objects share a model, so each model only gets hashed once and then stands in for itself with its hash
+	map<const Mesh*, unsigned long long> meshHashes;
+	for (size_t o = 0; o < objects.size(); o++)
+	{
+		const GameObject *object = objects[o];
+		const Mesh *mesh = object->mesh;
+		map<const Mesh*, unsigned long long>::iterator found = meshHashes.find(mesh);
+		if (found == meshHashes.end())
+		{
+			unsigned long long meshHash = 14695981039346656037ULL;
+			hashBytes(&meshHash, mesh->name.c_str(), mesh->name.size());
+			hashBytes(&meshHash, mesh->quantCentre, sizeof(mesh->quantCentre));
+			hashBytes(&meshHash, mesh->quantScale, sizeof(mesh->quantScale));
+			if (!mesh->vertices.empty())
+			{
+				hashBytes(&meshHash, &mesh->vertices[0], mesh->vertices.size() * sizeof(PackedVertex));
+			}
+			if (!mesh->indices.empty())
+			{
+				hashBytes(&meshHash, &mesh->indices[0], mesh->indices.size() * sizeof(GLushort));
+			}
+			found = meshHashes.insert(make_pair(mesh, meshHash)).first;
+		}
+
+		Uint8 colour[3] = {object->colour.r, object->colour.g, object->colour.b};
+		float placement[3] = {object->x, object->y, object->rz};
+		hashBytes(&hash, &found->second, sizeof(found->second));
+		hashBytes(&hash, colour, sizeof(colour));
+		hashBytes(&hash, placement, sizeof(placement));
+	}
+
+	return hash;
+}
+
+
+/*
+* Reads baked colours out of a cache file, if it was made from exactly the same objects.
+* Returns true if every object got its colours and false if they need baking.
+*/
+static bool readBakeCache(vector<GameObject*> &objects, string cacheFile, unsigned long long hash)
+{
+	FILE *file = fopen(cacheFile.c_str(), "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	char magic[4];
+	unsigned long long fileHash = 0;
+	unsigned int count = 0;
+	bool good = fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, "BAKE", 4) == 0;
+	good = good && fread(&fileHash, sizeof(fileHash), 1, file) == 1 && fileHash == hash;
+	good = good && fread(&count, sizeof(count), 1, file) == 1 && count == objects.size();
+	for (size_t o = 0; good && o < objects.size(); o++)
+	{
+		unsigned int vertices = 0;
+		good = fread(&vertices, sizeof(vertices), 1, file) == 1 && vertices == objects[o]->mesh->vertices.size();
+		if (good && vertices > 0)
+		{
+			objects[o]->bakedColours.resize(vertices * 4);
+			good = fread(&objects[o]->bakedColours[0], vertices * 4, 1, file) == 1;
+		}
+		good = good && fread(&objects[o]->bakedAmbient, sizeof(float), 1, file) == 1;
+	}
+	fclose(file);
+
+	//Don't leave half a bake behind
+	if (!good)
+	{
+		for (size_t o = 0; o < objects.size(); o++)
+		{
+			vector<GLubyte>().swap(objects[o]->bakedColours);
+		}
+	}
+	return good;
+}
+
+
+/*
+* Writes freshly baked colours out to a cache file.
+* Returns nothing.
+*/
+static void writeBakeCache(const vector<GameObject*> &objects, string cacheFile, unsigned long long hash)
+{
+	FILE *file = fopen(cacheFile.c_str(), "wb");
+	if (file == NULL)
+	{
+		printf("Couldn't write %s\n", cacheFile.c_str());
+		return;
+	}
+
+	unsigned int count = objects.size();
+	fwrite("BAKE", 4, 1, file);
+	fwrite(&hash, sizeof(hash), 1, file);
+	fwrite(&count, sizeof(count), 1, file);
+	for (size_t o = 0; o < objects.size(); o++)
+	{
+		unsigned int vertices = objects[o]->bakedColours.size() / 4;
+		fwrite(&vertices, sizeof(vertices), 1, file);
+		if (vertices > 0)
+		{
+			fwrite(&objects[o]->bakedColours[0], vertices * 4, 1, file);
+		}
+		fwrite(&objects[o]->bakedAmbient, sizeof(float), 1, file);
+	}
+	fclose(file);
+}
+
+
+/*
+* Works out the lighting for a set of static objects and keeps it in their bakedColours, so that they can be drawn without lighting them every frame. Only the given objects block each other's sky.
+* If the cache file was made from exactly the same objects, the colours come straight out of it instead, and otherwise it's written afresh (an empty name means no cache).
+* The objects are shared out between the job threads if parallel is true, which should only be asked for from the main thread.
+* Returns nothing.
+*/
+void bakeLighting(vector<GameObject*> &objects, string cacheFile, bool parallel, LightingBakeStats *stats)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	LightingBakeStats result;
+	result.objects = objects.size();
+	result.vertices = 0;
+	result.fromCache = false;
+	for (size_t o = 0; o < objects.size(); o++)
+	{
+		result.vertices += objects[o]->mesh->vertices.size();
+	}
+
+	unsigned long long hash = hashBake(objects);
+	if (!cacheFile.empty() && readBakeCache(objects, cacheFile, hash))
+	{
+		result.fromCache = true;
+	}
+	else
+	{
+		BakeJob job;
+		job.objects = &objects;
+		job.world.resize(objects.size());
+
+		//Everything has to be in place before the sky map can be drawn, and the sky map has to be finished before any vertex can look at it
+		int grain = parallel ? 1 : objects.size();
+		jobsParallelFor(objects.size(), grain, transformObjects, &job);
+		buildSkyMap(&job);
+		jobsParallelFor(objects.size(), grain, bakeObjects, &job);
+
+		if (!cacheFile.empty())
+		{
+			writeBakeCache(objects, cacheFile, hash);
+		}
+	}
+
+	result.milliseconds = (float)((double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+	if (stats != NULL)
+	{
+		*stats = result;
+	}
+}
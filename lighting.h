@@ -0,0 +1,46 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+
+//Where the scene's one light is, in world coordinates
+const float sceneLightPosition[3] = {0.0f, 10.0f, 200.0f};
+
+//The light that reaches everything no matter which way it faces (GL_LIGHT_MODEL_AMBIENT)
+const float sceneAmbient = 0.8f;
+
+//How much light a surface facing straight at the light gets on top of the ambient light. This is GL_LIGHT0's default diffuse colour, which updateLighting() leaves alone
+const float sceneDiffuse = 1.0f;
+
+//Whether static scenery is drawn with its lighting baked into vertex colours (the default) or lit as it's drawn like the vehicle is (--dynamic-lighting)
+extern bool bakedLighting;
+
+//What a bake did
+struct LightingBakeStats
+{
+	int objects;
+	int vertices;
+
+	//Whether the colours came out of the cache file rather than being worked out
+	bool fromCache;
+
+	float milliseconds;
+};
+
+void bakeLighting(std::vector<GameObject*> &objects, std::string cacheFile, bool parallel, LightingBakeStats *stats);
+
+#endif
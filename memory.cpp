@@ -0,0 +1,297 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include "memory.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+
+using namespace std;
+
+bool checkAllocations = false;
+
+//Every allocation from every thread goes through these, so they're atomic (and relaxed, since we only ever want rough totals)
+static atomic<long> newCalls(0);
+static atomic<long> mallocCalls(0);
+static atomic<long> allocatedBytes(0);
+
+//The frame arena: one big block, with everything handed out this frame below arenaUsed
+static unsigned char *arena = NULL;
+static atomic<size_t> arenaUsed(0);
+static size_t arenaPeak = 0;
+static bool arenaWarned = false;
+
+//What we'd counted at the end of the last frame, and totals for the current logging interval
+static const Uint32 allocationLogInterval = 5000;
+static AllocationStats lastFrameTotals = {0, 0, 0};
+static Uint32 lastLogTime = 0;
+static long frameNumber = 0;
+static int logFrames = 0;
+static long logNewCalls = 0;
+static long logMallocCalls = 0;
+static long logBytes = 0;
+
+
+//On glibc we can see every malloc in the process (including SDL's and the GL driver's) by providing our own that hands off to glibc's
+//Sanitizers bring their own malloc, so we stay out of their way
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+#define TRACK_MALLOC 1
+
+extern "C"
+{
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t count, size_t size);
+	void *__libc_realloc(void *pointer, size_t size);
+	void __libc_free(void *pointer);
+
+	void *malloc(size_t size)
+	{
+		mallocCalls.fetch_add(1, memory_order_relaxed);
+		allocatedBytes.fetch_add(size, memory_order_relaxed);
+		return __libc_malloc(size);
+	}
+
+	void *calloc(size_t count, size_t size)
+	{
+		mallocCalls.fetch_add(1, memory_order_relaxed);
+		allocatedBytes.fetch_add(count * size, memory_order_relaxed);
+		return __libc_calloc(count, size);
+	}
+
+	void *realloc(void *pointer, size_t size)
+	{
+		mallocCalls.fetch_add(1, memory_order_relaxed);
+		allocatedBytes.fetch_add(size, memory_order_relaxed);
+		return __libc_realloc(pointer, size);
+	}
+
+	void free(void *pointer)
+	{
+		__libc_free(pointer);
+	}
+}
+#endif
+
+
+/*
+* Allocates heap memory for operator new, counting it separately from plain mallocs.
+* Returns the memory, or NULL if there isn't any.
+*/
+static void *countedNew(size_t size)
+{
+	newCalls.fetch_add(1, memory_order_relaxed);
+	allocatedBytes.fetch_add(size, memory_order_relaxed);
+#ifdef TRACK_MALLOC
+	return __libc_malloc(size ? size : 1);
+#else
+	return malloc(size ? size : 1);
+#endif
+}
+
+
+/*
+* Frees memory from countedNew().
+* Returns nothing.
+*/
+static void countedDelete(void *pointer)
+{
+#ifdef TRACK_MALLOC
+	__libc_free(pointer);
+#else
+	free(pointer);
+#endif
+}
+
+
+//Replacing the global operator new and delete means every C++ allocation in the game (std::string, std::vector, new, ...) gets counted
+void *operator new(size_t size)
+{
+	void *pointer = countedNew(size);
+	if (pointer == NULL)
+	{
+		throw bad_alloc();
+	}
+	return pointer;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void *operator new(size_t size, const nothrow_t &) noexcept
+{
+	return countedNew(size);
+}
+
+void *operator new[](size_t size, const nothrow_t &) noexcept
+{
+	return countedNew(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+	countedDelete(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+	countedDelete(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+	countedDelete(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+	countedDelete(pointer);
+}
+
+void operator delete(void *pointer, const nothrow_t &) noexcept
+{
+	countedDelete(pointer);
+}
+
+void operator delete[](void *pointer, const nothrow_t &) noexcept
+{
+	countedDelete(pointer);
+}
+
+
+/*
+* Makes the block that the frame arena hands memory out of.
+* Returns true if it's ready, or false if we couldn't get the memory.
+*/
+bool initFrameArena()
+{
+	arena = (unsigned char *)malloc(frameArenaSize);
+	if (arena == NULL)
+	{
+		printf("Couldn't allocate the %dMB frame arena\n", (int)(frameArenaSize / 1048576));
+		return false;
+	}
+	arenaUsed = 0;
+	return true;
+}
+
+
+/*
+* Hands out memory that's only good until the end of the frame (the next frameArenaReset()). There's nothing to free. Safe to call from any thread.
+* Returns the memory, or NULL if the arena has run out for this frame (callers should cope by doing less).
+*/
+void *frameAlloc(size_t bytes, size_t alignment)
+{
+	if (arena == NULL)
+	{
+		return NULL;
+	}
+
+	//Grab enough for the worst case alignment in one go so that two threads can't hand out the same bytes
+	size_t start = arenaUsed.fetch_add(bytes + alignment - 1, memory_order_relaxed);
+	if (start + bytes + alignment - 1 > frameArenaSize)
+	{
+		if (!arenaWarned)
+		{
+			printf("The frame arena ran out of memory (%dKB). Some work will be skipped\n", (int)(frameArenaSize / 1024));
+			arenaWarned = true;
+		}
+		return NULL;
+	}
+
+	size_t aligned = ((size_t)(arena + start) + alignment - 1) & ~(alignment - 1);
+	return (void *)aligned;
+}
+
+
+/*
+* Throws away everything handed out by frameAlloc() this frame. Must only be called when nothing is using it, such as between frames on the main thread.
+* Returns nothing.
+*/
+void frameArenaReset()
+{
+	size_t used = arenaUsed.exchange(0);
+	if (used > arenaPeak && used <= frameArenaSize)
+	{
+		arenaPeak = used;
+	}
+}
+
+
+/*
+* Frees the frame arena.
+* Returns nothing.
+*/
+void closeFrameArena()
+{
+	free(arena);
+	arena = NULL;
+}
+
+
+/*
+* Gets the allocation totals since the game started.
+* Returns an AllocationStats.
+*/
+AllocationStats getAllocationStats()
+{
+	AllocationStats stats;
+	stats.newCalls = newCalls.load(memory_order_relaxed);
+	stats.mallocCalls = mallocCalls.load(memory_order_relaxed);
+	stats.bytes = allocatedBytes.load(memory_order_relaxed);
+	return stats;
+}
+
+
+/*
+* Works out how many allocations happened during the frame that just finished, prints the average every few seconds, and (with --check-allocations) stops the game if a steady state frame allocated anything.
+* steady should be false while we're expecting allocations, such as when the world is streaming in.
+* Returns nothing.
+*/
+void allocationFrameEnd(bool steady)
+{
+	AllocationStats now = getAllocationStats();
+	long frameNew = now.newCalls - lastFrameTotals.newCalls;
+	long frameMalloc = now.mallocCalls - lastFrameTotals.mallocCalls;
+	long frameBytes = now.bytes - lastFrameTotals.bytes;
+	lastFrameTotals = now;
+	frameNumber++;
+
+	logFrames++;
+	logNewCalls += frameNew;
+	logMallocCalls += frameMalloc;
+	logBytes += frameBytes;
+
+	if (checkAllocations && steady && frameNumber > steadyStateFrames && frameNew + frameMalloc > 0)
+	{
+		printf("Frame %ld made %ld allocations (%ld new, %ld malloc, %ld bytes) in steady state\n", frameNumber, frameNew + frameMalloc, frameNew, frameMalloc, frameBytes);
+		//Stopped with abort() rather than assert(), so that release builds (which define NDEBUG) stop too
+		fflush(stdout);
+		abort();
+	}
+
+	Uint32 ticks = SDL_GetTicks();
+	if (lastLogTime == 0)
+	{
+		lastLogTime = ticks;
+	}
+	if (ticks - lastLogTime >= allocationLogInterval && logFrames > 0)
+	{
+		printf("Allocations: %.2f a frame (%.2f new, %.2f malloc, %.0f bytes), frame arena peak %dKB\n", (double)(logNewCalls + logMallocCalls) / logFrames, (double)logNewCalls / logFrames, (double)logMallocCalls / logFrames, (double)logBytes / logFrames, (int)(arenaPeak / 1024));
+		lastLogTime = ticks;
+		logFrames = 0;
+		logNewCalls = 0;
+		logMallocCalls = 0;
+		logBytes = 0;
+	}
+}
@@ -0,0 +1,132 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stddef.h>
+#include <new>
+#include <mutex>
+#include <vector>
+
+//How much memory (in bytes) the frame arena hands out each frame before it runs dry
+const size_t frameArenaSize = 4 * 1024 * 1024;
+
+//How many frames we wait before expecting the game to stop allocating (--check-allocations)
+const int steadyStateFrames = 300;
+
+//Whether to complain about (and stop the game on) any heap allocation made during a steady state frame
+extern bool checkAllocations;
+
+//Running totals of heap allocations made through operator new and malloc, from every thread
+struct AllocationStats
+{
+	long newCalls;
+	long mallocCalls;
+	long bytes;
+};
+
+bool initFrameArena();
+void *frameAlloc(size_t bytes, size_t alignment = 16);
+void frameArenaReset();
+void closeFrameArena();
+
+AllocationStats getAllocationStats();
+void allocationFrameEnd(bool steady);
+
+
+//Hands out fixed size slots for long lived objects from big blocks, so that creating and destroying lots of them doesn't go to the heap each time
+//Freed slots get reused before any new blocks are made. Safe to use from any thread
+template <typename T>
+class ObjectPool
+{
+public:
+	ObjectPool(size_t slotsPerBlock = 256) : slotsPerBlock(slotsPerBlock), freeSlots(NULL), used(0)
+	{
+	}
+
+	~ObjectPool()
+	{
+		for (size_t i = 0; i < blocks.size(); i++)
+		{
+			::operator delete(blocks[i]);
+		}
+	}
+
+	/*
+	* Makes a new default constructed object in a free slot.
+	* Returns the object.
+	*/
+	T *allocate()
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		if (freeSlots == NULL)
+		{
+			//Make a new block and put all of its slots on the free list
+			Slot *block = (Slot *)::operator new(sizeof(Slot) * slotsPerBlock);
+			blocks.push_back(block);
+			for (size_t i = 0; i < slotsPerBlock; i++)
+			{
+				block[i].next = freeSlots;
+				freeSlots = &block[i];
+			}
+		}
+
+		Slot *slot = freeSlots;
+		freeSlots = slot->next;
+		used++;
+		return new (slot->storage) T();
+	}
+
+	/*
+	* Destroys an object that came from allocate() and puts its slot back on the free list.
+	* Returns nothing.
+	*/
+	void free(T *object)
+	{
+		if (object == NULL)
+		{
+			return;
+		}
+		object->~T();
+
+		std::lock_guard<std::mutex> lock(poolMutex);
+		Slot *slot = (Slot *)object;
+		slot->next = freeSlots;
+		freeSlots = slot;
+		used--;
+	}
+
+	/*
+	* Gets how much memory the pool has taken from the heap, whether or not it's in use.
+	* Returns the size in bytes.
+	*/
+	size_t bytes()
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		return blocks.size() * slotsPerBlock * sizeof(Slot);
+	}
+
+private:
+	union Slot
+	{
+		Slot *next;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	size_t slotsPerBlock;
+	std::vector<Slot*> blocks;
+	Slot *freeSlots;
+	size_t used;
+	std::mutex poolMutex;
+};
+
+#endif
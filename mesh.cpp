@@ -0,0 +1,714 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include "mesh.h"
+#include "meshopt.h"
+#include "assets.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <map>
+#include <mutex>
+#include "glstats.h"
+
+using namespace std;
+
+bool meshLogging = true;
+
+//Every mesh we have loaded, by file name
+static map<string, Mesh*> meshCache;
+
+//The cache gets used from the world streaming thread as well as the main thread
+static mutex meshCacheMutex;
+
+//The shader that unpacks our vertices and lights them the same way the fixed function pipeline would (0 if we couldn't make one)
+static GLuint meshProgram = 0;
+static GLint quantScaleUniform = -1;
+
+//Where the shader expects the packed normals (0 is gl_Vertex on some drivers, so we stay clear of it)
+static const GLuint packedNormalAttribute = 1;
+
+static const char *meshVertexShader =
+	"#version 120\n"
+	"attribute vec2 packedNormal;\n"
+	"uniform vec3 quantScale;\n"
+	"varying vec4 litColour;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 e = packedNormal / 127.0;\n"
+	"	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+	"	if (n.z < 0.0)\n"
+	"	{\n"
+	"		n.xy = (1.0 - abs(n.yx)) * (step(0.0, n.xy) * 2.0 - 1.0);\n"
+	"	}\n"
+	"	vec3 normal = normalize(gl_NormalMatrix * (normalize(n) * quantScale));\n"
+	"	vec4 eyePosition = gl_ModelViewMatrix * gl_Vertex;\n"
+	"	vec3 toLight = normalize(gl_LightSource[0].position.xyz - eyePosition.xyz * gl_LightSource[0].position.w);\n"
+	"	float diffuse = max(dot(normal, toLight), 0.0);\n"
+	"	litColour = gl_Color * (gl_LightModel.ambient + gl_LightSource[0].ambient + gl_LightSource[0].diffuse * diffuse);\n"
+	"	litColour.a = gl_Color.a;\n"
+	"	gl_Position = ftransform();\n"
+	"}\n";
+
+static const char *meshFragmentShader =
+	"#version 120\n"
+	"varying vec4 litColour;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = litColour;\n"
+	"}\n";
+
+
+/*
+* Works out roughly how much memory a mesh's geometry is taking up.
+* Returns the size in bytes.
+*/
+size_t meshBytes(const Mesh *mesh)
+{
+	return sizeof(Mesh) + mesh->vertices.capacity() * sizeof(PackedVertex) + mesh->indices.capacity() * sizeof(GLushort) + mesh->fallbackNormals.capacity() * sizeof(GLbyte);
+}
+
+
+/*
+* Gets the mesh for a .obj file, loading it if nobody has yet, and notes that there's one more object using it. Safe to call from any thread.
+* Returns a Mesh.
+*/
+Mesh *acquireMesh(string objFile)
+{
+	{
+		lock_guard<mutex> lock(meshCacheMutex);
+		map<string, Mesh*>::iterator found = meshCache.find(objFile);
+		if (found != meshCache.end())
+		{
+			found->second->users++;
+			return found->second;
+		}
+	}
+
+	//Do the slow bit without holding the lock
+	Mesh *mesh = loadMesh(objFile);
+
+	lock_guard<mutex> lock(meshCacheMutex);
+
+	//Someone else might have loaded the same file while we were busy, in which case we use theirs
+	map<string, Mesh*>::iterator found = meshCache.find(objFile);
+	if (found != meshCache.end())
+	{
+		delete mesh;
+		mesh = found->second;
+	}
+	else
+	{
+		meshCache[objFile] = mesh;
+	}
+	mesh->users++;
+
+	return mesh;
+}
+
+
+/*
+* Notes that an object has stopped using a mesh. The mesh stays in the cache in case it's needed again, until trimMeshCache() decides we need the memory back.
+* Returns nothing.
+*/
+void releaseMesh(Mesh *mesh)
+{
+	lock_guard<mutex> lock(meshCacheMutex);
+	mesh->users--;
+}
+
+
+/*
+* Frees meshes that nothing is using until the cache fits in the given number of bytes (or there's nothing left that can go).
+* Returns the number of bytes the cache is using afterwards.
+*/
+size_t trimMeshCache(size_t budget)
+{
+	lock_guard<mutex> lock(meshCacheMutex);
+
+	size_t total = 0;
+	map<string, Mesh*>::iterator x;
+	for (x = meshCache.begin(); x != meshCache.end(); ++x)
+	{
+		total += meshBytes(x->second);
+	}
+
+	x = meshCache.begin();
+	while (total > budget && x != meshCache.end())
+	{
+		if (x->second->users <= 0)
+		{
+			total -= meshBytes(x->second);
+			delete x->second;
+			meshCache.erase(x++);
+		}
+		else
+		{
+			++x;
+		}
+	}
+
+	return total;
+}
+
+
+/*
+* Octahedral encoding helper: 1 for zero or positive numbers and -1 for negative ones (unlike the usual sign function, which gives 0 for 0).
+* Returns 1 or -1.
+*/
+static float signNotZero(float v)
+{
+	return (v >= 0) ? 1.0f : -1.0f;
+}
+
+
+/*
+* Packs a unit length normal into two bytes by projecting it onto an octahedron and unfolding the bottom half over the top half's corners.
+* Returns nothing.
+*/
+static void encodeNormal(const float n[3], GLbyte packed[2])
+{
+	float length = fabs(n[0]) + fabs(n[1]) + fabs(n[2]);
+	if (length <= 0)
+	{
+		//A broken normal. Point it up rather than nowhere
+		packed[0] = 0;
+		packed[1] = 127;
+		return;
+	}
+
+	float x = n[0] / length;
+	float y = n[1] / length;
+	if (n[2] < 0)
+	{
+		float foldedX = (1 - fabs(y)) * signNotZero(x);
+		float foldedY = (1 - fabs(x)) * signNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	packed[0] = (GLbyte)lroundf(x * 127);
+	packed[1] = (GLbyte)lroundf(y * 127);
+}
+
+
+/*
+* Unpacks a normal that was packed by encodeNormal(). The mesh shader does exactly the same thing on the GPU.
+* Returns nothing.
+*/
+void decodeNormal(const GLbyte packed[2], float n[3])
+{
+	float x = packed[0] / 127.0f;
+	float y = packed[1] / 127.0f;
+	float z = 1 - fabs(x) - fabs(y);
+	if (z < 0)
+	{
+		float unfoldedX = (1 - fabs(y)) * signNotZero(x);
+		float unfoldedY = (1 - fabs(x)) * signNotZero(y);
+		x = unfoldedX;
+		y = unfoldedY;
+	}
+
+	float length = sqrt(x * x + y * y + z * z);
+	n[0] = x / length;
+	n[1] = y / length;
+	n[2] = z / length;
+}
+
+
+/*
+* Fills in a mesh's vertices from the positions and normals read out of a model, one vertex for each corner (a position index and a normal index), packing them down and putting a bounding sphere around them. The mesh's indices need to be there already, as the vertices and indices get reordered for the GPU's caches once they're packed.
+* Returns nothing.
+*/
+void packMesh(Mesh *newMesh, const vector<GLfloat> &positions, const vector<GLfloat> &normals, const vector< pair<unsigned int, unsigned int> > &corners)
+{
+	//Put a box around every position in the model
+	GLfloat minX = 0, minY = 0, minZ = 0;
+	GLfloat maxX = 0, maxY = 0, maxZ = 0;
+	for (size_t i = 0; i + 2 < positions.size(); i += 3)
+	{
+		GLfloat x = positions[i];
+		GLfloat y = positions[i + 1];
+		GLfloat z = positions[i + 2];
+		if (i == 0)
+		{
+			minX = maxX = x;
+			minY = maxY = y;
+			minZ = maxZ = z;
+		}
+		minX = (x < minX) ? x : minX;
+		minY = (y < minY) ? y : minY;
+		minZ = (z < minZ) ? z : minZ;
+		maxX = (x > maxX) ? x : maxX;
+		maxY = (y > maxY) ? y : maxY;
+		maxZ = (z > maxZ) ? z : maxZ;
+	}
+
+	//Put the bounding sphere in the middle of the bounding box, with a radius that reaches the corners
+	newMesh->boundX = (minX + maxX) / 2;
+	newMesh->boundY = (minY + maxY) / 2;
+	newMesh->boundZ = (minZ + maxZ) / 2;
+	newMesh->boundRadius = sqrt((maxX - minX) * (maxX - minX) + (maxY - minY) * (maxY - minY) + (maxZ - minZ) * (maxZ - minZ)) / 2;
+
+	//Positions get stored as the number of quantScale sized steps from the middle of the bounding box, with the box's edges at +/-32767 steps
+	float halfSize[3] = {(maxX - minX) / 2, (maxY - minY) / 2, (maxZ - minZ) / 2};
+	newMesh->quantCentre[0] = newMesh->boundX;
+	newMesh->quantCentre[1] = newMesh->boundY;
+	newMesh->quantCentre[2] = newMesh->boundZ;
+	for (int a = 0; a < 3; a++)
+	{
+		//A flat mesh has nothing to quantise along that axis, but we still don't want to divide by zero
+		newMesh->quantScale[a] = (halfSize[a] > 0) ? halfSize[a] / 32767 : 1;
+	}
+
+	//Pack every vertex, keeping track of how far the packed values end up from the real ones
+	float worstPosition = 0;
+	float worstNormalCos = 1;
+	newMesh->vertices.resize(corners.size());
+	for (size_t i = 0; i < corners.size(); i++)
+	{
+		PackedVertex *v = &newMesh->vertices[i];
+
+		float p[3] = {0, 0, 0};
+		if (corners[i].first < positions.size() / 3)
+		{
+			p[0] = positions[corners[i].first * 3];
+			p[1] = positions[corners[i].first * 3 + 1];
+			p[2] = positions[corners[i].first * 3 + 2];
+		}
+
+		float error = 0;
+		for (int a = 0; a < 3; a++)
+		{
+			long q = lroundf((p[a] - newMesh->quantCentre[a]) / newMesh->quantScale[a]);
+			q = (q < -32767) ? -32767 : (q > 32767) ? 32767 : q;
+			v->position[a] = (GLshort)q;
+
+			float difference = newMesh->quantCentre[a] + q * newMesh->quantScale[a] - p[a];
+			error += difference * difference;
+		}
+		worstPosition = (sqrt(error) > worstPosition) ? sqrt(error) : worstPosition;
+
+		float n[3] = {0, 1, 0};
+		if (corners[i].second < normals.size() / 3)
+		{
+			n[0] = normals[corners[i].second * 3];
+			n[1] = normals[corners[i].second * 3 + 1];
+			n[2] = normals[corners[i].second * 3 + 2];
+			float length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length > 0)
+			{
+				n[0] /= length;
+				n[1] /= length;
+				n[2] /= length;
+			}
+		}
+		encodeNormal(n, v->normal);
+
+		float decoded[3];
+		decodeNormal(v->normal, decoded);
+		float cosAngle = n[0] * decoded[0] + n[1] * decoded[1] + n[2] * decoded[2];
+		worstNormalCos = (cosAngle < worstNormalCos) ? cosAngle : worstNormalCos;
+	}
+
+	//We draw from client arrays, so the vertex data is sent with every draw and the saving applies to bandwidth as well as memory
+	//Compare against floats for both position and normal, and bound the position error at half a step along each axis
+	size_t floatBytes = newMesh->vertices.size() * 6 * sizeof(GLfloat);
+	size_t packedBytes = newMesh->vertices.size() * sizeof(PackedVertex);
+	float positionBound = sqrt(newMesh->quantScale[0] * newMesh->quantScale[0] + newMesh->quantScale[1] * newMesh->quantScale[1] + newMesh->quantScale[2] * newMesh->quantScale[2]) / 2;
+	worstNormalCos = (worstNormalCos > 1) ? 1 : worstNormalCos;
+	if (meshLogging)
+	{
+		printf("  Packed %d vertices into %d bytes instead of %d as floats. Positions within %g (bound %g), normals within %.2f degrees\n", (int)newMesh->vertices.size(), (int)packedBytes, (int)floatBytes, worstPosition, positionBound, acos(worstNormalCos) * 180 / M_PI);
+	}
+
+	//Reorder everything for the GPU's caches now, so that it's done once for every object that shares the mesh
+	optimiseMesh(newMesh);
+}
+
+
+/*
+* Reads a specified .obj model into a new Mesh. Most of the time you want acquireMesh() instead, so that models that are already loaded get shared.
+* Each distinct position and normal pair used by a face becomes one packed vertex.
+* Returns a Mesh (which will be empty if the file couldn't be read).
+*/
+Mesh *loadMesh(string objFile)
+{
+	Mesh *newMesh = new Mesh;
+	newMesh->name = objFile;
+	newMesh->users = 0;
+	newMesh->impostor = -1;
+
+	//Models cooked into the executable were packed and optimised when they were cooked, so there's nothing to read or work out
+	const CookedMesh *cooked = findCookedMesh(objFile);
+	if (cooked != NULL)
+	{
+		newMesh->vertices.assign(cooked->vertices, cooked->vertices + cooked->vertexCount);
+		newMesh->indices.assign(cooked->indices, cooked->indices + cooked->indexCount);
+		for (int a = 0; a < 3; a++)
+		{
+			newMesh->quantCentre[a] = cooked->quantCentre[a];
+			newMesh->quantScale[a] = cooked->quantScale[a];
+		}
+		newMesh->boundX = cooked->bound[0];
+		newMesh->boundY = cooked->bound[1];
+		newMesh->boundZ = cooked->bound[2];
+		newMesh->boundRadius = cooked->bound[3];
+		if (meshLogging)
+		{
+			printf("  Using cooked %s (%d vertices)\n", objFile.c_str(), cooked->vertexCount);
+		}
+		return newMesh;
+	}
+
+	//Then models cooked into resources/cooked, if they're still up to date with their .obj files
+	if (loadCookedMeshFile(objFile, newMesh))
+	{
+		if (meshLogging)
+		{
+			printf("  Using cooked %s (%d vertices)\n", cookedMeshFileName(objFile).c_str(), (int)newMesh->vertices.size());
+		}
+		return newMesh;
+	}
+
+	//Declare some temporary variables that we'll be using
+	GLfloat x = 0;
+	GLfloat y = 0;
+	GLfloat z = 0;
+
+	//Full precision positions and normals as they appear in the file, which we'll pack once we've seen all of them
+	vector<GLfloat> positions;
+	vector<GLfloat> normals;
+
+	//Which position and normal each vertex uses, and the vertex we've already made for each pair
+	vector< pair<unsigned int, unsigned int> > corners;
+	map< pair<unsigned int, unsigned int>, GLushort> cornerIndex;
+
+	//Open the .obj file
+	string fileName = "resources" + pathSeparator + "models" + pathSeparator + objFile;
+	FILE * currentFile = fopen(fileName.c_str(), "r");
+
+	//If the file exists and can be opened
+	if(currentFile != NULL)
+	{
+		if (meshLogging)
+		{
+			printf("  Attempting to parse obj file %s\n", fileName.c_str());
+		}
+		
+		//Loop through forever (we'll break out if we detect the end of the file)
+		while(1)
+		{
+			//A character array that we'll store the first part of the line that we're reading in
+			char lineType[256];
+
+			//TODO: Longer term, it'd probably be worth just reading the entire line here and then do our conditionals based on  the first two characters, instead of just reading the first word.
+			//Grab everything on the line before the first space (in the Wavefront OBJ format, the first few characters indicate the type of data stored on that line)
+			int result = fscanf(currentFile, "%s ", lineType);
+
+			//printf("   %s\n", lineType);
+
+			//If we've hit the end of the file, drop out of the loop
+			if (result == EOF)
+			{
+				break;
+			}
+
+			//TODO: There are other line types in the OBJ spec such as vt, usemtrl and mtrlib that we're ignoring for now
+			//If the line represents a vertex
+			if (strcmp(lineType, "v") == 0)
+			{
+				//Read the three float values and store them in our list of positions
+				fscanf(currentFile, "%f %f %f\n", &x, &y, &z);
+				positions.push_back(x);
+				positions.push_back(y);
+				positions.push_back(z);
+			}
+			//If the line represents a vertex normal
+			else if (strcmp(lineType, "vn") == 0)
+			{
+				fscanf(currentFile, "%f %f %f\n", &x, &y, &z);
+				normals.push_back(x);
+				normals.push_back(y);
+				normals.push_back(z);
+			}
+			//If the line represents a face
+			else if (strcmp(lineType, "f") == 0)
+			{
+				//Declare some temporary arrays to store the values we're reading out
+				unsigned int faceDefs[3];
+				unsigned int normalDefs[3];
+
+				//TODO: This doesn't account for other styles of face definitions (with texture verts)
+				//Read the vertex and normal values out of the file and put them into the temporary arrays
+				int pcount = fscanf(currentFile, "%d//%d %d//%d %d//%d\n", &faceDefs[0], &normalDefs[0], &faceDefs[1], &normalDefs[1], &faceDefs[2], &normalDefs[2]);
+
+				//If we've gotten the wrong number of pattern matches when reading from the file, output some information and make do with what we have so far
+				if (pcount != 6)
+				{
+					printf("Our obj parser is bad and we should feel bad. We couldn't parse the face defs >_<");
+					printf("%d  x: %+d  y: %+d  z: %+d\n", pcount, faceDefs[0], faceDefs[1], faceDefs[2]);
+					break;
+				}
+
+				//We're adding the corners backwards so that they're in the right order for glFrontFace(GL_CW)
+				for (int c = 2; c >= 0; c--)
+				{
+					//These indices aren't 0 based, so let's subtract one to get the right index into our lists
+					pair<unsigned int, unsigned int> corner(faceDefs[c] - 1, normalDefs[c] - 1);
+					map< pair<unsigned int, unsigned int>, GLushort>::iterator found = cornerIndex.find(corner);
+					if (found != cornerIndex.end())
+					{
+						newMesh->indices.push_back(found->second);
+					}
+					else if (corners.size() < 65536)
+					{
+						cornerIndex[corner] = (GLushort)corners.size();
+						newMesh->indices.push_back((GLushort)corners.size());
+						corners.push_back(corner);
+					}
+				}
+
+				//If we ran out of 16 bit indices part way through a face, drop the whole face
+				if (newMesh->indices.size() % 3 != 0)
+				{
+					printf("%s has too many vertices, so some faces will be missing\n", fileName.c_str());
+					newMesh->indices.resize(newMesh->indices.size() - newMesh->indices.size() % 3);
+					break;
+				}
+			}
+		}
+
+		//Close the .obj file
+		fclose(currentFile);
+	}
+	else
+	{
+		printf("Couldn't open %s\n", fileName.c_str());
+	}
+
+	//Pack and optimise what we read
+	packMesh(newMesh, positions, normals, corners);
+
+	return newMesh;
+}
+
+
+/*
+* Creates a GameObject instance representing a 3D model (which is read from the specified .obj file if it isn't already loaded) and its position/rotation in 3D space.
+* Returns a GameObject.
+*/
+GameObject loadObj(string objFile, SDL_Colour foo, float posX, float posY, float rotZ)
+{
+	//Create a new GameObject and set its properties based on what's been passed in
+	GameObject newObject;
+	newObject.name = objFile;
+	newObject.x = posX;
+	newObject.y = posY;
+	newObject.rz = rotZ;
+
+	//TODO: This stuff should be parsed from whatever mtrl files the OBJ says it uses
+	//Set the colour for the object
+	newObject.colour.r = foo.r;
+	newObject.colour.g = foo.g;
+	newObject.colour.b = foo.b;
+
+	//Share the geometry with every other object that uses the same model
+	newObject.mesh = acquireMesh(objFile);
+	newObject.visible = true;
+
+	//It's not in the transform hierarchy until someone puts it there
+	newObject.transform = -1;
+	newObject.bakedAmbient = 0;
+
+	return newObject;
+}
+
+
+/*
+* Compiles one of our shaders (the mesh, particle and impostor code all use this), printing the driver's complaints if it doesn't work. what says whose shader it is in the message.
+* Returns the shader, or 0 if it wouldn't compile.
+*/
+GLuint compileShader(GLenum type, const char *source, const char *what)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (compiled != GL_TRUE)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		printf("Couldn't compile %s shader: %s\n", what, log);
+		glDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+
+/*
+* Sets up the shader that draws our packed meshes. Needs a GL context.
+* Returns true if the shader is ready, or false if we'll be unpacking normals on the CPU instead.
+*/
+bool initMeshRendering()
+{
+	//GLSL 1.20 comes with GL 2.1, but 2.0 drivers generally manage it too
+	if (!GLEW_VERSION_2_0)
+	{
+		printf("No shaders, so mesh normals will be unpacked on the CPU\n");
+		return false;
+	}
+
+	GLuint vertexShader = compileShader(GL_VERTEX_SHADER, meshVertexShader, "mesh");
+	GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, meshFragmentShader, "mesh");
+	if (vertexShader == 0 || fragmentShader == 0)
+	{
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return false;
+	}
+
+	meshProgram = glCreateProgram();
+	glAttachShader(meshProgram, vertexShader);
+	glAttachShader(meshProgram, fragmentShader);
+	glBindAttribLocation(meshProgram, packedNormalAttribute, "packedNormal");
+	glLinkProgram(meshProgram);
+
+	//The program keeps hold of the shaders for as long as it needs them
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(meshProgram, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+	{
+		char log[1024];
+		glGetProgramInfoLog(meshProgram, sizeof(log), NULL, log);
+		printf("Couldn't link mesh shader: %s\n", log);
+		glDeleteProgram(meshProgram);
+		meshProgram = 0;
+		return false;
+	}
+
+	quantScaleUniform = glGetUniformLocation(meshProgram, "quantScale");
+
+	return true;
+}
+
+
+/*
+* Draws a mesh at the current position, colour and lighting, or with the given colour for each vertex (from bakeLighting()) and no lighting at all if bakedColours isn't NULL. Must be called from the thread with the GL context.
+* Returns nothing.
+*/
+void drawMesh(Mesh *mesh, const GLubyte *bakedColours)
+{
+	if (mesh->indices.empty())
+	{
+		return;
+	}
+
+	//Turn our 16 bit positions back into model coordinates
+	glPushMatrix();
+	glTranslatef(mesh->quantCentre[0], mesh->quantCentre[1], mesh->quantCentre[2]);
+	glScalef(mesh->quantScale[0], mesh->quantScale[1], mesh->quantScale[2]);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_SHORT, sizeof(PackedVertex), mesh->vertices[0].position);
+
+	//Baked lighting only needs the fixed function pipeline to pass the colours straight through, so there are no normals to send either
+	//The colours are blended across each triangle like the shader's are, rather than flat shaded
+	if (bakedColours != NULL)
+	{
+		glPushAttrib(GL_LIGHTING_BIT);
+		glDisable(GL_LIGHTING);
+		glShadeModel(GL_SMOOTH);
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, bakedColours);
+
+		glDrawElements(GL_TRIANGLES, mesh->indices.size(), GL_UNSIGNED_SHORT, &mesh->indices[0]);
+
+		glDisableClientState(GL_COLOR_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+		glPopAttrib();
+		glPopMatrix();
+		return;
+	}
+
+	//Without the shader, fixed function lighting needs three component normals, so unpack them the first time this mesh is drawn
+	//The lock stops trimMeshCache() from measuring the mesh while it's growing
+	if (meshProgram == 0 && mesh->fallbackNormals.empty())
+	{
+		lock_guard<mutex> lock(meshCacheMutex);
+		mesh->fallbackNormals.resize(mesh->vertices.size() * 3);
+		for (size_t i = 0; i < mesh->vertices.size(); i++)
+		{
+			//The modelview is about to be scaled by quantScale, which OpenGL undoes for normals, so scale them up to match first
+			float n[3];
+			decodeNormal(mesh->vertices[i].normal, n);
+			n[0] *= mesh->quantScale[0];
+			n[1] *= mesh->quantScale[1];
+			n[2] *= mesh->quantScale[2];
+			float length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			for (int a = 0; a < 3; a++)
+			{
+				mesh->fallbackNormals[i * 3 + a] = (GLbyte)lroundf(n[a] / length * 127);
+			}
+		}
+	}
+
+	if (meshProgram != 0)
+	{
+		glUseProgram(meshProgram);
+		glUniform3fv(quantScaleUniform, 1, mesh->quantScale);
+		glEnableVertexAttribArray(packedNormalAttribute);
+		glVertexAttribPointer(packedNormalAttribute, 2, GL_BYTE, GL_FALSE, sizeof(PackedVertex), mesh->vertices[0].normal);
+	}
+	else
+	{
+		//Normals come out of the scaled modelview the wrong length, so let OpenGL fix that up
+		glEnable(GL_NORMALIZE);
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(GL_BYTE, 0, &mesh->fallbackNormals[0]);
+	}
+
+	glDrawElements(GL_TRIANGLES, mesh->indices.size(), GL_UNSIGNED_SHORT, &mesh->indices[0]);
+
+	if (meshProgram != 0)
+	{
+		glDisableVertexAttribArray(packedNormalAttribute);
+		glUseProgram(0);
+	}
+	else
+	{
+		glDisableClientState(GL_NORMAL_ARRAY);
+	}
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	glPopMatrix();
+}
+
+
+/*
+* Frees the mesh shader while we still have a GL context.
+* Returns nothing.
+*/
+void closeMeshRendering()
+{
+	if (meshProgram != 0)
+	{
+		glDeleteProgram(meshProgram);
+		meshProgram = 0;
+	}
+}
@@ -0,0 +1,114 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef MESH_H
+#define MESH_H
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Certain operating systems are dumb and use the wrong slash to separate paths.
+//Thanks, Windows.
+const std::string pathSeparator =
+#ifdef __MINGW64__
+	"\\";
+#else
+	"/";
+#endif
+
+//Whether loading a mesh prints what it's doing (the microbenchmarks turn this off so that they don't time the terminal)
+extern bool meshLogging;
+
+//One corner of a triangle, packed down to 8 bytes (instead of 24 as floats)
+struct PackedVertex
+{
+	//Position, quantised to 16 bits against the mesh's bounding box (see Mesh::quantCentre and Mesh::quantScale)
+	GLshort position[3];
+
+	//Normal, octahedral encoded into two bytes
+	GLbyte normal[2];
+};
+
+//The geometry for a 3D model. Each model is only loaded once, and shared between all the GameObjects that use it
+struct Mesh
+{
+	std::string name;
+
+	//Geometry
+	std::vector <PackedVertex> vertices;
+	std::vector <GLushort> indices;
+
+	//To get back to the model's own coordinates, position = quantCentre + position * quantScale
+	float quantCentre[3];
+	float quantScale[3];
+
+	//Normals expanded back out to three bytes each, only filled in if we can't decode them in a shader
+	std::vector <GLbyte> fallbackNormals;
+
+	//A sphere that contains all of the geometry, in the model's own coordinates
+	float boundX;
+	float boundY;
+	float boundZ;
+	float boundRadius;
+
+	//How many GameObjects are using this mesh
+	int users;
+
+	//Which row of the impostor atlas has pictures of it (see impostor.h), or -1 if it's always drawn as it is
+	int impostor;
+};
+
+//A structure representing a 3D model in the game
+struct GameObject
+{
+	std::string name;
+
+	//Position
+	float x;
+	float y;
+	float rz;
+
+	//Material
+	SDL_Colour colour;
+
+	//Geometry
+	Mesh *mesh;
+
+	//Whether any of the object is inside the view this frame
+	bool visible;
+
+	//Where its world matrix is kept in the transform hierarchy (see transform.h), or -1 if it's placed from x, y and rz as it's drawn
+	int transform;
+
+	//Lighting baked into a colour for each of the mesh's vertices (four bytes each), or empty if the object gets lit as it's drawn
+	std::vector <GLubyte> bakedColours;
+
+	//The ambient light the object's vertices get on average once the bake has taken away the sky they can't see, for its impostor to be lit with (only set when bakedColours is)
+	float bakedAmbient;
+};
+
+void packMesh(Mesh *mesh, const std::vector<GLfloat> &positions, const std::vector<GLfloat> &normals, const std::vector< std::pair<unsigned int, unsigned int> > &corners);
+Mesh *loadMesh(std::string objFile);
+Mesh *acquireMesh(std::string objFile);
+void releaseMesh(Mesh *mesh);
+size_t meshBytes(const Mesh *mesh);
+size_t trimMeshCache(size_t budget);
+GLuint compileShader(GLenum type, const char *source, const char *what);
+bool initMeshRendering();
+void decodeNormal(const GLbyte packed[2], float n[3]);
+void drawMesh(Mesh *mesh, const GLubyte *bakedColours);
+void closeMeshRendering();
+GameObject loadObj(std::string objFile, SDL_Colour foo, float posX, float posY, float rotZ);
+
+#endif
@@ -0,0 +1,380 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include "meshopt.h"
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+using namespace std;
+
+//A run of triangles that gets kept together when we sort for overdraw
+struct TriangleCluster
+{
+	//Where the cluster's triangles start in the index list, and how many indices it has
+	size_t begin;
+	size_t count;
+
+	//How far the cluster faces away from the middle of the mesh. Clusters that face further out get drawn first
+	float sortKey;
+};
+
+
+/*
+* Sorting helper for clusters.
+* Returns true if cluster a faces further out than cluster b, and so should be drawn before it.
+*/
+static bool facesFurtherOut(const TriangleCluster &a, const TriangleCluster &b)
+{
+	return a.sortKey > b.sortKey;
+}
+
+
+/*
+* Runs a list of triangles through a pretend first in first out vertex cache (the kind most GPUs have) and counts how many vertices had to be transformed.
+* ACMR is transformed vertices per triangle (0.5 is perfect for a big grid, 3 is no reuse at all). ATVR is transformed vertices per actual vertex (1 is perfect).
+* Returns nothing.
+*/
+void measureVertexCache(const vector<GLushort> &indices, size_t vertexCount, int cacheSize, float *acmr, float *atvr)
+{
+	//When each vertex last went into the cache, counting one for every miss
+	vector<size_t> cachedAt(vertexCount, 0);
+	size_t misses = 0;
+
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		GLushort v = indices[i];
+		if (cachedAt[v] == 0 || misses - cachedAt[v] >= (size_t)cacheSize)
+		{
+			misses++;
+			cachedAt[v] = misses;
+		}
+	}
+
+	size_t triangles = indices.size() / 3;
+	*acmr = (triangles > 0) ? (float)misses / triangles : 0;
+	*atvr = (vertexCount > 0) ? (float)misses / vertexCount : 0;
+}
+
+
+/*
+* Reorders triangles so that vertices get reused while they're still in the cache, using Tipsify (Sander, Nehab and Barczak 2007).
+* It fans out around one vertex at a time, and picks the next vertex from the ones it just used, preferring ones that will still be in the cache after their remaining triangles are drawn.
+* Returns the new index list, and fills in where it had to jump somewhere unconnected (which makes a good place to split up clusters for overdraw sorting).
+*/
+static vector<GLushort> tipsify(const vector<GLushort> &indices, size_t vertexCount, int cacheSize, vector<size_t> &jumps)
+{
+	size_t triangleCount = indices.size() / 3;
+
+	//Which triangles use each vertex
+	vector<size_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		adjacencyStart[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		adjacencyStart[v + 1] += adjacencyStart[v];
+	}
+	vector<size_t> adjacency(indices.size());
+	vector<size_t> filled(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		adjacency[filled[indices[i]]++] = i / 3;
+	}
+
+	//How many triangles each vertex still has to be drawn in, and when it last went into the cache
+	vector<int> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		liveTriangles[indices[i]]++;
+	}
+	vector<int> cachedAt(vertexCount, 0);
+	int time = cacheSize + 1;
+
+	vector<bool> emitted(triangleCount, false);
+	vector<GLushort> deadEnds;
+	vector<GLushort> candidates;
+	vector<GLushort> result;
+	result.reserve(indices.size());
+
+	size_t cursor = 0;
+	int fanning = (vertexCount > 0 && triangleCount > 0) ? indices[0] : -1;
+
+	while (fanning >= 0)
+	{
+		//Draw every triangle around this vertex that hasn't been drawn yet
+		candidates.clear();
+		for (size_t a = adjacencyStart[fanning]; a < adjacencyStart[fanning + 1]; a++)
+		{
+			size_t t = adjacency[a];
+			if (emitted[t])
+			{
+				continue;
+			}
+
+			for (int c = 0; c < 3; c++)
+			{
+				GLushort v = indices[t * 3 + c];
+				result.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+				if (time - cachedAt[v] > cacheSize)
+				{
+					cachedAt[v] = time;
+					time++;
+				}
+			}
+			emitted[t] = true;
+		}
+
+		//Pick the vertex we just used that will be oldest in the cache while still being there once its remaining triangles are drawn
+		int next = -1;
+		int bestPriority = -1;
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			GLushort v = candidates[i];
+			if (liveTriangles[v] <= 0)
+			{
+				continue;
+			}
+
+			int priority = 0;
+			if (time - cachedAt[v] + 2 * liveTriangles[v] <= cacheSize)
+			{
+				priority = time - cachedAt[v];
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = v;
+			}
+		}
+
+		//If none of them have anything left, go back through recently used vertices, and failing that, just take the next one with triangles left
+		if (next < 0)
+		{
+			while (!deadEnds.empty() && next < 0)
+			{
+				GLushort v = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTriangles[v] > 0)
+				{
+					next = v;
+				}
+			}
+			while (next < 0 && cursor < vertexCount)
+			{
+				if (liveTriangles[cursor] > 0)
+				{
+					next = (int)cursor;
+				}
+				cursor++;
+			}
+
+			if (next >= 0)
+			{
+				jumps.push_back(result.size());
+			}
+		}
+
+		fanning = next;
+	}
+
+	return result;
+}
+
+
+/*
+* Splits the vertex cache optimised triangles into clusters and sorts them so that the ones facing furthest out from the middle of the mesh are drawn first, since those tend to cover up the rest (the other half of Tipsify).
+* Clusters are split wherever tipsify() had to jump, and also wherever the cache would be doing nearly as well starting from scratch, which gives more, smaller clusters to sort.
+* Returns nothing.
+*/
+static void sortForOverdraw(Mesh *mesh, const vector<size_t> &jumps, int cacheSize, float threshold)
+{
+	vector<GLushort> &indices = mesh->indices;
+
+	//Start with the hard boundaries
+	vector<size_t> boundaries;
+	boundaries.push_back(0);
+	for (size_t i = 0; i < jumps.size(); i++)
+	{
+		if (jumps[i] > boundaries.back() && jumps[i] < indices.size())
+		{
+			boundaries.push_back(jumps[i]);
+		}
+	}
+	boundaries.push_back(indices.size());
+
+	//Split each of those up where the cache is doing well enough that starting a new cluster won't cost much
+	vector<TriangleCluster> clusters;
+	for (size_t b = 0; b + 1 < boundaries.size(); b++)
+	{
+		vector<GLushort> whole(indices.begin() + boundaries[b], indices.begin() + boundaries[b + 1]);
+		float wholeAcmr;
+		float unused;
+		measureVertexCache(whole, mesh->vertices.size(), cacheSize, &wholeAcmr, &unused);
+
+		size_t start = boundaries[b];
+		vector<size_t> cachedAt(mesh->vertices.size(), 0);
+		size_t misses = 0;
+		for (size_t i = boundaries[b]; i < boundaries[b + 1]; i++)
+		{
+			GLushort v = indices[i];
+			if (cachedAt[v] == 0 || misses - cachedAt[v] >= (size_t)cacheSize)
+			{
+				misses++;
+				cachedAt[v] = misses;
+			}
+
+			//At the end of each triangle, see whether we've done well enough to cut here
+			size_t drawn = i + 1 - start;
+			if (drawn % 3 == 0 && i + 1 < boundaries[b + 1] && (float)misses / (drawn / 3) <= wholeAcmr * threshold)
+			{
+				TriangleCluster cluster = {start, drawn, 0};
+				clusters.push_back(cluster);
+				start = i + 1;
+				misses = 0;
+				fill(cachedAt.begin(), cachedAt.end(), 0);
+			}
+		}
+		TriangleCluster cluster = {start, boundaries[b + 1] - start, 0};
+		clusters.push_back(cluster);
+	}
+
+	//Work in the model's own coordinates so that the quantisation scale doesn't squash things
+	vector<float> positions(mesh->vertices.size() * 3);
+	float meshCentre[3] = {0, 0, 0};
+	for (size_t v = 0; v < mesh->vertices.size(); v++)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			positions[v * 3 + a] = mesh->quantCentre[a] + mesh->vertices[v].position[a] * mesh->quantScale[a];
+			meshCentre[a] += positions[v * 3 + a] / mesh->vertices.size();
+		}
+	}
+
+	//Work out which way each cluster faces on average, and how far out from the middle it sits in that direction
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		float centre[3] = {0, 0, 0};
+		float normal[3] = {0, 0, 0};
+		float totalArea = 0;
+
+		for (size_t i = clusters[c].begin; i < clusters[c].begin + clusters[c].count; i += 3)
+		{
+			const float *p0 = &positions[indices[i] * 3];
+			const float *p1 = &positions[indices[i + 1] * 3];
+			const float *p2 = &positions[indices[i + 2] * 3];
+			float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+			float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+
+			//Our front faces are clockwise, so this cross product points out of the front of the triangle. Its length is twice the triangle's area
+			float n[3] = {e2[1] * e1[2] - e2[2] * e1[1], e2[2] * e1[0] - e2[0] * e1[2], e2[0] * e1[1] - e2[1] * e1[0]};
+			float area = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) / 2;
+
+			for (int a = 0; a < 3; a++)
+			{
+				centre[a] += (p0[a] + p1[a] + p2[a]) / 3 * area;
+				normal[a] += n[a];
+			}
+			totalArea += area;
+		}
+
+		if (totalArea > 0)
+		{
+			for (int a = 0; a < 3; a++)
+			{
+				centre[a] /= totalArea;
+			}
+		}
+
+		float length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length > 0)
+		{
+			clusters[c].sortKey = ((centre[0] - meshCentre[0]) * normal[0] + (centre[1] - meshCentre[1]) * normal[1] + (centre[2] - meshCentre[2]) * normal[2]) / length;
+		}
+	}
+
+	stable_sort(clusters.begin(), clusters.end(), facesFurtherOut);
+
+	vector<GLushort> sorted;
+	sorted.reserve(indices.size());
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		sorted.insert(sorted.end(), indices.begin() + clusters[c].begin, indices.begin() + clusters[c].begin + clusters[c].count);
+	}
+	indices.swap(sorted);
+
+	if (meshLogging)
+	{
+		printf("  Sorted %d triangle clusters for overdraw\n", (int)clusters.size());
+	}
+}
+
+
+/*
+* Renumbers vertices in the order the triangles first use them, so that reading them is as close to a straight walk through memory as we can get.
+* Vertices that no triangle uses get dropped.
+* Returns nothing.
+*/
+static void reorderVertices(Mesh *mesh)
+{
+	const GLushort unused = 0xffff;
+	vector<GLushort> newIndex(mesh->vertices.size(), unused);
+	vector<PackedVertex> reordered;
+	reordered.reserve(mesh->vertices.size());
+
+	for (size_t i = 0; i < mesh->indices.size(); i++)
+	{
+		GLushort v = mesh->indices[i];
+		if (newIndex[v] == unused)
+		{
+			newIndex[v] = (GLushort)reordered.size();
+			reordered.push_back(mesh->vertices[v]);
+		}
+		mesh->indices[i] = newIndex[v];
+	}
+
+	mesh->vertices.swap(reordered);
+}
+
+
+/*
+* Reorders a freshly loaded mesh's triangles and vertices so that the GPU does less work drawing it: fewer vertices transformed, fewer pixels drawn over, and less jumping around memory.
+* Returns nothing.
+*/
+void optimiseMesh(Mesh *mesh)
+{
+	if (mesh->indices.size() < 3)
+	{
+		return;
+	}
+
+	float acmrBefore;
+	float atvrBefore;
+	measureVertexCache(mesh->indices, mesh->vertices.size(), vertexCacheSize, &acmrBefore, &atvrBefore);
+
+	vector<size_t> jumps;
+	mesh->indices = tipsify(mesh->indices, mesh->vertices.size(), vertexCacheSize, jumps);
+	sortForOverdraw(mesh, jumps, vertexCacheSize, overdrawThreshold);
+	reorderVertices(mesh);
+
+	float acmrAfter;
+	float atvrAfter;
+	measureVertexCache(mesh->indices, mesh->vertices.size(), vertexCacheSize, &acmrAfter, &atvrAfter);
+
+	if (meshLogging)
+	{
+		printf("  Vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", acmrBefore, acmrAfter, atvrBefore, atvrAfter);
+	}
+}
@@ -0,0 +1,28 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef MESHOPT_H
+#define MESHOPT_H
+
+#include <vector>
+
+#include "mesh.h"
+
+//How many vertices we assume the GPU keeps around after transforming them. Real hardware varies, but 16 is a safe middle ground to optimise for
+const int vertexCacheSize = 16;
+
+//How much worse than the best vertex cache order we're willing to go to get triangles drawn front to back (1.05 means 5%)
+const float overdrawThreshold = 1.05f;
+
+void measureVertexCache(const std::vector<GLushort> &indices, size_t vertexCount, int cacheSize, float *acmr, float *atvr);
+void optimiseMesh(Mesh *mesh);
+
+#endif
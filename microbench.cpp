@@ -0,0 +1,1047 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+//Microbenchmarks for the functions that the game spends its time in. This is built along with drive.cpp (without its main()) so that we measure the real thing
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <string>
+#include <vector>
+#include "capture.h"
+#include "framepacing.h"
+#include "impostor.h"
+#include "jobs.h"
+#include "lighting.h"
+#include "mesh.h"
+#include "particles.h"
+#include "replay.h"
+#include "stress.h"
+#include "terrain.h"
+#include "text.h"
+#include "transform.h"
+
+using namespace std;
+
+//The bits of drive.cpp that we benchmark or need to set things up
+extern SDL_Window *win;
+extern int screenWidth;
+extern int screenHeight;
+extern float fieldOfView;
+extern bool carAccel;
+extern bool carBrake;
+extern int carSteer;
+extern float carSpeed;
+extern float carDirection;
+extern float carX;
+extern float carY;
+extern SDL_Colour textColour;
+extern TTF_Font *hudFont;
+extern FontAtlas hudAtlas;
+extern list<GameObject> sceneryObjects;
+extern vector<GameObject*> sceneryDrawList;
+extern int sceneryDrawnObjects;
+extern long sceneryDrawnTriangles;
+extern float cameraX;
+extern float cameraY;
+extern float cameraHeight;
+extern GLfloat rotX;
+extern GLfloat rotY;
+bool init();
+void close();
+void updateSim();
+void rotateCamera();
+void updateLighting();
+void renderObject(const GameObject &o);
+void renderHUD();
+void loadScenery();
+void attachScenery();
+void rebuildDrawList();
+void updateFrustum();
+void cullScenery(void *data, int begin, int end);
+void renderScenery();
+void updateVehicleParticles(float seconds);
+
+//The model the loading benchmarks use (it's the biggest one we have)
+static const char *benchModel = "bladder.obj";
+
+//One thing we measure
+struct Benchmark
+{
+	const char *name;
+
+	//What one operation is, for the results
+	const char *operation;
+
+	//How many times run() is asked to go around in each repetition
+	int iterations;
+
+	//Whether it needs a window and GL context
+	bool needsGL;
+
+	//Called once before the warm-up, and once after the last repetition (either can be NULL)
+	void (*setup)();
+	void (*teardown)();
+
+	//Does the work. Returns how many operations it did, so that we can report the time for each one
+	long (*run)(int iterations);
+
+	//Called after each repetition, outside of the timing, to let anything queued up finish (can be NULL)
+	void (*settle)();
+};
+
+//What we found for one benchmark, in nanoseconds per operation
+struct BenchmarkResult
+{
+	const Benchmark *benchmark;
+	vector<double> samples;
+	double min;
+	double median;
+	double mean;
+	double stddev;
+	double max;
+};
+
+
+/*
+* Loads the benchmark model from disk every time, throwing it away again afterwards.
+* Returns the number of models loaded.
+*/
+static long benchLoadObjCold(int iterations)
+{
+	SDL_Colour colour = {128, 128, 128};
+	for (int i = 0; i < iterations; i++)
+	{
+		GameObject o = loadObj(benchModel, colour, 0, 0, 0);
+		releaseMesh(o.mesh);
+		trimMeshCache(0);
+	}
+	return iterations;
+}
+
+
+//Keeps the benchmark model in the cache while we measure cached loads
+static GameObject cachedObject;
+
+static void setupLoadObjCached()
+{
+	SDL_Colour colour = {128, 128, 128};
+	cachedObject = loadObj(benchModel, colour, 0, 0, 0);
+}
+
+static void teardownLoadObjCached()
+{
+	releaseMesh(cachedObject.mesh);
+	trimMeshCache(0);
+}
+
+
+/*
+* Makes objects from a model that's already loaded, which is what happens for every tree after the first.
+* Returns the number of objects made.
+*/
+static long benchLoadObjCached(int iterations)
+{
+	SDL_Colour colour = {128, 128, 128};
+	for (int i = 0; i < iterations; i++)
+	{
+		GameObject o = loadObj(benchModel, colour, 0, 0, 0);
+		releaseMesh(o.mesh);
+	}
+	return iterations;
+}
+
+
+/*
+* Puts the vehicle back where the game starts it, with the accelerator down and turning so that every branch of updateSim() gets a go.
+* Returns nothing.
+*/
+static void setupUpdateSim()
+{
+	carX = 0;
+	carY = -4.0f;
+	carDirection = 180.0f;
+	carSpeed = 0;
+	carAccel = true;
+	carBrake = false;
+	carSteer = 1;
+}
+
+static void teardownUpdateSim()
+{
+	setupUpdateSim();
+	carAccel = false;
+	carSteer = 0;
+}
+
+
+/*
+* Runs the vehicle simulation.
+* Returns the number of ticks simulated.
+*/
+static long benchUpdateSim(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		updateSim();
+	}
+	return iterations;
+}
+
+
+//The simulation again, this time keeping every tick for rewinding the way the game does
+static void setupRecordedSim()
+{
+	replayInit();
+	setupUpdateSim();
+}
+
+static void teardownRecordedSim()
+{
+	replayClose();
+	teardownUpdateSim();
+}
+
+
+//A full replay buffer of driving around in circles (swapping direction every few seconds) to seek around in
+static void setupReplaySeek()
+{
+	setupRecordedSim();
+	int ticks = (int)(replayMinutes * 60 * simTickRate);
+	for (int i = 0; i < ticks; i++)
+	{
+		carSteer = ((i / (5 * simTickRate)) % 2) ? 1 : -1;
+		updateSim();
+	}
+}
+
+
+/*
+* Jumps to random ticks in the replay buffer, which is the worst case for seeking (playing forwards carries on from the last seek, so it's cheaper).
+* Returns the number of seeks.
+*/
+static long benchReplaySeek(int iterations)
+{
+	int oldest = replayOldestTick();
+	int span = replayNewestTick() - oldest + 1;
+	unsigned int random = 1;
+	ReplayFrame frame;
+	for (int i = 0; i < iterations; i++)
+	{
+		random = random * 1103515245 + 12345;
+		replaySeek(oldest + (random >> 8) % span, &frame);
+	}
+	return iterations;
+}
+
+
+/*
+* Loads the built in scenery and points the camera at it with the lights on, the way a frame would.
+* Returns nothing.
+*/
+static void setupRenderObjects()
+{
+	loadScenery();
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glEnable(GL_DEPTH_TEST);
+	rotateCamera();
+	updateLighting();
+}
+
+static void teardownRenderObjects()
+{
+	list<GameObject>::iterator o;
+	for (o = sceneryObjects.begin(); o != sceneryObjects.end(); ++o)
+	{
+		releaseMesh(o->mesh);
+		detachTransform(&(*o));
+	}
+	sceneryObjects.clear();
+	trimMeshCache(0);
+}
+
+
+/*
+* Submits every scenery object to GL. This measures what it costs us to hand the work over, not how long the GPU takes to do it.
+* Returns the number of objects submitted.
+*/
+static long benchRenderObjects(int iterations)
+{
+	long objects = 0;
+	for (int i = 0; i < iterations; i++)
+	{
+		list<GameObject>::iterator o;
+		for (o = sceneryObjects.begin(); o != sceneryObjects.end(); ++o)
+		{
+			renderObject(*o);
+			objects++;
+		}
+	}
+	return objects;
+}
+
+
+static void setupRenderHUD()
+{
+	buildFontAtlas(hudFont, textColour, &hudAtlas);
+}
+
+static void teardownRenderHUD()
+{
+	freeFontAtlas(&hudAtlas);
+}
+
+
+/*
+* Draws the HUD text.
+* Returns the number of HUDs drawn.
+*/
+static long benchRenderHUD(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		renderHUD();
+	}
+	return iterations;
+}
+
+
+/*
+* Draws and swaps whole frames of scenery, so that we can see what capturing adds to the frame time.
+* Returns the number of frames drawn.
+*/
+static long benchFrame(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		benchRenderObjects(1);
+		captureFrame();
+		SDL_GL_SwapWindow(win);
+	}
+	return iterations;
+}
+
+
+static void setupCapturedFrame()
+{
+	setupRenderObjects();
+	captureDirectory = "microbench-capture";
+	startCapture(screenWidth, screenHeight);
+}
+
+static void teardownCapturedFrame()
+{
+	stopCapture();
+	teardownRenderObjects();
+}
+
+
+/*
+* Sets up the same scene as setupRenderObjects(), but with the scenery lit as it's drawn instead of baked, to compare frames against.
+* Returns nothing.
+*/
+static void setupDynamicLighting()
+{
+	bakedLighting = false;
+	setupRenderObjects();
+}
+
+static void teardownDynamicLighting()
+{
+	teardownRenderObjects();
+	bakedLighting = true;
+}
+
+
+//The built in scenery, for the lighting bake to work through
+static vector<GameObject*> bakeObjects;
+
+
+/*
+* Starts the job threads and loads the built in scenery, so that the bake can be shared out the way it is when the game starts.
+* Returns nothing.
+*/
+static void setupBakeLighting()
+{
+	jobsInit(0);
+	loadScenery();
+	list<GameObject>::iterator o;
+	for (o = sceneryObjects.begin(); o != sceneryObjects.end(); ++o)
+	{
+		bakeObjects.push_back(&(*o));
+	}
+}
+
+static void teardownBakeLighting()
+{
+	bakeObjects.clear();
+	teardownRenderObjects();
+	jobsShutdown();
+}
+
+
+/*
+* Bakes the built in scenery's lighting from scratch (without the cache), which is what the first start after a scenery change costs.
+* Returns the number of bakes.
+*/
+static long benchBakeLighting(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		bakeLighting(bakeObjects, "", true, NULL);
+	}
+	return iterations;
+}
+
+
+//How many particles of each type the particle benchmarks run with (two types, so over 100k in all)
+static const int benchParticleBudget = 65536;
+
+//The vehicle parts that particles come off
+static GameObject particleSkirt;
+static GameObject particleFans;
+
+
+/*
+* Loads the scenery and the vehicle parts that particles come from, and runs the vehicle flat out with both fans on until every particle ring is full.
+* Returns nothing.
+*/
+static void setupParticles()
+{
+	setupRenderObjects();
+
+	SDL_Colour colour = {128, 128, 128};
+	particleSkirt = loadObj("bladder.obj", colour, 0, 0, 0);
+	particleFans = loadObj("fans.obj", colour, 0, 0, 0);
+	particleBudget = benchParticleBudget;
+	initParticles(particleFans.mesh, particleSkirt.mesh);
+
+	setupUpdateSim();
+	carSteer = 0;
+	carSpeed = 0.25f;
+	for (int i = 0; i < 3 * simTickRate; i++)
+	{
+		updateSim();
+		updateVehicleParticles(1.0f / simTickRate);
+		renderParticles(screenHeight, fieldOfView);
+	}
+	glFinish();
+}
+
+static void teardownParticles()
+{
+	closeParticles();
+	releaseMesh(particleSkirt.mesh);
+	releaseMesh(particleFans.mesh);
+	teardownUpdateSim();
+	teardownRenderObjects();
+}
+
+
+/*
+* Moves the vehicle along, starts a frame's worth of particles and hands them all to GL. This is everything particles cost the CPU each frame.
+* Returns the number of frames' worth of particles submitted.
+*/
+static long benchParticles(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		updateSim();
+		updateVehicleParticles(1.0f / simTickRate);
+		renderParticles(screenHeight, fieldOfView);
+	}
+	return iterations;
+}
+
+
+/*
+* Draws and swaps whole frames of scenery with full particle rings on top, so that the GPU's share of the particles shows up too.
+* Returns the number of frames drawn.
+*/
+static long benchParticleFrame(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		benchRenderObjects(1);
+		updateSim();
+		updateVehicleParticles(1.0f / simTickRate);
+		renderParticles(screenHeight, fieldOfView);
+		SDL_GL_SwapWindow(win);
+	}
+	return iterations;
+}
+
+
+//A big scene for the transform hierarchy: lots of scenery that never moves, and a few vehicles whose fans spin
+static const int benchStaticTransforms = 100000;
+static const int benchVehicles = 100;
+static vector<int> staticTransforms;
+static vector<int> vehicleTransforms;
+static vector<int> fanTransforms;
+static vector<float> staticPlacements;
+static int transformFrame = 0;
+
+static void setupTransforms()
+{
+	unsigned int random = 1;
+	for (int i = 0; i < benchStaticTransforms; i++)
+	{
+		float placement[3];
+		for (int k = 0; k < 3; k++)
+		{
+			random = random * 1103515245 + 12345;
+			placement[k] = ((random >> 8) & 0xFFFF) / 65536.0f;
+		}
+		staticPlacements.insert(staticPlacements.end(), placement, placement + 3);
+		staticTransforms.push_back(createTransform(transformNone));
+		setTransform(staticTransforms.back(), placement[0] * 4000 - 2000, 0, placement[1] * 4000 - 2000, placement[2] * 360);
+	}
+
+	//Each vehicle has its three parts under it, and a spinning fan under the fan housing
+	for (int i = 0; i < benchVehicles; i++)
+	{
+		int vehicle = createTransform(transformNone);
+		vehicleTransforms.push_back(vehicle);
+		createTransform(vehicle);
+		createTransform(vehicle);
+		fanTransforms.push_back(createTransform(createTransform(vehicle)));
+	}
+	updateTransforms();
+	transformFrame = 0;
+}
+
+static void teardownTransforms()
+{
+	closeTransforms();
+	staticTransforms.clear();
+	vehicleTransforms.clear();
+	fanTransforms.clear();
+	staticPlacements.clear();
+}
+
+
+/*
+* Updates the hierarchy when nothing has moved, which is what the scenery costs every frame.
+* Returns the number of updates.
+*/
+static long benchUpdateTransformsStatic(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		updateTransforms();
+	}
+	return iterations;
+}
+
+
+/*
+* Drives every vehicle along and spins its fan, then updates the hierarchy, which only has to look at the vehicles.
+* Returns the number of updates.
+*/
+static long benchUpdateTransformsVehicles(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		transformFrame++;
+		float spin = transformFrame * 30.0f * (float)M_PI / 180;
+		float fan[16] = {cos(spin), sin(spin), 0, 0, -sin(spin), cos(spin), 0, 0, 0, 0, 1, 0, 0, 0.12f, -0.15f, 1};
+		for (int v = 0; v < benchVehicles; v++)
+		{
+			setTransform(vehicleTransforms[v], v * 10.0f, carHoverHeight, transformFrame * 0.25f, (float)(transformFrame % 360));
+			setTransformMatrix(fanTransforms[v], fan);
+		}
+		updateTransforms();
+	}
+	return iterations;
+}
+
+
+/*
+* Builds every static object's matrix from its position and rotation again, which is what placing them as they're drawn amounts to.
+* Returns the number of frames' worth.
+*/
+static long benchTransformsEveryFrame(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		for (int o = 0; o < benchStaticTransforms; o++)
+		{
+			const float *placement = &staticPlacements[o * 3];
+			setTransform(staticTransforms[o], placement[0] * 4000 - 2000, 0, placement[1] * 4000 - 2000, placement[2] * 360);
+		}
+		updateTransforms();
+	}
+	return iterations;
+}
+
+
+//A big generated heightmap, and how far along a loop around it we've driven
+static const int benchTerrainSize = 4096;
+static float terrainDistance = 0;
+
+static void setupTerrain()
+{
+	generateTerrain(benchTerrainSize, 1);
+	terrainDistance = 0;
+	updateTerrain(0, 0);
+}
+
+static void teardownTerrain()
+{
+	closeTerrain();
+}
+
+
+/*
+* Moves the terrain along a big circle at eight times the vehicle's top speed (two units a frame), so that every level keeps shifting.
+* Returns the number of updates.
+*/
+static long benchUpdateTerrain(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		terrainDistance += 2.0f;
+		float angle = terrainDistance / 1500.0f;
+		updateTerrain(1500.0f * sin(angle), 1500.0f - 1500.0f * cos(angle));
+	}
+	return iterations;
+}
+
+
+static void setupTerrainFrame()
+{
+	setupTerrain();
+	setupRenderObjects();
+}
+
+static void teardownTerrainFrame()
+{
+	teardownRenderObjects();
+	teardownTerrain();
+}
+
+
+/*
+* Draws and swaps whole frames of the terrain (moving as it does in benchUpdateTerrain()) with the rest of the scenery on top.
+* Returns the number of frames drawn.
+*/
+static long benchTerrainFrame(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		benchUpdateTerrain(1);
+		renderTerrain();
+		benchRenderObjects(1);
+		SDL_GL_SwapWindow(win);
+	}
+	return iterations;
+}
+
+
+//A frame that looks something like the game's: flat sky, flat shaded blocks and some noisy detail
+static vector<unsigned char> testFrame;
+static vector<unsigned char> encodedFrame;
+
+static void setupEncodeTGA()
+{
+	testFrame.resize((size_t)screenWidth * screenHeight * 4);
+	unsigned int noise = 1;
+	for (int y = 0; y < screenHeight; y++)
+	{
+		for (int x = 0; x < screenWidth; x++)
+		{
+			unsigned char *p = &testFrame[((size_t)y * screenWidth + x) * 4];
+			if (y > screenHeight / 2)
+			{
+				p[0] = 255; p[1] = 128; p[2] = 128;
+			}
+			else if (y > screenHeight / 8)
+			{
+				int shade = ((x / 40) * 7 + (y / 30) * 13) % 64;
+				p[0] = 60 + shade; p[1] = 90 + shade; p[2] = 60 + shade;
+			}
+			else
+			{
+				noise = noise * 1103515245 + 12345;
+				p[0] = p[1] = p[2] = (noise >> 16) & 0xFF;
+			}
+			p[3] = 255;
+		}
+	}
+}
+
+static void teardownEncodeTGA()
+{
+	vector<unsigned char>().swap(testFrame);
+	vector<unsigned char>().swap(encodedFrame);
+}
+
+
+/*
+* Run length encodes a window sized frame, which is the bulk of the capture writer thread's work.
+* Returns the number of frames encoded.
+*/
+static long benchEncodeTGA(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		encodeTGA(&testFrame[0], screenWidth, screenHeight, encodedFrame);
+	}
+	return iterations;
+}
+
+
+//What impostorDistance was before the stress frames changed it
+static float savedImpostorDistance = 0;
+
+/*
+* Makes a forest of a stress scene and stands the camera in the clearing in the middle of it, looking out across the treetops, with every tree and building drawn properly.
+* Returns nothing.
+*/
+static void setupStressFrame()
+{
+	savedImpostorDistance = impostorDistance;
+	impostorDistance = 0;
+	generateStressScene(sceneryObjects, 250, 20000, 50, 1);
+	attachScenery();
+	updateTransforms();
+	rebuildDrawList();
+
+	cameraX = 0;
+	cameraY = 0;
+	cameraHeight = 20;
+	rotX = 0;
+	rotY = 5;
+	glEnable(GL_DEPTH_TEST);
+	rotateCamera();
+	updateLighting();
+}
+
+/*
+* The same scene, with the far away trees and buildings as impostors.
+* Returns nothing.
+*/
+static void setupStressImpostorFrame()
+{
+	setupStressFrame();
+	impostorDistance = savedImpostorDistance > 0 ? savedImpostorDistance : 300.0f;
+	initImpostors();
+}
+
+static void teardownStressFrame()
+{
+	closeImpostors();
+	impostorDistance = savedImpostorDistance;
+	teardownRenderObjects();
+	sceneryDrawList.clear();
+	cameraHeight = 0;
+	rotY = 0;
+}
+
+
+/*
+* Culls and draws whole frames of the stress scene the way the game does (without the job threads), printing how many triangles it took the first time.
+* Returns the number of frames drawn.
+*/
+static long benchStressFrame(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		rotateCamera();
+		updateFrustum();
+		cullScenery(NULL, 0, (int)sceneryDrawList.size());
+		renderScenery();
+		SDL_GL_SwapWindow(win);
+	}
+
+	static float reportedDistance = -1;
+	if (reportedDistance != impostorDistance)
+	{
+		printf("  %d objects drawn with %ld triangles\n", sceneryDrawnObjects, sceneryDrawnTriangles);
+		reportedDistance = impostorDistance;
+	}
+	return iterations;
+}
+
+
+/*
+* Waits for GL to get through everything we've given it, so that one repetition's work doesn't spill into the next one's timing.
+* Returns nothing.
+*/
+static void settleGL()
+{
+	glFinish();
+}
+
+
+static const Benchmark benchmarks[] =
+{
+	{"loadObj_cold", "model loaded from disk", 20, false, NULL, NULL, benchLoadObjCold, NULL},
+	{"loadObj_cached", "object made from a cached model", 100000, false, setupLoadObjCached, teardownLoadObjCached, benchLoadObjCached, NULL},
+	{"updateSim", "simulation tick", 1000000, false, setupUpdateSim, teardownUpdateSim, benchUpdateSim, NULL},
+	{"updateSim_recorded", "simulation tick kept for rewinding", 1000000, false, setupRecordedSim, teardownRecordedSim, benchUpdateSim, NULL},
+	{"replaySeek", "random seek in a full replay buffer", 100000, false, setupReplaySeek, teardownRecordedSim, benchReplaySeek, NULL},
+	{"renderObject", "object submitted", 100, true, setupRenderObjects, teardownRenderObjects, benchRenderObjects, settleGL},
+	{"renderHUD", "HUD drawn", 1000, true, setupRenderHUD, teardownRenderHUD, benchRenderHUD, settleGL},
+	{"encodeTGA", "frame encoded", 10, false, setupEncodeTGA, teardownEncodeTGA, benchEncodeTGA, NULL},
+	{"frame", "frame drawn", 100, true, setupRenderObjects, teardownRenderObjects, benchFrame, settleGL},
+	{"frame_dynamic_lighting", "frame drawn with the scenery lit as it's drawn", 100, true, setupDynamicLighting, teardownDynamicLighting, benchFrame, settleGL},
+	{"bakeLighting", "scenery lighting baked", 10, false, setupBakeLighting, teardownBakeLighting, benchBakeLighting, NULL},
+	{"frame_captured", "frame drawn and captured", 100, true, setupCapturedFrame, teardownCapturedFrame, benchFrame, settleGL},
+	{"particles", "frame of particles emitted and submitted", 100, true, setupParticles, teardownParticles, benchParticles, settleGL},
+	{"frame_particles", "frame drawn with full particle rings", 100, true, setupParticles, teardownParticles, benchParticleFrame, settleGL},
+	{"updateTransforms_static", "update of 100000 static nodes with nothing moved", 10000, false, setupTransforms, teardownTransforms, benchUpdateTransformsStatic, NULL},
+	{"updateTransforms_vehicles", "update with 100 vehicles moved and their fans spun among 100000 static nodes", 1000, false, setupTransforms, teardownTransforms, benchUpdateTransformsVehicles, NULL},
+	{"transforms_every_frame", "frame of all 100000 static nodes placed again", 10, false, setupTransforms, teardownTransforms, benchTransformsEveryFrame, NULL},
+	{"updateTerrain", "terrain moved along with the car", 1000, false, setupTerrain, teardownTerrain, benchUpdateTerrain, NULL},
+	{"frame_terrain", "frame drawn over a moving 4096x4096 heightmap", 100, true, setupTerrainFrame, teardownTerrainFrame, benchTerrainFrame, settleGL},
+	{"frame_stress", "frame drawn looking across 20000 trees", 10, true, setupStressFrame, teardownStressFrame, benchStressFrame, settleGL},
+	{"frame_stress_impostors", "frame drawn looking across 20000 trees, with far away ones as impostors", 10, true, setupStressImpostorFrame, teardownStressFrame, benchStressFrame, settleGL},
+};
+
+
+/*
+* Runs one benchmark: the warm-up repetitions (which are thrown away), then the ones we keep.
+* Returns the results.
+*/
+static BenchmarkResult runBenchmark(const Benchmark *b, int warmup, int repetitions)
+{
+	BenchmarkResult result;
+	result.benchmark = b;
+
+	if (b->setup != NULL)
+	{
+		b->setup();
+	}
+
+	for (int r = 0; r < warmup + repetitions; r++)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		long operations = b->run(b->iterations);
+		chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+		if (b->settle != NULL)
+		{
+			b->settle();
+		}
+
+		if (r >= warmup && operations > 0)
+		{
+			result.samples.push_back(chrono::duration<double, nano>(end - start).count() / operations);
+		}
+	}
+
+	if (b->teardown != NULL)
+	{
+		b->teardown();
+	}
+
+	//Work out the statistics
+	vector<double> sorted = result.samples;
+	sort(sorted.begin(), sorted.end());
+	size_t count = sorted.size();
+	result.min = result.median = result.mean = result.stddev = result.max = 0;
+	if (count > 0)
+	{
+		result.min = sorted[0];
+		result.max = sorted[count - 1];
+		result.median = (count % 2) ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+
+		double total = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			total += sorted[i];
+		}
+		result.mean = total / count;
+
+		double variance = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			variance += (sorted[i] - result.mean) * (sorted[i] - result.mean);
+		}
+		result.stddev = (count > 1) ? sqrt(variance / (count - 1)) : 0;
+	}
+
+	return result;
+}
+
+
+/*
+* Writes the results out as JSON, so that runs can be compared against each other.
+* Returns nothing.
+*/
+static void writeResults(FILE *out, const vector<BenchmarkResult> &results, int warmup, int repetitions)
+{
+	fprintf(out, "{\n");
+#ifdef NDEBUG
+	fprintf(out, "  \"build\": \"release\",\n");
+#else
+	fprintf(out, "  \"build\": \"debug\",\n");
+#endif
+	fprintf(out, "  \"warmup\": %d,\n", warmup);
+	fprintf(out, "  \"repetitions\": %d,\n", repetitions);
+	fprintf(out, "  \"benchmarks\": [\n");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult &r = results[i];
+		fprintf(out, "    {\n");
+		fprintf(out, "      \"name\": \"%s\",\n", r.benchmark->name);
+		fprintf(out, "      \"operation\": \"%s\",\n", r.benchmark->operation);
+		fprintf(out, "      \"iterations\": %d,\n", r.benchmark->iterations);
+		fprintf(out, "      \"unit\": \"ns\",\n");
+		fprintf(out, "      \"min\": %.3f,\n", r.min);
+		fprintf(out, "      \"median\": %.3f,\n", r.median);
+		fprintf(out, "      \"mean\": %.3f,\n", r.mean);
+		fprintf(out, "      \"stddev\": %.3f,\n", r.stddev);
+		fprintf(out, "      \"max\": %.3f,\n", r.max);
+		fprintf(out, "      \"per_second\": %.1f,\n", (r.median > 0) ? 1e9 / r.median : 0.0);
+		fprintf(out, "      \"samples\": [");
+		for (size_t s = 0; s < r.samples.size(); s++)
+		{
+			fprintf(out, "%s%.3f", s ? ", " : "", r.samples[s]);
+		}
+		fprintf(out, "]\n");
+		fprintf(out, "    }%s\n", (i + 1 < results.size()) ? "," : "");
+	}
+	fprintf(out, "  ]\n");
+	fprintf(out, "}\n");
+}
+
+
+/*
+* Runs each benchmark (or the ones asked for) and writes out the results.
+* Returns zero if everything went to plan.
+*/
+int main(int argc, char* args[])
+{
+	int warmup = 3;
+	int repetitions = 15;
+	string filter = "";
+	string jsonFile = "microbench.json";
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = args[i];
+
+		//How many repetitions to run and throw away before we start measuring
+		if (arg == "--warmup" && i + 1 < argc)
+		{
+			warmup = atoi(args[++i]);
+			if (warmup < 0)
+			{
+				printf("Warm-up count can't be negative\n");
+				return 1;
+			}
+		}
+		//How many repetitions to measure
+		else if (arg == "--repetitions" && i + 1 < argc)
+		{
+			repetitions = atoi(args[++i]);
+			if (repetitions <= 0)
+			{
+				printf("Repetition count must be a positive number\n");
+				return 1;
+			}
+		}
+		//Only run the benchmarks with this in their name
+		else if (arg == "--filter" && i + 1 < argc)
+		{
+			filter = args[++i];
+		}
+		//Where to write the results ("-" for the terminal, although the game's own messages will end up mixed in with them)
+		else if (arg == "--json" && i + 1 < argc)
+		{
+			jsonFile = args[++i];
+		}
+		else
+		{
+			printf("Unknown option %s\n", arg.c_str());
+			printf("Usage: drive_bench [--warmup n] [--repetitions n] [--filter name] [--json file]\n");
+			return 1;
+		}
+	}
+
+	//Keep the loader's progress messages out of the results (and out of the timing)
+	meshLogging = false;
+
+	//Only open a window if something we're running needs one
+	int count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+	bool wantGL = false;
+	for (int i = 0; i < count; i++)
+	{
+		if (benchmarks[i].needsGL && string(benchmarks[i].name).find(filter) != string::npos)
+		{
+			wantGL = true;
+		}
+	}
+
+	bool haveGL = false;
+	if (wantGL)
+	{
+		//Frames go out as fast as they can, so that we see their whole cost
+		pacingMode = PACING_UNCAPPED;
+
+		haveGL = init();
+		if (!haveGL)
+		{
+			fprintf(stderr, "Couldn't set up a window, so the rendering benchmarks will be skipped\n");
+		}
+	}
+
+	vector<BenchmarkResult> results;
+	for (int i = 0; i < count; i++)
+	{
+		const Benchmark *b = &benchmarks[i];
+		if (string(b->name).find(filter) == string::npos || (b->needsGL && !haveGL))
+		{
+			continue;
+		}
+
+		fprintf(stderr, "Running %s...\n", b->name);
+		results.push_back(runBenchmark(b, warmup, repetitions));
+
+		const BenchmarkResult &r = results.back();
+		fprintf(stderr, "  %.1f ns per %s (min %.1f, max %.1f, stddev %.1f)\n", r.median, b->operation, r.min, r.max, r.stddev);
+	}
+
+	if (wantGL)
+	{
+		close();
+	}
+
+	if (jsonFile == "-")
+	{
+		writeResults(stdout, results, warmup, repetitions);
+	}
+	else
+	{
+		FILE *out = fopen(jsonFile.c_str(), "w");
+		if (out == NULL)
+		{
+			printf("Couldn't write %s\n", jsonFile.c_str());
+			return 1;
+		}
+		writeResults(out, results, warmup, repetitions);
+		fclose(out);
+		fprintf(stderr, "Results written to %s\n", jsonFile.c_str());
+	}
+
+	return 0;
+}
@@ -0,0 +1,1686 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include <SDL2/SDL.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#ifdef __MINGW64__
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	typedef int socklen_t;
+#else
+	#include <arpa/inet.h>
+	#include <fcntl.h>
+	#include <netdb.h>
+	#include <netinet/in.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+	typedef int SOCKET;
+	#define INVALID_SOCKET -1
+	#define closesocket close
+#endif
+
+#include "framepacing.h"
+#include "net.h"
+#include "random.h"
+
+using namespace std;
+
+//Settings (from the command line)
+int netPort = 24614;
+float netLatencyMs = 0;
+float netLossPercent = 0;
+
+//Nothing we send is bigger than this, which keeps us well under the usual 1500 byte MTU
+static const int netMaxPacket = 1200;
+
+//Every UDP packet also costs this much in IPv4 and UDP headers, which we count so that the bandwidth numbers are honest
+static const int netHeaderBytes = 28;
+
+//How many snapshots each end remembers, for delta compression and interpolation
+static const int netHistorySize = 32;
+
+//How many ticks of input each end remembers (a bit over two seconds)
+static const int netInputBufferSize = 128;
+
+//The most ticks a client's vehicle is run on by in one of ours, so that a client that's got well ahead is caught up over a few ticks rather than all at once
+static const int netMaxCatchUp = 4;
+
+//How long we'll go without hearing from the other end before giving up on it
+static const Uint32 netTimeout = 5000;
+
+//How often clients knock while they're waiting to be let in
+static const Uint32 netConnectInterval = 250;
+
+//How many received packets can be held back to simulate latency
+static const int netServerDelaySlots = 1024;
+static const int netClientDelaySlots = 64;
+
+static const Uint32 netLogInterval = 5000;
+
+enum NetPacketType
+{
+	//Client to host: let me in. Sent until the host answers
+	PACKET_CONNECT = 1,
+
+	//Host to client: you're in, and this is your vehicle's id
+	PACKET_ACCEPT,
+
+	//Client to host: the newest snapshot I've got, and my latest few inputs
+	PACKET_INPUT,
+
+	//Host to client: everything near you that's changed since a snapshot you said you've got
+	PACKET_SNAPSHOT,
+
+	//Client to host: I'm off
+	PACKET_DISCONNECT
+};
+
+//Which fields follow a vehicle's id in a snapshot. New vehicles are sent as changes from zero
+enum SnapshotField
+{
+	FIELD_X = 1,
+	FIELD_Y = 2,
+	FIELD_DIRECTION = 4,
+	FIELD_SPEED = 8,
+	FIELD_NEW = 16
+};
+
+//How finely vehicles are sent. Speed and direction only ever change in steps of 0.0025 and 5 degrees, so those are exact
+static const float positionSteps = 256.0f;
+static const float directionSteps = 10.0f;
+static const float speedSteps = 400.0f;
+
+//A vehicle as it goes over the wire
+struct QuantisedCar
+{
+	int x;
+	int y;
+	int direction;
+	int speed;
+};
+
+//Every vehicle a snapshot knows about, by id
+struct Snapshot
+{
+	int tick;
+	bool present[netMaxPlayers];
+	QuantisedCar cars[netMaxPlayers];
+};
+
+struct PacketWriter
+{
+	unsigned char data[netMaxPacket];
+	int size;
+	bool overflowed;
+};
+
+struct PacketReader
+{
+	const unsigned char *data;
+	int size;
+	int position;
+	bool failed;
+};
+
+//A packet that's arrived, but that we're pretending hasn't yet
+struct DelayedPacket
+{
+	sockaddr_in from;
+	Uint32 deliverAt;
+	int size;
+	unsigned char data[netMaxPacket];
+};
+
+struct NetSocket
+{
+	SOCKET fd;
+
+	//Received packets being held back, oldest first
+	vector<DelayedPacket> delayed;
+	int delayedStart;
+	int delayedCount;
+
+	//Somewhere to put packets when there's no room to hold them back, since they have to come off the socket either way
+	DelayedPacket discard;
+
+	unsigned int random;
+
+	//Totals since we last logged, including headers
+	long bytesSent;
+	long bytesReceived;
+};
+
+//What the host knows about one client
+struct RemoteClient
+{
+	bool connected;
+	sockaddr_in address;
+	Uint32 lastHeard;
+
+	//Inputs that have arrived, by the client's tick number
+	CarInput inputs[netInputBufferSize];
+	int inputTicks[netInputBufferSize];
+	int newestInput;
+	int lastProcessedInput;
+	CarInput lastInput;
+
+	//What we've sent, so that we can send changes from whichever snapshot the client last said it's got
+	Snapshot sent[netHistorySize];
+	int ackedSnapshot;
+};
+
+struct NetServer
+{
+	NetSocket socket;
+	int tick;
+
+	//Whether whoever's hosting is driving too, as player 0
+	bool hostPlaying;
+
+	//If this is more than zero, vehicles start somewhere random in a square this big rather than lined up at the start
+	float spawnArea;
+	unsigned int random;
+
+	bool present[netMaxPlayers];
+	CarState cars[netMaxPlayers];
+	RemoteClient clients[netMaxPlayers];
+
+	//Totals since we last logged
+	long fullSnapshots;
+	long deltaSnapshots;
+	long snapshotVehicles;
+	long lostInputs;
+};
+
+struct NetClient
+{
+	NetSocket socket;
+	sockaddr_in server;
+	bool connected;
+	int id;
+	Uint32 lastConnectAttempt;
+	Uint32 lastHeard;
+
+	//Our inputs, and where we predicted each one would leave us, by tick
+	int tick;
+	CarInput inputs[netInputBufferSize];
+	CarState predictions[netInputBufferSize];
+	CarState predicted;
+	bool havePrediction;
+
+	//Snapshots from the host, for decoding the next one against and for drawing everyone else
+	Snapshot received[netHistorySize];
+	int newestSnapshot;
+
+	//The host's tick that we're drawing everyone else at, which trails the newest snapshot
+	float renderTick;
+
+	//Totals since we last logged
+	long mispredictions;
+};
+
+static NetServer *server = NULL;
+static NetClient *client = NULL;
+
+static Uint32 lastLogTime = 0;
+static NetStats lastStats;
+
+//Bots coming and going in the benchmark aren't worth a line each
+static bool benchmarking = false;
+
+
+/*
+* Rounds a vehicle to the steps it's sent in (positionSteps to a unit and so on).
+* Returns the vehicle in whole steps.
+*/
+static QuantisedCar quantise(const CarState &car)
+{
+	QuantisedCar quantised;
+	quantised.x = (int)lroundf(car.x * positionSteps);
+	quantised.y = (int)lroundf(car.y * positionSteps);
+	quantised.direction = (int)lroundf(car.direction * directionSteps);
+	quantised.speed = (int)lroundf(car.speed * speedSteps);
+	return quantised;
+}
+
+
+/*
+* Turns a vehicle sent in whole steps back into units.
+* Returns the vehicle.
+*/
+static CarState dequantise(const QuantisedCar &quantised)
+{
+	CarState car;
+	car.x = quantised.x / positionSteps;
+	car.y = quantised.y / positionSteps;
+	car.direction = quantised.direction / directionSteps;
+	car.speed = quantised.speed / speedSteps;
+	return car;
+}
+
+
+/*
+* Rounds a vehicle to what can be sent. The host does this to every vehicle every tick and clients do it to their predictions, so that a client replaying its inputs from a snapshot ends up exactly where the host did.
+* Returns nothing.
+*/
+static void snapCar(CarState *car)
+{
+	*car = dequantise(quantise(*car));
+}
+
+
+/*
+* Checks whether two rounded vehicles are exactly the same, which is when a delta snapshot can leave one out.
+* Returns true if they are.
+*/
+static bool sameCar(const QuantisedCar &a, const QuantisedCar &b)
+{
+	return a.x == b.x && a.y == b.y && a.direction == b.direction && a.speed == b.speed;
+}
+
+
+/*
+* Adds a byte to a packet, or marks it as overflowed if there's no room left.
+* Returns nothing.
+*/
+static void writeByte(PacketWriter *packet, unsigned int value)
+{
+	if (packet->size >= netMaxPacket)
+	{
+		packet->overflowed = true;
+		return;
+	}
+	packet->data[packet->size++] = value;
+}
+
+
+/*
+* Writes a number seven bits to a byte, so that small numbers only take one.
+* Returns nothing.
+*/
+static void writeVarint(PacketWriter *packet, unsigned int value)
+{
+	while (value >= 0x80)
+	{
+		writeByte(packet, (value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	writeByte(packet, value);
+}
+
+
+/*
+* Writes a signed number with zigzag encoding (0, -1, 1, -2, 2... become 0, 1, 2, 3, 4...), so that small changes either way stay small.
+* Returns nothing.
+*/
+static void writeSigned(PacketWriter *packet, int value)
+{
+	writeVarint(packet, ((unsigned int)value << 1) ^ (unsigned int)(value >> 31));
+}
+
+
+/*
+* Reads the next byte of a packet, or marks it as failed if we've run off the end.
+* Returns the byte, or 0 if there wasn't one.
+*/
+static unsigned int readByte(PacketReader *packet)
+{
+	if (packet->position >= packet->size)
+	{
+		packet->failed = true;
+		return 0;
+	}
+	return packet->data[packet->position++];
+}
+
+
+/*
+* Reads a number written by writeVarint(), marking the packet as failed if it's cut short or longer than a number can be.
+* Returns the number, or 0 if it couldn't be read.
+*/
+static unsigned int readVarint(PacketReader *packet)
+{
+	unsigned int value = 0;
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		unsigned int byte = readByte(packet);
+		value |= (byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+		{
+			return value;
+		}
+	}
+	packet->failed = true;
+	return 0;
+}
+
+
+/*
+* Reads a number written by writeSigned(), undoing the zigzag encoding.
+* Returns the number.
+*/
+static int readSigned(PacketReader *packet)
+{
+	unsigned int value = readVarint(packet);
+	return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+
+/*
+* Packs an input into the byte it goes over the wire as: steering in the bottom two bits, then the accelerator and the brake.
+* Returns the byte.
+*/
+static unsigned int packInput(CarInput input)
+{
+	int steer = input.steer < 0 ? 0 : (input.steer > 0 ? 2 : 1);
+	return steer | (input.accel ? 4 : 0) | (input.brake ? 8 : 0);
+}
+
+
+/*
+* Turns an input byte from packInput() back into an input.
+* Returns the input.
+*/
+static CarInput unpackInput(unsigned int bits)
+{
+	CarInput input;
+	input.steer = (int)(bits & 3) - 1;
+	input.accel = (bits & 4) != 0;
+	input.brake = (bits & 8) != 0;
+	return input;
+}
+
+
+/*
+* Describes what went wrong with the last socket call (Winsock keeps its errors separately from errno).
+* Returns the description, which is only good until the next call.
+*/
+static const char *socketError()
+{
+#ifdef __MINGW64__
+	static char error[32];
+	sprintf(error, "error %d", WSAGetLastError());
+	return error;
+#else
+	return strerror(errno);
+#endif
+}
+
+
+/*
+* Opens a non-blocking UDP socket on the given port (0 for any), only reachable from this machine if loopbackOnly is set.
+* Returns true on success, false on failure.
+*/
+static bool openSocket(NetSocket *socket, int port, bool loopbackOnly, int delaySlots)
+{
+#ifdef __MINGW64__
+	static bool started = false;
+	if (!started)
+	{
+		WSADATA data;
+		if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+		{
+			printf("Unable to start Winsock\n");
+			return false;
+		}
+		started = true;
+	}
+#endif
+
+	socket->fd = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (socket->fd == INVALID_SOCKET)
+	{
+		printf("Unable to create a UDP socket: %s\n", socketError());
+		return false;
+	}
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+	address.sin_port = htons(port);
+	if (bind(socket->fd, (sockaddr *)&address, sizeof(address)) != 0)
+	{
+		printf("Unable to use UDP port %d: %s\n", port, socketError());
+		closesocket(socket->fd);
+		socket->fd = INVALID_SOCKET;
+		return false;
+	}
+
+	//Never wait on the network; if there's nothing there, there's nothing there
+#ifdef __MINGW64__
+	u_long nonBlocking = 1;
+	ioctlsocket(socket->fd, FIONBIO, &nonBlocking);
+#else
+	fcntl(socket->fd, F_SETFL, fcntl(socket->fd, F_GETFL) | O_NONBLOCK);
+#endif
+
+	//A host with a lot of players gets a lot of small packets between ticks
+	int bufferSize = 1 << 20;
+	setsockopt(socket->fd, SOL_SOCKET, SO_RCVBUF, (const char *)&bufferSize, sizeof(bufferSize));
+
+	socket->delayed.resize(delaySlots);
+	socket->delayedStart = 0;
+	socket->delayedCount = 0;
+	socket->random = 0x9e3779b9 ^ (unsigned int)port ^ (unsigned int)(size_t)socket;
+	if (socket->random == 0)
+	{
+		socket->random = 1;
+	}
+	socket->bytesSent = 0;
+	socket->bytesReceived = 0;
+	return true;
+}
+
+
+/*
+* Closes a socket, if it's open.
+* Returns nothing.
+*/
+static void closeSocket(NetSocket *socket)
+{
+	if (socket->fd != INVALID_SOCKET)
+	{
+		closesocket(socket->fd);
+		socket->fd = INVALID_SOCKET;
+	}
+}
+
+
+/*
+* Finds out which port a socket ended up on, which is how a socket opened on port 0 tells us what it was given.
+* Returns the port, or 0 if it couldn't be found out.
+*/
+static int socketPort(NetSocket *socket)
+{
+	sockaddr_in address;
+	socklen_t length = sizeof(address);
+	if (getsockname(socket->fd, (sockaddr *)&address, &length) != 0)
+	{
+		return 0;
+	}
+	return ntohs(address.sin_port);
+}
+
+
+/*
+* Sends a packet straight away, counting it (and the IP and UDP headers it'll go out with) towards what we've sent.
+* Returns nothing.
+*/
+static void sendPacket(NetSocket *socket, const sockaddr_in *to, const PacketWriter *packet)
+{
+	//If the send buffer's full, the packet's lost, which is something we have to cope with anyway
+	sendto(socket->fd, (const char *)packet->data, packet->size, 0, (const sockaddr *)to, sizeof(*to));
+	socket->bytesSent += packet->size + netHeaderBytes;
+}
+
+
+/*
+* Takes everything waiting on the socket (throwing away netLossPercent of it, and holding the rest back by netLatencyMs), then hands back the oldest packet that's due, if any.
+* Returns the packet, which is only good until the next call, or NULL if there's nothing due.
+*/
+static DelayedPacket *receivePacket(NetSocket *socket, Uint32 now)
+{
+	int slots = socket->delayed.size();
+	while (true)
+	{
+		bool full = socket->delayedCount == slots;
+		DelayedPacket *packet = full ? &socket->discard : &socket->delayed[(socket->delayedStart + socket->delayedCount) % slots];
+		socklen_t length = sizeof(packet->from);
+		int size = recvfrom(socket->fd, (char *)packet->data, netMaxPacket, 0, (sockaddr *)&packet->from, &length);
+		if (size <= 0)
+		{
+			break;
+		}
+
+		socket->bytesReceived += size + netHeaderBytes;
+		if (full || (netLossPercent > 0 && nextRandom(&socket->random) * 100 < netLossPercent))
+		{
+			continue;
+		}
+		packet->size = size;
+		packet->deliverAt = now + (Uint32)netLatencyMs;
+		socket->delayedCount++;
+	}
+
+	//The delay is the same for everything, so the oldest packet is always the next one due
+	if (socket->delayedCount == 0)
+	{
+		return NULL;
+	}
+	DelayedPacket *packet = &socket->delayed[socket->delayedStart];
+	if ((Sint32)(packet->deliverAt - now) > 0)
+	{
+		return NULL;
+	}
+	socket->delayedStart = (socket->delayedStart + 1) % slots;
+	socket->delayedCount--;
+	return packet;
+}
+
+
+/*
+* Checks whether two addresses are the same machine and port.
+* Returns true if they are.
+*/
+static bool sameAddress(const sockaddr_in &a, const sockaddr_in &b)
+{
+	return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+
+/*
+* Puts a new vehicle at the start line, spread out sideways so that nobody starts inside anybody else (or somewhere random, for the benchmark).
+* Returns nothing.
+*/
+static void spawnCar(NetServer *server, int id)
+{
+	CarState car = {0.0f, -4.0f, 180.0f, 0.0f};
+	if (server->spawnArea > 0)
+	{
+		car.x = (nextRandom(&server->random) - 0.5f) * server->spawnArea;
+		car.y = (nextRandom(&server->random) - 0.5f) * server->spawnArea;
+		car.direction = (int)(nextRandom(&server->random) * 72) * 5.0f;
+	}
+	else
+	{
+		car.x = (id % 2 ? -6.0f : 6.0f) * ((id + 1) / 2);
+	}
+	snapCar(&car);
+	server->cars[id] = car;
+	server->present[id] = true;
+}
+
+
+/*
+* Opens the host's socket and sets up an empty game, with the host's own vehicle in it if hostPlaying is set. spawnArea spreads vehicles around a square that size instead of lining them up at the start (for the benchmark).
+* Returns true on success, false if the socket couldn't be opened.
+*/
+static bool startServer(NetServer *server, int port, bool loopbackOnly, bool hostPlaying, float spawnArea)
+{
+	if (!openSocket(&server->socket, port, loopbackOnly, netServerDelaySlots))
+	{
+		return false;
+	}
+	server->tick = 0;
+	server->hostPlaying = hostPlaying;
+	server->spawnArea = spawnArea;
+	server->random = 12345;
+	for (int i = 0; i < netMaxPlayers; i++)
+	{
+		server->present[i] = false;
+		server->clients[i].connected = false;
+	}
+	if (hostPlaying)
+	{
+		spawnCar(server, 0);
+	}
+	return true;
+}
+
+
+/*
+* Looks for the connected client a packet came from.
+* Returns the client's id, or -1 if it isn't one of ours.
+*/
+static int findClient(NetServer *server, const sockaddr_in &address)
+{
+	for (int i = 0; i < netMaxPlayers; i++)
+	{
+		if (server->clients[i].connected && sameAddress(server->clients[i].address, address))
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+/*
+* Starts a client off from scratch in a slot: no inputs, nothing sent and a freshly spawned vehicle, with its ticks counting from 1 again.
+* Returns nothing.
+*/
+static void startRemoteClient(NetServer *server, int id, const sockaddr_in &address, Uint32 now)
+{
+	RemoteClient *remote = &server->clients[id];
+	remote->connected = true;
+	remote->address = address;
+	remote->lastHeard = now;
+	for (int j = 0; j < netInputBufferSize; j++)
+	{
+		remote->inputTicks[j] = -1;
+	}
+	remote->newestInput = 0;
+	remote->lastProcessedInput = 0;
+	remote->lastInput = CarInput();
+	for (int j = 0; j < netHistorySize; j++)
+	{
+		remote->sent[j].tick = -1;
+	}
+	remote->ackedSnapshot = -1;
+	spawnCar(server, id);
+}
+
+
+/*
+* Lets a new client into the first free slot (slot 0 is the host's own, if the host is playing).
+* Returns the client's id, or -1 if the game is full.
+*/
+static int addClient(NetServer *server, const sockaddr_in &address, Uint32 now)
+{
+	for (int i = server->hostPlaying ? 1 : 0; i < netMaxPlayers; i++)
+	{
+		if (server->present[i])
+		{
+			continue;
+		}
+
+		startRemoteClient(server, i, address, now);
+		return i;
+	}
+	return -1;
+}
+
+
+/*
+* Takes a client and its vehicle out of the game.
+* Returns nothing.
+*/
+static void removeClient(NetServer *server, int id)
+{
+	server->clients[id].connected = false;
+	server->present[id] = false;
+}
+
+
+/*
+* Stores the inputs in a client's packet, ready to be run in order as their ticks come up.
+* Returns nothing.
+*/
+static void readInputs(RemoteClient *remote, PacketReader *reader)
+{
+	int ack = (int)readVarint(reader) - 1;
+	int newest = readVarint(reader);
+	int count = readByte(reader);
+	unsigned int bits[netInputRedundancy];
+	for (int i = 0; i < count && i < netInputRedundancy; i++)
+	{
+		bits[i] = readByte(reader);
+	}
+	if (reader->failed || count > netInputRedundancy)
+	{
+		return;
+	}
+
+	//A client can't be further ahead of us (or behind) than we remember inputs for, so anything claiming to be is broken or malicious and mustn't be allowed to set how far we run its vehicle on
+	if (newest > remote->lastProcessedInput + netInputBufferSize || newest < remote->lastProcessedInput - netInputBufferSize)
+	{
+		return;
+	}
+
+	//The newest comes first, and anything we've run already, or that's too far ahead to have anywhere to put, is no use
+	for (int i = 0; i < count; i++)
+	{
+		int tick = newest - i;
+		if (tick > remote->lastProcessedInput && tick < remote->lastProcessedInput + netInputBufferSize)
+		{
+			remote->inputs[tick % netInputBufferSize] = unpackInput(bits[i]);
+			remote->inputTicks[tick % netInputBufferSize] = tick;
+		}
+	}
+	if (newest > remote->newestInput)
+	{
+		remote->newestInput = newest;
+	}
+	if (ack > remote->ackedSnapshot)
+	{
+		remote->ackedSnapshot = ack;
+	}
+}
+
+
+/*
+* Handles every packet that's due: lets in clients that knock (and starts again with ones that have restarted), stores inputs and lets go of clients that say goodbye.
+* Returns nothing.
+*/
+static void serverReceive(NetServer *server, Uint32 now)
+{
+	DelayedPacket *packet;
+	while ((packet = receivePacket(&server->socket, now)) != NULL)
+	{
+		PacketReader reader = {packet->data, packet->size, 0, false};
+		unsigned int type = readByte(&reader);
+		int id = findClient(server, packet->from);
+
+		if (type == PACKET_CONNECT)
+		{
+			if (id < 0)
+			{
+				id = addClient(server, packet->from, now);
+				if (id < 0)
+				{
+					//We're full; they'll give up eventually
+					continue;
+				}
+				if (!benchmarking)
+				{
+					printf("Player %d joined from %s:%d\n", id, inet_ntoa(packet->from.sin_addr), ntohs(packet->from.sin_port));
+				}
+			}
+			else if (server->clients[id].newestInput > 0)
+			{
+				//Clients only knock until they're let in, so one that's already sent us inputs has started again (after a restart, or giving up on us) and is counting its ticks from 1
+				startRemoteClient(server, id, packet->from, now);
+				if (!benchmarking)
+				{
+					printf("Player %d rejoined from %s:%d\n", id, inet_ntoa(packet->from.sin_addr), ntohs(packet->from.sin_port));
+				}
+			}
+
+			//Answer every knock, in case our last answer got lost
+			PacketWriter accept;
+			accept.size = 0;
+			accept.overflowed = false;
+			writeByte(&accept, PACKET_ACCEPT);
+			writeVarint(&accept, id);
+			sendPacket(&server->socket, &packet->from, &accept);
+		}
+		else if (id < 0)
+		{
+			continue;
+		}
+		else if (type == PACKET_INPUT)
+		{
+			readInputs(&server->clients[id], &reader);
+		}
+		else if (type == PACKET_DISCONNECT)
+		{
+			if (!benchmarking)
+			{
+				printf("Player %d left\n", id);
+			}
+			removeClient(server, id);
+			continue;
+		}
+		server->clients[id].lastHeard = now;
+	}
+}
+
+
+/*
+* Runs a client's vehicle on through whatever inputs have arrived for it, one tick's worth each tick unless the client has got ahead of us.
+* Returns nothing.
+*/
+static void processInputs(NetServer *server, int id)
+{
+	RemoteClient *remote = &server->clients[id];
+	int backlog = remote->newestInput - remote->lastProcessedInput;
+	int budget = backlog > netInputRedundancy ? backlog - 2 : (backlog > 2 ? 2 : 1);
+	if (budget > netMaxCatchUp)
+	{
+		budget = netMaxCatchUp;
+	}
+
+	for (int i = 0; i < budget; i++)
+	{
+		int next = remote->lastProcessedInput + 1;
+		int slot = next % netInputBufferSize;
+		CarInput input;
+		if (remote->inputTicks[slot] == next)
+		{
+			input = remote->inputs[slot];
+		}
+		//Every packet that could have carried this input has arrived without it or never will, so assume they kept doing whatever they were doing
+		else if (remote->newestInput >= next + netInputRedundancy)
+		{
+			input = remote->lastInput;
+			server->lostInputs++;
+		}
+		else
+		{
+			break;
+		}
+
+		stepCar(&server->cars[id], input);
+		snapCar(&server->cars[id]);
+		remote->lastInput = input;
+		remote->lastProcessedInput = next;
+	}
+}
+
+
+/*
+* Sends a client every nearby vehicle that's changed since the newest snapshot it's told us it has, or all of them if it hasn't got one we still remember.
+* Returns nothing.
+*/
+static void sendSnapshot(NetServer *server, int id)
+{
+	RemoteClient *remote = &server->clients[id];
+
+	Snapshot *baseline = NULL;
+	if (remote->ackedSnapshot >= 0 && server->tick - remote->ackedSnapshot < netHistorySize * netSnapshotInterval)
+	{
+		baseline = &remote->sent[(remote->ackedSnapshot / netSnapshotInterval) % netHistorySize];
+		if (baseline->tick != remote->ackedSnapshot)
+		{
+			baseline = NULL;
+		}
+	}
+
+	Snapshot *snapshot = &remote->sent[(server->tick / netSnapshotInterval) % netHistorySize];
+	snapshot->tick = server->tick;
+
+	PacketWriter packet;
+	packet.size = 0;
+	packet.overflowed = false;
+	writeByte(&packet, PACKET_SNAPSHOT);
+	writeVarint(&packet, server->tick);
+	writeVarint(&packet, baseline ? baseline->tick + 1 : 0);
+	writeVarint(&packet, remote->lastProcessedInput);
+
+	//netMaxPlayers is under 128, so both counts fit in a byte that we can fill in afterwards
+	int changedAt = packet.size;
+	int changed = 0;
+	writeByte(&packet, 0);
+
+	const CarState &own = server->cars[id];
+	for (int i = 0; i < netMaxPlayers; i++)
+	{
+		float dx = server->cars[i].x - own.x;
+		float dy = server->cars[i].y - own.y;
+		snapshot->present[i] = server->present[i] && (i == id || dx * dx + dy * dy <= netRelevanceRadius * netRelevanceRadius);
+		if (!snapshot->present[i])
+		{
+			continue;
+		}
+		server->snapshotVehicles++;
+
+		QuantisedCar car = quantise(server->cars[i]);
+		snapshot->cars[i] = car;
+
+		QuantisedCar from = {0, 0, 0, 0};
+		int fields = 0;
+		if (baseline && baseline->present[i])
+		{
+			from = baseline->cars[i];
+		}
+		else
+		{
+			fields |= FIELD_NEW;
+		}
+		fields |= car.x != from.x ? FIELD_X : 0;
+		fields |= car.y != from.y ? FIELD_Y : 0;
+		fields |= car.direction != from.direction ? FIELD_DIRECTION : 0;
+		fields |= car.speed != from.speed ? FIELD_SPEED : 0;
+		if (fields == 0)
+		{
+			continue;
+		}
+
+		writeVarint(&packet, i);
+		writeByte(&packet, fields);
+		if (fields & FIELD_X)
+		{
+			writeSigned(&packet, car.x - from.x);
+		}
+		if (fields & FIELD_Y)
+		{
+			writeSigned(&packet, car.y - from.y);
+		}
+		if (fields & FIELD_DIRECTION)
+		{
+			writeSigned(&packet, car.direction - from.direction);
+		}
+		if (fields & FIELD_SPEED)
+		{
+			writeSigned(&packet, car.speed - from.speed);
+		}
+		changed++;
+	}
+
+	//Then anything the client's got that's gone away or out of range
+	int removedAt = packet.size;
+	int removed = 0;
+	writeByte(&packet, 0);
+	for (int i = 0; baseline && i < netMaxPlayers; i++)
+	{
+		if (baseline->present[i] && !snapshot->present[i])
+		{
+			writeVarint(&packet, i);
+			removed++;
+		}
+	}
+
+	if (packet.overflowed)
+	{
+		printf("Snapshot for player %d is too big to send\n", id);
+		return;
+	}
+	packet.data[changedAt] = changed;
+	packet.data[removedAt] = removed;
+	sendPacket(&server->socket, &remote->address, &packet);
+
+	if (baseline)
+	{
+		server->deltaSnapshots++;
+	}
+	else
+	{
+		server->fullSnapshots++;
+	}
+}
+
+
+/*
+* Runs one tick as the host: takes in what's arrived, moves the host's vehicle and everyone else's, drops clients we haven't heard from in too long and sends out snapshots when they're due.
+* Returns nothing.
+*/
+static void serverTick(NetServer *server, Uint32 now, const CarInput *hostInput)
+{
+	serverReceive(server, now);
+
+	if (server->hostPlaying && hostInput)
+	{
+		stepCar(&server->cars[0], *hostInput);
+		snapCar(&server->cars[0]);
+	}
+
+	for (int i = 0; i < netMaxPlayers; i++)
+	{
+		if (!server->clients[i].connected)
+		{
+			continue;
+		}
+		if (now - server->clients[i].lastHeard > netTimeout)
+		{
+			printf("Player %d timed out\n", i);
+			removeClient(server, i);
+			continue;
+		}
+		processInputs(server, i);
+	}
+
+	server->tick++;
+	if (server->tick % netSnapshotInterval == 0)
+	{
+		for (int i = 0; i < netMaxPlayers; i++)
+		{
+			if (server->clients[i].connected)
+			{
+				sendSnapshot(server, i);
+			}
+		}
+	}
+}
+
+
+/*
+* Counts the clients connected to the host (not including the host).
+* Returns the number of clients.
+*/
+static int serverClientCount(NetServer *server)
+{
+	int count = 0;
+	for (int i = 0; i < netMaxPlayers; i++)
+	{
+		count += server->clients[i].connected ? 1 : 0;
+	}
+	return count;
+}
+
+
+/*
+* Forgets everything about the game we were in, ready to knock again.
+* Returns nothing.
+*/
+static void resetClient(NetClient *client)
+{
+	client->connected = false;
+	client->id = -1;
+	client->lastConnectAttempt = 0;
+	client->tick = 0;
+	CarState start = {0.0f, -4.0f, 180.0f, 0.0f};
+	client->predicted = start;
+	client->havePrediction = false;
+	for (int i = 0; i < netHistorySize; i++)
+	{
+		client->received[i].tick = -1;
+	}
+	client->newestSnapshot = -1;
+	client->renderTick = 0;
+}
+
+
+/*
+* Looks up the host and opens a socket to talk to it on. Nothing is sent until the first clientTick().
+* Returns true on success, false if the host couldn't be found or the socket couldn't be opened.
+*/
+static bool startClient(NetClient *client, const char *host, int port)
+{
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo *found = NULL;
+	if (getaddrinfo(host, NULL, &hints, &found) != 0 || !found)
+	{
+		printf("Unable to find host %s\n", host);
+		return false;
+	}
+	client->server = *(sockaddr_in *)found->ai_addr;
+	client->server.sin_port = htons(port);
+	freeaddrinfo(found);
+
+	if (!openSocket(&client->socket, 0, false, netClientDelaySlots))
+	{
+		return false;
+	}
+	resetClient(client);
+	client->mispredictions = 0;
+	return true;
+}
+
+
+/*
+* Checks our prediction against where the host says our vehicle was after the last input it's run, and replays the inputs it hasn't got to yet on top of that.
+* Returns nothing.
+*/
+static void reconcile(NetClient *client, const Snapshot *snapshot, int processed)
+{
+	if (!snapshot->present[client->id] || processed > client->tick)
+	{
+		return;
+	}
+
+	const QuantisedCar &actual = snapshot->cars[client->id];
+	if (client->havePrediction && processed > 0 && client->tick - processed < netInputBufferSize && !sameCar(quantise(client->predictions[processed % netInputBufferSize]), actual))
+	{
+		client->mispredictions++;
+	}
+
+	CarState car = dequantise(actual);
+	if (client->tick - processed < netInputBufferSize)
+	{
+		for (int tick = processed + 1; tick <= client->tick; tick++)
+		{
+			stepCar(&car, client->inputs[tick % netInputBufferSize]);
+			snapCar(&car);
+			client->predictions[tick % netInputBufferSize] = car;
+		}
+	}
+	client->predicted = car;
+	client->havePrediction = true;
+}
+
+
+/*
+* Decodes a snapshot against the one it says it's a change from, and keeps it.
+* Returns nothing.
+*/
+static void readSnapshot(NetClient *client, PacketReader *reader)
+{
+	int tick = readVarint(reader);
+	int baselineTick = (int)readVarint(reader) - 1;
+	int processed = readVarint(reader);
+	if (reader->failed || tick <= client->newestSnapshot)
+	{
+		return;
+	}
+
+	//Decode into a copy, so that a bad packet can't leave anything half changed
+	Snapshot decoded;
+	if (baselineTick >= 0)
+	{
+		const Snapshot &baseline = client->received[(baselineTick / netSnapshotInterval) % netHistorySize];
+		if (baseline.tick != baselineTick)
+		{
+			return;
+		}
+		decoded = baseline;
+	}
+	else
+	{
+		memset(decoded.present, 0, sizeof(decoded.present));
+	}
+	decoded.tick = tick;
+
+	int changed = readByte(reader);
+	for (int i = 0; i < changed && !reader->failed; i++)
+	{
+		unsigned int id = readVarint(reader);
+		unsigned int fields = readByte(reader);
+		if (id >= (unsigned int)netMaxPlayers || (!(fields & FIELD_NEW) && !decoded.present[id]))
+		{
+			return;
+		}
+
+		QuantisedCar car = {0, 0, 0, 0};
+		if (!(fields & FIELD_NEW))
+		{
+			car = decoded.cars[id];
+		}
+		car.x += fields & FIELD_X ? readSigned(reader) : 0;
+		car.y += fields & FIELD_Y ? readSigned(reader) : 0;
+		car.direction += fields & FIELD_DIRECTION ? readSigned(reader) : 0;
+		car.speed += fields & FIELD_SPEED ? readSigned(reader) : 0;
+		decoded.cars[id] = car;
+		decoded.present[id] = true;
+	}
+
+	int removed = readByte(reader);
+	for (int i = 0; i < removed && !reader->failed; i++)
+	{
+		unsigned int id = readVarint(reader);
+		if (id < (unsigned int)netMaxPlayers)
+		{
+			decoded.present[id] = false;
+		}
+	}
+	if (reader->failed)
+	{
+		return;
+	}
+
+	client->received[(tick / netSnapshotInterval) % netHistorySize] = decoded;
+	client->newestSnapshot = tick;
+	reconcile(client, &decoded, processed);
+}
+
+
+/*
+* Handles every packet from the host that's due: the answer to our knocking and the snapshots. Anything from anywhere else is ignored.
+* Returns nothing.
+*/
+static void clientReceive(NetClient *client, Uint32 now)
+{
+	DelayedPacket *packet;
+	while ((packet = receivePacket(&client->socket, now)) != NULL)
+	{
+		if (!sameAddress(packet->from, client->server))
+		{
+			continue;
+		}
+
+		PacketReader reader = {packet->data, packet->size, 0, false};
+		unsigned int type = readByte(&reader);
+		if (type == PACKET_ACCEPT)
+		{
+			int id = readVarint(&reader);
+			if (!client->connected && !reader.failed && id < netMaxPlayers)
+			{
+				client->connected = true;
+				client->id = id;
+				client->lastHeard = now;
+			}
+		}
+		else if (type == PACKET_SNAPSHOT && client->connected)
+		{
+			readSnapshot(client, &reader);
+			client->lastHeard = now;
+		}
+	}
+}
+
+
+/*
+* Runs one tick as a client: takes in what's arrived, knocks until the host lets us in, then predicts where our input takes us, sends it (with the last few before it) and moves the time everyone else is drawn at along.
+* Returns nothing.
+*/
+static void clientTick(NetClient *client, Uint32 now, CarInput input)
+{
+	clientReceive(client, now);
+
+	if (client->connected && now - client->lastHeard > netTimeout)
+	{
+		printf("Lost the connection to the host\n");
+		resetClient(client);
+	}
+
+	//Keep knocking until the host lets us in
+	if (!client->connected)
+	{
+		if (client->lastConnectAttempt == 0 || now - client->lastConnectAttempt >= netConnectInterval)
+		{
+			PacketWriter connect;
+			connect.size = 0;
+			connect.overflowed = false;
+			writeByte(&connect, PACKET_CONNECT);
+			sendPacket(&client->socket, &client->server, &connect);
+			client->lastConnectAttempt = now ? now : 1;
+		}
+		return;
+	}
+
+	//Work out where our input takes us straight away, rather than waiting for the host to tell us
+	client->tick++;
+	int slot = client->tick % netInputBufferSize;
+	input = unpackInput(packInput(input));
+	client->inputs[slot] = input;
+	if (client->havePrediction)
+	{
+		stepCar(&client->predicted, input);
+		snapCar(&client->predicted);
+	}
+	client->predictions[slot] = client->predicted;
+
+	//Every packet carries the last few inputs too, so that losing one loses nothing
+	PacketWriter packet;
+	packet.size = 0;
+	packet.overflowed = false;
+	writeByte(&packet, PACKET_INPUT);
+	writeVarint(&packet, client->newestSnapshot + 1);
+	writeVarint(&packet, client->tick);
+	int count = client->tick < netInputRedundancy ? client->tick : netInputRedundancy;
+	writeByte(&packet, count);
+	for (int i = 0; i < count; i++)
+	{
+		writeByte(&packet, packInput(client->inputs[(client->tick - i) % netInputBufferSize]));
+	}
+	sendPacket(&client->socket, &client->server, &packet);
+
+	//Everyone else is drawn a little way behind the newest snapshot, easing towards it rather than jumping as snapshots arrive
+	client->renderTick += 1.0f;
+	float target = client->newestSnapshot - netInterpolationDelay;
+	if (fabs(target - client->renderTick) > netSnapshotInterval * 4)
+	{
+		client->renderTick = target;
+	}
+	else
+	{
+		client->renderTick += (target - client->renderTick) * 0.05f;
+	}
+}
+
+
+/*
+* Works out where everyone else should be drawn, interpolating between the snapshots either side of the tick we're drawing.
+* Returns the number of vehicles filled in.
+*/
+static int clientOtherCars(NetClient *client, NetCar *cars, int maxCars)
+{
+	const Snapshot *before = NULL;
+	const Snapshot *after = NULL;
+	for (int i = 0; i < netHistorySize; i++)
+	{
+		const Snapshot *snapshot = &client->received[i];
+		if (snapshot->tick < 0)
+		{
+			continue;
+		}
+		if (snapshot->tick <= client->renderTick && (!before || snapshot->tick > before->tick))
+		{
+			before = snapshot;
+		}
+		if (snapshot->tick > client->renderTick && (!after || snapshot->tick < after->tick))
+		{
+			after = snapshot;
+		}
+	}
+
+	//If nothing's old enough yet, just use the oldest we've got
+	if (!before)
+	{
+		before = after;
+		after = NULL;
+	}
+	if (!before)
+	{
+		return 0;
+	}
+
+	int count = 0;
+	for (int id = 0; id < netMaxPlayers && count < maxCars; id++)
+	{
+		if (id == client->id || !before->present[id])
+		{
+			continue;
+		}
+
+		CarState car = dequantise(before->cars[id]);
+		if (after && after->present[id])
+		{
+			CarState next = dequantise(after->cars[id]);
+			float t = (client->renderTick - before->tick) / (after->tick - before->tick);
+			car.x += (next.x - car.x) * t;
+			car.y += (next.y - car.y) * t;
+			car.speed += (next.speed - car.speed) * t;
+
+			//Turn the short way round, rather than spinning the long way when crossing 0 degrees
+			float turn = next.direction - car.direction;
+			if (turn > 180)
+			{
+				turn -= 360;
+			}
+			else if (turn < -180)
+			{
+				turn += 360;
+			}
+			car.direction += turn * t;
+		}
+
+		cars[count].id = id;
+		cars[count].state = car;
+		count++;
+	}
+	return count;
+}
+
+
+/*
+* Starts hosting a game on the given UDP port, with us driving as player 0.
+* Returns true on success, false on failure.
+*/
+bool netHost(int port)
+{
+	netClose();
+	server = new NetServer();
+	if (!startServer(server, port, false, true, 0))
+	{
+		delete server;
+		server = NULL;
+		return false;
+	}
+	printf("Hosting on UDP port %d\n", port);
+	lastLogTime = SDL_GetTicks();
+	return true;
+}
+
+
+/*
+* Starts trying to join a game hosted elsewhere. Our vehicle stays put until the host lets us in.
+* Returns true on success, false on failure.
+*/
+bool netConnect(const char *host, int port)
+{
+	netClose();
+	client = new NetClient();
+	if (!startClient(client, host, port))
+	{
+		delete client;
+		client = NULL;
+		return false;
+	}
+	printf("Connecting to %s:%d\n", host, port);
+	lastLogTime = SDL_GetTicks();
+	return true;
+}
+
+
+/*
+* Checks whether we're hosting or in a network game.
+* Returns true if we are.
+*/
+bool netActive()
+{
+	return server || client;
+}
+
+
+/*
+* Runs one simulation tick of the network game: sends and receives everything, and moves our vehicle with the given input.
+* Returns nothing.
+*/
+void netTick(CarInput input)
+{
+	Uint32 now = SDL_GetTicks();
+	if (server)
+	{
+		serverTick(server, now, &input);
+	}
+	else if (client)
+	{
+		bool wasConnected = client->connected;
+		clientTick(client, now, input);
+		if (client->connected && !wasConnected)
+		{
+			printf("Joined the game as player %d\n", client->id);
+		}
+	}
+	else
+	{
+		return;
+	}
+
+	//Every so often, print how the network's doing
+	if (now - lastLogTime >= netLogInterval)
+	{
+		float seconds = (now - lastLogTime) / 1000.0f;
+		NetSocket *socket = server ? &server->socket : &client->socket;
+		if (server)
+		{
+			int clients = serverClientCount(server);
+			lastStats.players = clients + 1;
+			lastStats.downBytesPerPlayer = clients ? socket->bytesSent / (float)clients / seconds : 0;
+			lastStats.upBytesPerPlayer = clients ? socket->bytesReceived / (float)clients / seconds : 0;
+			lastStats.mispredictionsPerSecond = 0;
+			printf("Network: %d players, %.0f B/s down and %.0f B/s up per player, %ld full and %ld delta snapshots, %ld inputs lost\n", lastStats.players, lastStats.downBytesPerPlayer, lastStats.upBytesPerPlayer, server->fullSnapshots, server->deltaSnapshots, server->lostInputs);
+			server->fullSnapshots = 0;
+			server->deltaSnapshots = 0;
+			server->snapshotVehicles = 0;
+			server->lostInputs = 0;
+		}
+		else
+		{
+			lastStats.players = 0;
+			if (client->newestSnapshot >= 0)
+			{
+				const Snapshot &newest = client->received[(client->newestSnapshot / netSnapshotInterval) % netHistorySize];
+				for (int i = 0; i < netMaxPlayers; i++)
+				{
+					lastStats.players += newest.present[i] ? 1 : 0;
+				}
+			}
+			lastStats.downBytesPerPlayer = socket->bytesReceived / seconds;
+			lastStats.upBytesPerPlayer = socket->bytesSent / seconds;
+			lastStats.mispredictionsPerSecond = client->mispredictions / seconds;
+			printf("Network: %d vehicles nearby, %.0f B/s down, %.0f B/s up, %.1f mispredictions a second\n", lastStats.players, lastStats.downBytesPerPlayer, lastStats.upBytesPerPlayer, lastStats.mispredictionsPerSecond);
+			client->mispredictions = 0;
+		}
+		socket->bytesSent = 0;
+		socket->bytesReceived = 0;
+		lastLogTime = now;
+	}
+}
+
+
+/*
+* Returns where our own vehicle is: the real thing if we're hosting, or our prediction of it if we're not.
+*/
+CarState netLocalCar()
+{
+	if (server)
+	{
+		return server->cars[0];
+	}
+	return client->predicted;
+}
+
+
+/*
+* Fills in everyone else's vehicles as they should be drawn this frame.
+* Returns the number of vehicles filled in.
+*/
+int netOtherCars(NetCar *cars, int maxCars)
+{
+	if (client)
+	{
+		return client->connected ? clientOtherCars(client, cars, maxCars) : 0;
+	}
+	int count = 0;
+	for (int id = 1; server && id < netMaxPlayers && count < maxCars; id++)
+	{
+		if (server->present[id])
+		{
+			cars[count].id = id;
+			cars[count].state = server->cars[id];
+			count++;
+		}
+	}
+	return count;
+}
+
+
+/*
+* Gets the network statistics from the last time they were logged.
+* Returns the statistics.
+*/
+NetStats getNetStats()
+{
+	return lastStats;
+}
+
+
+/*
+* Leaves or stops hosting the game, if we're in one.
+* Returns nothing.
+*/
+void netClose()
+{
+	if (client)
+	{
+		//Say goodbye a few times, since any one of them might get lost
+		if (client->connected)
+		{
+			PacketWriter packet;
+			packet.size = 0;
+			packet.overflowed = false;
+			writeByte(&packet, PACKET_DISCONNECT);
+			for (int i = 0; i < 3; i++)
+			{
+				sendPacket(&client->socket, &client->server, &packet);
+			}
+		}
+		closeSocket(&client->socket);
+		delete client;
+		client = NULL;
+	}
+	if (server)
+	{
+		closeSocket(&server->socket);
+		delete server;
+		server = NULL;
+	}
+}
+
+
+//A pretend driver for the benchmark, mostly flat out and changing its mind about steering every second or two
+struct BotDriver
+{
+	unsigned int random;
+	CarInput input;
+	int ticksLeft;
+};
+
+
+/*
+* Works out a bot's input for the next tick, picking a new one when it's held the last one long enough.
+* Returns the input.
+*/
+static CarInput nextBotInput(BotDriver *bot)
+{
+	if (--bot->ticksLeft <= 0)
+	{
+		float steer = nextRandom(&bot->random);
+		bot->input.steer = steer < 0.2f ? -1 : (steer < 0.4f ? 1 : 0);
+		bot->input.accel = nextRandom(&bot->random) < 0.9f;
+		bot->input.brake = !bot->input.accel && nextRandom(&bot->random) < 0.5f;
+		bot->ticksLeft = 30 + (int)(nextRandom(&bot->random) * 90);
+	}
+	return bot->input;
+}
+
+
+/*
+* Plays a host and increasing numbers of bot clients against each other over loopback, in simulated time with netLatencyMs and netLossPercent applied, and prints the bandwidth each player costs.
+* Returns nothing.
+*/
+void runNetBenchmark(int maxPlayers, int seconds)
+{
+	const int warmupSeconds = 2;
+	const float area = 1200.0f;
+	if (maxPlayers > netMaxPlayers)
+	{
+		maxPlayers = netMaxPlayers;
+	}
+
+	benchmarking = true;
+	printf("Network benchmark: %d seconds a run, %.0fms latency, %.0f%% loss, %.0f unit square, %.0f unit relevance radius\n", seconds, netLatencyMs, netLossPercent, area, netRelevanceRadius);
+	printf("%8s %10s %14s %12s %12s %12s %14s\n", "players", "nearby", "down B/s each", "up B/s each", "bytes/snap", "full snaps", "mispredicts/s");
+
+	//Doubling each time, finishing on maxPlayers
+	for (int players = 1; players <= maxPlayers; players = players < maxPlayers && players * 2 > maxPlayers ? maxPlayers : players * 2)
+	{
+		NetServer *host = new NetServer();
+		if (!startServer(host, 0, true, false, area))
+		{
+			delete host;
+			break;
+		}
+		int port = socketPort(&host->socket);
+
+		vector<NetClient*> bots(players);
+		vector<BotDriver> drivers(players);
+		for (int i = 0; i < players; i++)
+		{
+			bots[i] = new NetClient();
+			startClient(bots[i], "127.0.0.1", port);
+			drivers[i].random = 2654435761u * (i + 1);
+			drivers[i].ticksLeft = 0;
+		}
+
+		long mispredictions = 0;
+		for (int tick = 0; tick < (warmupSeconds + seconds) * simTickRate; tick++)
+		{
+			Uint32 now = (Uint32)((long)tick * 1000 / simTickRate) + 1;
+
+			//Only count once everyone's in and settled
+			if (tick == warmupSeconds * simTickRate)
+			{
+				host->socket.bytesSent = 0;
+				host->socket.bytesReceived = 0;
+				host->fullSnapshots = 0;
+				host->deltaSnapshots = 0;
+				host->snapshotVehicles = 0;
+				for (int i = 0; i < players; i++)
+				{
+					bots[i]->mispredictions = 0;
+				}
+			}
+
+			serverTick(host, now, NULL);
+			for (int i = 0; i < players; i++)
+			{
+				clientTick(bots[i], now, nextBotInput(&drivers[i]));
+			}
+		}
+
+		long snapshots = host->fullSnapshots + host->deltaSnapshots;
+		for (int i = 0; i < players; i++)
+		{
+			mispredictions += bots[i]->mispredictions;
+		}
+		printf("%8d %10.1f %14.0f %12.0f %12.1f %12ld %14.2f\n", players, snapshots ? host->snapshotVehicles / (float)snapshots : 0, host->socket.bytesSent / (float)players / seconds, host->socket.bytesReceived / (float)players / seconds, snapshots ? host->socket.bytesSent / (float)snapshots : 0, host->fullSnapshots, mispredictions / (float)players / seconds);
+
+		for (int i = 0; i < players; i++)
+		{
+			closeSocket(&bots[i]->socket);
+			delete bots[i];
+		}
+		closeSocket(&host->socket);
+		delete host;
+	}
+	benchmarking = false;
+}
@@ -0,0 +1,69 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef NET_H
+#define NET_H
+
+#include "sim.h"
+
+//The most vehicles a game can have, including the host's
+const int netMaxPlayers = 64;
+
+//How many simulation ticks there are between the snapshots of the world that the host sends each client (3 makes it 20 a second)
+const int netSnapshotInterval = 3;
+
+//How many of its latest inputs a client puts in each packet, so that losing a few packets in a row doesn't lose any input
+const int netInputRedundancy = 8;
+
+//Clients are only told about vehicles this close to their own
+const float netRelevanceRadius = 300.0f;
+
+//How far (in ticks) behind the newest snapshot clients draw everyone else, so that there's usually a snapshot either side to interpolate between even if one goes missing
+const int netInterpolationDelay = 2 * netSnapshotInterval + 2;
+
+//The port we host on or connect to (--host, --connect)
+extern int netPort;
+
+//Pretend the network is worse than it is: a delay (in milliseconds, each way) and a percentage of packets to throw away, applied to everything we receive
+extern float netLatencyMs;
+extern float netLossPercent;
+
+//Someone else's vehicle, as we should draw it this frame
+struct NetCar
+{
+	int id;
+	CarState state;
+};
+
+//How the network is doing, averaged over the last logging interval
+struct NetStats
+{
+	int players;
+
+	//Bytes each player receives and sends each second, including UDP and IP headers
+	float downBytesPerPlayer;
+	float upBytesPerPlayer;
+
+	//How often a client's prediction of its own vehicle turned out to be wrong
+	float mispredictionsPerSecond;
+};
+
+bool netHost(int port);
+bool netConnect(const char *host, int port);
+bool netActive();
+void netTick(CarInput input);
+CarState netLocalCar();
+int netOtherCars(NetCar *cars, int maxCars);
+NetStats getNetStats();
+void netClose();
+void runNetBenchmark(int maxPlayers, int seconds);
+
+#endif
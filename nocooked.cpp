@@ -0,0 +1,16 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+//The cooked asset tables for builds without cooked assets, so that everything gets read from resources/ instead
+#include "assets.h"
+
+const CookedMesh *const cookedMeshes[COOKED_MODELS] = {NULL};
+const CookedData *const cookedFiles[COOKED_FILES] = {NULL};
@@ -0,0 +1,567 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include "occlusion.h"
+#include "jobs.h"
+#include "memory.h"
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+bool occlusionCulling = true;
+float occlusionBudget = 1;
+float occluderMinRadius = 20;
+
+//Anything closer to the camera than this is too close to project safely (it's the same as our near plane)
+static const float occlusionNear = 0.2f;
+
+//Each job rasterises one band of this many rows
+static const int occlusionBandHeight = 16;
+
+static const int occlusionTilesAcross = occlusionWidth / occlusionTileSize;
+static const int occlusionTilesDown = occlusionHeight / occlusionTileSize;
+
+//Our depth buffer, where 0 is the near plane and 1 is the far plane, and the furthest depth in each tile of it
+alignas(16) static float depthBuffer[occlusionWidth * occlusionHeight];
+static float tileDepth[occlusionTilesAcross * occlusionTilesDown];
+
+//The camera's combined projection and modelview matrix for this frame
+static float viewProjection[16];
+
+//An occluder triangle, already projected into depth buffer pixels and set up for rasterising
+struct OccluderTriangle
+{
+	//Edge functions (a * x + b * y + c, positive on the inside) and the depth plane (the same form)
+	float edgeA[3];
+	float edgeB[3];
+	float edgeC[3];
+	float depthA;
+	float depthB;
+	float depthC;
+
+	//The pixels that it might cover
+	int minX;
+	int maxX;
+	int minY;
+	int maxY;
+};
+
+//This frame's occluders and their triangles, which live in the frame arena
+static GameObject **occluders = NULL;
+static int occluderCount = 0;
+static OccluderTriangle *occluderTriangles = NULL;
+static int occluderTriangleCount = 0;
+static int occluderTriangleSpace = 0;
+
+//When drawing occluders has to stop, and whether we got there
+static Uint64 rasteriseDeadline = 0;
+static atomic<bool> ranOutOfTime(false);
+
+static atomic<int> culledCount(0);
+static atomic<int> testedCount(0);
+static OcclusionStats lastStats = {0, 0, 0, 0, 0, 0, false};
+
+//Totals since we last printed anything
+static const Uint32 occlusionLogInterval = 5000;
+static Uint32 lastLogTime = 0;
+static int logFrames = 0;
+static long logTested = 0;
+static long logCulled = 0;
+static double logRasteriseMs = 0;
+static double logTestMs = 0;
+static int logOverBudget = 0;
+
+
+/*
+* Builds the matrix that takes an object's packed vertex positions straight to clip space, by following renderObject() and drawMesh(): move to x, y, rotate around Y by rz, then undo the quantisation.
+* Returns nothing.
+*/
+static void objectToClipMatrix(const GameObject *o, float out[16])
+{
+	float c = cos((M_PI * o->rz) / 180);
+	float s = sin((M_PI * o->rz) / 180);
+	const float *qc = o->mesh->quantCentre;
+	const float *qs = o->mesh->quantScale;
+
+	//OpenGL style, column by column
+	float model[16] = {
+		c * qs[0], 0, -s * qs[0], 0,
+		0, qs[1], 0, 0,
+		s * qs[2], 0, c * qs[2], 0,
+		o->x + c * qc[0] + s * qc[2], qc[1], o->y - s * qc[0] + c * qc[2], 1
+	};
+
+	for (int col = 0; col < 4; col++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			out[col * 4 + row] = 0;
+			for (int k = 0; k < 4; k++)
+			{
+				out[col * 4 + row] += viewProjection[k * 4 + row] * model[col * 4 + k];
+			}
+		}
+	}
+}
+
+
+/*
+* Transforms a packed position by a matrix from objectToClipMatrix().
+* Returns nothing.
+*/
+static void transformPosition(const float m[16], float x, float y, float z, float out[4])
+{
+	for (int row = 0; row < 4; row++)
+	{
+		out[row] = m[row] * x + m[4 + row] * y + m[8 + row] * z + m[12 + row];
+	}
+}
+
+
+/*
+* Sorting helper for occluders. We can't be sure of drawing all of them, so the nearest (which tend to hide the most) go first.
+* Returns true if a is closer to the camera than b.
+*/
+static bool closerToCamera(const GameObject *a, const GameObject *b)
+{
+	float ca[4];
+	float cb[4];
+	float m[16];
+	objectToClipMatrix(a, m);
+	transformPosition(m, 0, 0, 0, ca);
+	objectToClipMatrix(b, m);
+	transformPosition(m, 0, 0, 0, cb);
+	return ca[3] < cb[3];
+}
+
+
+/*
+* Projects an occluder's triangles into depth buffer pixels and adds the ones that face the camera to occluderTriangles.
+* Triangles that poke through the near plane are left out, which only means they hide a little less than they could.
+* Returns nothing.
+*/
+static void setUpOccluder(const GameObject *o)
+{
+	float m[16];
+	objectToClipMatrix(o, m);
+
+	const Mesh *mesh = o->mesh;
+	for (size_t i = 0; i + 2 < mesh->indices.size(); i += 3)
+	{
+		float x[3];
+		float y[3];
+		float z[3];
+		bool tooClose = false;
+
+		for (int v = 0; v < 3; v++)
+		{
+			const GLshort *p = mesh->vertices[mesh->indices[i + v]].position;
+			float clip[4];
+			transformPosition(m, p[0], p[1], p[2], clip);
+			if (clip[3] < occlusionNear)
+			{
+				tooClose = true;
+				break;
+			}
+
+			//Into pixels (with y going up like OpenGL's window coordinates) and a 0 to 1 depth
+			x[v] = (clip[0] / clip[3] * 0.5f + 0.5f) * occlusionWidth;
+			y[v] = (clip[1] / clip[3] * 0.5f + 0.5f) * occlusionHeight;
+			z[v] = clip[2] / clip[3] * 0.5f + 0.5f;
+		}
+
+		if (tooClose)
+		{
+			continue;
+		}
+
+		//Twice the triangle's area, positive if it's anticlockwise on screen. Our front faces are clockwise, so OpenGL won't draw anything else and neither should we
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (area >= 0)
+		{
+			continue;
+		}
+
+		OccluderTriangle t;
+		t.minX = max(0, (int)floor(min(x[0], min(x[1], x[2]))));
+		t.maxX = min(occlusionWidth - 1, (int)ceil(max(x[0], max(x[1], x[2]))));
+		t.minY = max(0, (int)floor(min(y[0], min(y[1], y[2]))));
+		t.maxY = min(occlusionHeight - 1, (int)ceil(max(y[0], max(y[1], y[2]))));
+		if (t.minX > t.maxX || t.minY > t.maxY)
+		{
+			continue;
+		}
+
+		//Walk the edges the other way around so that the inside is positive for all three
+		for (int e = 0; e < 3; e++)
+		{
+			int from = (3 - e) % 3;
+			int to = (5 - e) % 3;
+			t.edgeA[e] = y[from] - y[to];
+			t.edgeB[e] = x[to] - x[from];
+			t.edgeC[e] = -(t.edgeA[e] * x[from] + t.edgeB[e] * y[from]);
+		}
+
+		//Depth is linear across the screen after the perspective divide, so it's a plane we can step along like the edges
+		t.depthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+		t.depthB = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) / area;
+		t.depthC = z[0] - t.depthA * x[0] - t.depthB * y[0];
+
+		if (occluderTriangleCount < occluderTriangleSpace)
+		{
+			occluderTriangles[occluderTriangleCount++] = t;
+		}
+	}
+}
+
+
+/*
+* Draws one occluder triangle into rows firstRow to lastRow (inclusive) of the depth buffer, 4 pixels at a time, keeping the nearest depth.
+* Returns nothing.
+*/
+static void rasteriseTriangle(const OccluderTriangle &t, int firstRow, int lastRow)
+{
+	int startX = t.minX & ~3;
+
+	for (int y = max(firstRow, t.minY); y <= min(lastRow, t.maxY); y++)
+	{
+		float py = y + 0.5f;
+		float *row = &depthBuffer[y * occlusionWidth];
+
+#ifdef __SSE2__
+		__m128 px = _mm_setr_ps(startX + 0.5f, startX + 1.5f, startX + 2.5f, startX + 3.5f);
+		__m128 four = _mm_set1_ps(4);
+		__m128 zero = _mm_setzero_ps();
+		__m128 a0 = _mm_set1_ps(t.edgeA[0]);
+		__m128 a1 = _mm_set1_ps(t.edgeA[1]);
+		__m128 a2 = _mm_set1_ps(t.edgeA[2]);
+		__m128 r0 = _mm_set1_ps(t.edgeB[0] * py + t.edgeC[0]);
+		__m128 r1 = _mm_set1_ps(t.edgeB[1] * py + t.edgeC[1]);
+		__m128 r2 = _mm_set1_ps(t.edgeB[2] * py + t.edgeC[2]);
+		__m128 za = _mm_set1_ps(t.depthA);
+		__m128 zr = _mm_set1_ps(t.depthB * py + t.depthC);
+
+		for (int x = startX; x <= t.maxX; x += 4)
+		{
+			__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), r0), zero);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), r1), zero));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), r2), zero));
+
+			if (_mm_movemask_ps(inside) != 0)
+			{
+				__m128 old = _mm_load_ps(&row[x]);
+				__m128 nearer = _mm_min_ps(old, _mm_add_ps(_mm_mul_ps(za, px), zr));
+				_mm_store_ps(&row[x], _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+			}
+
+			px = _mm_add_ps(px, four);
+		}
+#else
+		for (int x = startX; x <= t.maxX; x++)
+		{
+			float px = x + 0.5f;
+			if (t.edgeA[0] * px + t.edgeB[0] * py + t.edgeC[0] >= 0 && t.edgeA[1] * px + t.edgeB[1] * py + t.edgeC[1] >= 0 && t.edgeA[2] * px + t.edgeB[2] * py + t.edgeC[2] >= 0)
+			{
+				float z = t.depthA * px + t.depthB * py + t.depthC;
+				row[x] = (z < row[x]) ? z : row[x];
+			}
+		}
+#endif
+	}
+}
+
+
+/*
+* Job that clears and draws bands begin to end (exclusive) of the depth buffer, then works out the furthest depth in each of their tiles.
+* Returns nothing.
+*/
+static void rasteriseBands(void *data, int begin, int end)
+{
+	for (int band = begin; band < end; band++)
+	{
+		int firstRow = band * occlusionBandHeight;
+		int lastRow = firstRow + occlusionBandHeight - 1;
+
+		fill(&depthBuffer[firstRow * occlusionWidth], &depthBuffer[(lastRow + 1) * occlusionWidth], 1.0f);
+
+		for (int i = 0; i < occluderTriangleCount; i++)
+		{
+			//Check the time every so often, and leave the rest if we're out of it
+			if (i % 32 == 31 && SDL_GetPerformanceCounter() > rasteriseDeadline)
+			{
+				ranOutOfTime = true;
+				break;
+			}
+
+			const OccluderTriangle &t = occluderTriangles[i];
+			if (t.maxY >= firstRow && t.minY <= lastRow)
+			{
+				rasteriseTriangle(t, firstRow, lastRow);
+			}
+		}
+
+		for (int ty = firstRow / occlusionTileSize; ty <= lastRow / occlusionTileSize; ty++)
+		{
+			for (int tx = 0; tx < occlusionTilesAcross; tx++)
+			{
+				float furthest = 0;
+				for (int y = ty * occlusionTileSize; y < (ty + 1) * occlusionTileSize; y++)
+				{
+					for (int x = tx * occlusionTileSize; x < (tx + 1) * occlusionTileSize; x++)
+					{
+						furthest = max(furthest, depthBuffer[y * occlusionWidth + x]);
+					}
+				}
+				tileDepth[ty * occlusionTilesAcross + tx] = furthest;
+			}
+		}
+	}
+}
+
+
+/*
+* Checks whether an object's bounding box is completely behind what's in the depth buffer. Tiles are checked first, and only the tiles that can't decide get checked pixel by pixel.
+* Returns true if the object is definitely hidden.
+*/
+static bool isOccluded(const GameObject *o)
+{
+	float m[16];
+	objectToClipMatrix(o, m);
+
+	//The corners of the mesh's bounding box are at +/-32767 in packed coordinates
+	float minX = 1e30f, maxX = -1e30f;
+	float minY = 1e30f, maxY = -1e30f;
+	float nearest = 1e30f;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		float clip[4];
+		transformPosition(m, (corner & 1) ? 32767 : -32767, (corner & 2) ? 32767 : -32767, (corner & 4) ? 32767 : -32767, clip);
+
+		//If the box reaches past the near plane, we can't say anything useful about it
+		if (clip[3] < occlusionNear)
+		{
+			return false;
+		}
+
+		float x = (clip[0] / clip[3] * 0.5f + 0.5f) * occlusionWidth;
+		float y = (clip[1] / clip[3] * 0.5f + 0.5f) * occlusionHeight;
+		float z = clip[2] / clip[3] * 0.5f + 0.5f;
+		minX = min(minX, x);
+		maxX = max(maxX, x);
+		minY = min(minY, y);
+		maxY = max(maxY, y);
+		nearest = min(nearest, z);
+	}
+
+	int x0 = max(0, (int)floor(minX));
+	int x1 = min(occlusionWidth - 1, (int)floor(maxX));
+	int y0 = max(0, (int)floor(minY));
+	int y1 = min(occlusionHeight - 1, (int)floor(maxY));
+	if (x0 > x1 || y0 > y1)
+	{
+		return false;
+	}
+
+	for (int ty = y0 / occlusionTileSize; ty <= y1 / occlusionTileSize; ty++)
+	{
+		for (int tx = x0 / occlusionTileSize; tx <= x1 / occlusionTileSize; tx++)
+		{
+			//Everything in this tile is in front of the object, so no need to look any closer
+			if (tileDepth[ty * occlusionTilesAcross + tx] < nearest)
+			{
+				continue;
+			}
+
+			int px0 = max(x0, tx * occlusionTileSize);
+			int px1 = min(x1, (tx + 1) * occlusionTileSize - 1);
+			int py0 = max(y0, ty * occlusionTileSize);
+			int py1 = min(y1, (ty + 1) * occlusionTileSize - 1);
+			for (int y = py0; y <= py1; y++)
+			{
+				for (int x = px0; x <= px1; x++)
+				{
+					if (depthBuffer[y * occlusionWidth + x] >= nearest)
+					{
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+
+/*
+* Job that tests objects begin to end (exclusive) against the depth buffer, and hides the ones that are behind occluders.
+* Returns nothing.
+*/
+static void testObjects(void *data, int begin, int end)
+{
+	vector<GameObject*> &objects = *(vector<GameObject*> *)data;
+	int tested = 0;
+	int culled = 0;
+
+	for (int i = begin; i < end; i++)
+	{
+		GameObject *o = objects[i];
+
+		//Occluders always get drawn (they'd hide themselves otherwise)
+		if (!o->visible || o->mesh->indices.empty() || o->mesh->boundRadius >= occluderMinRadius)
+		{
+			continue;
+		}
+
+		tested++;
+		if (isOccluded(o))
+		{
+			o->visible = false;
+			culled++;
+		}
+	}
+
+	testedCount += tested;
+	culledCount += culled;
+}
+
+
+/*
+* Grabs the camera matrix for this frame and prints how occlusion culling has been doing every few seconds. Must be called from the main thread after the camera is set up.
+* Returns nothing.
+*/
+void occlusionBeginFrame(const float matrix[16])
+{
+	for (int i = 0; i < 16; i++)
+	{
+		viewProjection[i] = matrix[i];
+	}
+
+	if (!occlusionCulling)
+	{
+		return;
+	}
+
+	logFrames++;
+	logTested += lastStats.tested;
+	logCulled += lastStats.culled;
+	logRasteriseMs += lastStats.rasteriseMs;
+	logTestMs += lastStats.testMs;
+	logOverBudget += lastStats.overBudget ? 1 : 0;
+
+	Uint32 now = SDL_GetTicks();
+	if (lastLogTime == 0)
+	{
+		lastLogTime = now;
+	}
+	if (now - lastLogTime >= occlusionLogInterval && logFrames > 1)
+	{
+		printf("Occlusion: %.1f of %.1f objects culled a frame, %d occluders (%d triangles), %.3fms drawing, %.3fms testing, over budget %d of %d frames\n", (double)logCulled / logFrames, (double)logTested / logFrames, lastStats.occluders, lastStats.triangles, logRasteriseMs / logFrames, logTestMs / logFrames, logOverBudget, logFrames);
+		lastLogTime = now;
+		logFrames = 0;
+		logTested = 0;
+		logCulled = 0;
+		logRasteriseMs = 0;
+		logTestMs = 0;
+		logOverBudget = 0;
+	}
+}
+
+
+/*
+* Draws the biggest visible objects into a small depth buffer and hides any other visible objects that end up completely behind them. Uses the job threads, so call it from a frame stage after frustum culling.
+* Returns nothing.
+*/
+void cullOccluded(vector<GameObject*> &objects)
+{
+	if (!occlusionCulling)
+	{
+		return;
+	}
+
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	Uint64 start = SDL_GetPerformanceCounter();
+	rasteriseDeadline = start + (Uint64)(occlusionBudget / 1000 * frequency);
+	ranOutOfTime = false;
+
+	//Pick out the occluders that we can see, nearest first
+	occluderCount = 0;
+	occluderTriangleCount = 0;
+	occluderTriangleSpace = 0;
+	occluders = (GameObject **)frameAlloc(objects.size() * sizeof(GameObject*), alignof(GameObject*));
+	if (occluders == NULL)
+	{
+		return;
+	}
+
+	size_t maxTriangles = 0;
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		GameObject *o = objects[i];
+		if (o->visible && o->mesh->boundRadius >= occluderMinRadius && !o->mesh->indices.empty())
+		{
+			occluders[occluderCount++] = o;
+			maxTriangles += o->mesh->indices.size() / 3;
+		}
+	}
+	sort(occluders, occluders + occluderCount, closerToCamera);
+
+	occluderTriangles = (OccluderTriangle *)frameAlloc(maxTriangles * sizeof(OccluderTriangle), alignof(OccluderTriangle));
+	occluderTriangleSpace = (occluderTriangles != NULL) ? (int)maxTriangles : 0;
+	for (int i = 0; i < occluderCount; i++)
+	{
+		if (SDL_GetPerformanceCounter() > rasteriseDeadline)
+		{
+			ranOutOfTime = true;
+			break;
+		}
+		setUpOccluder(occluders[i]);
+	}
+
+	testedCount = 0;
+	culledCount = 0;
+	Uint64 rasterised = SDL_GetPerformanceCounter();
+	Uint64 tested = rasterised;
+
+	//With nothing to draw, nothing can be hidden, so don't bother testing
+	if (occluderTriangleCount > 0)
+	{
+		jobsParallelFor(occlusionHeight / occlusionBandHeight, 1, rasteriseBands, NULL);
+		rasterised = SDL_GetPerformanceCounter();
+
+		jobsParallelFor((int)objects.size(), 64, testObjects, &objects);
+		tested = SDL_GetPerformanceCounter();
+	}
+
+	lastStats.occluders = occluderCount;
+	lastStats.triangles = occluderTriangleCount;
+	lastStats.tested = testedCount;
+	lastStats.culled = culledCount;
+	lastStats.rasteriseMs = (float)(rasterised - start) * 1000 / frequency;
+	lastStats.testMs = (float)(tested - rasterised) * 1000 / frequency;
+	lastStats.overBudget = ranOutOfTime;
+}
+
+
+/*
+* Gets what occlusion culling did in the most recent frame.
+* Returns an OcclusionStats.
+*/
+OcclusionStats getOcclusionStats()
+{
+	return lastStats;
+}
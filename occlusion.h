@@ -0,0 +1,50 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <vector>
+
+#include "mesh.h"
+
+//The size of our software depth buffer. It only needs to be good enough to tell whether something is hidden, so it's much smaller than the window
+//The width has to be a multiple of 4 (we fill 4 pixels at a time) and both have to be multiples of occlusionTileSize
+const int occlusionWidth = 256;
+const int occlusionHeight = 128;
+const int occlusionTileSize = 8;
+
+//Whether we hide objects that are behind big ones
+extern bool occlusionCulling;
+
+//How long (in milliseconds) drawing occluders is allowed to take each frame. Anything left over doesn't get drawn, which just means less gets culled
+extern float occlusionBudget;
+
+//How big (bounding sphere radius) an object's mesh has to be before we draw it into the depth buffer to hide things behind it
+extern float occluderMinRadius;
+
+//What happened in the most recent frame
+struct OcclusionStats
+{
+	int occluders;
+	int triangles;
+	int tested;
+	int culled;
+	float rasteriseMs;
+	float testMs;
+	bool overBudget;
+};
+
+void occlusionBeginFrame(const float viewProjection[16]);
+void cullOccluded(std::vector<GameObject*> &objects);
+OcclusionStats getOcclusionStats();
+
+#endif
@@ -0,0 +1,599 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include <GL/glew.h>
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "framepacing.h"
+#include "particles.h"
+#include "random.h"
+#include "terrain.h"
+#include "glstats.h"
+
+using namespace std;
+
+//Settings (from the command line)
+int particleBudget = 16384;
+
+//How long a slot has to have been dead before we reuse it, so that frames the GPU hasn't finished drawing yet never see it change underneath them
+static const float particleReuseDelay = 0.1f;
+
+//One particle, exactly as it sits in the buffer. Nothing here changes after it's written; the vertex shader works out where the particle has got to from how old it is
+struct Particle
+{
+	GLfloat position[3];
+	GLfloat velocity[3];
+
+	//When it was born (on particleClock), and how long it lives for, in seconds
+	GLfloat born;
+	GLfloat lifetime;
+
+	//How low it can fall: the ground under where it was born (where the bottom of the skirt would be)
+	GLfloat floor;
+};
+
+//How each type of particle looks and moves
+struct ParticleLook
+{
+	float minLifetime;
+	float maxLifetime;
+
+	//Sizes at birth and death, as a fraction of the vehicle's width
+	float startSize;
+	float endSize;
+
+	//How quickly particles lose the speed they were born with (per second), and what pulls on them as they go
+	float drag;
+	float acceleration[3];
+
+	float colour[4];
+	GLenum blendSource;
+	GLenum blendDestination;
+};
+
+static const ParticleLook particleLooks[PARTICLE_TYPES] =
+{
+	//Exhaust: pale and see-through, spreading out quickly and drifting up a little as it slows
+	{0.5f, 1.0f, 0.2f, 1.2f, 2.5f, {0.0f, 0.3f, 0.0f}, {0.85f, 0.85f, 0.9f, 0.3f}, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA},
+
+	//Spray: small and bright, thrown out from under the skirt and falling back to the ground
+	{0.6f, 1.2f, 0.1f, 0.4f, 0.8f, {0.0f, -4.0f, 0.0f}, {0.9f, 0.95f, 1.0f, 0.5f}, GL_SRC_ALPHA, GL_ONE}
+};
+
+//A ring of particles in a buffer. New particles go in after the newest, over the top of the oldest
+struct ParticleRing
+{
+	GLuint buffer;
+
+	//When the particle in each slot dies, so that we only overwrite ones that are long gone
+	vector<float> deaths;
+
+	//Particles started since the last draw, waiting to be written into the buffer from pendingStart onwards
+	vector<Particle> pending;
+	int pendingStart;
+
+	//How many slots have ever had anything written to them (there's no point drawing the rest)
+	int used;
+};
+
+static ParticleRing rings[PARTICLE_TYPES];
+static bool particlesReady = false;
+
+//Whether we can write into the buffer without GL waiting for the GPU to finish with it first
+static bool unsynchronisedWrites = false;
+
+//Seconds of game time since we started. Particles are timed against this
+static double particleClock = 0;
+
+//Where particles come from, in the vehicle's own coordinates
+static float fanPositions[2][3];
+static float skirtCentre[3];
+static float skirtRadius[2];
+static float vehicleWidth = 1;
+
+//Where particles get their random numbers from (see random.h)
+static unsigned int particleRandom = 1;
+
+static ParticleStats currentStats;
+static ParticleStats lastStats;
+
+//The shader does all of the moving, so the CPU only ever touches a particle once
+static GLuint particleProgram = 0;
+static GLint timeUniform = -1;
+static GLint pointScaleUniform = -1;
+static GLint accelerationUniform = -1;
+static GLint shapeUniform = -1;
+static GLint colourUniform = -1;
+static const GLuint velocityAttribute = 1;
+static const GLuint timingAttribute = 2;
+
+static const char *particleVertexShader =
+	"#version 120\n"
+	"attribute vec3 velocity;\n"
+	"attribute vec3 timing;\n"
+	"uniform float time;\n"
+	"uniform float pointScale;\n"
+	"uniform vec3 acceleration;\n"
+	"uniform vec3 shape;\n"
+	"varying float life;\n"
+	"void main()\n"
+	"{\n"
+	"	float age = time - timing.x;\n"
+	"	life = age / timing.y;\n"
+	"	if (life < 0.0 || life > 1.0)\n"
+	"	{\n"
+	"		gl_Position = vec4(0.0, 0.0, -2.0, 1.0);\n"
+	"		gl_PointSize = 0.0;\n"
+	"		return;\n"
+	"	}\n"
+	"	vec3 position = gl_Vertex.xyz + velocity * ((1.0 - exp(-shape.z * age)) / shape.z) + 0.5 * acceleration * age * age;\n"
+	"	position.y = max(position.y, timing.z);\n"
+	"	vec4 eyePosition = gl_ModelViewMatrix * vec4(position, 1.0);\n"
+	"	gl_Position = gl_ProjectionMatrix * eyePosition;\n"
+	"	gl_PointSize = mix(shape.x, shape.y, life) * pointScale / max(-eyePosition.z, 0.1);\n"
+	"}\n";
+
+static const char *particleFragmentShader =
+	"#version 120\n"
+	"uniform vec4 colour;\n"
+	"varying float life;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 offset = gl_PointCoord * 2.0 - 1.0;\n"
+	"	float distance = dot(offset, offset);\n"
+	"	if (distance > 1.0)\n"
+	"	{\n"
+	"		discard;\n"
+	"	}\n"
+	"	gl_FragColor = vec4(colour.rgb, colour.a * (1.0 - life) * (1.0 - distance));\n"
+	"}\n";
+
+
+/*
+* Works out a mesh's bounding box from its quantisation (the box's edges are at +/-32767 steps from the centre).
+* Returns nothing.
+*/
+static void meshBox(const Mesh *mesh, float low[3], float high[3])
+{
+	for (int a = 0; a < 3; a++)
+	{
+		float half = mesh->quantScale[a] * 32767;
+		low[a] = mesh->quantCentre[a] - half;
+		high[a] = mesh->quantCentre[a] + half;
+	}
+}
+
+
+/*
+* Sets up the particle shader and buffers, and works out where on the vehicle particles come from. Needs a GL context.
+* Returns true if particles are ready, or false if we'll be going without.
+*/
+bool initParticles(const Mesh *fans, const Mesh *skirt)
+{
+	if (particleBudget <= 0)
+	{
+		return false;
+	}
+	if (!GLEW_VERSION_2_0)
+	{
+		printf("No shaders, so no particles\n");
+		return false;
+	}
+
+	GLuint vertexShader = compileShader(GL_VERTEX_SHADER, particleVertexShader, "particle");
+	GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, particleFragmentShader, "particle");
+	if (vertexShader == 0 || fragmentShader == 0)
+	{
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return false;
+	}
+
+	particleProgram = glCreateProgram();
+	glAttachShader(particleProgram, vertexShader);
+	glAttachShader(particleProgram, fragmentShader);
+	glBindAttribLocation(particleProgram, velocityAttribute, "velocity");
+	glBindAttribLocation(particleProgram, timingAttribute, "timing");
+	glLinkProgram(particleProgram);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(particleProgram, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+	{
+		char log[1024];
+		glGetProgramInfoLog(particleProgram, sizeof(log), NULL, log);
+		printf("Couldn't link particle shader: %s\n", log);
+		glDeleteProgram(particleProgram);
+		particleProgram = 0;
+		return false;
+	}
+
+	timeUniform = glGetUniformLocation(particleProgram, "time");
+	pointScaleUniform = glGetUniformLocation(particleProgram, "pointScale");
+	accelerationUniform = glGetUniformLocation(particleProgram, "acceleration");
+	shapeUniform = glGetUniformLocation(particleProgram, "shape");
+	colourUniform = glGetUniformLocation(particleProgram, "colour");
+
+	//Everything we'll ever need is set aside now, so that making particles never allocates
+	for (int t = 0; t < PARTICLE_TYPES; t++)
+	{
+		ParticleRing *ring = &rings[t];
+		glGenBuffers(1, &ring->buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, ring->buffer);
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)particleBudget * sizeof(Particle), NULL, GL_STREAM_DRAW);
+		ring->deaths.assign(particleBudget, -FLT_MAX);
+		ring->pending.reserve(particleBudget);
+		ring->pendingStart = 0;
+		ring->used = 0;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	unsynchronisedWrites = GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range;
+
+	//The exhaust comes out of the back of each fan, and the spray from the bottom edge of the skirt
+	float low[3];
+	float high[3];
+	meshBox(fans, low, high);
+	float middle = (low[0] + high[0]) / 2;
+	for (int side = 0; side < 2; side++)
+	{
+		fanPositions[side][0] = side == 0 ? (middle + high[0]) / 2 : (low[0] + middle) / 2;
+		fanPositions[side][1] = (low[1] + high[1]) / 2;
+		fanPositions[side][2] = low[2];
+	}
+	meshBox(skirt, low, high);
+	skirtCentre[0] = (low[0] + high[0]) / 2;
+	skirtCentre[1] = low[1];
+	skirtCentre[2] = (low[2] + high[2]) / 2;
+	skirtRadius[0] = (high[0] - low[0]) / 2;
+	skirtRadius[1] = (high[2] - low[2]) / 2;
+	vehicleWidth = high[0] - low[0];
+
+	particleClock = 0;
+	particlesReady = true;
+	printf("Particles: %d of each type, %s writes\n", particleBudget, unsynchronisedWrites ? "unsynchronised mapped" : "glBufferSubData");
+	return true;
+}
+
+
+/*
+* Moves particle time along. Particles move themselves (on the GPU), so this is all that needs doing each frame.
+* Returns nothing.
+*/
+void updateParticles(float seconds)
+{
+	particleClock += seconds;
+}
+
+
+/*
+* Finds room for a new particle in a ring, after the newest one.
+* Returns the particle to fill in, or NULL if the oldest particle in the way is still alive.
+*/
+static Particle *newParticle(ParticleRing *ring, float born, float lifetime)
+{
+	int capacity = ring->deaths.size();
+	if ((int)ring->pending.size() == capacity)
+	{
+		return NULL;
+	}
+	int slot = (ring->pendingStart + ring->pending.size()) % capacity;
+	if (ring->deaths[slot] > particleClock - particleReuseDelay)
+	{
+		return NULL;
+	}
+
+	ring->deaths[slot] = born + lifetime;
+	ring->pending.push_back(Particle());
+	Particle *particle = &ring->pending.back();
+	particle->born = born;
+	particle->lifetime = lifetime;
+	currentStats.emitted++;
+	return particle;
+}
+
+
+//Where a vehicle is and how it's moving this frame, worked out once rather than for every particle it emits
+struct VehicleFrame
+{
+	CarState car;
+	float cosine;
+	float sine;
+	float velocity[3];
+
+	//How far the terrain under the vehicle is above the flat ground
+	float ground;
+};
+
+
+/*
+* Turns a point (or direction, if w is 0) in the vehicle's coordinates into world coordinates, the same way renderVehicle() places the vehicle.
+* Returns nothing.
+*/
+static void vehicleToWorld(const VehicleFrame &frame, const float local[3], float w, float world[3])
+{
+	world[0] = local[0] * frame.cosine + local[2] * frame.sine + frame.car.x * w;
+	world[1] = local[1] + (carHoverHeight + frame.ground) * w;
+	world[2] = -local[0] * frame.sine + local[2] * frame.cosine + frame.car.y * w;
+}
+
+
+/*
+* Works out how many particles are due over a frame, rounding up or down at random so that the fractions even out over time.
+* Returns the number of particles to emit.
+*/
+static int particlesDue(float rate, float seconds)
+{
+	float due = rate * seconds;
+	int count = (int)due;
+	return count + (nextRandom(&particleRandom) < due - count ? 1 : 0);
+}
+
+
+/*
+* Starts one particle, somewhere over the last frame, where the vehicle was at that moment.
+* Returns nothing.
+*/
+static void emitParticle(ParticleType type, const VehicleFrame &frame, const float local[3], const float localVelocity[3], float seconds)
+{
+	const ParticleLook &look = particleLooks[type];
+	float age = nextRandom(&particleRandom) * seconds;
+	float born = particleClock - age;
+	Particle *particle = newParticle(&rings[type], born, look.minLifetime + nextRandom(&particleRandom) * (look.maxLifetime - look.minLifetime));
+	if (!particle)
+	{
+		return;
+	}
+
+	float position[3];
+	float velocity[3];
+	vehicleToWorld(frame, local, 1, position);
+	vehicleToWorld(frame, localVelocity, 0, velocity);
+	for (int a = 0; a < 3; a++)
+	{
+		particle->position[a] = position[a] - frame.velocity[a] * age;
+		particle->velocity[a] = velocity[a] + frame.velocity[a] * 0.5f;
+	}
+	particle->floor = terrainHeight(particle->position[0], particle->position[2]) + carHoverHeight + skirtCentre[1];
+}
+
+
+/*
+* Works out how long a particle of the given type lives on average.
+* Returns the lifetime in seconds.
+*/
+static float averageLifetime(ParticleType type)
+{
+	return (particleLooks[type].minLifetime + particleLooks[type].maxLifetime) / 2;
+}
+
+
+/*
+* Starts this frame's exhaust and spray for a vehicle, depending on how fast it's going and which fans are on (the same way the HUD decides).
+* Returns nothing.
+*/
+void emitVehicleParticles(const CarState &car, CarInput input, float seconds)
+{
+	if (!particlesReady || seconds <= 0)
+	{
+		return;
+	}
+
+	//0.25 is the top speed in stepCar()
+	float throttle = car.speed / 0.25f;
+	float angle = M_PI * car.direction / 180;
+	VehicleFrame frame;
+	frame.car = car;
+	frame.cosine = cos(angle);
+	frame.sine = sin(angle);
+	frame.velocity[0] = frame.sine * car.speed * simTickRate;
+	frame.velocity[1] = 0;
+	frame.velocity[2] = frame.cosine * car.speed * simTickRate;
+	frame.ground = terrainHeight(car.x, car.y);
+
+	//Flat out with both fans going keeps each ring just about full (if a long lived particle is in the way, the new one just doesn't happen)
+	float exhaustRate = particleBudget / (averageLifetime(PARTICLES_EXHAUST) + particleReuseDelay);
+	float sprayRate = particleBudget / (averageLifetime(PARTICLES_SPRAY) + particleReuseDelay);
+
+	bool fanOn[2];
+	fanOn[0] = input.steer > 0 || (input.steer == 0 && input.accel);
+	fanOn[1] = input.steer < 0 || (input.steer == 0 && input.accel);
+	for (int side = 0; side < 2; side++)
+	{
+		if (!fanOn[side])
+		{
+			continue;
+		}
+		int count = particlesDue(exhaustRate * (0.4f + 0.6f * throttle) / 2, seconds);
+		for (int i = 0; i < count; i++)
+		{
+			float spread = vehicleWidth * 0.1f;
+			float local[3] = {fanPositions[side][0] + (nextRandom(&particleRandom) - 0.5f) * spread, fanPositions[side][1] + (nextRandom(&particleRandom) - 0.5f) * spread, fanPositions[side][2]};
+			float localVelocity[3] = {(nextRandom(&particleRandom) - 0.5f) * vehicleWidth, (nextRandom(&particleRandom) - 0.5f) * vehicleWidth, -vehicleWidth * (4 + nextRandom(&particleRandom) * 4)};
+			emitParticle(PARTICLES_EXHAUST, frame, local, localVelocity, seconds);
+		}
+	}
+
+	//The skirt always blows, but it kicks up more the faster we go
+	int count = particlesDue(sprayRate * (0.25f + 0.75f * throttle), seconds);
+	for (int i = 0; i < count; i++)
+	{
+		float around = nextRandom(&particleRandom) * 2 * M_PI;
+		float outX = cos(around);
+		float outZ = sin(around);
+		float local[3] = {skirtCentre[0] + outX * skirtRadius[0], skirtCentre[1], skirtCentre[2] + outZ * skirtRadius[1]};
+		float outward = vehicleWidth * (1.5f + nextRandom(&particleRandom) * 2);
+		float localVelocity[3] = {outX * outward, vehicleWidth * (1 + nextRandom(&particleRandom) * 2), outZ * outward};
+		emitParticle(PARTICLES_SPRAY, frame, local, localVelocity, seconds);
+	}
+}
+
+
+/*
+* Copies particles into part of a ring's buffer, which must be bound to GL_ARRAY_BUFFER. The slots are all long dead, so there's no need to wait for the GPU to finish with them.
+* Returns nothing.
+*/
+static void writeParticles(int slot, const Particle *particles, int count)
+{
+	GLintptr offset = (GLintptr)slot * sizeof(Particle);
+	GLsizeiptr bytes = (GLsizeiptr)count * sizeof(Particle);
+	currentStats.uploadBytes += bytes;
+
+	if (unsynchronisedWrites)
+	{
+		void *mapped = glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (mapped)
+		{
+			memcpy(mapped, particles, bytes);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+			return;
+		}
+	}
+	glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, particles);
+}
+
+
+/*
+* Writes a ring's new particles into its buffer, in two goes if they wrap around the end. The ring's buffer must be bound to GL_ARRAY_BUFFER.
+* Returns nothing.
+*/
+static void flushRing(ParticleRing *ring)
+{
+	int capacity = ring->deaths.size();
+	int count = ring->pending.size();
+	if (count == 0)
+	{
+		return;
+	}
+
+	int first = capacity - ring->pendingStart < count ? capacity - ring->pendingStart : count;
+	writeParticles(ring->pendingStart, &ring->pending[0], first);
+	if (count > first)
+	{
+		writeParticles(0, &ring->pending[first], count - first);
+	}
+
+	int end = ring->pendingStart + count;
+	if (end > ring->used)
+	{
+		ring->used = end < capacity ? end : capacity;
+	}
+	ring->pendingStart = end % capacity;
+	ring->pending.clear();
+}
+
+
+/*
+* Writes out this frame's new particles and draws every type with a single call each. Should be called with the camera's modelview matrix current, after everything solid has been drawn.
+* Returns nothing.
+*/
+void renderParticles(int viewportHeight, float fieldOfView)
+{
+	if (!particlesReady)
+	{
+		return;
+	}
+
+	//How many pixels across something one unit wide is, one unit in front of the camera
+	float pointScale = viewportHeight / (2 * tan(M_PI * fieldOfView / 360));
+
+	glUseProgram(particleProgram);
+	glUniform1f(timeUniform, (float)particleClock);
+	glUniform1f(pointScaleUniform, pointScale);
+
+	//Particles are see-through, so they shouldn't hide each other (or anything drawn after them)
+	glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+	glEnable(GL_POINT_SPRITE);
+	glEnable(GL_BLEND);
+	glDepthMask(GL_FALSE);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableVertexAttribArray(velocityAttribute);
+	glEnableVertexAttribArray(timingAttribute);
+
+	for (int t = 0; t < PARTICLE_TYPES; t++)
+	{
+		ParticleRing *ring = &rings[t];
+		const ParticleLook &look = particleLooks[t];
+
+		glBindBuffer(GL_ARRAY_BUFFER, ring->buffer);
+		flushRing(ring);
+		if (ring->used == 0)
+		{
+			continue;
+		}
+
+		float shape[3] = {look.startSize * vehicleWidth, look.endSize * vehicleWidth, look.drag};
+		glUniform3fv(accelerationUniform, 1, look.acceleration);
+		glUniform3fv(shapeUniform, 1, shape);
+		glUniform4fv(colourUniform, 1, look.colour);
+		glBlendFunc(look.blendSource, look.blendDestination);
+
+		glVertexPointer(3, GL_FLOAT, sizeof(Particle), (const GLvoid *)offsetof(Particle, position));
+		glVertexAttribPointer(velocityAttribute, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (const GLvoid *)offsetof(Particle, velocity));
+		glVertexAttribPointer(timingAttribute, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (const GLvoid *)offsetof(Particle, born));
+		glDrawArrays(GL_POINTS, 0, ring->used);
+		currentStats.drawn += ring->used;
+	}
+
+	glDisableVertexAttribArray(timingAttribute);
+	glDisableVertexAttribArray(velocityAttribute);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glDepthMask(GL_TRUE);
+	glDisable(GL_POINT_SPRITE);
+	glDisable(GL_VERTEX_PROGRAM_POINT_SIZE);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glUseProgram(0);
+
+	lastStats = currentStats;
+	memset(&currentStats, 0, sizeof(currentStats));
+}
+
+
+/*
+* Gets what the particles cost over the last whole frame.
+* Returns the statistics.
+*/
+ParticleStats getParticleStats()
+{
+	return lastStats;
+}
+
+
+/*
+* Frees the particle buffers and shader while we still have a GL context.
+* Returns nothing.
+*/
+void closeParticles()
+{
+	if (!particlesReady)
+	{
+		return;
+	}
+	for (int t = 0; t < PARTICLE_TYPES; t++)
+	{
+		glDeleteBuffers(1, &rings[t].buffer);
+		rings[t].buffer = 0;
+		vector<float>().swap(rings[t].deaths);
+		vector<Particle>().swap(rings[t].pending);
+	}
+	glDeleteProgram(particleProgram);
+	particleProgram = 0;
+	particlesReady = false;
+}
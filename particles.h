@@ -0,0 +1,53 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "mesh.h"
+#include "sim.h"
+
+//The kinds of particle we have. Each one is a ring of particles in its own buffer, drawn with a single call
+enum ParticleType
+{
+	//Air blown out the back of the fans
+	PARTICLES_EXHAUST,
+
+	//Spray kicked up around the hover skirt
+	PARTICLES_SPRAY,
+
+	PARTICLE_TYPES
+};
+
+//How many particles of each type can be alive at once (--particles). Zero turns them off
+extern int particleBudget;
+
+//What the particles cost over the last frame
+struct ParticleStats
+{
+	//Particles started this frame, which is the only per-particle work the CPU does
+	int emitted;
+
+	//Bytes written into the particle buffers this frame
+	size_t uploadBytes;
+
+	//Particles the GPU was asked to consider (living or not)
+	int drawn;
+};
+
+bool initParticles(const Mesh *fans, const Mesh *skirt);
+void updateParticles(float seconds);
+void emitVehicleParticles(const CarState &car, CarInput input, float seconds);
+void renderParticles(int viewportHeight, float fieldOfView);
+ParticleStats getParticleStats();
+void closeParticles();
+
+#endif
@@ -0,0 +1,31 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+//Anything made up from a seed (generated worlds and stress scenes, terrain bumps, benchmark setups, lost packets and particles) uses this instead of rand(), which isn't the same on every platform and shares one state between everything
+//Each user keeps its own state, which must never be 0
+
+
+/*
+* A small xorshift random number generator.
+* Returns a number from 0 up to (but not including) 1.
+*/
+inline float nextRandom(unsigned int *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return (*state & 0xffffff) / (float)0x1000000;
+}
+
+#endif
@@ -0,0 +1,531 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#include "replay.h"
+#include "framepacing.h"
+
+using namespace std;
+
+//Settings (from the command line)
+float replayMinutes = 5;
+
+//Which values follow a record's first byte. A keyframe has all of them, as changes from zero
+enum ReplayField
+{
+	REPLAY_X = 1,
+	REPLAY_Y = 2,
+	REPLAY_DIRECTION = 4,
+	REPLAY_SPEED = 8,
+	REPLAY_ROTX = 16,
+	REPLAY_ROTY = 32,
+	REPLAY_INPUT = 64
+};
+
+//How many of the values above are numbers (the input is packed into a byte of its own)
+static const int replayValues = 6;
+
+//How finely each value is kept. Speed and direction only ever change in steps of 0.0025 and 5 degrees, so those are exact, and the rest are much finer than anyone could see
+static const float replaySteps[replayValues] = {256.0f, 256.0f, 10.0f, 400.0f, 100.0f, 100.0f};
+
+//The biggest a record can be: the field byte, every value as a full five byte varint, and the input
+static const int replayMaxRecord = 1 + replayValues * 5 + 1;
+
+//A tick as it's kept in the buffer
+struct QuantisedFrame
+{
+	int values[replayValues];
+	int input;
+};
+
+//Where a full snapshot starts. Positions count every byte ever written, so they only go up (the buffer slot is the position modulo the capacity)
+struct ReplayKeyframe
+{
+	int tick;
+	long long position;
+};
+
+//Where the last seek got to, so that playing forwards only has to read the next few records
+struct ReplayCursor
+{
+	bool valid;
+	int tick;
+	long long position;
+	QuantisedFrame frame;
+};
+
+//The recording. The bytes are a ring, and so are the keyframes (the oldest ones go when their bytes are written over or they're more than replayMinutes old)
+static vector<unsigned char> buffer;
+static long long writePosition = 0;
+static vector<ReplayKeyframe> keyframes;
+static int keyframeFirst = 0;
+static int keyframeCount = 0;
+static int newestTick = -1;
+static int maxTicks = 0;
+static QuantisedFrame lastFrame;
+static ReplayCursor cursor;
+
+//Playback
+static bool replaying = false;
+static double playTick = 0;
+static const float replaySpeeds[] = {-16, -8, -4, -2, -1, -0.5f, -0.25f, 0, 0.25f, 0.5f, 1, 2, 4, 8, 16};
+static const int replaySpeedCount = sizeof(replaySpeeds) / sizeof(replaySpeeds[0]);
+static const int replayPausedSpeed = 7;
+static const int replayRewindSpeed = 4;
+static int speedIndex = replayRewindSpeed;
+static int unpausedSpeedIndex = replayRewindSpeed;
+
+//Seek timing
+static long seekCount = 0;
+static Uint64 seekTotal = 0;
+static Uint64 seekMax = 0;
+
+
+/*
+* Rounds a frame to the steps it's recorded in (replaySteps), and packs the input into the bits of a byte.
+* Returns the rounded frame.
+*/
+static QuantisedFrame quantiseFrame(const ReplayFrame &frame)
+{
+	float values[replayValues] = {frame.car.x, frame.car.y, frame.car.direction, frame.car.speed, frame.rotX, frame.rotY};
+	QuantisedFrame quantised;
+	for (int i = 0; i < replayValues; i++)
+	{
+		quantised.values[i] = (int)lroundf(values[i] * replaySteps[i]);
+	}
+	quantised.input = (frame.input.steer + 1) | (frame.input.accel ? 4 : 0) | (frame.input.brake ? 8 : 0);
+	return quantised;
+}
+
+
+/*
+* Turns a recorded frame back into one that can be shown.
+* Returns the frame.
+*/
+static ReplayFrame dequantiseFrame(const QuantisedFrame &quantised)
+{
+	ReplayFrame frame;
+	frame.car.x = quantised.values[0] / replaySteps[0];
+	frame.car.y = quantised.values[1] / replaySteps[1];
+	frame.car.direction = quantised.values[2] / replaySteps[2];
+	frame.car.speed = quantised.values[3] / replaySteps[3];
+	frame.rotX = quantised.values[4] / replaySteps[4];
+	frame.rotY = quantised.values[5] / replaySteps[5];
+	frame.input.steer = (quantised.input & 3) - 1;
+	frame.input.accel = (quantised.input & 4) != 0;
+	frame.input.brake = (quantised.input & 8) != 0;
+	return frame;
+}
+
+
+/*
+* Writes a byte at the end of the recording, going around to the start of the buffer (over the oldest bytes) when it gets to the end.
+* Returns nothing.
+*/
+static void writeByte(unsigned int value)
+{
+	buffer[writePosition % buffer.size()] = value;
+	writePosition++;
+}
+
+
+/*
+* Writes a signed number seven bits at a time, zigzagged so that small changes either way take a single byte.
+* Returns nothing.
+*/
+static void writeSigned(int value)
+{
+	unsigned int zigzag = ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+	while (zigzag >= 0x80)
+	{
+		writeByte((zigzag & 0x7F) | 0x80);
+		zigzag >>= 7;
+	}
+	writeByte(zigzag);
+}
+
+
+/*
+* Reads a byte of the recording and moves the position on past it.
+* Returns the byte.
+*/
+static unsigned int readByte(long long *position)
+{
+	return buffer[(*position)++ % buffer.size()];
+}
+
+
+/*
+* Reads a number written by writeSigned() and moves the position on past it.
+* Returns the number.
+*/
+static int readSigned(long long *position)
+{
+	unsigned int zigzag = 0;
+	int shift = 0;
+	unsigned int byte;
+	do
+	{
+		byte = readByte(position);
+		zigzag |= (byte & 0x7F) << shift;
+		shift += 7;
+	} while ((byte & 0x80) && shift < 35);
+	return (int)(zigzag >> 1) ^ -(int)(zigzag & 1);
+}
+
+
+/*
+* Reads one record and applies its changes.
+* Returns nothing.
+*/
+static void readRecord(long long *position, QuantisedFrame *frame)
+{
+	int fields = readByte(position);
+	for (int i = 0; i < replayValues; i++)
+	{
+		if (fields & (1 << i))
+		{
+			frame->values[i] += readSigned(position);
+		}
+	}
+	if (fields & REPLAY_INPUT)
+	{
+		frame->input = readByte(position);
+	}
+}
+
+
+/*
+* Finds a keyframe by how far it is from the oldest one we still have.
+* Returns the keyframe.
+*/
+static ReplayKeyframe &keyframeAt(int index)
+{
+	return keyframes[(keyframeFirst + index) % keyframes.size()];
+}
+
+
+/*
+* Sets aside the memory for replayMinutes of driving. Nothing else is allocated while recording or playing back, so it's cheap enough to leave on all the time.
+* Returns true if recording is on.
+*/
+bool replayInit()
+{
+	replayClose();
+	if (replayMinutes <= 0)
+	{
+		return false;
+	}
+
+	//There always has to be room for a couple of whole keyframe intervals, or the newest keyframe could get written over
+	maxTicks = (int)(replayMinutes * 60 * simTickRate);
+	maxTicks = (maxTicks < replayKeyframeInterval * 2) ? replayKeyframeInterval * 2 : maxTicks;
+	size_t capacity = (size_t)maxTicks * replayBytesPerTick;
+	capacity = (capacity < (size_t)replayKeyframeInterval * replayMaxRecord * 2) ? (size_t)replayKeyframeInterval * replayMaxRecord * 2 : capacity;
+
+	buffer.assign(capacity, 0);
+	keyframes.resize(maxTicks / replayKeyframeInterval + 3);
+	return true;
+}
+
+
+/*
+* Throws away the recording and frees its memory.
+* Returns nothing.
+*/
+void replayClose()
+{
+	vector<unsigned char>().swap(buffer);
+	vector<ReplayKeyframe>().swap(keyframes);
+	writePosition = 0;
+	keyframeFirst = 0;
+	keyframeCount = 0;
+	newestTick = -1;
+	cursor.valid = false;
+	replaying = false;
+}
+
+
+/*
+* Adds a simulation tick to the recording, as the changes from the tick before (or in full every replayKeyframeInterval ticks). This should be called once for every tick.
+* Returns nothing.
+*/
+void replayRecord(const ReplayFrame &frame)
+{
+	if (buffer.empty() || replaying)
+	{
+		return;
+	}
+
+	QuantisedFrame quantised = quantiseFrame(frame);
+	int tick = newestTick + 1;
+	QuantisedFrame from = lastFrame;
+	int fields = 0;
+	if (keyframeCount == 0 || tick - keyframeAt(keyframeCount - 1).tick >= replayKeyframeInterval)
+	{
+		ReplayKeyframe keyframe = {tick, writePosition};
+		keyframeAt(keyframeCount++) = keyframe;
+		from = QuantisedFrame();
+		fields = REPLAY_INPUT;
+		for (int i = 0; i < replayValues; i++)
+		{
+			fields |= 1 << i;
+		}
+	}
+	else
+	{
+		for (int i = 0; i < replayValues; i++)
+		{
+			fields |= (quantised.values[i] != from.values[i]) ? 1 << i : 0;
+		}
+		fields |= (quantised.input != from.input) ? REPLAY_INPUT : 0;
+	}
+
+	writeByte(fields);
+	for (int i = 0; i < replayValues; i++)
+	{
+		if (fields & (1 << i))
+		{
+			writeSigned(quantised.values[i] - from.values[i]);
+		}
+	}
+	if (fields & REPLAY_INPUT)
+	{
+		writeByte(quantised.input);
+	}
+	lastFrame = quantised;
+	newestTick = tick;
+
+	//Let go of the oldest second once its bytes have been written over or we've got more than enough without it
+	while (keyframeCount > 1 && (keyframeAt(0).position + (long long)buffer.size() < writePosition || newestTick - keyframeAt(1).tick >= maxTicks))
+	{
+		keyframeFirst = (keyframeFirst + 1) % keyframes.size();
+		keyframeCount--;
+	}
+}
+
+
+/*
+* Gets the oldest tick that can still be seeked to.
+* Returns the tick, or -1 if nothing has been recorded.
+*/
+int replayOldestTick()
+{
+	return (keyframeCount > 0) ? keyframeAt(0).tick : -1;
+}
+
+
+/*
+* Gets the newest tick that's been recorded.
+* Returns the tick, or -1 if nothing has been recorded.
+*/
+int replayNewestTick()
+{
+	return (keyframeCount > 0) ? newestTick : -1;
+}
+
+
+/*
+* Works out what things looked like at a tick, starting from the keyframe before it or carrying on from the last seek if that's closer.
+* Returns true if the tick is in the recording.
+*/
+bool replaySeek(int tick, ReplayFrame *frame)
+{
+	if (keyframeCount == 0 || tick < replayOldestTick() || tick > newestTick)
+	{
+		return false;
+	}
+
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	//Keyframes are exactly replayKeyframeInterval ticks apart, so finding the right one is just a division
+	const ReplayKeyframe &keyframe = keyframeAt((tick - keyframeAt(0).tick) / replayKeyframeInterval);
+	if (!cursor.valid || cursor.tick > tick || cursor.tick < keyframe.tick)
+	{
+		cursor.valid = true;
+		cursor.tick = keyframe.tick - 1;
+		cursor.position = keyframe.position;
+		cursor.frame = QuantisedFrame();
+	}
+	while (cursor.tick < tick)
+	{
+		readRecord(&cursor.position, &cursor.frame);
+		cursor.tick++;
+	}
+	*frame = dequantiseFrame(cursor.frame);
+
+	Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+	seekCount++;
+	seekTotal += elapsed;
+	seekMax = (elapsed > seekMax) ? elapsed : seekMax;
+	return true;
+}
+
+
+/*
+* Forgets everything after a tick, so that recording carries on from there (for taking over from a replay).
+* Returns nothing.
+*/
+void replayTruncate(int tick)
+{
+	ReplayFrame frame;
+	if (!replaySeek(tick, &frame))
+	{
+		return;
+	}
+
+	writePosition = cursor.position;
+	newestTick = tick;
+	lastFrame = cursor.frame;
+	while (keyframeCount > 1 && keyframeAt(keyframeCount - 1).tick > tick)
+	{
+		keyframeCount--;
+	}
+}
+
+
+/*
+* Stops recording and starts playing the recording back, rewinding from the newest tick.
+* Returns true if there was anything to play back.
+*/
+bool startReplay()
+{
+	if (keyframeCount == 0)
+	{
+		return false;
+	}
+	replaying = true;
+	playTick = newestTick;
+	speedIndex = replayRewindSpeed;
+	unpausedSpeedIndex = replayRewindSpeed;
+	return true;
+}
+
+
+/*
+* Stops playing back and goes back to recording from wherever playback got to. Anything after that is forgotten.
+* Returns nothing.
+*/
+void stopReplay()
+{
+	if (!replaying)
+	{
+		return;
+	}
+	replaying = false;
+	replayTruncate((int)playTick);
+}
+
+
+/*
+* Checks whether we're playing back rather than recording.
+* Returns true if we're playing back.
+*/
+bool isReplaying()
+{
+	return replaying;
+}
+
+
+/*
+* Moves playback along by some simulation ticks' worth of time at the current speed, stopping at either end of the recording.
+* Returns true if there's a frame to show.
+*/
+bool advanceReplay(int simTicks, ReplayFrame *frame)
+{
+	if (!replaying)
+	{
+		return false;
+	}
+
+	playTick += replaySpeeds[speedIndex] * simTicks;
+	playTick = (playTick < replayOldestTick()) ? replayOldestTick() : playTick;
+	playTick = (playTick > newestTick) ? newestTick : playTick;
+	return replaySeek((int)playTick, frame);
+}
+
+
+/*
+* Plays back faster or slower (or rewinds faster or slower), by some number of steps through the speeds we have.
+* Returns nothing.
+*/
+void changeReplaySpeed(int steps)
+{
+	speedIndex += steps;
+	speedIndex = (speedIndex < 0) ? 0 : speedIndex;
+	speedIndex = (speedIndex >= replaySpeedCount) ? replaySpeedCount - 1 : speedIndex;
+	if (speedIndex != replayPausedSpeed)
+	{
+		unpausedSpeedIndex = speedIndex;
+	}
+}
+
+
+/*
+* Pauses playback, or carries on at the speed it was going before it was paused.
+* Returns nothing.
+*/
+void toggleReplayPause()
+{
+	speedIndex = (speedIndex == replayPausedSpeed) ? unpausedSpeedIndex : replayPausedSpeed;
+}
+
+
+/*
+* Skips playback to the start or the end of the recording.
+* Returns nothing.
+*/
+void jumpReplay(bool toNewest)
+{
+	playTick = toNewest ? replayNewestTick() : replayOldestTick();
+}
+
+
+/*
+* Gets how fast playback is going, as a multiple of real time (negative when it's rewinding).
+* Returns the speed.
+*/
+float getReplaySpeed()
+{
+	return replaySpeeds[speedIndex];
+}
+
+
+/*
+* Gets how far behind the end of the recording playback is.
+* Returns the number of seconds.
+*/
+float getReplaySecondsBehind()
+{
+	return (newestTick - (int)playTick) / (float)simTickRate;
+}
+
+
+/*
+* Gets how much is recorded, what it's costing and how long seeks take.
+* Returns the statistics.
+*/
+ReplayStats getReplayStats()
+{
+	ReplayStats stats;
+	stats.minutes = (keyframeCount > 0) ? (newestTick - replayOldestTick() + 1) / (60.0f * simTickRate) : 0;
+	stats.bytes = (keyframeCount > 0) ? (int)(writePosition - keyframeAt(0).position) : 0;
+	stats.capacity = (int)(buffer.size() + keyframes.size() * sizeof(ReplayKeyframe));
+	stats.bytesPerMinute = (stats.minutes > 0) ? stats.bytes / stats.minutes : 0;
+	stats.seeks = seekCount;
+	stats.seekAverageUs = seekCount ? (float)((double)seekTotal * 1000000 / SDL_GetPerformanceFrequency() / seekCount) : 0;
+	stats.seekMaxUs = (float)((double)seekMax * 1000000 / SDL_GetPerformanceFrequency());
+	return stats;
+}
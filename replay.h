@@ -0,0 +1,68 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "sim.h"
+
+//How many minutes of driving are kept for rewinding and replaying (from the command line). Zero turns recording off
+extern float replayMinutes;
+
+//How many ticks apart the full snapshots that seeking starts from are (one a second), so that a seek never has to go through more than this many changes
+const int replayKeyframeInterval = 60;
+
+//Memory is set aside for this many bytes a tick. Driving along while looking around takes under half of it
+const int replayBytesPerTick = 16;
+
+//Everything that's needed to show one simulation tick again
+struct ReplayFrame
+{
+	CarState car;
+	CarInput input;
+	float rotX;
+	float rotY;
+};
+
+//What recording costs and how quickly we can get back to any point in it
+struct ReplayStats
+{
+	//How much driving is in the buffer, the bytes it takes up and the bytes set aside for it
+	float minutes;
+	int bytes;
+	int capacity;
+	float bytesPerMinute;
+
+	//Seeks since we started, and how long they took
+	long seeks;
+	float seekAverageUs;
+	float seekMaxUs;
+};
+
+bool replayInit();
+void replayClose();
+void replayRecord(const ReplayFrame &frame);
+int replayOldestTick();
+int replayNewestTick();
+bool replaySeek(int tick, ReplayFrame *frame);
+void replayTruncate(int tick);
+bool startReplay();
+void stopReplay();
+bool isReplaying();
+bool advanceReplay(int simTicks, ReplayFrame *frame);
+void changeReplaySpeed(int steps);
+void toggleReplayPause();
+void jumpReplay(bool toNewest);
+float getReplaySpeed();
+float getReplaySecondsBehind();
+ReplayStats getReplayStats();
+
+#endif
@@ -0,0 +1,339 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_opengl.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "resolution.h"
+#include "glstats.h"
+
+//Settings (from the command line)
+bool dynamicResolution = false;
+float targetFrameTimeMs = 14.0f;
+float minRenderScale = 0.5f;
+
+//The size of the window, which is also the largest our offscreen buffer will ever need to be
+static int fullWidth = 0;
+static int fullHeight = 0;
+
+//The offscreen buffer that the scene gets rendered into
+static GLuint sceneFramebuffer = 0;
+static GLuint sceneColour = 0;
+static GLuint sceneDepth = 0;
+
+//The current scale, and the steps we move it in (changing the size by a pixel here and there every frame would just make things shimmer)
+static float renderScale = 1.0f;
+const float renderScaleStep = 0.05f;
+
+//Timer queries for measuring how long the GPU spends on the scene. We keep a few in flight and read back the oldest so that we never have to wait on the GPU
+const int sceneQueryCount = 4;
+static GLuint sceneQueries[sceneQueryCount];
+static bool sceneQueryIssued[sceneQueryCount];
+static int sceneQueryIndex = 0;
+static bool haveTimerQueries = false;
+
+//If we don't have timer queries, we fall back to timing whole frames on the CPU (which only tells us anything useful when vsync is off)
+static Uint64 lastFrameTime = 0;
+
+//The most recent measurement and how many frames in a row it's been outside our comfort zone
+static float sceneTimeMs = 0;
+static int framesOver = 0;
+static int framesUnder = 0;
+
+
+/*
+* Creates the offscreen buffer and timer queries that dynamic resolution needs.
+* Returns true if everything is ready to go, or false if the GL doesn't support it (in which case we carry on rendering straight to the window).
+*/
+bool initDynamicResolution(int width, int height)
+{
+	fullWidth = width;
+	fullHeight = height;
+
+	if (!dynamicResolution)
+	{
+		return false;
+	}
+
+	//Framebuffer objects are core in GL 3.0, and available as an extension on most 2.1 drivers
+	if (!(GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object))
+	{
+		printf("No framebuffer objects, so no dynamic resolution\n");
+		dynamicResolution = false;
+		return false;
+	}
+
+	//Make a colour texture the size of the window. We'll only ever render into the bottom left corner of it
+	glGenTextures(1, &sceneColour);
+	glBindTexture(GL_TEXTURE_2D, sceneColour);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	//And a depth buffer to go with it
+	glGenRenderbuffers(1, &sceneDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, sceneDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	//Tie them together into a framebuffer and check that the driver is happy with it
+	glGenFramebuffers(1, &sceneFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sceneColour, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, sceneDepth);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		printf("Error whilst creating scene framebuffer: 0x%x\n", status);
+		closeDynamicResolution();
+		dynamicResolution = false;
+		return false;
+	}
+
+	//Timer queries tell us how long the GPU actually took, rather than how long we waited for it
+	haveTimerQueries = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+	if (haveTimerQueries)
+	{
+		glGenQueries(sceneQueryCount, sceneQueries);
+		for (int i = 0; i < sceneQueryCount; i++)
+		{
+			sceneQueryIssued[i] = false;
+		}
+	}
+	else
+	{
+		printf("No timer queries, so dynamic resolution will go by frame time instead (this works best with vsync off)\n");
+	}
+
+	printf("Dynamic resolution: aiming for %.1fms, scaling down to %.0f%% at most\n", targetFrameTimeMs, minRenderScale * 100);
+	return true;
+}
+
+
+/*
+* Nudges the render scale up or down based on the last scene time measurement.
+* We only drop the scale once we've been over budget for a couple of frames, and only raise it again after a long run of frames comfortably under budget, so that it doesn't flip back and forth.
+* Returns nothing.
+*/
+static void updateRenderScale()
+{
+	float oldScale = renderScale;
+
+	if (sceneTimeMs > targetFrameTimeMs)
+	{
+		framesUnder = 0;
+		framesOver++;
+		if (framesOver >= 2)
+		{
+			//The GPU time is roughly proportional to the number of pixels, so scale each side by the square root of how far over we are
+			float scale = renderScale * sqrt(targetFrameTimeMs * 0.9f / sceneTimeMs);
+			scale = floor(scale / renderScaleStep) * renderScaleStep;
+			renderScale = (scale < renderScale - renderScaleStep) ? scale : renderScale - renderScaleStep;
+			framesOver = 0;
+		}
+	}
+	else if (sceneTimeMs < targetFrameTimeMs * 0.7f)
+	{
+		framesOver = 0;
+		framesUnder++;
+		if (framesUnder >= 30)
+		{
+			renderScale += renderScaleStep;
+			framesUnder = 0;
+		}
+	}
+	else
+	{
+		framesOver = 0;
+		framesUnder = 0;
+	}
+
+	if (renderScale < minRenderScale)
+	{
+		renderScale = minRenderScale;
+	}
+	else if (renderScale > 1.0f)
+	{
+		renderScale = 1.0f;
+	}
+
+	if (renderScale != oldScale)
+	{
+		printf("Dynamic resolution: %.1fms against %.1fms target, scale %.0f%% -> %.0f%%\n", sceneTimeMs, targetFrameTimeMs, oldScale * 100, renderScale * 100);
+	}
+}
+
+
+/*
+* Points rendering at wherever the scene should go this frame, and sets the viewport to match.
+* Returns nothing.
+*/
+void beginSceneRender()
+{
+	if (!dynamicResolution)
+	{
+		//Bind our rendering to the primary framebuffer and tell OpenGL to render to the entire window
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, fullWidth, fullHeight);
+		return;
+	}
+
+	//Pick up the oldest timing result if it's ready. If it isn't, we just skip adjusting this frame rather than waiting
+	if (haveTimerQueries)
+	{
+		int oldest = (sceneQueryIndex + 1) % sceneQueryCount;
+		if (sceneQueryIssued[oldest])
+		{
+			GLint available = 0;
+			glGetQueryObjectiv(sceneQueries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available)
+			{
+				GLuint64 elapsed = 0;
+				glGetQueryObjectui64v(sceneQueries[oldest], GL_QUERY_RESULT, &elapsed);
+				sceneQueryIssued[oldest] = false;
+				sceneTimeMs = elapsed / 1000000.0f;
+				updateRenderScale();
+			}
+		}
+	}
+	else
+	{
+		Uint64 now = SDL_GetPerformanceCounter();
+		if (lastFrameTime != 0)
+		{
+			sceneTimeMs = (float)((now - lastFrameTime) * 1000.0 / SDL_GetPerformanceFrequency());
+			updateRenderScale();
+		}
+		lastFrameTime = now;
+	}
+
+	//Render into the bottom left corner of our offscreen buffer
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+	glViewport(0, 0, (int)(fullWidth * renderScale), (int)(fullHeight * renderScale));
+
+	if (haveTimerQueries)
+	{
+		sceneQueryIndex = (sceneQueryIndex + 1) % sceneQueryCount;
+		glBeginQuery(GL_TIME_ELAPSED, sceneQueries[sceneQueryIndex]);
+	}
+}
+
+
+/*
+* Finishes off the scene and, if it went to our offscreen buffer, stretches it over the whole window. The HUD should be drawn after this so that it stays at full resolution.
+* Returns nothing.
+*/
+void endSceneRender()
+{
+	if (!dynamicResolution)
+	{
+		return;
+	}
+
+	if (haveTimerQueries)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		sceneQueryIssued[sceneQueryIndex] = true;
+	}
+
+	//Back to the window
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, fullWidth, fullHeight);
+
+	//Draw a single quad over the whole window with the part of the texture that we rendered into
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0.0, 1.0, 0.0, 1.0, -1.0, 1.0);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_BLEND);
+	glColor3ub(255, 255, 255);
+	glBindTexture(GL_TEXTURE_2D, sceneColour);
+
+	float u = (float)(int)(fullWidth * renderScale) / fullWidth;
+	float v = (float)(int)(fullHeight * renderScale) / fullHeight;
+	glBegin(GL_QUADS);
+		glTexCoord2f(0, 0); glVertex2f(0, 0);
+		glTexCoord2f(u, 0); glVertex2f(1, 0);
+		glTexCoord2f(u, v); glVertex2f(1, 1);
+		glTexCoord2f(0, v); glVertex2f(0, 1);
+	glEnd();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glEnable(GL_BLEND);
+	glEnable(GL_LIGHTING);
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+}
+
+
+/*
+* Gets the fraction of the window's width and height that the scene is currently being rendered at.
+* Returns the scale (1 when dynamic resolution is off).
+*/
+float getRenderScale()
+{
+	return dynamicResolution ? renderScale : 1.0f;
+}
+
+
+/*
+* Gets the most recent measurement of how long the scene took to render.
+* Returns the time in milliseconds (0 if we haven't measured it).
+*/
+float getSceneTimeMs()
+{
+	return sceneTimeMs;
+}
+
+
+/*
+* Frees the offscreen buffer and timer queries.
+* Returns nothing.
+*/
+void closeDynamicResolution()
+{
+	if (haveTimerQueries)
+	{
+		glDeleteQueries(sceneQueryCount, sceneQueries);
+		haveTimerQueries = false;
+	}
+	if (sceneFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &sceneFramebuffer);
+		sceneFramebuffer = 0;
+	}
+	if (sceneDepth != 0)
+	{
+		glDeleteRenderbuffers(1, &sceneDepth);
+		sceneDepth = 0;
+	}
+	if (sceneColour != 0)
+	{
+		glDeleteTextures(1, &sceneColour);
+		sceneColour = 0;
+	}
+}
@@ -0,0 +1,31 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+//Whether we render the scene into an offscreen buffer whose resolution adapts to hold a frame time budget
+extern bool dynamicResolution;
+
+//The GPU time we're aiming to keep the scene under, in milliseconds
+extern float targetFrameTimeMs;
+
+//The smallest fraction of the window's width and height that we'll drop the scene to
+extern float minRenderScale;
+
+bool initDynamicResolution(int width, int height);
+void beginSceneRender();
+void endSceneRender();
+float getRenderScale();
+float getSceneTimeMs();
+void closeDynamicResolution();
+
+#endif
@@ -0,0 +1,73 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include "sim.h"
+#include <math.h>
+
+
+/*
+* Moves a vehicle along by one simulation tick (see simTickRate). Everything that drives a vehicle, whether it's ours, someone else's over the network or a prediction of where ours will end up, goes through here so that they all handle the same.
+* Returns nothing.
+*/
+void stepCar(CarState *car, CarInput input)
+{
+	//Steering will be a negative number for right, positive number for left. If we're going straight, then input.steer will be zero and there'll be no change
+	car->direction += 5.0f * input.steer;
+	
+	//Adjust orientation to fit within 0 - 360 degrees
+	if (car->direction > 360)
+	{
+		car->direction = fmod(car->direction, 360.0f);
+	}
+	else if (car->direction < 0)
+	{
+		car->direction = 360.0f - car->direction;
+	}
+
+	//If we're braking, slow us down nice and quick
+	if (input.brake)
+	{
+		car->speed -= 0.01f;
+		if (car->speed < 0)
+		{
+			car->speed = 0.0f;
+		}	
+	}
+	//If we're accelerating, speed us up quickfast (node that this increases our speed over time rather than jumping instantly to top speed)
+	else if (input.accel)
+	{
+		car->speed += 0.01f;
+		if (car->speed > 0.25f)
+		{
+			car->speed = 0.25f;
+		}
+	}
+	//If we're not braking or accelerating, let's slow down by a tiny amount to give the impression of drag
+	else if (car->speed > 0.02f)
+	{
+		car->speed -= 0.0025f;
+		
+		//This if is unnecessary, but if we ever applied drag when car->speed was below 0.0025, we'd end up moving backwards, so we'd need this check
+		if (car->speed < 0)
+		{
+			car->speed = 0.0f;
+		}
+	}
+
+	//Yay, trigonometry! What we're calculating is the distance that the vehicle has traveled from 0,0 (world origin) along each axis since the last frame
+	//cos() and sin() take stuff in radians, so we're doing the conversion from degrees inline
+	float dy = cos((M_PI * car->direction) / 180) * car->speed;
+	float dx = sin((M_PI * car->direction) / 180) * car->speed;
+
+	//Add these new distances to the car's current position
+	car->x += dx;	
+	car->y += dy;	
+}
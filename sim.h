@@ -0,0 +1,38 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef SIM_H
+#define SIM_H
+
+//What the driver is asking the vehicle to do for one simulation tick
+struct CarInput
+{
+	//Negative for right, positive for left, zero for straight ahead
+	int steer;
+	bool accel;
+	bool brake;
+};
+
+//Where a vehicle is and how it's moving
+struct CarState
+{
+	float x;
+	float y;
+	float direction;
+	float speed;
+};
+
+//How high above the world's origin vehicles hover (they all ride at the same height)
+const float carHoverHeight = -1.8f;
+
+void stepCar(CarState *car, CarInput input);
+
+#endif
@@ -0,0 +1,364 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <list>
+#include <vector>
+
+#include "random.h"
+#include "stress.h"
+#include "terrain.h"
+
+using namespace std;
+
+//Settings (from the command line)
+int stressBuildings = 0;
+int stressTrees = 0;
+int stressHills = 0;
+float flyThroughSeconds = 0;
+
+//Trees are packed about as densely as the streamed world's chunks have them
+static const int treesPerCell = 40;
+
+//How many points the fly-through loop goes through
+static const int flyThroughPoints = 12;
+
+//The fly-through never looks further up or down than this (the mouse is held to 60 degrees either way)
+static const float flyThroughMaxPitch = 55.0f;
+
+//The most frames a fly-through report keeps times for each second, so that the list can be set aside before it starts
+static const int flyThroughMaxFps = 1000;
+
+//The fly-through report as it goes
+static StressScene reportScene;
+static float reportSeconds = 0;
+static vector<float> reportFrameMs;
+static Uint64 reportStart = 0;
+static Uint64 reportLastFrame = 0;
+static int reportFrames = 0;
+static double reportObjects = 0;
+static double reportTriangles = 0;
+
+
+/*
+* Places a scene of buildings, trees and hills from a seed, on a square of ground tiles big enough to keep them about as far apart as they are in the streamed world however many there are.
+* Buildings and hills get a cell of their own (no more than half of the cells, so there's room left for trees), trees go anywhere in the other cells, and the cell in the middle is left empty for the car.
+* Returns what ended up in the scene.
+*/
+StressScene generateStressScene(list<GameObject> &objects, int buildings, int trees, int hills, unsigned int seed)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	StressScene scene;
+	scene.seed = seed;
+	scene.buildings = buildings;
+	scene.trees = trees;
+	scene.hills = hills;
+
+	//An odd number of cells across, so that there's one in the middle
+	int cellsNeeded = max((buildings + hills) * 2, (trees + treesPerCell - 1) / treesPerCell) + 1;
+	int across = (int)ceil(sqrt((double)cellsNeeded));
+	across += (across % 2 == 0) ? 1 : 0;
+	int half = across / 2;
+	int cellCount = across * across;
+	int middle = half * across + half;
+	scene.size = across * stressCellSize;
+	scene.groundTiles = cellCount;
+
+	SDL_Colour grey = {128, 128, 128, 255};
+	SDL_Colour green = {60, 128, 60, 255};
+	unsigned int state = seed ? seed : 1;
+
+	//Every cell gets a ground tile (hill.obj, despite the name), unless the terrain is standing in for the ground like it does for the built in scenery
+	if (terrainActive())
+	{
+		scene.groundTiles = 0;
+	}
+	else
+	{
+		for (int cy = -half; cy <= half; cy++)
+		{
+			for (int cx = -half; cx <= half; cx++)
+			{
+				objects.push_back(loadObj("hill.obj", grey, cx * stressCellSize, cy * stressCellSize, 0));
+			}
+		}
+	}
+
+	//Shuffle the cells (all but the middle one) and hand the first few out to the buildings and hills
+	vector<int> cells;
+	cells.reserve(cellCount - 1);
+	for (int i = 0; i < cellCount; i++)
+	{
+		if (i != middle)
+		{
+			cells.push_back(i);
+		}
+	}
+	int taken = buildings + hills;
+	for (int i = 0; i < taken; i++)
+	{
+		int pick = i + (int)(nextRandom(&state) * (cells.size() - i));
+		swap(cells[i], cells[pick]);
+
+		//The building and hill models sit off to one side of their origin, so shift them back into the middle of the cell like generateWorld() does
+		float x = (cells[i] % across - half) * stressCellSize;
+		float y = (cells[i] / across - half) * stressCellSize;
+		if (i < buildings)
+		{
+			objects.push_back(loadObj("buildings.obj", grey, x + 192.0f, y - 23.0f, 0));
+		}
+		else
+		{
+			objects.push_back(loadObj("ground.obj", grey, x - 266.0f, y - 15.0f, 0));
+		}
+	}
+
+	//Scatter the trees over whichever cells are left
+	int freeCells = (int)cells.size() - taken;
+	for (int i = 0; i < trees; i++)
+	{
+		int cell = cells[taken + (int)(nextRandom(&state) * freeCells)];
+		float x = (cell % across - half + nextRandom(&state) - 0.5f) * stressCellSize;
+		float y = (cell / across - half + nextRandom(&state) - 0.5f) * stressCellSize;
+		objects.push_back(loadObj("tree.obj", green, x, y, nextRandom(&state) * 360.0f));
+	}
+
+	scene.milliseconds = (float)((double)(SDL_GetPerformanceCounter() - start) * 1000 / SDL_GetPerformanceFrequency());
+	printf("Stress scene (seed %u): %d buildings, %d trees, %d hills and %d ground tiles over %.0f units square, placed in %.0fms\n", seed, buildings, trees, hills, scene.groundTiles, scene.size, scene.milliseconds);
+
+	return scene;
+}
+
+
+/*
+* Makes a loop for the camera to fly around a scene, weaving in and out from the middle and up and down between the treetops and well above the buildings. The same scene always gets the same loop.
+* Returns the path.
+*/
+FlyThroughPath makeFlyThrough(const StressScene &scene, float seconds)
+{
+	FlyThroughPath path;
+	path.seconds = seconds;
+	unsigned int state = (scene.seed ? scene.seed : 1) * 2654435761u;
+	state = state ? state : 1;
+
+	//Go once around the middle, somewhere between a tenth and two fifths of the way out to the edge
+	for (int k = 0; k < flyThroughPoints; k++)
+	{
+		float angle = (k + (nextRandom(&state) - 0.5f) * 0.6f) * 2 * (float)M_PI / flyThroughPoints;
+		float radius = scene.size * (0.1f + 0.3f * nextRandom(&state));
+		float height = nextRandom(&state);
+
+		FlyThroughPose point;
+		point.x = cos(angle) * radius;
+		point.y = sin(angle) * radius;
+		point.height = 2.0f + 100.0f * height * height;
+		point.heading = 0;
+		point.pitch = 0;
+		path.points.push_back(point);
+	}
+
+	//Share the time out by how far apart the points are
+	float total = 0;
+	path.times.push_back(0);
+	for (int k = 0; k < flyThroughPoints; k++)
+	{
+		const FlyThroughPose &a = path.points[k];
+		const FlyThroughPose &b = path.points[(k + 1) % flyThroughPoints];
+		total += sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y) + (b.height - a.height) * (b.height - a.height));
+		path.times.push_back(total);
+	}
+	for (int k = 0; k <= flyThroughPoints; k++)
+	{
+		path.times[k] *= seconds / total;
+	}
+
+	return path;
+}
+
+
+/*
+* Works out one coordinate (and how fast it's changing) on a Catmull-Rom spline through four points, u of the way from the second to the third.
+* Returns nothing.
+*/
+static void catmullRom(float p0, float p1, float p2, float p3, float u, float *value, float *slope)
+{
+	float a = -p0 + 3 * p1 - 3 * p2 + p3;
+	float b = 2 * p0 - 5 * p1 + 4 * p2 - p3;
+	float c = -p0 + p2;
+	*value = 0.5f * (((a * u + b) * u + c) * u + 2 * p1);
+	*slope = 0.5f * ((3 * a * u + 2 * b) * u + c);
+}
+
+
+/*
+* Works out where the camera is on a fly-through after some number of seconds (going around again once it gets to the end), looking the way it's going and a little down.
+* Returns the pose.
+*/
+FlyThroughPose flyThroughAt(const FlyThroughPath &path, float seconds)
+{
+	int n = (int)path.points.size();
+	float t = fmod(seconds, path.seconds);
+	t = (t < 0) ? t + path.seconds : t;
+	int k = 0;
+	while (k < n - 1 && t >= path.times[k + 1])
+	{
+		k++;
+	}
+	float span = path.times[k + 1] - path.times[k];
+	float u = (span > 0) ? (t - path.times[k]) / span : 0;
+
+	const FlyThroughPose &p0 = path.points[(k + n - 1) % n];
+	const FlyThroughPose &p1 = path.points[k];
+	const FlyThroughPose &p2 = path.points[(k + 1) % n];
+	const FlyThroughPose &p3 = path.points[(k + 2) % n];
+	FlyThroughPose pose;
+	float dx, dy, dh;
+	catmullRom(p0.x, p1.x, p2.x, p3.x, u, &pose.x, &dx);
+	catmullRom(p0.y, p1.y, p2.y, p3.y, u, &pose.y, &dy);
+	catmullRom(p0.height, p1.height, p2.height, p3.height, u, &pose.height, &dh);
+	pose.height = (pose.height < 0) ? 0 : pose.height;
+
+	//The camera looks down -Z before it's turned, and rotX turns it clockwise from above
+	pose.heading = atan2(dx, -dy) * 180 / (float)M_PI;
+	pose.heading += (pose.heading < 0) ? 360 : 0;
+	pose.pitch = 10 - atan2(dh, sqrt(dx * dx + dy * dy)) * 180 / (float)M_PI;
+	pose.pitch = (pose.pitch > flyThroughMaxPitch) ? flyThroughMaxPitch : (pose.pitch < -flyThroughMaxPitch) ? -flyThroughMaxPitch : pose.pitch;
+	return pose;
+}
+
+
+/*
+* Builds the combined projection and modelview matrix that the game would have for a fly-through pose (the same as gluPerspective() and rotateCamera() make), for benchmarks that cull without a window.
+* Returns nothing.
+*/
+void flyThroughMatrix(const FlyThroughPose &pose, float fieldOfView, float aspect, float out[16])
+{
+	float nearPlane = 0.2f;
+	float farPlane = 2000;
+	float f = 1 / tan(fieldOfView * (float)M_PI / 360);
+	float projection[16] = {
+		f / aspect, 0, 0, 0,
+		0, f, 0, 0,
+		0, 0, (farPlane + nearPlane) / (nearPlane - farPlane), -1,
+		0, 0, 2 * farPlane * nearPlane / (nearPlane - farPlane), 0
+	};
+
+	//Pitch after heading, then move the world so that the camera is at the origin
+	float cp = cos(pose.pitch * (float)M_PI / 180);
+	float sp = sin(pose.pitch * (float)M_PI / 180);
+	float ch = cos(pose.heading * (float)M_PI / 180);
+	float sh = sin(pose.heading * (float)M_PI / 180);
+	float rotation[16] = {
+		ch, sp * sh, -cp * sh, 0,
+		0, cp, sp, 0,
+		sh, -sp * ch, cp * ch, 0,
+		0, 0, 0, 1
+	};
+	float position[3] = {-pose.x, -pose.height, -pose.y};
+	for (int row = 0; row < 3; row++)
+	{
+		rotation[12 + row] = rotation[row] * position[0] + rotation[4 + row] * position[1] + rotation[8 + row] * position[2];
+	}
+
+	for (int col = 0; col < 4; col++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			out[col * 4 + row] = 0;
+			for (int k = 0; k < 4; k++)
+			{
+				out[col * 4 + row] += projection[k * 4 + row] * rotation[col * 4 + k];
+			}
+		}
+	}
+}
+
+
+/*
+* Starts timing a fly-through. The list of frame times is set aside now so that the frames themselves don't allocate.
+* Returns nothing.
+*/
+void beginFlyThroughReport(const StressScene &scene, float seconds)
+{
+	reportScene = scene;
+	reportSeconds = seconds;
+	reportFrameMs.clear();
+	reportFrameMs.reserve((size_t)(seconds * flyThroughMaxFps) + 1);
+	reportStart = 0;
+	reportLastFrame = 0;
+	reportFrames = 0;
+	reportObjects = 0;
+	reportTriangles = 0;
+}
+
+
+/*
+* Notes that a frame has gone out during a fly-through, with how many objects and triangles it drew, and prints the frame times once the fly-through is over.
+* Returns true once the fly-through is over.
+*/
+bool flyThroughFrame(int objects, long triangles)
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+	double frequency = SDL_GetPerformanceFrequency();
+
+	//The first frame only starts the clock
+	if (reportStart == 0)
+	{
+		reportStart = now;
+		reportLastFrame = now;
+		return false;
+	}
+
+	if (reportFrameMs.size() < reportFrameMs.capacity())
+	{
+		reportFrameMs.push_back((float)((now - reportLastFrame) * 1000 / frequency));
+	}
+	reportLastFrame = now;
+	reportFrames++;
+	reportObjects += objects;
+	reportTriangles += triangles;
+
+	if ((now - reportStart) / frequency < reportSeconds)
+	{
+		return false;
+	}
+
+	vector<float> sorted = reportFrameMs;
+	sort(sorted.begin(), sorted.end());
+	size_t count = sorted.size();
+	double total = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		total += sorted[i];
+	}
+	int sceneObjects = reportScene.buildings + reportScene.trees + reportScene.hills + reportScene.groundTiles;
+	printf("Fly-through: %d objects (%d buildings, %d trees, %d hills, %d ground tiles, seed %u), %d frames in %.1fs\n", sceneObjects, reportScene.buildings, reportScene.trees, reportScene.hills, reportScene.groundTiles, reportScene.seed, reportFrames, (now - reportStart) / frequency);
+	printf("Fly-through: %.2fms mean, %.2fms median, %.2fms 99th percentile, %.2fms worst, %.0f objects and %.0f triangles drawn a frame\n", total / count, sorted[count / 2], sorted[(size_t)(count * 0.99)], sorted[count - 1], reportObjects / reportFrames, reportTriangles / reportFrames);
+	return true;
+}
+
+
+/*
+* Gets how far through the fly-through we are.
+* Returns the number of seconds since its first frame.
+*/
+float flyThroughTime()
+{
+	if (reportStart == 0)
+	{
+		return 0;
+	}
+	return (float)((double)(SDL_GetPerformanceCounter() - reportStart) / SDL_GetPerformanceFrequency());
+}
@@ -0,0 +1,72 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef STRESS_H
+#define STRESS_H
+
+#include <list>
+#include <vector>
+
+#include "mesh.h"
+
+//A made up scene for finding out how things cope as the scene grows: the same models as the built in scenery, scattered from a seed so that every run (and every benchmark) gets exactly the same one
+//Buildings and hills get a cell each on a grid of ground tiles the same size as the streamed world's chunks, and trees go in between
+const float stressCellSize = 350.0f;
+
+//How many of each to place (from the command line). Nothing is placed unless at least one is asked for
+extern int stressBuildings;
+extern int stressTrees;
+extern int stressHills;
+
+//How long to fly the camera around the scene for before reporting the frame times and quitting (from the command line, 0 to drive around as normal)
+extern float flyThroughSeconds;
+
+//What ended up in a stress scene
+struct StressScene
+{
+	unsigned int seed;
+	int buildings;
+	int trees;
+	int hills;
+	int groundTiles;
+
+	//How far it reaches across, centred on the origin
+	float size;
+	float milliseconds;
+};
+
+//Where the camera is and which way it's looking, in the same terms as rotateCamera() (heading is rotX and pitch is rotY)
+struct FlyThroughPose
+{
+	float x;
+	float y;
+	float height;
+	float heading;
+	float pitch;
+};
+
+//A loop around a stress scene through points made from the same seed. Each point is reached at its time in seconds, so the camera moves at much the same speed all the way round
+struct FlyThroughPath
+{
+	std::vector<FlyThroughPose> points;
+	std::vector<float> times;
+	float seconds;
+};
+
+StressScene generateStressScene(std::list<GameObject> &objects, int buildings, int trees, int hills, unsigned int seed);
+FlyThroughPath makeFlyThrough(const StressScene &scene, float seconds);
+FlyThroughPose flyThroughAt(const FlyThroughPath &path, float seconds);
+void flyThroughMatrix(const FlyThroughPose &pose, float fieldOfView, float aspect, float out[16]);
+void beginFlyThroughReport(const StressScene &scene, float seconds);
+bool flyThroughFrame(int objects, long triangles);
+float flyThroughTime();
+
+#endif
@@ -0,0 +1,772 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "random.h"
+#include "terrain.h"
+#include "glstats.h"
+
+using namespace std;
+
+//Settings (from the command line)
+int terrainSize = 0;
+string heightmapFile = "";
+
+//Each level is centred on the car to the nearest two of its squares, so that the level inside it always lines up with its vertices
+static const int terrainHalfGrid = (terrainGridSize - 1) / 2;
+
+//Heights are kept as 16 bit steps from the ground up to terrainHeightRange
+static const float heightStep = terrainHeightRange / 65535.0f;
+
+//The generated terrain stays flat this far out from the origin (where the built in scenery is) and rises to its full height by the second distance
+static const float flatRadius = 200.0f;
+static const float hillRadius = 600.0f;
+
+static const Uint32 terrainLogInterval = 5000;
+
+//A terrain vertex, ready for glVertexPointer and glNormalPointer
+struct TerrainVertex
+{
+	GLfloat position[3];
+	GLbyte normal[4];
+};
+
+//One clipmap level. Vertices are kept a row at a time, from the level's origin (which is in units of the level's spacing)
+struct TerrainLevel
+{
+	int spacing;
+	int originX;
+	int originZ;
+	bool placed;
+
+	//Which triangle list to draw it with (where the hole for the level inside it is)
+	int hole;
+
+	vector<TerrainVertex> vertices;
+
+	//The vertices live in a buffer object if we've got them, and are sent again whenever the level moves
+	GLuint buffer;
+	bool dirty;
+};
+
+//The heightmap, and a smoothed copy at half the size for each coarser level. Texel 0 of every copy is at the same corner, which is a multiple of the coarsest spacing
+struct HeightmapMip
+{
+	int width;
+	int height;
+	vector<unsigned short> heights;
+};
+
+static vector<HeightmapMip> mips;
+static int heightmapX = 0;
+static int heightmapZ = 0;
+
+static TerrainLevel levels[terrainLevels];
+
+//The finest level is drawn whole. The rest leave a hole (half their width) for the level inside them, which can be one square either way of the middle
+static const int holeVariants = 9;
+static vector<GLushort> fullIndices;
+static vector<GLushort> holeIndices[holeVariants];
+static bool buffersMade = false;
+
+//Statistics for the current logging interval, and the last one
+static long logVertices = 0;
+static int logUpdates = 0;
+static Uint64 logUpdateTicks = 0;
+static Uint64 logWorstUpdate = 0;
+static size_t logUploadBytes = 0;
+static Uint32 lastLogTime = 0;
+static TerrainStats lastStats;
+
+
+/*
+* Halves a grid coordinate, rounding down for negative ones too.
+* Returns the halved coordinate.
+*/
+static int floorHalf(int value)
+{
+	return (value >= 0) ? value / 2 : -((1 - value) / 2);
+}
+
+
+/*
+* Looks up a height in one of the heightmap's copies, in that copy's texels from the world's origin. Anything off the edge gets the nearest edge texel.
+* Returns the height above the ground.
+*/
+static float sampleHeight(int mip, int gx, int gz)
+{
+	const HeightmapMip &m = mips[mip];
+	int tx = gx - heightmapX / (1 << mip);
+	int tz = gz - heightmapZ / (1 << mip);
+	tx = (tx < 0) ? 0 : (tx >= m.width) ? m.width - 1 : tx;
+	tz = (tz < 0) ? 0 : (tz >= m.height) ? m.height - 1 : tz;
+	return m.heights[(size_t)tz * m.width + tx] * heightStep;
+}
+
+
+/*
+* Works out the height of a vertex on the outside edge of a level from the next level out, so that the two meet without any cracks. Vertices that the coarser level has take its height, and the ones in between go halfway between their neighbours.
+* Returns the height above the ground.
+*/
+static float edgeHeight(int l, int gx, int gz)
+{
+	int x0 = floorHalf(gx);
+	int z0 = floorHalf(gz);
+	int x1 = x0 + (gx & 1);
+	int z1 = z0 + (gz & 1);
+	return 0.25f * (sampleHeight(l + 1, x0, z0) + sampleHeight(l + 1, x1, z0) + sampleHeight(l + 1, x0, z1) + sampleHeight(l + 1, x1, z1));
+}
+
+
+/*
+* Works out one of a level's vertices (its position and normal) from the heightmap.
+* Returns nothing.
+*/
+static void fillVertex(int l, int i, int j)
+{
+	TerrainLevel &level = levels[l];
+	int gx = level.originX + i;
+	int gz = level.originZ + j;
+
+	bool edge = (l < terrainLevels - 1) && (i == 0 || j == 0 || i == terrainGridSize - 1 || j == terrainGridSize - 1);
+	float h = edge ? edgeHeight(l, gx, gz) : sampleHeight(l, gx, gz);
+
+	//The normal comes from the slope across the neighbouring texels
+	float s = level.spacing;
+	float nx = (sampleHeight(l, gx - 1, gz) - sampleHeight(l, gx + 1, gz)) / (2 * s);
+	float nz = (sampleHeight(l, gx, gz - 1) - sampleHeight(l, gx, gz + 1)) / (2 * s);
+	float length = sqrt(nx * nx + 1 + nz * nz);
+
+	TerrainVertex &v = level.vertices[(size_t)j * terrainGridSize + i];
+	v.position[0] = gx * s;
+	v.position[1] = terrainGroundLevel + h;
+	v.position[2] = gz * s;
+	v.normal[0] = (GLbyte)lroundf(nx / length * 127);
+	v.normal[1] = (GLbyte)lroundf(1 / length * 127);
+	v.normal[2] = (GLbyte)lroundf(nz / length * 127);
+	v.normal[3] = 0;
+}
+
+
+/*
+* Works out every vertex along row j of a level.
+* Returns how many vertices were worked out, which is what moveLevel() adds up (a vertex that's in a row and a column it fills counts twice).
+*/
+static int fillRow(int l, int j)
+{
+	for (int i = 0; i < terrainGridSize; i++)
+	{
+		fillVertex(l, i, j);
+	}
+	return terrainGridSize;
+}
+
+
+/*
+* Works out every vertex down column i of a level.
+* Returns how many vertices were worked out, which is what moveLevel() adds up (a vertex that's in a row and a column it fills counts twice).
+*/
+static int fillColumn(int l, int i)
+{
+	for (int j = 0; j < terrainGridSize; j++)
+	{
+		fillVertex(l, i, j);
+	}
+	return terrainGridSize;
+}
+
+
+/*
+* Moves a level to a new origin. The vertices that are still in the level are shuffled across to where they belong, and only the rows and columns that are new (plus the old and new edges, whose heights are different) are worked out again.
+* Returns the number of vertices that were worked out.
+*/
+static int moveLevel(int l, int originX, int originZ)
+{
+	TerrainLevel &level = levels[l];
+	int dx = originX - level.originX;
+	int dz = originZ - level.originZ;
+	int n = terrainGridSize;
+	level.originX = originX;
+	level.originZ = originZ;
+
+	//If it's moved a long way (or it's the first time) there's nothing worth keeping
+	if (!level.placed || abs(dx) >= n || abs(dz) >= n)
+	{
+		level.placed = true;
+		level.dirty = true;
+		for (int j = 0; j < n; j++)
+		{
+			fillRow(l, j);
+		}
+		return n * n;
+	}
+	if (dx == 0 && dz == 0)
+	{
+		return 0;
+	}
+	level.dirty = true;
+
+	//Shuffle the rows (in whichever order doesn't overwrite rows we haven't moved yet), and the vertices along each one
+	int kept = n - abs(dx);
+	int from = (dx > 0) ? dx : 0;
+	int to = (dx < 0) ? -dx : 0;
+	for (int step = 0; step < n; step++)
+	{
+		int j = (dz > 0) ? step : n - 1 - step;
+		int source = j + dz;
+		if (source < 0 || source >= n)
+		{
+			continue;
+		}
+		memmove(&level.vertices[(size_t)j * n + to], &level.vertices[(size_t)source * n + from], kept * sizeof(TerrainVertex));
+	}
+
+	//Fill in what's new
+	int updated = 0;
+	for (int j = 0; j < n; j++)
+	{
+		if (j + dz < 0 || j + dz >= n)
+		{
+			updated += fillRow(l, j);
+		}
+	}
+	for (int i = 0; i < n; i++)
+	{
+		if (i + dx < 0 || i + dx >= n)
+		{
+			updated += fillColumn(l, i);
+		}
+	}
+
+	//The old edges were bent to meet the next level out, and aren't edges any more (unless they've gone altogether), and the new edges need bending
+	if (l < terrainLevels - 1)
+	{
+		int oldRows[2] = {-dz, n - 1 - dz};
+		int oldColumns[2] = {-dx, n - 1 - dx};
+		for (int k = 0; k < 2; k++)
+		{
+			if (oldRows[k] >= 0 && oldRows[k] < n)
+			{
+				updated += fillRow(l, oldRows[k]);
+			}
+			if (oldColumns[k] >= 0 && oldColumns[k] < n)
+			{
+				updated += fillColumn(l, oldColumns[k]);
+			}
+		}
+		updated += fillRow(l, 0) + fillRow(l, n - 1) + fillColumn(l, 0) + fillColumn(l, n - 1);
+	}
+	return updated;
+}
+
+
+/*
+* Adds the two triangles for one square of a level's grid, in the right order for glFrontFace(GL_CW) from above.
+* Returns nothing.
+*/
+static void addSquare(vector<GLushort> &indices, int i, int j)
+{
+	GLushort a = j * terrainGridSize + i;
+	GLushort b = a + 1;
+	GLushort c = a + terrainGridSize;
+	GLushort d = c + 1;
+	GLushort square[6] = {a, b, c, b, d, c};
+	indices.insert(indices.end(), square, square + 6);
+}
+
+
+/*
+* Builds the triangle lists that every level shares: the whole grid, and the grid with a hole in each of the places the next level in can be.
+* Returns nothing.
+*/
+static void buildIndices()
+{
+	int squares = terrainGridSize - 1;
+	fullIndices.clear();
+	for (int j = 0; j < squares; j++)
+	{
+		for (int i = 0; i < squares; i++)
+		{
+			addSquare(fullIndices, i, j);
+		}
+	}
+
+	for (int v = 0; v < holeVariants; v++)
+	{
+		int holeX = terrainHalfGrid / 2 - 1 + v / 3;
+		int holeZ = terrainHalfGrid / 2 - 1 + v % 3;
+		holeIndices[v].clear();
+		for (int j = 0; j < squares; j++)
+		{
+			for (int i = 0; i < squares; i++)
+			{
+				if (i < holeX || i >= holeX + terrainHalfGrid || j < holeZ || j >= holeZ + terrainHalfGrid)
+				{
+					addSquare(holeIndices[v], i, j);
+				}
+			}
+		}
+	}
+}
+
+
+/*
+* Makes the smaller copies of the heightmap for the coarser levels. Each texel is the texel at the same place in the copy before, smoothed with its neighbours so that distant terrain doesn't shimmer.
+* Returns nothing.
+*/
+static void buildMips()
+{
+	mips.resize(terrainLevels);
+	for (int m = 1; m < terrainLevels; m++)
+	{
+		const HeightmapMip &fine = mips[m - 1];
+		HeightmapMip &coarse = mips[m];
+		coarse.width = (fine.width + 1) / 2;
+		coarse.height = (fine.height + 1) / 2;
+		coarse.heights.resize((size_t)coarse.width * coarse.height);
+
+		const int weights[3] = {1, 2, 1};
+		for (int z = 0; z < coarse.height; z++)
+		{
+			for (int x = 0; x < coarse.width; x++)
+			{
+				unsigned int total = 0;
+				for (int b = 0; b < 3; b++)
+				{
+					int fz = 2 * z + b - 1;
+					fz = (fz < 0) ? 0 : (fz >= fine.height) ? fine.height - 1 : fz;
+					for (int a = 0; a < 3; a++)
+					{
+						int fx = 2 * x + a - 1;
+						fx = (fx < 0) ? 0 : (fx >= fine.width) ? fine.width - 1 : fx;
+						total += fine.heights[(size_t)fz * fine.width + fx] * weights[a] * weights[b];
+					}
+				}
+				coarse.heights[(size_t)z * coarse.width + x] = (total + 8) / 16;
+			}
+		}
+	}
+}
+
+
+/*
+* Sets up everything that's the same whichever heightmap we've got, once the full sized one is in mips[0]: the smaller copies, the levels and their triangle lists.
+* Returns nothing.
+*/
+static void finishHeightmap(Uint64 start)
+{
+	//Put the heightmap's middle at the origin, with its corner on a multiple of the coarsest spacing so that every copy lines up with its level's vertices
+	int coarsest = 1 << (terrainLevels - 1);
+	heightmapX = -((mips[0].width - 1) / 2 / coarsest) * coarsest;
+	heightmapZ = -((mips[0].height - 1) / 2 / coarsest) * coarsest;
+
+	buildMips();
+	buildIndices();
+	for (int l = 0; l < terrainLevels; l++)
+	{
+		levels[l].spacing = 1 << l;
+		levels[l].placed = false;
+		levels[l].dirty = true;
+		levels[l].hole = holeVariants / 2;
+		levels[l].vertices.resize((size_t)terrainGridSize * terrainGridSize);
+	}
+
+	TerrainStats stats = getTerrainStats();
+	printf("Terrain: %dx%d heightmap in %.1fMB (with its smaller copies), %d levels of %dx%d vertices in %.2fMB, ready in %.0fms\n", stats.width, stats.height, stats.heightmapBytes / 1048576.0f, terrainLevels, terrainGridSize, terrainGridSize, stats.levelBytes / 1048576.0f, (double)(SDL_GetPerformanceCounter() - start) * 1000 / SDL_GetPerformanceFrequency());
+}
+
+
+/*
+* Makes a heightmap of rolling hills with the diamond-square algorithm, flat around the origin so that the built in scenery still sits on it.
+* Returns true if it worked.
+*/
+bool generateTerrain(int size, unsigned int seed)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	//Diamond-square needs a power of two squares across
+	int squares = 1 << (terrainLevels - 1);
+	while (squares < size)
+	{
+		squares *= 2;
+	}
+	int n = squares + 1;
+	vector<float> heights((size_t)n * n, 0.0f);
+	unsigned int random = seed ? seed : 1;
+
+	float amplitude = 1.0f;
+	for (int step = squares; step > 1; step /= 2, amplitude *= 0.55f)
+	{
+		int half = step / 2;
+
+		//Diamonds: the middle of each square is the average of its corners, plus a bump
+		for (int z = half; z < n; z += step)
+		{
+			for (int x = half; x < n; x += step)
+			{
+				float corners = heights[(size_t)(z - half) * n + x - half] + heights[(size_t)(z - half) * n + x + half] + heights[(size_t)(z + half) * n + x - half] + heights[(size_t)(z + half) * n + x + half];
+				heights[(size_t)z * n + x] = corners / 4 + (nextRandom(&random) * 2 - 1) * amplitude;
+			}
+		}
+
+		//Squares: the middle of each edge is the average of the points around it
+		for (int z = 0; z < n; z += half)
+		{
+			for (int x = ((z / half) % 2 == 0) ? half : 0; x < n; x += step)
+			{
+				float total = 0;
+				int count = 0;
+				if (x >= half) { total += heights[(size_t)z * n + x - half]; count++; }
+				if (x + half < n) { total += heights[(size_t)z * n + x + half]; count++; }
+				if (z >= half) { total += heights[(size_t)(z - half) * n + x]; count++; }
+				if (z + half < n) { total += heights[(size_t)(z + half) * n + x]; count++; }
+				heights[(size_t)z * n + x] = total / count + (nextRandom(&random) * 2 - 1) * amplitude;
+			}
+		}
+	}
+
+	float lowest = heights[0];
+	float highest = heights[0];
+	for (size_t i = 0; i < heights.size(); i++)
+	{
+		lowest = (heights[i] < lowest) ? heights[i] : lowest;
+		highest = (heights[i] > highest) ? heights[i] : highest;
+	}
+	float range = (highest > lowest) ? highest - lowest : 1;
+
+	//Squash it down to 16 bits, flattening the middle
+	mips.assign(1, HeightmapMip());
+	mips[0].width = n;
+	mips[0].height = n;
+	mips[0].heights.resize((size_t)n * n);
+	for (int z = 0; z < n; z++)
+	{
+		for (int x = 0; x < n; x++)
+		{
+			float dx = x - squares / 2;
+			float dz = z - squares / 2;
+			float t = (sqrt(dx * dx + dz * dz) - flatRadius) / (hillRadius - flatRadius);
+			t = (t < 0) ? 0 : (t > 1) ? 1 : t;
+			float h = (heights[(size_t)z * n + x] - lowest) / range;
+			mips[0].heights[(size_t)z * n + x] = (unsigned short)lroundf(h * h * t * t * (3 - 2 * t) * 65535);
+		}
+	}
+
+	finishHeightmap(start);
+	return true;
+}
+
+
+/*
+* Skips the whitespace and comments between the numbers at the top of a PGM file.
+* Returns the next number, or -1 if there isn't one.
+*/
+static int readPGMNumber(FILE *file)
+{
+	int c = fgetc(file);
+	while (c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n')
+	{
+		if (c == '#')
+		{
+			while (c != '\n' && c != EOF)
+			{
+				c = fgetc(file);
+			}
+		}
+		c = fgetc(file);
+	}
+
+	int value = -1;
+	while (c >= '0' && c <= '9')
+	{
+		value = ((value < 0) ? 0 : value * 10) + (c - '0');
+		c = fgetc(file);
+	}
+	return value;
+}
+
+
+/*
+* Loads a heightmap from a binary (P5) PGM file, 8 or 16 bits a pixel, with a pixel every unit and white as terrainHeightRange above the ground.
+* Returns true if the file could be read.
+*/
+bool loadHeightmap(const string &fileName)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	FILE *file = fopen(fileName.c_str(), "rb");
+	if (file == NULL)
+	{
+		printf("Couldn't open heightmap %s\n", fileName.c_str());
+		return false;
+	}
+
+	char magic[2] = {0, 0};
+	int width = -1, height = -1, maxValue = -1;
+	if (fread(magic, 1, 2, file) == 2 && magic[0] == 'P' && magic[1] == '5')
+	{
+		width = readPGMNumber(file);
+		height = readPGMNumber(file);
+		maxValue = readPGMNumber(file);
+	}
+	if (width < 2 || height < 2 || maxValue <= 0 || maxValue > 65535)
+	{
+		printf("Heightmap %s isn't a binary PGM file\n", fileName.c_str());
+		fclose(file);
+		return false;
+	}
+
+	int bytesPerPixel = (maxValue > 255) ? 2 : 1;
+	vector<unsigned char> row((size_t)width * bytesPerPixel);
+	mips.assign(1, HeightmapMip());
+	mips[0].width = width;
+	mips[0].height = height;
+	mips[0].heights.resize((size_t)width * height);
+	for (int z = 0; z < height; z++)
+	{
+		if (fread(&row[0], 1, row.size(), file) != row.size())
+		{
+			printf("Heightmap %s is cut short\n", fileName.c_str());
+			fclose(file);
+			mips.clear();
+			return false;
+		}
+		for (int x = 0; x < width; x++)
+		{
+			//16 bit PGMs are big endian
+			unsigned int value = (bytesPerPixel == 2) ? (row[x * 2] << 8) | row[x * 2 + 1] : row[x];
+			mips[0].heights[(size_t)z * width + x] = (unsigned short)((value * 65535u) / maxValue);
+		}
+	}
+	fclose(file);
+
+	finishHeightmap(start);
+	return true;
+}
+
+
+/*
+* Checks whether there's any terrain to draw.
+* Returns true if there's a heightmap.
+*/
+bool terrainActive()
+{
+	return !mips.empty();
+}
+
+
+/*
+* Works out how far the terrain under a point is above the flat ground, blending between the heightmap's texels.
+* Returns the height, or 0 if there isn't any terrain.
+*/
+float terrainHeight(float x, float y)
+{
+	if (mips.empty())
+	{
+		return 0;
+	}
+	float fx = x - heightmapX;
+	float fz = y - heightmapZ;
+	int x0 = (int)floor(fx);
+	int z0 = (int)floor(fz);
+	float tx = fx - x0;
+	float tz = fz - z0;
+	x0 += heightmapX;
+	z0 += heightmapZ;
+	float top = sampleHeight(0, x0, z0) * (1 - tx) + sampleHeight(0, x0 + 1, z0) * tx;
+	float bottom = sampleHeight(0, x0, z0 + 1) * (1 - tx) + sampleHeight(0, x0 + 1, z0 + 1) * tx;
+	return top * (1 - tz) + bottom * tz;
+}
+
+
+/*
+* Moves the levels along with the car, working out only the vertices that have come into them. This doesn't need a GL context.
+* Returns nothing.
+*/
+void updateTerrain(float x, float y)
+{
+	if (mips.empty())
+	{
+		return;
+	}
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	for (int l = 0; l < terrainLevels; l++)
+	{
+		TerrainLevel &level = levels[l];
+		int centreX = 2 * (int)floor(x / (2 * level.spacing) + 0.5f);
+		int centreZ = 2 * (int)floor(y / (2 * level.spacing) + 0.5f);
+		logVertices += moveLevel(l, centreX - terrainHalfGrid, centreZ - terrainHalfGrid);
+
+		//Work out where the hole for the level inside goes (it's a square either side of the middle at most)
+		if (l > 0)
+		{
+			int holeX = levels[l - 1].originX / 2 - level.originX - (terrainHalfGrid / 2 - 1);
+			int holeZ = levels[l - 1].originZ / 2 - level.originZ - (terrainHalfGrid / 2 - 1);
+			holeX = (holeX < 0) ? 0 : (holeX > 2) ? 2 : holeX;
+			holeZ = (holeZ < 0) ? 0 : (holeZ > 2) ? 2 : holeZ;
+			level.hole = holeX * 3 + holeZ;
+		}
+	}
+
+	Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+	logUpdateTicks += elapsed;
+	logWorstUpdate = (elapsed > logWorstUpdate) ? elapsed : logWorstUpdate;
+	logUpdates++;
+
+	Uint32 now = SDL_GetTicks();
+	if (now - lastLogTime >= terrainLogInterval)
+	{
+		double frequency = SDL_GetPerformanceFrequency();
+		lastStats = getTerrainStats();
+		lastStats.verticesUpdated = logVertices;
+		lastStats.updateMs = logUpdates ? (float)(logUpdateTicks * 1000 / frequency / logUpdates) : 0;
+		lastStats.worstUpdateMs = (float)(logWorstUpdate * 1000 / frequency);
+		lastStats.uploadBytes = logUploadBytes;
+		if (lastLogTime != 0)
+		{
+			printf("Terrain: %ld vertices updated, %.3fms a frame (%.3fms at worst), %.1fKB sent to GL, %d triangles a frame\n", lastStats.verticesUpdated, lastStats.updateMs, lastStats.worstUpdateMs, lastStats.uploadBytes / 1024.0f, lastStats.triangles);
+		}
+		lastLogTime = now;
+		logVertices = 0;
+		logUpdates = 0;
+		logUpdateTicks = 0;
+		logWorstUpdate = 0;
+		logUploadBytes = 0;
+	}
+}
+
+
+/*
+* Draws the levels from the inside out, lit as they're drawn like the vehicle is. Must be called from the thread with the GL context, after updateTerrain().
+* Returns nothing.
+*/
+void renderTerrain()
+{
+	if (mips.empty() || !levels[0].placed)
+	{
+		return;
+	}
+
+	//Vertices go in buffer objects if we've got them, so that levels that haven't moved don't get sent again
+	if (!buffersMade)
+	{
+		if (GLEW_VERSION_1_5)
+		{
+			for (int l = 0; l < terrainLevels; l++)
+			{
+				glGenBuffers(1, &levels[l].buffer);
+				glBindBuffer(GL_ARRAY_BUFFER, levels[l].buffer);
+				glBufferData(GL_ARRAY_BUFFER, levels[l].vertices.size() * sizeof(TerrainVertex), NULL, GL_DYNAMIC_DRAW);
+				levels[l].dirty = true;
+			}
+		}
+		buffersMade = true;
+	}
+
+	glEnable(GL_COLOR_MATERIAL);
+	glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
+	glColor3ub(128, 128, 128);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+
+	for (int l = 0; l < terrainLevels; l++)
+	{
+		TerrainLevel &level = levels[l];
+		const char *base = (const char *)&level.vertices[0];
+		if (level.buffer != 0)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, level.buffer);
+			if (level.dirty)
+			{
+				glBufferSubData(GL_ARRAY_BUFFER, 0, level.vertices.size() * sizeof(TerrainVertex), &level.vertices[0]);
+				logUploadBytes += level.vertices.size() * sizeof(TerrainVertex);
+			}
+			base = NULL;
+		}
+		level.dirty = false;
+
+		glVertexPointer(3, GL_FLOAT, sizeof(TerrainVertex), base + offsetof(TerrainVertex, position));
+		glNormalPointer(GL_BYTE, sizeof(TerrainVertex), base + offsetof(TerrainVertex, normal));
+
+		const vector<GLushort> &indices = (l == 0) ? fullIndices : holeIndices[level.hole];
+		glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_SHORT, &indices[0]);
+	}
+
+	if (levels[0].buffer != 0)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+
+/*
+* Gets what the terrain takes up, and how updating and drawing it went over the last logging interval.
+* Returns the statistics.
+*/
+TerrainStats getTerrainStats()
+{
+	TerrainStats stats = lastStats;
+	stats.width = mips.empty() ? 0 : mips[0].width;
+	stats.height = mips.empty() ? 0 : mips[0].height;
+	stats.heightmapBytes = 0;
+	for (size_t m = 0; m < mips.size(); m++)
+	{
+		stats.heightmapBytes += mips[m].heights.capacity() * sizeof(unsigned short);
+	}
+	stats.levelBytes = fullIndices.capacity() * sizeof(GLushort);
+	for (int v = 0; v < holeVariants; v++)
+	{
+		stats.levelBytes += holeIndices[v].capacity() * sizeof(GLushort);
+	}
+	stats.triangles = fullIndices.size() / 3;
+	for (int l = 0; l < terrainLevels; l++)
+	{
+		stats.levelBytes += levels[l].vertices.capacity() * sizeof(TerrainVertex);
+		stats.triangles += (l > 0) ? holeIndices[levels[l].hole].size() / 3 : 0;
+	}
+	return stats;
+}
+
+
+/*
+* Frees the heightmap and the levels, and their buffers while we still have a GL context.
+* Returns nothing.
+*/
+void closeTerrain()
+{
+	for (int l = 0; l < terrainLevels; l++)
+	{
+		if (levels[l].buffer != 0)
+		{
+			glDeleteBuffers(1, &levels[l].buffer);
+			levels[l].buffer = 0;
+		}
+		vector<TerrainVertex>().swap(levels[l].vertices);
+		levels[l].placed = false;
+	}
+	buffersMade = false;
+	vector<HeightmapMip>().swap(mips);
+	vector<GLushort>().swap(fullIndices);
+	for (int v = 0; v < holeVariants; v++)
+	{
+		vector<GLushort>().swap(holeIndices[v]);
+	}
+}
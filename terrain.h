@@ -0,0 +1,63 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <stddef.h>
+#include <string>
+
+//Terrain drawn from a heightmap as nested square grids (clipmap levels) around the car, each twice the size and half the detail of the one inside it
+//Only the rows and columns that come into view as the car moves are worked out again, so the work each frame doesn't depend on how big the heightmap is
+
+//How many vertices there are along each side of each level (64 squares)
+const int terrainGridSize = 65;
+
+//How many levels there are. The first has a vertex every unit and the last one every 64, which reaches about 2000 units out to the far plane
+const int terrainLevels = 7;
+
+//How high the highest point of the heightmap is above the flat ground that the built in scenery sits on
+const float terrainHeightRange = 150.0f;
+const float terrainGroundLevel = -2.0f;
+
+//Where the heightmap comes from (from the command line): a generated one this many units across, or a PGM file with a pixel per unit
+extern int terrainSize;
+extern std::string heightmapFile;
+
+//What the terrain costs
+struct TerrainStats
+{
+	//The heightmap (including its smaller copies for the coarser levels), and the levels' vertices and the triangle lists they share
+	int width;
+	int height;
+	size_t heightmapBytes;
+	size_t levelBytes;
+
+	//Over the last logging interval
+	long verticesUpdated;
+	float updateMs;
+	float worstUpdateMs;
+	size_t uploadBytes;
+
+	//Triangles in a frame
+	int triangles;
+};
+
+bool generateTerrain(int size, unsigned int seed);
+bool loadHeightmap(const std::string &file);
+bool terrainActive();
+float terrainHeight(float x, float y);
+void updateTerrain(float x, float y);
+void renderTerrain();
+TerrainStats getTerrainStats();
+void closeTerrain();
+
+#endif
@@ -0,0 +1,149 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include "text.h"
+#include <stdio.h>
+#include "glstats.h"
+
+
+/*
+* Renders every glyph we can draw into a grid on one texture. Each glyph is rendered as a one character string, so that it sits on the baseline the same way it would in a whole line of text.
+* Returns true if the atlas is ready, and false otherwise.
+*/
+bool buildFontAtlas(TTF_Font *font, SDL_Colour colour, FontAtlas *atlas)
+{
+	SDL_Surface *glyphs[glyphCount];
+	atlas->cellWidth = 1;
+	atlas->cellHeight = 1;
+
+	for (int i = 0; i < glyphCount; i++)
+	{
+		char text[2] = {(char)(firstGlyph + i), 0};
+		glyphs[i] = TTF_RenderText_Blended(font, text, colour);
+		if (glyphs[i] == NULL)
+		{
+			//Some versions of SDL_ttf won't render a string with nothing visible in it (like a space), but it still takes up room
+			int w = 0;
+			TTF_SizeText(font, text, &w, NULL);
+			atlas->advance[i] = w;
+			continue;
+		}
+
+		atlas->advance[i] = glyphs[i]->w;
+		atlas->cellWidth = (glyphs[i]->w > atlas->cellWidth) ? glyphs[i]->w : atlas->cellWidth;
+		atlas->cellHeight = (glyphs[i]->h > atlas->cellHeight) ? glyphs[i]->h : atlas->cellHeight;
+	}
+
+	//Lay the glyphs out in a grid on a surface with the same pixel layout that SDL_ttf gives us (ARGB, which is BGRA in memory)
+	int rows = (glyphCount + atlasColumns - 1) / atlasColumns;
+	atlas->width = atlas->cellWidth * atlasColumns;
+	atlas->height = atlas->cellHeight * rows;
+	SDL_Surface *sheet = SDL_CreateRGBSurface(0, atlas->width, atlas->height, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+	if (sheet == NULL)
+	{
+		printf("Error whilst making a font atlas: %s\n", SDL_GetError());
+		for (int i = 0; i < glyphCount; i++)
+		{
+			SDL_FreeSurface(glyphs[i]);
+		}
+		return false;
+	}
+
+	for (int i = 0; i < glyphCount; i++)
+	{
+		if (glyphs[i] == NULL)
+		{
+			continue;
+		}
+
+		//Copy the glyph's alpha straight across instead of blending it onto the (empty) sheet
+		SDL_SetSurfaceBlendMode(glyphs[i], SDL_BLENDMODE_NONE);
+		SDL_Rect cell = {(i % atlasColumns) * atlas->cellWidth, (i / atlasColumns) * atlas->cellHeight, glyphs[i]->w, glyphs[i]->h};
+		SDL_BlitSurface(glyphs[i], NULL, sheet, &cell);
+		SDL_FreeSurface(glyphs[i]);
+	}
+
+	glGenTextures(1, &atlas->texture);
+	glBindTexture(GL_TEXTURE_2D, atlas->texture);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, sheet->pitch / 4);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas->width, atlas->height, 0, GL_BGRA, GL_UNSIGNED_BYTE, sheet->pixels);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	SDL_FreeSurface(sheet);
+
+	return true;
+}
+
+
+/*
+* Renders a given string from a font atlas at given coordinates, wrapping to a given width. Nothing is allocated, so this is cheap enough to call every frame.
+* Returns nothing.
+*/
+void renderText(const FontAtlas &atlas, float x, float y, int width, const char *text)
+{
+	glBindTexture(GL_TEXTURE_2D, atlas.texture);
+
+	float penX = x;
+	float penY = y;
+
+	glBegin(GL_QUADS);
+	for (const char *c = text; *c != 0; c++)
+	{
+		int glyph = *c - firstGlyph;
+
+		//Start a new line if we're asked to or if this glyph would go past the edge
+		if (*c == '\n' || (glyph >= 0 && glyph < glyphCount && penX + atlas.advance[glyph] > x + width && penX > x))
+		{
+			penX = x;
+			penY += atlas.cellHeight;
+		}
+		if (glyph < 0 || glyph >= glyphCount)
+		{
+			continue;
+		}
+
+		//Draw just the part of the cell that the glyph covers
+		float w = (float)atlas.advance[glyph];
+		float h = (float)atlas.cellHeight;
+		float u0 = (float)((glyph % atlasColumns) * atlas.cellWidth) / atlas.width;
+		float v0 = (float)((glyph / atlasColumns) * atlas.cellHeight) / atlas.height;
+		float u1 = u0 + w / atlas.width;
+		float v1 = v0 + h / atlas.height;
+
+		glTexCoord2f(u0, v0); glVertex3f(penX, penY, 1.0f);
+		glTexCoord2f(u1, v0); glVertex3f(penX + w, penY, 1.0f);
+		glTexCoord2f(u1, v1); glVertex3f(penX + w, penY + h, 1.0f);
+		glTexCoord2f(u0, v1); glVertex3f(penX, penY + h, 1.0f);
+
+		penX += w;
+	}
+	glEnd();
+
+	//Leave nothing bound, so that untextured drawing after us doesn't pick up our glyphs
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+
+/*
+* Frees a font atlas's texture.
+* Returns nothing.
+*/
+void freeFontAtlas(FontAtlas *atlas)
+{
+	if (atlas->texture != 0)
+	{
+		glDeleteTextures(1, &atlas->texture);
+		atlas->texture = 0;
+	}
+}
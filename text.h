@@ -0,0 +1,41 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+//The characters we can draw (printable ASCII)
+const int firstGlyph = 32;
+const int glyphCount = 95;
+const int atlasColumns = 16;
+
+//Every glyph in a font, rendered once into a grid on one texture so that drawing text doesn't have to make new surfaces and textures
+struct FontAtlas
+{
+	GLuint texture;
+	int width;
+	int height;
+
+	//Each glyph's cell is this big, and each glyph moves the pen along by its own advance
+	int cellWidth;
+	int cellHeight;
+	int advance[glyphCount];
+};
+
+bool buildFontAtlas(TTF_Font *font, SDL_Colour colour, FontAtlas *atlas);
+void renderText(const FontAtlas &atlas, float x, float y, int width, const char *text);
+void freeFontAtlas(FontAtlas *atlas);
+
+#endif
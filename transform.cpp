@@ -0,0 +1,330 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#include "transform.h"
+
+using namespace std;
+
+//A column major 4x4 matrix, the way GL wants it
+struct TransformMatrix
+{
+	float m[16];
+};
+
+//How a node hangs off the rest of the hierarchy. Children are kept in a list running through their siblings, so that one can be taken out without looking through the rest
+struct TransformLinks
+{
+	int parent;
+	int firstChild;
+	int previousSibling;
+	int nextSibling;
+	bool dirty;
+	bool used;
+};
+
+//Every node's links, local matrix and world matrix, each kept in one block and indexed by node
+static vector<TransformLinks> links;
+static vector<TransformMatrix> localMatrices;
+static vector<TransformMatrix> worldMatrices;
+
+//Nodes that have been destroyed and can be handed out again
+static vector<int> freeNodes;
+
+//Nodes that have been moved since the last update, and the stack for walking down from them
+static vector<int> dirtyNodes;
+static vector<int> walkStack;
+
+static int nodesInUse = 0;
+static TransformStats lastStats = {0, 0, 0, 0};
+
+static const TransformMatrix identityMatrix = {{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1}};
+
+
+/*
+* Marks a node as needing its world matrix (and its children's) worked out again.
+* Returns nothing.
+*/
+static void markDirty(int node)
+{
+	if (!links[node].dirty)
+	{
+		links[node].dirty = true;
+		dirtyNodes.push_back(node);
+	}
+}
+
+
+/*
+* Makes a new node, at its parent's origin until it's moved.
+* Returns the node.
+*/
+int createTransform(int parent)
+{
+	int node;
+	if (!freeNodes.empty())
+	{
+		node = freeNodes.back();
+		freeNodes.pop_back();
+	}
+	else
+	{
+		node = (int)links.size();
+		links.push_back(TransformLinks());
+		localMatrices.push_back(identityMatrix);
+		worldMatrices.push_back(identityMatrix);
+	}
+
+	TransformLinks &l = links[node];
+	l.parent = parent;
+	l.firstChild = transformNone;
+	l.previousSibling = transformNone;
+	l.nextSibling = transformNone;
+	l.dirty = false;
+	l.used = true;
+	localMatrices[node] = identityMatrix;
+
+	//Go on the front of the parent's list of children
+	if (parent != transformNone)
+	{
+		l.nextSibling = links[parent].firstChild;
+		if (l.nextSibling != transformNone)
+		{
+			links[l.nextSibling].previousSibling = node;
+		}
+		links[parent].firstChild = node;
+	}
+
+	nodesInUse++;
+	markDirty(node);
+	return node;
+}
+
+
+/*
+* Throws a node away. Anything still hanging off it is left where it is, but isn't under anything any more.
+* Returns nothing.
+*/
+void destroyTransform(int node)
+{
+	if (node == transformNone || !links[node].used)
+	{
+		return;
+	}
+	TransformLinks &l = links[node];
+
+	//Take it out of its parent's list of children
+	if (l.previousSibling != transformNone)
+	{
+		links[l.previousSibling].nextSibling = l.nextSibling;
+	}
+	else if (l.parent != transformNone)
+	{
+		links[l.parent].firstChild = l.nextSibling;
+	}
+	if (l.nextSibling != transformNone)
+	{
+		links[l.nextSibling].previousSibling = l.previousSibling;
+	}
+
+	//Its children keep their world matrices, which become their local ones
+	int child = l.firstChild;
+	while (child != transformNone)
+	{
+		int next = links[child].nextSibling;
+		links[child].parent = transformNone;
+		links[child].previousSibling = transformNone;
+		links[child].nextSibling = transformNone;
+		localMatrices[child] = worldMatrices[child];
+		child = next;
+	}
+
+	//If it's in the dirty list, updateTransforms() skips it once it sees it's not in use
+	l.used = false;
+	l.dirty = false;
+	l.firstChild = transformNone;
+	freeNodes.push_back(node);
+	nodesInUse--;
+}
+
+
+/*
+* Places a node relative to its parent, the same way renderObject() places an object: moved to x, y, z and turned yaw degrees around Y.
+* Returns nothing.
+*/
+void setTransform(int node, float x, float y, float z, float yaw)
+{
+	float c = cos(yaw * (float)M_PI / 180);
+	float s = sin(yaw * (float)M_PI / 180);
+	float *m = localMatrices[node].m;
+	m[0] = c;	m[4] = 0;	m[8] = s;	m[12] = x;
+	m[1] = 0;	m[5] = 1;	m[9] = 0;	m[13] = y;
+	m[2] = -s;	m[6] = 0;	m[10] = c;	m[14] = z;
+	m[3] = 0;	m[7] = 0;	m[11] = 0;	m[15] = 1;
+	markDirty(node);
+}
+
+
+/*
+* Places a node relative to its parent with a matrix of its own (for spinning parts and the like). The matrix mustn't project, so its bottom row is 0, 0, 0, 1.
+* Returns nothing.
+*/
+void setTransformMatrix(int node, const float local[16])
+{
+	memcpy(localMatrices[node].m, local, sizeof(TransformMatrix));
+	markDirty(node);
+}
+
+
+/*
+* Multiplies two matrices that don't project, which saves a quarter of the work.
+* Returns nothing.
+*/
+static void multiplyAffine(const float *a, const float *b, float *out)
+{
+	for (int col = 0; col < 4; col++)
+	{
+		for (int row = 0; row < 3; row++)
+		{
+			out[col * 4 + row] = a[row] * b[col * 4] + a[4 + row] * b[col * 4 + 1] + a[8 + row] * b[col * 4 + 2] + a[12 + row] * b[col * 4 + 3];
+		}
+		out[col * 4 + 3] = b[col * 4 + 3];
+	}
+}
+
+
+/*
+* Works out the world matrices of every node that's been moved and everything that hangs off them. Nothing else is touched.
+* Returns nothing.
+*/
+void updateTransforms()
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+	int dirty = (int)dirtyNodes.size();
+	int updated = 0;
+
+	for (size_t i = 0; i < dirtyNodes.size(); i++)
+	{
+		int node = dirtyNodes[i];
+
+		//If it's been destroyed, or a node above it has already been done (which takes it along too), there's nothing left to do
+		if (!links[node].used || !links[node].dirty)
+		{
+			continue;
+		}
+
+		//Start from the highest node above it that's also been moved, so that every parent is up to date before its children
+		for (int parent = links[node].parent; parent != transformNone; parent = links[parent].parent)
+		{
+			if (links[parent].dirty)
+			{
+				node = parent;
+			}
+		}
+
+		walkStack.push_back(node);
+		while (!walkStack.empty())
+		{
+			int n = walkStack.back();
+			walkStack.pop_back();
+
+			int parent = links[n].parent;
+			if (parent == transformNone)
+			{
+				worldMatrices[n] = localMatrices[n];
+			}
+			else
+			{
+				multiplyAffine(worldMatrices[parent].m, localMatrices[n].m, worldMatrices[n].m);
+			}
+			links[n].dirty = false;
+			updated++;
+
+			for (int child = links[n].firstChild; child != transformNone; child = links[child].nextSibling)
+			{
+				walkStack.push_back(child);
+			}
+		}
+	}
+	dirtyNodes.clear();
+
+	lastStats.nodes = nodesInUse;
+	lastStats.dirty = dirty;
+	lastStats.updated = updated;
+	lastStats.updateUs = (float)((double)(SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency());
+}
+
+
+/*
+* Gets a node's world matrix as of the last updateTransforms().
+* Returns the matrix (column major, ready for glMultMatrixf()).
+*/
+const float *getWorldMatrix(int node)
+{
+	return worldMatrices[node].m;
+}
+
+
+/*
+* Puts an object into the hierarchy under a parent, placed from its x, y and rz, so that it's drawn with a cached world matrix from then on.
+* Returns nothing.
+*/
+void attachTransform(GameObject *object, int parent)
+{
+	if (object->transform == transformNone)
+	{
+		object->transform = createTransform(parent);
+	}
+	setTransform(object->transform, object->x, 0, object->y, object->rz);
+}
+
+
+/*
+* Takes an object back out of the hierarchy.
+* Returns nothing.
+*/
+void detachTransform(GameObject *object)
+{
+	destroyTransform(object->transform);
+	object->transform = transformNone;
+}
+
+
+/*
+* Gets how big the hierarchy is and what the last update had to do.
+* Returns the statistics.
+*/
+TransformStats getTransformStats()
+{
+	TransformStats stats = lastStats;
+	stats.nodes = nodesInUse;
+	return stats;
+}
+
+
+/*
+* Throws the whole hierarchy away. Any objects that were in it need detaching (or forgetting) first.
+* Returns nothing.
+*/
+void closeTransforms()
+{
+	vector<TransformLinks>().swap(links);
+	vector<TransformMatrix>().swap(localMatrices);
+	vector<TransformMatrix>().swap(worldMatrices);
+	vector<int>().swap(freeNodes);
+	vector<int>().swap(dirtyNodes);
+	vector<int>().swap(walkStack);
+	nodesInUse = 0;
+}
@@ -0,0 +1,43 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "mesh.h"
+
+//A hierarchy of transforms, each placed relative to its parent, with every node's world matrix kept ready for glMultMatrixf()
+//Nodes that are moved are marked dirty, and only they and whatever hangs off them get their world matrices worked out again, so scenery that never moves costs nothing after the first frame
+
+//The parent of a node that isn't under anything
+const int transformNone = -1;
+
+//What the last updateTransforms() did
+struct TransformStats
+{
+	int nodes;
+	int dirty;
+	int updated;
+	float updateUs;
+};
+
+int createTransform(int parent);
+void destroyTransform(int node);
+void setTransform(int node, float x, float y, float z, float yaw);
+void setTransformMatrix(int node, const float local[16]);
+void updateTransforms();
+const float *getWorldMatrix(int node);
+void attachTransform(GameObject *object, int parent);
+void detachTransform(GameObject *object);
+TransformStats getTransformStats();
+void closeTransforms();
+
+#endif
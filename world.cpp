@@ -0,0 +1,558 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#include "world.h"
+#include "memory.h"
+#include "lighting.h"
+#include "transform.h"
+#include "random.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <map>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#ifdef __MINGW64__
+	#include <direct.h>
+#else
+	#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+//Settings (from the command line)
+int worldStreamRadius = 2;
+float worldMemoryBudget = 64.0f;
+
+//The stages a chunk goes through on its way into the scene and back out again
+enum ChunkState
+{
+	//Only the description from the scene file is in memory
+	CHUNK_UNLOADED,
+
+	//Waiting for (or being handled by) the loader thread
+	CHUNK_QUEUED,
+
+	//Its objects are in the scene
+	CHUNK_RESIDENT
+};
+
+//A square piece of the world
+struct WorldChunk
+{
+	//Which chunk this is (chunk 0, 0 has its corner at the world origin) and where its contents are described
+	int cx;
+	int cy;
+	string file;
+
+	ChunkState state;
+
+	//The chunk's objects (only filled in once it's been loaded)
+	vector<GameObject*> objects;
+};
+
+//The world, as described by the scene file
+static vector<WorldChunk> chunks;
+
+//Where the chunks' objects live. Chunks come and go all the time, so their objects get recycled instead of going back to the heap
+static ObjectPool<GameObject> objectPool(1024);
+static map<pair<int, int>, int> chunkLookup;
+static float chunkSize = 350.0f;
+static string worldDirectory;
+
+//The loader thread and the queues we pass chunk numbers back and forth on
+static thread loaderThread;
+static mutex loaderMutex;
+static condition_variable loaderCondition;
+static deque<int> loadRequests;
+static deque<int> loadedChunks;
+static bool loaderStopping = false;
+
+//Statistics for the current logging interval
+static Uint64 lastFrameTime = 0;
+static Uint64 lastLogTime = 0;
+static float averageFrameMs = 0;
+static float worstFrameMs = 0;
+static int hitches = 0;
+static int chunksLoaded = 0;
+static int chunksEvicted = 0;
+
+
+/*
+* Converts a performance counter duration to milliseconds.
+* Returns the duration in milliseconds.
+*/
+static float ticksToMs(Uint64 ticks)
+{
+	return (float)((double)ticks * 1000.0 / (double)SDL_GetPerformanceFrequency());
+}
+
+
+/*
+* Reads the objects out of a chunk file. Each line is a model file, a colour and a position/rotation: "tree.obj 60 128 60 10.5 -20 0".
+* Returns nothing.
+*/
+static void readChunk(string fileName, vector<GameObject*> &objects)
+{
+	FILE *chunkFile = fopen(fileName.c_str(), "r");
+	if (chunkFile == NULL)
+	{
+		printf("Couldn't open chunk %s\n", fileName.c_str());
+		return;
+	}
+
+	char line[512];
+	while (fgets(line, sizeof(line), chunkFile) != NULL)
+	{
+		char model[256];
+		int r = 0, g = 0, b = 0;
+		float x = 0, y = 0, rz = 0;
+
+		//Skip comments and blank lines
+		if (line[0] == '#' || sscanf(line, "%255s %d %d %d %f %f %f", model, &r, &g, &b, &x, &y, &rz) != 7)
+		{
+			continue;
+		}
+
+		SDL_Colour colour = {(Uint8)r, (Uint8)g, (Uint8)b, 255};
+		GameObject *object = objectPool.allocate();
+		*object = loadObj(model, colour, x, y, rz);
+		objects.push_back(object);
+	}
+
+	fclose(chunkFile);
+}
+
+
+/*
+* The loader thread. It reads chunk files (and any models they use that aren't loaded yet) in the background so that the main thread never has to wait on the disk.
+* Returns nothing.
+*/
+static void loaderLoop()
+{
+	while (true)
+	{
+		int index = -1;
+		{
+			unique_lock<mutex> lock(loaderMutex);
+			while (!loaderStopping && loadRequests.empty())
+			{
+				loaderCondition.wait(lock);
+			}
+			if (loaderStopping)
+			{
+				return;
+			}
+			index = loadRequests.front();
+			loadRequests.pop_front();
+		}
+
+		//The main thread leaves queued chunks alone, so we can fill this in without holding the lock
+		vector<GameObject*> objects;
+		readChunk(worldDirectory + chunks[index].file, objects);
+
+		//Bake the chunk's lighting while we're off the main thread anyway. Only the chunk's own objects shade each other, and the bake is kept next to the chunk file for next time
+		if (bakedLighting)
+		{
+			bakeLighting(objects, worldDirectory + chunks[index].file + ".lighting", false, NULL);
+		}
+		chunks[index].objects.swap(objects);
+
+		lock_guard<mutex> lock(loaderMutex);
+		loadedChunks.push_back(index);
+	}
+}
+
+
+/*
+* Reads a scene file, which lists the size of the chunks and the file that describes each one:
+*   chunksize 350
+*   chunk 0 0 chunk_0_0.txt
+* Chunk files are found relative to the scene file. Nothing gets loaded until updateWorldStreaming() decides the car is close enough.
+* Returns true if the scene file was read and false otherwise.
+*/
+bool loadWorld(string sceneFile)
+{
+	FILE *file = fopen(sceneFile.c_str(), "r");
+	if (file == NULL)
+	{
+		printf("Couldn't open scene %s\n", sceneFile.c_str());
+		return false;
+	}
+
+	//Chunk files live next to the scene file
+	size_t slash = sceneFile.find_last_of("/\\");
+	worldDirectory = (slash == string::npos) ? "" : sceneFile.substr(0, slash + 1);
+
+	char line[512];
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		char chunkFile[256];
+		int cx = 0, cy = 0;
+		float size = 0;
+
+		if (sscanf(line, "chunksize %f", &size) == 1 && size > 0)
+		{
+			chunkSize = size;
+		}
+		else if (sscanf(line, "chunk %d %d %255s", &cx, &cy, chunkFile) == 3)
+		{
+			WorldChunk chunk;
+			chunk.cx = cx;
+			chunk.cy = cy;
+			chunk.file = chunkFile;
+			chunk.state = CHUNK_UNLOADED;
+			chunkLookup[make_pair(cx, cy)] = chunks.size();
+			chunks.push_back(chunk);
+		}
+	}
+	fclose(file);
+
+	printf("World %s: %d chunks of %.0f units\n", sceneFile.c_str(), (int)chunks.size(), chunkSize);
+
+	loaderStopping = false;
+	loaderThread = thread(loaderLoop);
+
+	Uint64 now = SDL_GetPerformanceCounter();
+	lastFrameTime = now;
+	lastLogTime = now;
+
+	return !chunks.empty();
+}
+
+
+/*
+* Works out roughly how much memory a chunk's objects are taking up (not counting the meshes, which are shared).
+* Returns the size in bytes.
+*/
+static size_t chunkBytes(const WorldChunk &chunk)
+{
+	size_t bytes = chunk.objects.capacity() * sizeof(GameObject*) + chunk.objects.size() * sizeof(GameObject);
+	for (size_t i = 0; i < chunk.objects.size(); i++)
+	{
+		bytes += chunk.objects[i]->name.capacity() + chunk.objects[i]->bakedColours.capacity();
+	}
+	return bytes;
+}
+
+
+/*
+* Throws a chunk's objects away and lets go of their meshes.
+* Returns nothing.
+*/
+static void evictChunk(WorldChunk &chunk)
+{
+	for (size_t i = 0; i < chunk.objects.size(); i++)
+	{
+		releaseMesh(chunk.objects[i]->mesh);
+		detachTransform(chunk.objects[i]);
+		objectPool.free(chunk.objects[i]);
+	}
+	vector<GameObject*>().swap(chunk.objects);
+	chunk.state = CHUNK_UNLOADED;
+	chunksEvicted++;
+}
+
+
+/*
+* Asks for the chunks around the given position to be loaded, brings loaded chunks into the scene, and evicts far away chunks if we're over our memory budget. This should be called once a frame.
+* Returns true if the set of objects in the scene changed (so the draw list needs rebuilding) and false otherwise.
+*/
+bool updateWorldStreaming(float centreX, float centreY)
+{
+	bool changed = false;
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	//Keep an eye out for frames that take much longer than the ones around them
+	float frameMs = ticksToMs(start - lastFrameTime);
+	lastFrameTime = start;
+	if (averageFrameMs > 0 && frameMs > averageFrameMs * 2 && frameMs > 20)
+	{
+		hitches++;
+	}
+	averageFrameMs = (averageFrameMs == 0) ? frameMs : averageFrameMs * 0.95f + frameMs * 0.05f;
+	if (frameMs > worstFrameMs)
+	{
+		worstFrameMs = frameMs;
+	}
+
+	//Queue up the chunks around us, nearest first, so that the one we're in arrives before the ones at the edge
+	int centreChunkX = (int)floor(centreX / chunkSize);
+	int centreChunkY = (int)floor(centreY / chunkSize);
+	for (int ring = 0; ring <= worldStreamRadius; ring++)
+	{
+		for (int cy = centreChunkY - ring; cy <= centreChunkY + ring; cy++)
+		{
+			for (int cx = centreChunkX - ring; cx <= centreChunkX + ring; cx++)
+			{
+				//Only the outside of each ring, since we've done the inside already
+				if (abs(cx - centreChunkX) != ring && abs(cy - centreChunkY) != ring)
+				{
+					continue;
+				}
+
+				map<pair<int, int>, int>::iterator found = chunkLookup.find(make_pair(cx, cy));
+				if (found != chunkLookup.end() && chunks[found->second].state == CHUNK_UNLOADED)
+				{
+					chunks[found->second].state = CHUNK_QUEUED;
+					lock_guard<mutex> lock(loaderMutex);
+					loadRequests.push_back(found->second);
+					loaderCondition.notify_one();
+				}
+			}
+		}
+	}
+
+	//Pick up whatever the loader thread has finished. It's already read the models and baked the lighting, so all that's left is switching the objects on, which is cheap enough to do for a whole chunk at once
+	{
+		lock_guard<mutex> lock(loaderMutex);
+		while (!loadedChunks.empty())
+		{
+			WorldChunk &chunk = chunks[loadedChunks.front()];
+			loadedChunks.pop_front();
+			for (size_t i = 0; i < chunk.objects.size(); i++)
+			{
+				chunk.objects[i]->visible = true;
+				attachTransform(chunk.objects[i], transformNone);
+			}
+			chunk.state = CHUNK_RESIDENT;
+			chunksLoaded++;
+			changed = true;
+		}
+	}
+
+	//Work out how much memory we're using
+	size_t budget = (size_t)(worldMemoryBudget * 1024 * 1024);
+	size_t objectBytes = 0;
+	int residentChunks = 0;
+	int pendingChunks = 0;
+	size_t objectCount = 0;
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		if (chunks[i].state == CHUNK_RESIDENT)
+		{
+			objectBytes += chunkBytes(chunks[i]);
+			objectCount += chunks[i].objects.size();
+			residentChunks++;
+		}
+		else if (chunks[i].state == CHUNK_QUEUED)
+		{
+			pendingChunks++;
+		}
+	}
+	size_t meshTotal = trimMeshCache((size_t)-1);
+
+	//If we're over budget, throw away the furthest chunks that are out of range until we aren't
+	while (objectBytes + meshTotal > budget)
+	{
+		int furthest = -1;
+		int furthestDistance = worldStreamRadius;
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			if (chunks[i].state != CHUNK_RESIDENT)
+			{
+				continue;
+			}
+			int dx = abs(chunks[i].cx - centreChunkX);
+			int dy = abs(chunks[i].cy - centreChunkY);
+			int distance = (dx > dy) ? dx : dy;
+			if (distance > furthestDistance)
+			{
+				furthest = i;
+				furthestDistance = distance;
+			}
+		}
+		if (furthest == -1)
+		{
+			break;
+		}
+
+		objectBytes -= chunkBytes(chunks[furthest]);
+		objectCount -= chunks[furthest].objects.size();
+		residentChunks--;
+		evictChunk(chunks[furthest]);
+		changed = true;
+	}
+
+	//And then drop any meshes that nothing's using any more if we still need to
+	if (objectBytes + meshTotal > budget)
+	{
+		meshTotal = trimMeshCache(budget > objectBytes ? budget - objectBytes : 0);
+	}
+
+	//Report how we're going every few seconds
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (ticksToMs(now - lastLogTime) >= 5000)
+	{
+		printf("World: %d chunks resident, %d loading, %d objects, %.2fMB objects + %.2fMB meshes (budget %.1fMB)\n", residentChunks, pendingChunks, (int)objectCount, objectBytes / 1048576.0f, meshTotal / 1048576.0f, worldMemoryBudget);
+		printf("World: %d chunks loaded, %d evicted, %d hitches, worst frame %.1fms\n", chunksLoaded, chunksEvicted, hitches, worstFrameMs);
+		lastLogTime = now;
+		worstFrameMs = 0;
+		hitches = 0;
+		chunksLoaded = 0;
+		chunksEvicted = 0;
+	}
+
+	return changed;
+}
+
+
+/*
+* Adds every object that's been brought into the scene to a draw list.
+* Returns nothing.
+*/
+void addWorldObjects(vector<GameObject*> &drawList)
+{
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		if (chunks[i].state != CHUNK_RESIDENT)
+		{
+			continue;
+		}
+		for (size_t j = 0; j < chunks[i].objects.size(); j++)
+		{
+			drawList.push_back(chunks[i].objects[j]);
+		}
+	}
+}
+
+
+/*
+* Checks whether the world has finished streaming in everything it's been asked for. Objects get created while it hasn't, so the game isn't in a steady state.
+* Returns true if no chunks are waiting to be loaded.
+*/
+bool isWorldStreamingIdle()
+{
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		if (chunks[i].state == CHUNK_QUEUED)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+/*
+* Stops the loader thread and throws the world away.
+* Returns nothing.
+*/
+void closeWorld()
+{
+	if (loaderThread.joinable())
+	{
+		{
+			lock_guard<mutex> lock(loaderMutex);
+			loaderStopping = true;
+		}
+		loaderCondition.notify_all();
+		loaderThread.join();
+	}
+
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		if (chunks[i].state != CHUNK_UNLOADED)
+		{
+			evictChunk(chunks[i]);
+		}
+	}
+	chunks.clear();
+	chunkLookup.clear();
+	loadRequests.clear();
+	loadedChunks.clear();
+}
+
+
+/*
+* Writes out a square world, chunksAcross chunks on each side and centred on the origin, with a ground tile in every chunk and trees, buildings and hills scattered around.
+* Returns true if everything was written and false otherwise.
+*/
+bool generateWorld(string directory, int chunksAcross, unsigned int seed)
+{
+#ifdef __MINGW64__
+	_mkdir(directory.c_str());
+#else
+	mkdir(directory.c_str(), 0755);
+#endif
+
+	string sceneName = directory + pathSeparator + "world.scene";
+	FILE *scene = fopen(sceneName.c_str(), "w");
+	if (scene == NULL)
+	{
+		printf("Couldn't write %s\n", sceneName.c_str());
+		return false;
+	}
+
+	//The flat ground model (hill.obj, despite the name) is a little over 350 units across, so that's how big we make our chunks
+	fprintf(scene, "# Hover Drive world, %d x %d chunks, seed %u\n", chunksAcross, chunksAcross, seed);
+	fprintf(scene, "chunksize %.0f\n", 350.0f);
+
+	unsigned int state = seed ? seed : 1;
+	int objects = 0;
+	for (int cy = -chunksAcross / 2; cy < chunksAcross - chunksAcross / 2; cy++)
+	{
+		for (int cx = -chunksAcross / 2; cx < chunksAcross - chunksAcross / 2; cx++)
+		{
+			char chunkName[64];
+			sprintf(chunkName, "chunk_%d_%d.txt", cx, cy);
+			fprintf(scene, "chunk %d %d %s\n", cx, cy, chunkName);
+
+			FILE *chunk = fopen((directory + pathSeparator + chunkName).c_str(), "w");
+			if (chunk == NULL)
+			{
+				printf("Couldn't write %s\n", chunkName);
+				fclose(scene);
+				return false;
+			}
+
+			//The middle of the chunk
+			float x = (cx + 0.5f) * 350.0f;
+			float y = (cy + 0.5f) * 350.0f;
+
+			fprintf(chunk, "# model r g b x y rz\n");
+			fprintf(chunk, "hill.obj 128 128 128 %.1f %.1f 0\n", x, y);
+			objects++;
+
+			//The building and hill models sit off to one side of their origin, so shift them back into the middle of the chunk
+			if (nextRandom(&state) < 0.3f)
+			{
+				fprintf(chunk, "buildings.obj 128 128 128 %.1f %.1f 0\n", x + 192.0f, y - 23.0f);
+				objects++;
+			}
+			if (nextRandom(&state) < 0.15f)
+			{
+				fprintf(chunk, "ground.obj 128 128 128 %.1f %.1f 0\n", x - 266.0f, y - 15.0f);
+				objects++;
+			}
+
+			int trees = 10 + (int)(nextRandom(&state) * 40);
+			for (int i = 0; i < trees; i++)
+			{
+				float tx = x + (nextRandom(&state) - 0.5f) * 340.0f;
+				float ty = y + (nextRandom(&state) - 0.5f) * 340.0f;
+				fprintf(chunk, "tree.obj 60 128 60 %.1f %.1f %.0f\n", tx, ty, nextRandom(&state) * 360.0f);
+			}
+			objects += trees;
+
+			fclose(chunk);
+		}
+	}
+
+	fclose(scene);
+	printf("Wrote %s: %d chunks, %d objects\n", sceneName.c_str(), chunksAcross * chunksAcross, objects);
+
+	return true;
+}
@@ -0,0 +1,33 @@
+/*
+* A quick and dirty example "game" created for the November 2014 TasLUG
+* (Tasmanian Linux User Group) talk on creating a simple game from scratch
+* using SDL2 and OpenGL.
+*
+* Copyright Josh "Cheeseness" Bush 2014
+*
+* Licenced under Creative Commons: By Attribution 3.0
+* http://creativecommons.org/licenses/by/3.0/
+*/
+
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+
+//How many chunks out from the one the car is in we keep loaded (2 means a 5x5 block of chunks)
+extern int worldStreamRadius;
+
+//How much memory (in megabytes) the world's objects and meshes are allowed to use before we start throwing away chunks that are out of range
+extern float worldMemoryBudget;
+
+bool loadWorld(std::string sceneFile);
+bool updateWorldStreaming(float centreX, float centreY);
+void addWorldObjects(std::vector<GameObject*> &drawList);
+bool isWorldStreamingIdle();
+void closeWorld();
+bool generateWorld(std::string directory, int chunksAcross, unsigned int seed);
+
+#endif